@@ -76,6 +76,7 @@ struct CmdOptions
     int restartTimes;
     int downlimit;
     int uplimit;
+    bool memoryReport;
 };
 
 // we can't use csync_set_userdata because the SyncEngine sets it already.
@@ -185,6 +186,7 @@ void help()
     std::cout << "  --max-sync-retries [n] Retries maximum n times (default to 3)" << std::endl;
     std::cout << "  --uplimit [n]          Limit the upload speed of files to n KB/s" << std::endl;
     std::cout << "  --downlimit [n]        Limit the download speed of files to n KB/s" << std::endl;
+    std::cout << "  --memory-report        Print object counts and memory use after each sync phase" << std::endl;
     std::cout << "  -h                     Sync hidden files, do not ignore them" << std::endl;
     std::cout << "  --version, -v          Display version and exit" << std::endl;
     std::cout << "  --logdebug             More verbose logging" << std::endl;
@@ -265,6 +267,8 @@ void parseOptions(const QStringList &app_args, CmdOptions *options)
             options->uplimit = it.next().toInt() * 1000;
         } else if (option == "--downlimit" && !it.peekNext().startsWith("-")) {
             options->downlimit = it.next().toInt() * 1000;
+        } else if (option == "--memory-report") {
+            options->memoryReport = true;
         } else if (option == "--logdebug") {
             Logger::instance()->setLogFile("-");
             Logger::instance()->setLogDebug(true);
@@ -324,6 +328,7 @@ int main(int argc, char **argv)
     options.restartTimes = 3;
     options.uplimit = 0;
     options.downlimit = 0;
+    options.memoryReport = false;
 
     parseOptions(app.arguments(), &options);
 
@@ -512,6 +517,11 @@ restart_sync:
     QObject::connect(&engine, &SyncEngine::finished,
         [&app](bool result) { app.exit(result ? EXIT_SUCCESS : EXIT_FAILURE); });
     QObject::connect(&engine, &SyncEngine::transmissionProgress, &cmd, &Cmd::transmissionProgressSlot);
+    if (options.memoryReport) {
+        QObject::connect(&engine, &SyncEngine::memoryUsage, [](const QString &phase, const QString &usage) {
+            std::cout << "Memory after " << qPrintable(phase) << ": " << qPrintable(usage) << std::endl;
+        });
+    }
 
 
     // Exclude lists
@@ -19,6 +19,8 @@
 #include "filesystembase.h"
 #include "common/checksums.h"
 
+#include <QCryptographicHash>
+#include <QFile>
 #include <QLoggingCategory>
 #include <qtconcurrentrun.h>
 
@@ -215,6 +217,50 @@ void ComputeChecksum::slotCalculationDone()
 }
 
 
+ComputeBlockHashes::ComputeBlockHashes(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ComputeBlockHashes::start(const QString &filePath, qint64 blockSize)
+{
+    qCInfo(lcChecksums) << "Computing block hashes of" << filePath << "in a thread";
+
+    connect(&_watcher, &QFutureWatcherBase::finished,
+        this, &ComputeBlockHashes::slotCalculationDone,
+        Qt::UniqueConnection);
+    _watcher.setFuture(QtConcurrent::run(ComputeBlockHashes::computeNow, filePath, blockSize));
+}
+
+QByteArray ComputeBlockHashes::computeNow(const QString &filePath, qint64 blockSize)
+{
+    QFile file(filePath);
+    if (blockSize <= 0 || !file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QByteArray result;
+    result.reserve(static_cast<int>((file.size() / blockSize + 1) * hashSize));
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray block;
+    while (!file.atEnd()) {
+        block = file.read(blockSize);
+        if (block.isEmpty()) {
+            qCWarning(lcChecksums) << "Error reading" << filePath << file.errorString();
+            return QByteArray();
+        }
+        hash.reset();
+        hash.addData(block);
+        result.append(hash.result());
+    }
+    return result;
+}
+
+void ComputeBlockHashes::slotCalculationDone()
+{
+    emit done(_watcher.future().result());
+}
+
 ValidateChecksumHeader::ValidateChecksumHeader(QObject *parent)
     : QObject(parent)
 {
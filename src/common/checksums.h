@@ -104,6 +104,47 @@ private:
     QFutureWatcher<QByteArray> _watcher;
 };
 
+/**
+ * Computes the hashes of the fixed size blocks of a file.
+ *
+ * The result is the concatenation of the raw SHA1 digests of each block,
+ * in file order. It's used to find the parts of a modified file that
+ * actually need to be uploaded, see SyncJournalDb::BlockManifest.
+ * \ingroup libsync
+ */
+class OCSYNC_EXPORT ComputeBlockHashes : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ComputeBlockHashes(QObject *parent = nullptr);
+
+    /// Size of one digest in the result
+    static const int hashSize = 20;
+
+    /**
+     * Computes the block hashes for the given file path in a thread.
+     *
+     * done() is emitted when the calculation finishes.
+     */
+    void start(const QString &filePath, qint64 blockSize);
+
+    /**
+     * Computes the block hashes synchronously.
+     *
+     * Returns a null QByteArray if the file can't be read.
+     */
+    static QByteArray computeNow(const QString &filePath, qint64 blockSize);
+
+signals:
+    void done(const QByteArray &blockHashes);
+
+private slots:
+    void slotCalculationDone();
+
+private:
+    QFutureWatcher<QByteArray> _watcher;
+};
+
 /**
  * Checks whether a file's checksum matches the expected value.
  * @ingroup libsync
@@ -0,0 +1,88 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "memorycounters.h"
+
+#include <QStringList>
+
+#include <atomic>
+
+namespace OCC {
+
+namespace {
+    std::atomic<qint64> currentValues[MemoryCounters::CounterCount];
+    std::atomic<qint64> highWaterValues[MemoryCounters::CounterCount];
+}
+
+void MemoryCounters::add(Counter counter, qint64 delta)
+{
+    const qint64 value = currentValues[counter].fetch_add(delta, std::memory_order_relaxed) + delta;
+    qint64 peak = highWaterValues[counter].load(std::memory_order_relaxed);
+    while (value > peak && !highWaterValues[counter].compare_exchange_weak(peak, value, std::memory_order_relaxed)) {
+    }
+}
+
+qint64 MemoryCounters::current(Counter counter)
+{
+    return currentValues[counter].load(std::memory_order_relaxed);
+}
+
+qint64 MemoryCounters::highWater(Counter counter)
+{
+    return highWaterValues[counter].load(std::memory_order_relaxed);
+}
+
+void MemoryCounters::resetHighWater()
+{
+    for (int i = 0; i < CounterCount; ++i)
+        highWaterValues[i].store(currentValues[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+const char *MemoryCounters::name(Counter counter)
+{
+    switch (counter) {
+    case FileStats:
+        return "fileStats";
+    case SyncFileItems:
+        return "syncFileItems";
+    case PropagatorJobs:
+        return "propagatorJobs";
+    case NetworkJobs:
+        return "networkJobs";
+    case UploadBufferBytes:
+        return "uploadBufferBytes";
+    case DownloadBufferBytes:
+        return "downloadBufferBytes";
+    case CounterCount:
+        break;
+    }
+    return "unknown";
+}
+
+QString MemoryCounters::toString()
+{
+    QStringList parts;
+    for (int i = 0; i < CounterCount; ++i) {
+        const auto counter = static_cast<Counter>(i);
+        parts.append(QStringLiteral("%1=%2 (peak %3)")
+                         .arg(QLatin1String(name(counter)))
+                         .arg(current(counter))
+                         .arg(highWater(counter)));
+    }
+    return parts.join(QStringLiteral(", "));
+}
+}
@@ -0,0 +1,94 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QString>
+
+namespace OCC {
+
+/**
+ * @brief Process wide counters of live sync objects and buffered bytes
+ *
+ * The counters are always compiled in. Updating one is a relaxed atomic
+ * addition plus a high-water mark check, cheap enough for objects that
+ * exist millions of times during the sync of a large folder.
+ *
+ * The SyncEngine logs them at the end of each sync phase together with
+ * the high-water mark reached during that phase.
+ */
+namespace MemoryCounters {
+
+    enum Counter {
+        FileStats, // csync_file_stat_t in the discovery trees
+        SyncFileItems,
+        PropagatorJobs,
+        NetworkJobs,
+        UploadBufferBytes,
+        DownloadBufferBytes,
+        CounterCount
+    };
+
+    OCSYNC_EXPORT void add(Counter counter, qint64 delta);
+
+    OCSYNC_EXPORT qint64 current(Counter counter);
+
+    /** The highest value since the last resetHighWater(). */
+    OCSYNC_EXPORT qint64 highWater(Counter counter);
+
+    /** Starts a new high-water period, for example for the next sync phase. */
+    OCSYNC_EXPORT void resetHighWater();
+
+    OCSYNC_EXPORT const char *name(Counter counter);
+
+    /** All counters as "name=current (peak highWater)". */
+    OCSYNC_EXPORT QString toString();
+
+    /** Counts the live instances of the class it is a member of. */
+    template <Counter C>
+    class Instance
+    {
+    public:
+        Instance() { add(C, 1); }
+        Instance(const Instance &) { add(C, 1); }
+        Instance &operator=(const Instance &) { return *this; }
+        ~Instance() { add(C, -1); }
+    };
+
+    /** Counts the bytes of a buffer held by the object it is a member of. */
+    template <Counter C>
+    class Bytes
+    {
+    public:
+        Bytes() = default;
+        Bytes(const Bytes &) = delete;
+        Bytes &operator=(const Bytes &) = delete;
+        ~Bytes() { set(0); }
+
+        void set(qint64 bytes)
+        {
+            add(C, bytes - _bytes);
+            _bytes = bytes;
+        }
+
+    private:
+        qint64 _bytes = 0;
+    };
+}
+}
@@ -412,6 +412,7 @@ bool SyncJournalDb::checkConnect()
                         "size INTEGER(8),"
                         "modtime INTEGER(8),"
                         "contentChecksum TEXT,"
+                        "isDelta INTEGER,"
                         "PRIMARY KEY(path)"
                         ");");
 
@@ -419,6 +420,18 @@ bool SyncJournalDb::checkConnect()
         return sqlFail("Create table uploadinfo", createQuery);
     }
 
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS blockmanifest("
+                        "path TEXT PRIMARY KEY,"
+                        "etag TEXT,"
+                        "size INTEGER(8),"
+                        "blocksize INTEGER(8),"
+                        "hashes BLOB"
+                        ");");
+
+    if (!createQuery.exec()) {
+        return sqlFail("Create table blockmanifest", createQuery);
+    }
+
     // create the blacklist table.
     createQuery.prepare("CREATE TABLE IF NOT EXISTS blacklist ("
                         "path VARCHAR(4096),"
@@ -479,6 +492,23 @@ bool SyncJournalDb::checkConnect()
         return sqlFail("Create table conflicts", createQuery);
     }
 
+    // create the tables for the propagation plan of an unfinished sync.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS syncplanheader("
+                        "header BLOB"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail("Create table syncplanheader", createQuery);
+    }
+
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS syncplan("
+                        "id INTEGER PRIMARY KEY,"
+                        "item BLOB,"
+                        "done INTEGER"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail("Create table syncplan", createQuery);
+    }
+
     createQuery.prepare("CREATE TABLE IF NOT EXISTS version("
                         "major INTEGER(8),"
                         "minor INTEGER(8),"
@@ -568,6 +598,10 @@ bool SyncJournalDb::checkConnect()
         return sqlFail("prepare _deleteUploadInfoQuery", _deleteUploadInfoQuery);
     }
 
+    if (!_deleteBlockManifestQuery.initOrReset("DELETE FROM blockmanifest WHERE path=?1", _db)) {
+        return sqlFail("prepare _deleteBlockManifestQuery", _deleteBlockManifestQuery);
+    }
+
     QByteArray sql("SELECT lastTryEtag, lastTryModtime, retrycount, errorstring, lastTryTime, ignoreDuration, renameTarget, errorCategory "
                    "FROM blacklist WHERE path=?1");
     if (Utility::fsCasePreserving()) {
@@ -741,6 +775,16 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal("update database structure: add contentChecksum col for uploadinfo");
     }
 
+    if (!tableColumns("uploadinfo").contains("isDelta")) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE uploadinfo ADD COLUMN isDelta INTEGER;");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: add isDelta column", query);
+            re = false;
+        }
+        commitInternal("update database structure: add isDelta col for uploadinfo");
+    }
+
     if (true) {
         SqlQuery query(_db);
         query.prepare("CREATE INDEX IF NOT EXISTS metadata_e2e_id ON metadata(e2eMangledName);");
@@ -1187,6 +1231,13 @@ bool SyncJournalDb::postSyncCleanup(const QSet<QString> &filepathsToKeep,
         }
     }
 
+    // Manifests are only useful for files that are still known
+    SqlQuery manifestQuery(_db);
+    manifestQuery.prepare("DELETE FROM blockmanifest WHERE path NOT IN (SELECT path FROM metadata)");
+    if (!manifestQuery.exec()) {
+        return false;
+    }
+
     // Incorporate results back into main DB
     walCheckpoint();
 
@@ -1439,7 +1490,7 @@ SyncJournalDb::UploadInfo SyncJournalDb::getUploadInfo(const QString &file)
 
     if (checkConnect()) {
         if (!_getUploadInfoQuery.initOrReset(QByteArrayLiteral(
-                "SELECT chunk, transferid, errorcount, size, modtime, contentChecksum FROM "
+                "SELECT chunk, transferid, errorcount, size, modtime, contentChecksum, isDelta FROM "
                 "uploadinfo WHERE path=?1"), _db)) {
             return res;
         }
@@ -1457,6 +1508,7 @@ SyncJournalDb::UploadInfo SyncJournalDb::getUploadInfo(const QString &file)
             res._size = _getUploadInfoQuery.int64Value(3);
             res._modtime = _getUploadInfoQuery.int64Value(4);
             res._contentChecksum = _getUploadInfoQuery.baValue(5);
+            res._isDelta = _getUploadInfoQuery.intValue(6) != 0;
             res._valid = ok;
         }
     }
@@ -1474,8 +1526,8 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
     if (i._valid) {
         if (!_setUploadInfoQuery.initOrReset(QByteArrayLiteral(
             "INSERT OR REPLACE INTO uploadinfo "
-            "(path, chunk, transferid, errorcount, size, modtime, contentChecksum) "
-            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 )"), _db)) {
+            "(path, chunk, transferid, errorcount, size, modtime, contentChecksum, isDelta) "
+            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 , ?8 )"), _db)) {
             return;
         }
 
@@ -1486,6 +1538,7 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
         _setUploadInfoQuery.bindValue(5, i._size);
         _setUploadInfoQuery.bindValue(6, i._modtime);
         _setUploadInfoQuery.bindValue(7, i._contentChecksum);
+        _setUploadInfoQuery.bindValue(8, i._isDelta ? 1 : 0);
 
         if (!_setUploadInfoQuery.exec()) {
             return;
@@ -1500,34 +1553,61 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
     }
 }
 
-QVector<uint> SyncJournalDb::deleteStaleUploadInfos(const QSet<QString> &keep)
+SyncJournalDb::BlockManifest SyncJournalDb::getBlockManifest(const QString &file)
 {
     QMutexLocker locker(&_mutex);
-    QVector<uint> ids;
 
-    if (!checkConnect()) {
-        return ids;
-    }
+    BlockManifest res;
 
-    SqlQuery query(_db);
-    query.prepare("SELECT path,transferid FROM uploadinfo");
+    if (checkConnect()) {
+        if (!_getBlockManifestQuery.initOrReset(QByteArrayLiteral(
+                "SELECT etag, size, blocksize, hashes FROM blockmanifest WHERE path=?1"), _db)) {
+            return res;
+        }
+        _getBlockManifestQuery.bindValue(1, file);
 
-    if (!query.exec()) {
-        return ids;
+        if (!_getBlockManifestQuery.exec()) {
+            return res;
+        }
+
+        if (_getBlockManifestQuery.next()) {
+            res._etag = _getBlockManifestQuery.baValue(0);
+            res._size = _getBlockManifestQuery.int64Value(1);
+            res._blockSize = _getBlockManifestQuery.int64Value(2);
+            res._blockHashes = _getBlockManifestQuery.baValue(3);
+            res._valid = true;
+        }
     }
+    return res;
+}
 
-    QStringList superfluousPaths;
+void SyncJournalDb::setBlockManifest(const QString &file, const BlockManifest &manifest)
+{
+    QMutexLocker locker(&_mutex);
 
-    while (query.next()) {
-        const QString file = query.stringValue(0);
-        if (!keep.contains(file)) {
-            superfluousPaths.append(file);
-            ids.append(query.intValue(1));
-        }
+    if (!checkConnect()) {
+        return;
     }
 
-    deleteBatch(_deleteUploadInfoQuery, superfluousPaths, "uploadinfo");
-    return ids;
+    if (manifest._valid) {
+        if (!_setBlockManifestQuery.initOrReset(QByteArrayLiteral(
+            "INSERT OR REPLACE INTO blockmanifest "
+            "(path, etag, size, blocksize, hashes) "
+            "VALUES ( ?1 , ?2, ?3 , ?4 , ?5 )"), _db)) {
+            return;
+        }
+
+        _setBlockManifestQuery.bindValue(1, file);
+        _setBlockManifestQuery.bindValue(2, manifest._etag);
+        _setBlockManifestQuery.bindValue(3, manifest._size);
+        _setBlockManifestQuery.bindValue(4, manifest._blockSize);
+        _setBlockManifestQuery.bindValue(5, manifest._blockHashes);
+        _setBlockManifestQuery.exec();
+    } else {
+        _deleteBlockManifestQuery.reset_and_clear_bindings();
+        _deleteBlockManifestQuery.bindValue(1, file);
+        _deleteBlockManifestQuery.exec();
+    }
 }
 
 SyncJournalErrorBlacklistRecord SyncJournalDb::errorBlacklistEntry(const QString &file)
@@ -1562,33 +1642,91 @@ SyncJournalErrorBlacklistRecord SyncJournalDb::errorBlacklistEntry(const QString
     return entry;
 }
 
-bool SyncJournalDb::deleteStaleErrorBlacklistEntries(const QSet<QString> &keep)
+SyncJournalDb::StaleEntries SyncJournalDb::deleteStaleEntries(const StaleEntryKeepList &keep)
 {
     QMutexLocker locker(&_mutex);
+    StaleEntries stale;
 
     if (!checkConnect()) {
-        return false;
+        return stale;
     }
 
-    SqlQuery query(_db);
-    query.prepare("SELECT path FROM blacklist");
+    // The kinds of paths in the stale_keep table
+    enum { KeepDownloadInfo = 0, KeepUploadInfo = 1, KeepErrorBlacklist = 2 };
 
+    SqlQuery query(_db);
+    query.prepare("CREATE TEMP TABLE IF NOT EXISTS stale_keep("
+                  "kind INTEGER,"
+                  "path TEXT,"
+                  "PRIMARY KEY(kind, path)"
+                  ") WITHOUT ROWID;");
     if (!query.exec()) {
-        return false;
+        qCWarning(lcDb) << "Could not create the stale_keep table" << query.error();
+        return stale;
+    }
+    auto fillKeepTable = [this](int kind, const QStringList &paths) {
+        SqlQuery insertQuery(_db);
+        insertQuery.prepare("INSERT OR IGNORE INTO stale_keep (kind, path) VALUES (?1, ?2);");
+        for (const auto &path : paths) {
+            insertQuery.reset_and_clear_bindings();
+            insertQuery.bindValue(1, kind);
+            insertQuery.bindValue(2, path);
+            if (!insertQuery.exec()) {
+                qCWarning(lcDb) << "Could not fill the stale_keep table" << insertQuery.error();
+                return false;
+            }
+        }
+        return true;
+    };
+    query.prepare("DELETE FROM stale_keep;");
+    if (!query.exec()
+        || !fillKeepTable(KeepDownloadInfo, keep.downloadInfos)
+        || !fillKeepTable(KeepUploadInfo, keep.uploadInfos)
+        || !fillKeepTable(KeepErrorBlacklist, keep.errorBlacklist)) {
+        return stale;
     }
 
-    QStringList superfluousPaths;
-
-    while (query.next()) {
-        const QString file = query.stringValue(0);
-        if (!keep.contains(file)) {
-            superfluousPaths.append(file);
+    // The selected values *must* match the ones expected by toDownloadInfo().
+    query.prepare("SELECT tmpfile, etag, errorcount, path FROM downloadinfo "
+                  "WHERE path NOT IN (SELECT path FROM stale_keep WHERE kind=?1);");
+    query.bindValue(1, int(KeepDownloadInfo));
+    if (query.exec()) {
+        QVector<DownloadInfo> infos;
+        while (query.next()) {
+            DownloadInfo info;
+            toDownloadInfo(query, &info);
+            infos.append(info);
         }
+        query.prepare("DELETE FROM downloadinfo WHERE path NOT IN (SELECT path FROM stale_keep WHERE kind=?1);");
+        query.bindValue(1, int(KeepDownloadInfo));
+        if (query.exec())
+            stale.downloadInfos = infos;
+    }
+
+    query.prepare("SELECT transferid FROM uploadinfo "
+                  "WHERE path NOT IN (SELECT path FROM stale_keep WHERE kind=?1);");
+    query.bindValue(1, int(KeepUploadInfo));
+    if (query.exec()) {
+        QVector<uint> ids;
+        while (query.next())
+            ids.append(query.intValue(0));
+        query.prepare("DELETE FROM uploadinfo WHERE path NOT IN (SELECT path FROM stale_keep WHERE kind=?1);");
+        query.bindValue(1, int(KeepUploadInfo));
+        if (query.exec())
+            stale.uploadTransferIds = ids;
     }
 
-    SqlQuery delQuery(_db);
-    delQuery.prepare("DELETE FROM blacklist WHERE path = ?");
-    return deleteBatch(delQuery, superfluousPaths, "blacklist");
+    query.prepare("DELETE FROM blacklist WHERE path NOT IN (SELECT path FROM stale_keep WHERE kind=?1);");
+    query.bindValue(1, int(KeepErrorBlacklist));
+    query.exec();
+    const auto blacklistDeleted = query.numRowsAffected();
+
+    query.prepare("DELETE FROM stale_keep;");
+    query.exec();
+
+    qCDebug(lcDb) << "Removed stale entries:" << stale.downloadInfos.size() << "downloadinfo,"
+                  << stale.uploadTransferIds.size() << "uploadinfo," << blacklistDeleted << "blacklist";
+    return stale;
 }
 
 int SyncJournalDb::errorBlackListEntryCount()
@@ -2044,6 +2182,94 @@ QByteArray SyncJournalDb::conflictFileBaseName(const QByteArray &conflictName)
     return result;
 }
 
+void SyncJournalDb::setSyncPlan(const QByteArray &header, const QVector<QByteArray> &items)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return;
+
+    SqlQuery query(_db);
+    query.prepare("DELETE FROM syncplanheader;");
+    query.exec();
+    query.prepare("DELETE FROM syncplan;");
+    query.exec();
+
+    query.prepare("INSERT INTO syncplanheader (header) VALUES (?1);");
+    query.bindValue(1, header);
+    if (!query.exec()) {
+        sqlFail("setSyncPlan: insert header", query);
+        return;
+    }
+
+    auto &itemQuery = _setSyncPlanItemQuery;
+    if (!itemQuery.initOrReset(QByteArrayLiteral("INSERT INTO syncplan (id, item, done) VALUES (?1, ?2, 0);"), _db))
+        return;
+    for (int i = 0; i < items.size(); ++i) {
+        itemQuery.reset_and_clear_bindings();
+        itemQuery.bindValue(1, i);
+        itemQuery.bindValue(2, items.at(i));
+        if (!itemQuery.exec()) {
+            sqlFail("setSyncPlan: insert item", itemQuery);
+            return;
+        }
+    }
+}
+
+QByteArray SyncJournalDb::syncPlanHeader()
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return QByteArray();
+
+    SqlQuery query(_db);
+    query.prepare("SELECT header FROM syncplanheader");
+    if (!query.exec() || !query.next())
+        return QByteArray();
+    return query.baValue(0);
+}
+
+QVector<QPair<int, QByteArray>> SyncJournalDb::pendingSyncPlanItems()
+{
+    QMutexLocker locker(&_mutex);
+    QVector<QPair<int, QByteArray>> items;
+    if (!checkConnect())
+        return items;
+
+    SqlQuery query(_db);
+    query.prepare("SELECT id, item FROM syncplan WHERE done=0 ORDER BY id");
+    if (!query.exec())
+        return items;
+    while (query.next())
+        items.append(qMakePair(query.intValue(0), query.baValue(1)));
+    return items;
+}
+
+void SyncJournalDb::setSyncPlanItemDone(int id)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return;
+
+    auto &query = _setSyncPlanItemDoneQuery;
+    if (!query.initOrReset(QByteArrayLiteral("UPDATE syncplan SET done=1 WHERE id=?1;"), _db))
+        return;
+    query.bindValue(1, id);
+    query.exec();
+}
+
+void SyncJournalDb::clearSyncPlan()
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return;
+
+    SqlQuery query(_db);
+    query.prepare("DELETE FROM syncplanheader;");
+    query.exec();
+    query.prepare("DELETE FROM syncplan;");
+    query.exec();
+}
+
 void SyncJournalDb::clearFileTable()
 {
     QMutexLocker lock(&_mutex);
@@ -2090,6 +2316,17 @@ bool SyncJournalDb::isConnected()
     return checkConnect();
 }
 
+qint64 SyncJournalDb::pageCacheBytes()
+{
+    QMutexLocker lock(&_mutex);
+    if (!_db.isOpen())
+        return 0;
+    int current = 0;
+    int highWater = 0;
+    sqlite3_db_status(_db.sqliteDb(), SQLITE_DBSTATUS_CACHE_USED, &current, &highWater, 0);
+    return current;
+}
+
 bool operator==(const SyncJournalDb::DownloadInfo &lhs,
     const SyncJournalDb::DownloadInfo &rhs)
 {
@@ -2108,7 +2345,8 @@ bool operator==(const SyncJournalDb::UploadInfo &lhs,
         && lhs._valid == rhs._valid
         && lhs._size == rhs._size
         && lhs._transferid == rhs._transferid
-        && lhs._contentChecksum == rhs._contentChecksum;
+        && lhs._contentChecksum == rhs._contentChecksum
+        && lhs._isDelta == rhs._isDelta;
 }
 
 } // namespace OCC
@@ -101,6 +101,8 @@ public:
         int _errorCount = 0;
         bool _valid = false;
         QByteArray _contentChecksum;
+        /// Only the changed blocks were sent, the chunks don't cover the whole file
+        bool _isDelta = false;
         /**
          * Returns true if this entry refers to a chunked upload that can be continued.
          * (As opposed to a small file transfer which is stored in the db so we can detect the case
@@ -109,6 +111,22 @@ public:
         bool isChunked() const { return _transferid != 0; }
     };
 
+    /**
+     * Hashes of the fixed size blocks of a file as it is known to exist on the server.
+     *
+     * Recorded after a chunked upload. When the file is modified locally and
+     * the server still has the version with _etag, only the blocks whose
+     * hash changed need to be uploaded.
+     */
+    struct BlockManifest
+    {
+        QByteArray _etag;
+        qint64 _size = 0;
+        qint64 _blockSize = 0;
+        QByteArray _blockHashes; /// concatenated ComputeBlockHashes digests
+        bool _valid = false;
+    };
+
     struct PollInfo
     {
         QString _file;
@@ -123,11 +141,36 @@ public:
 
     UploadInfo getUploadInfo(const QString &file);
     void setUploadInfo(const QString &file, const UploadInfo &i);
-    // Return the list of transfer ids that were removed.
-    QVector<uint> deleteStaleUploadInfos(const QSet<QString> &keep);
+
+    BlockManifest getBlockManifest(const QString &file);
+    /// Stores the manifest, or removes it if it's not valid
+    void setBlockManifest(const QString &file, const BlockManifest &manifest);
 
     SyncJournalErrorBlacklistRecord errorBlacklistEntry(const QString &);
-    bool deleteStaleErrorBlacklistEntries(const QSet<QString> &keep);
+
+    /// The paths whose entries deleteStaleEntries() keeps, per table
+    struct StaleEntryKeepList
+    {
+        QStringList downloadInfos;
+        QStringList uploadInfos;
+        QStringList errorBlacklist;
+    };
+
+    /// What deleteStaleEntries() removed and still needs cleaning up elsewhere
+    struct StaleEntries
+    {
+        QVector<DownloadInfo> downloadInfos;
+        QVector<uint> uploadTransferIds;
+    };
+
+    /**
+     * Deletes the download infos, upload infos and error blacklist entries
+     * of all paths that are not in the keep list.
+     *
+     * The kept paths go to a temporary table, so that each table is cleaned
+     * with one statement instead of being read into memory.
+     */
+    StaleEntries deleteStaleEntries(const StaleEntryKeepList &keep);
 
     void avoidRenamesOnNextSync(const QString &path) { avoidRenamesOnNextSync(path.toUtf8()); }
     void avoidRenamesOnNextSync(const QByteArray &path);
@@ -200,6 +243,11 @@ public:
      */
     bool isConnected();
 
+    /**
+     * The memory used by the page cache of the database connection.
+     */
+    qint64 pageCacheBytes();
+
     /**
      * Returns the checksum type for an id.
      */
@@ -234,6 +282,26 @@ public:
      */
     QByteArray conflictFileBaseName(const QByteArray &conflictName);
 
+    // Sync plan functions
+
+    /**
+     * Store the propagation plan of a sync run, replacing any previous one.
+     *
+     * The header and the items are opaque to the journal, see SyncPlan in
+     * libsync. The items get consecutive ids in the order of the vector.
+     */
+    void setSyncPlan(const QByteArray &header, const QVector<QByteArray> &items);
+
+    /// Header of the stored plan, empty if there is none
+    QByteArray syncPlanHeader();
+
+    /// Ids and data of the items of the stored plan that aren't done yet, in plan order
+    QVector<QPair<int, QByteArray>> pendingSyncPlanItems();
+
+    void setSyncPlanItemDone(int id);
+
+    void clearSyncPlan();
+
     /**
      * Delete any file entry. This will force the next sync to re-sync everything as if it was new,
      * restoring everyfile on every remote. If a file is there both on the client and server side,
@@ -282,6 +350,9 @@ private:
     SqlQuery _getUploadInfoQuery;
     SqlQuery _setUploadInfoQuery;
     SqlQuery _deleteUploadInfoQuery;
+    SqlQuery _getBlockManifestQuery;
+    SqlQuery _setBlockManifestQuery;
+    SqlQuery _deleteBlockManifestQuery;
     SqlQuery _deleteFileRecordPhash;
     SqlQuery _deleteFileRecordRecursively;
     SqlQuery _getErrorBlacklistQuery;
@@ -296,6 +367,8 @@ private:
     SqlQuery _getConflictRecordQuery;
     SqlQuery _setConflictRecordQuery;
     SqlQuery _deleteConflictRecordQuery;
+    SqlQuery _setSyncPlanItemQuery;
+    SqlQuery _setSyncPlanItemDoneQuery;
 
     /* Storing etags to these folders, or their parent folders, is filtered out.
      *
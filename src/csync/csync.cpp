@@ -46,12 +46,59 @@
 #include "vio/csync_vio.h"
 
 #include "csync_rename.h"
+#include "csync_spill.h"
 #include "common/c_jhash.h"
 #include "common/syncjournalfilerecord.h"
 
 Q_LOGGING_CATEGORY(lcCSync, "nextcloud.sync.csync.csync", QtInfoMsg)
 
 
+qint64 csync_s::FileMap::bytesUsed() const
+{
+  qint64 bytes = (bucket_count() + reloaded.bucket_count()) * sizeof(void *)
+      + spillCandidates.capacity() * sizeof(ByteArrayRef);
+  for (const FileMapBase *map : { static_cast<const FileMapBase *>(this), &reloaded }) {
+    for (const auto &entry : *map) {
+      const csync_file_stat_t &fs = *entry.second;
+      // The node holds the key and the pointer, the stat holds the strings
+      bytes += sizeof(value_type) + 2 * sizeof(void *) + sizeof(csync_file_stat_t)
+          + fs.path.capacity() + fs.rename_path.capacity() + fs.etag.capacity()
+          + fs.file_id.capacity() + fs.directDownloadUrl.capacity()
+          + fs.directDownloadCookies.capacity() + fs.original_path.capacity()
+          + fs.checksumHeader.capacity() + fs.e2eMangledName.capacity();
+    }
+  }
+  return bytes;
+}
+
+qint64 csync_s::FileMap::totalSize() const
+{
+  return qint64(size() + reloaded.size()) + (spill ? spill->count(replica) : 0);
+}
+
+csync_file_stat_t *csync_s::FileMap::findFile(const ByteArrayRef &key)
+{
+  if (auto fs = findFileInMemory(key))
+    return fs;
+  if (!spill || key.isEmpty())
+    return nullptr;
+  // Callers may change the entry, so it has to come back into memory
+  auto fs = spill->take(replica, key.toByteArray());
+  if (!fs)
+    return nullptr;
+  auto result = fs.get();
+  reloaded[result->path] = std::move(fs);
+  return result;
+}
+
+void csync_s::FileMap::clear()
+{
+  FileMapBase::clear();
+  reloaded.clear();
+  spillCandidates.clear();
+  spill = nullptr;
+}
+
 csync_s::csync_s(const char *localUri, OCC::SyncJournalDb *statedb)
   : statedb(statedb)
 {
@@ -97,7 +144,7 @@ int csync_update(CSYNC *ctx) {
   }
 
   qCInfo(lcCSync) << "Update detection for local replica took" << timer.elapsed() / 1000.
-                  << "seconds walking" << ctx->local.files.size() << "files";
+                  << "seconds walking" << ctx->local.files.totalSize() << "files";
   csync_memstat_check();
 
   /* update detection for remote replica */
@@ -116,7 +163,7 @@ int csync_update(CSYNC *ctx) {
 
 
   qCInfo(lcCSync) << "Update detection for remote replica took" << timer.elapsed() / 1000.
-                  << "seconds walking" << ctx->remote.files.size() << "files";
+                  << "seconds walking" << ctx->remote.files.totalSize() << "files";
   csync_memstat_check();
 
   ctx->status |= CSYNC_STATUS_UPDATE;
@@ -138,7 +185,7 @@ int csync_reconcile(CSYNC *ctx) {
   csync_reconcile_updates(ctx);
 
   qCInfo(lcCSync) << "Reconciliation for local replica took " << timer.elapsed() / 1000.
-                  << "seconds visiting " << ctx->local.files.size() << " files.";
+                  << "seconds visiting " << ctx->local.files.totalSize() << " files.";
 
   /* Reconciliation for remote replica */
   timer.restart();
@@ -148,12 +195,29 @@ int csync_reconcile(CSYNC *ctx) {
   csync_reconcile_updates(ctx);
 
   qCInfo(lcCSync) << "Reconciliation for remote replica took " << timer.elapsed() / 1000.
-                  << "seconds visiting " << ctx->remote.files.size() << " files.";
+                  << "seconds visiting " << ctx->remote.files.totalSize() << " files.";
 
   ctx->status |= CSYNC_STATUS_RECONCILE;
   return 0;
 }
 
+/*
+ * Finds the entry of the opposite tree for the treewalk. Spilled entries
+ * are not loaded back, holder keeps a copy of them instead.
+ */
+static csync_file_stat_t *_csync_treewalk_find_other(csync_s::FileMap *other_tree, const QByteArray &path,
+    std::unique_ptr<csync_file_stat_t> &holder)
+{
+    if (auto other = other_tree->findFileInMemory(path))
+        return other;
+    if (other_tree->spill) {
+        holder = other_tree->spill->peek(other_tree->replica, path);
+        if (holder)
+            return holder.get();
+    }
+    return nullptr;
+}
+
 /*
  * local visitor which calls the user visitor with repacked stat info.
  */
@@ -172,24 +236,23 @@ static int _csync_treewalk_visitor(csync_file_stat_t *cur, CSYNC * ctx, const cs
         break;
     }
 
-    csync_s::FileMap::const_iterator other_file_it = other_tree->find(cur->path);
+    std::unique_ptr<csync_file_stat_t> holder;
+    csync_file_stat_t *other = _csync_treewalk_find_other(other_tree, cur->path, holder);
 
-    if (other_file_it == other_tree->cend()) {
+    if (!other) {
         /* Check the renamed path as well. */
         QByteArray renamed_path = csync_rename_adjust_parent_path(ctx, cur->path);
         if (renamed_path != cur->path)
-            other_file_it = other_tree->find(renamed_path);
+            other = _csync_treewalk_find_other(other_tree, renamed_path, holder);
     }
 
-    if (other_file_it == other_tree->cend()) {
+    if (!other) {
         /* Check the source path as well. */
         QByteArray renamed_path = csync_rename_adjust_parent_path_source(ctx, cur->path);
         if (renamed_path != cur->path)
-            other_file_it = other_tree->find(renamed_path);
+            other = _csync_treewalk_find_other(other_tree, renamed_path, holder);
     }
 
-    csync_file_stat_t *other = (other_file_it != other_tree->cend()) ? other_file_it->second.get() : nullptr;
-
     ctx->status_code = CSYNC_STATUS_OK;
 
     Q_ASSERT(visitor);
@@ -201,12 +264,25 @@ static int _csync_treewalk_visitor(csync_file_stat_t *cur, CSYNC * ctx, const cs
  */
 static int _csync_walk_tree(CSYNC *ctx, csync_s::FileMap &tree, const csync_treewalk_visit_func &visitor)
 {
-    for (auto &pair : tree) {
-        if (_csync_treewalk_visitor(pair.second.get(), ctx, visitor) < 0) {
-            return -1;
+    for (const csync_s::FileMapBase *map : { static_cast<csync_s::FileMapBase *>(&tree), &tree.reloaded }) {
+        for (auto &pair : *map) {
+            if (_csync_treewalk_visitor(pair.second.get(), ctx, visitor) < 0) {
+                return -1;
+            }
         }
     }
-    return 0;
+
+    if (!tree.spill)
+        return 0;
+
+    /* Stream over the spilled entries, the store already joined the ones of the other tree */
+    return tree.spill->walk(tree.replica, [ctx, &visitor](csync_file_stat_t *cur, csync_file_stat_t *other) {
+        if (other) {
+            ctx->status_code = CSYNC_STATUS_OK;
+            return visitor(cur, other);
+        }
+        return _csync_treewalk_visitor(cur, ctx, visitor);
+    });
 }
 
 /*
@@ -239,6 +315,7 @@ int csync_s::reinitialize() {
 
   local.files.clear();
   remote.files.clear();
+  spill.reset();
 
   renames.folder_renamed_from.clear();
   renames.folder_renamed_to.clear();
@@ -44,6 +44,7 @@
 #include <memory>
 #include <QByteArray>
 #include "common/remotepermissions.h"
+#include "common/memorycounters.h"
 
 namespace OCC {
 class SyncJournalFileRecord;
@@ -175,6 +176,8 @@ struct OCSYNC_EXPORT csync_file_stat_t {
 
   enum csync_instructions_e instruction = CSYNC_INSTRUCTION_NONE; /* u32 */
 
+  OCC::MemoryCounters::Instance<OCC::MemoryCounters::FileStats> instanceCounter;
+
   csync_file_stat_t()
     : type(ItemTypeSkip)
     , child_modified(false)
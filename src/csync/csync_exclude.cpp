@@ -34,8 +34,11 @@
 
 #include "common/utility.h"
 
-#include <QString>
+#include <QCryptographicHash>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QString>
 
 
 /** Expands C-like escape sequences (in place)
@@ -236,6 +239,53 @@ static CSYNC_EXCLUDE_TYPE _csync_excluded_common(const char *path, bool excludeC
     return match;
 }
 
+/** Reads the patterns of an exclude file
+ *
+ * The parsed patterns are cached for the process and reused as long as
+ * the content of the file stays the same. Timestamps are too coarse on
+ * some file systems to notice an edit that keeps the size.
+ */
+static bool csync_exclude_read_file(const QString &file, QList<QByteArray> *patterns)
+{
+    struct CachedFile
+    {
+        QByteArray contentHash;
+        QList<QByteArray> patterns;
+    };
+    static QMutex mutex;
+    static QHash<QString, CachedFile> cache;
+
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        QMutexLocker lock(&mutex);
+        cache.remove(file);
+        return false;
+    }
+    const auto content = f.readAll();
+    const auto contentHash = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+    {
+        QMutexLocker lock(&mutex);
+        auto it = cache.constFind(file);
+        if (it != cache.constEnd() && it->contentHash == contentHash) {
+            *patterns = it->patterns;
+            return true;
+        }
+    }
+
+    patterns->clear();
+    for (const auto &rawLine : content.split('\n')) {
+        QByteArray line = rawLine.trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        csync_exclude_expand_escapes(line);
+        patterns->append(line);
+    }
+
+    QMutexLocker lock(&mutex);
+    cache.insert(file, CachedFile{ contentHash, *patterns });
+    return true;
+}
+
 static QByteArray leftIncludeLast(const QByteArray & arr, char c)
 {
     // left up to and including `c`
@@ -265,13 +315,18 @@ ExcludedFiles::~ExcludedFiles() = default;
 
 void ExcludedFiles::addExcludeFilePath(const QString &path)
 {
-    _excludeFiles[_localPath.toUtf8()].append(path);
+    auto &files = _excludeFiles[_localPath.toUtf8()];
+    if (!files.contains(path))
+        files.append(path);
 }
 
 void ExcludedFiles::addInTreeExcludeFilePath(const QString &path)
 {
     BasePathByteArray basePath = leftIncludeLast(path.toUtf8(), '/');
-    _excludeFiles[basePath].append(path);
+    auto &files = _excludeFiles[basePath];
+    if (!files.contains(path))
+        files.append(path);
+    _inTreeExcludeFiles.insert(path);
 }
 
 void ExcludedFiles::setExcludeConflictFiles(bool onoff)
@@ -313,51 +368,66 @@ void ExcludedFiles::setWildcardsMatchSlash(bool onoff)
 
 bool ExcludedFiles::loadExcludeFile(const QByteArray & basePath, const QString & file)
 {
-    QFile f(file);
-    if (!f.open(QIODevice::ReadOnly))
-        return false;
+    auto &files = _excludeFiles[basePath];
+    if (!files.contains(file))
+        files.append(file);
+    return updateBasePath(basePath);
+}
 
+bool ExcludedFiles::updateBasePath(const BasePathByteArray &basePath)
+{
+    bool success = true;
     QList<QByteArray> patterns;
-    while (!f.atEnd()) {
-        QByteArray line = f.readLine().trimmed();
-        if (line.isEmpty() || line.startsWith('#'))
+    auto &files = _excludeFiles[basePath];
+    for (auto it = files.begin(); it != files.end();) {
+        QList<QByteArray> filePatterns;
+        if (csync_exclude_read_file(*it, &filePatterns)) {
+            patterns.append(filePatterns);
+        } else if (_inTreeExcludeFiles.contains(*it) && !QFileInfo::exists(*it)) {
+            // The exclude file was removed from the synced tree
+            _inTreeExcludeFiles.remove(*it);
+            it = files.erase(it);
             continue;
-        csync_exclude_expand_escapes(line);
-        patterns.append(line);
+        } else {
+            success = false;
+        }
+        ++it;
     }
-    _allExcludes.insert(basePath, patterns);
-
-    // nothing to prepare if the user decided to not exclude anything
-    if (!_allExcludes.value(basePath).isEmpty()){
+    if (files.isEmpty())
+        _excludeFiles.remove(basePath);
+    patterns.append(_manualExcludes.value(basePath));
+
+    if (patterns.isEmpty()) {
+        // nothing to prepare if the user decided to not exclude anything
+        _allExcludes.remove(basePath);
+        _regexSets.remove(basePath);
+    } else if (patterns != _allExcludes.value(basePath) || !_regexSets.contains(basePath)) {
+        _allExcludes.insert(basePath, patterns);
         prepare(basePath);
     }
-
-    return true;
+    return success;
 }
 
 bool ExcludedFiles::reloadExcludeFiles()
 {
-    _allExcludes.clear();
-    // clear all regex
-    _bnameTraversalRegexFile.clear();
-    _bnameTraversalRegexDir.clear();
-    _fullTraversalRegexFile.clear();
-    _fullTraversalRegexDir.clear();
-    _fullRegexFile.clear();
-    _fullRegexDir.clear();
-
     bool success = true;
-    const auto keys = _excludeFiles.keys();
-    for (const auto& basePath : keys) {
-        for (const auto& file : _excludeFiles.value(basePath)) {
-            success = loadExcludeFile(basePath, file);
-        }
+    QSet<QByteArray> basePaths;
+    for (const auto &basePath : _excludeFiles.keys())
+        basePaths.insert(basePath);
+    for (const auto &basePath : _manualExcludes.keys())
+        basePaths.insert(basePath);
+    for (const auto &basePath : basePaths) {
+        if (!updateBasePath(basePath))
+            success = false;
     }
 
-    auto endManual = _manualExcludes.cend();
-    for (auto kv = _manualExcludes.cbegin(); kv != endManual; ++kv) {
-        _allExcludes[kv.key()].append(kv.value());
-        prepare(kv.key());
+    // Forget the base paths that neither have files nor manual excludes anymore
+    const auto keys = _allExcludes.keys();
+    for (const auto &basePath : keys) {
+        if (!basePaths.contains(basePath)) {
+            _allExcludes.remove(basePath);
+            _regexSets.remove(basePath);
+        }
     }
 
     return success;
@@ -437,13 +507,14 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const char *path, ItemTy
     QByteArray basePath(_localPath.toUtf8() + path);
     while (basePath.size() > _localPath.size()) {
         basePath = leftIncludeLast(basePath, '/');
+        const auto regexSet = _regexSets.constFind(basePath);
+        if (regexSet == _regexSets.constEnd())
+            continue;
         QRegularExpressionMatch m;
-        if (filetype == ItemTypeDirectory
-            && _bnameTraversalRegexDir.contains(basePath)) {
-            m = _bnameTraversalRegexDir[basePath].match(bnameStr);
-        } else if (filetype == ItemTypeFile
-            && _bnameTraversalRegexFile.contains(basePath)) {
-            m = _bnameTraversalRegexFile[basePath].match(bnameStr);
+        if (filetype == ItemTypeDirectory) {
+            m = (*regexSet)->bnameTraversalRegexDir.match(bnameStr);
+        } else if (filetype == ItemTypeFile) {
+            m = (*regexSet)->bnameTraversalRegexFile.match(bnameStr);
         } else {
             continue;
         }
@@ -462,13 +533,14 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const char *path, ItemTy
     basePath = _localPath.toUtf8() + path;
     while (basePath.size() > _localPath.size()) {
         basePath = leftIncludeLast(basePath, '/');
+        const auto regexSet = _regexSets.constFind(basePath);
+        if (regexSet == _regexSets.constEnd())
+            continue;
         QRegularExpressionMatch m;
-        if (filetype == ItemTypeDirectory
-            && _fullTraversalRegexDir.contains(basePath)) {
-            m = _fullTraversalRegexDir[basePath].match(pathStr);
-        } else if (filetype == ItemTypeFile
-            && _fullTraversalRegexFile.contains(basePath)) {
-            m = _fullTraversalRegexFile[basePath].match(pathStr);
+        if (filetype == ItemTypeDirectory) {
+            m = (*regexSet)->fullTraversalRegexDir.match(pathStr);
+        } else if (filetype == ItemTypeFile) {
+            m = (*regexSet)->fullTraversalRegexFile.match(pathStr);
         } else {
             continue;
         }
@@ -501,13 +573,14 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::fullPatternMatch(const char *path, ItemType fi
     QByteArray basePath(_localPath.toUtf8() + path);
     while (basePath.size() > _localPath.size()) {
         basePath = leftIncludeLast(basePath, '/');
+        const auto regexSet = _regexSets.constFind(basePath);
+        if (regexSet == _regexSets.constEnd())
+            continue;
         QRegularExpressionMatch m;
-        if (filetype == ItemTypeDirectory
-            && _fullRegexDir.contains(basePath)) {
-            m = _fullRegexDir[basePath].match(p);
-        } else if (filetype == ItemTypeFile
-            && _fullRegexFile.contains(basePath)) {
-            m = _fullRegexFile[basePath].match(p);
+        if (filetype == ItemTypeDirectory) {
+            m = (*regexSet)->fullRegexDir.match(p);
+        } else if (filetype == ItemTypeFile) {
+            m = (*regexSet)->fullRegexFile.match(p);
         } else {
             continue;
         }
@@ -663,13 +736,7 @@ static QString extractBnameTrigger(const QString &exclude, bool wildcardsMatchSl
 
 void ExcludedFiles::prepare()
 {
-    // clear all regex
-    _bnameTraversalRegexFile.clear();
-    _bnameTraversalRegexDir.clear();
-    _fullTraversalRegexFile.clear();
-    _fullTraversalRegexDir.clear();
-    _fullRegexFile.clear();
-    _fullRegexDir.clear();
+    _regexSets.clear();
 
     const auto keys = _allExcludes.keys();
     for (auto const & basePath : keys)
@@ -680,18 +747,77 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
 {
     Q_ASSERT(_allExcludes.contains(basePath));
 
+    // The full patterns are matched against a path relative to _localPath, however they are
+    // relative to basePath. We know for sure that both _localPath and basePath are absolute
+    // and that basePath is contained in _localPath. So we can simply remove it from the begining.
+    _regexSets[basePath] = regexSetFor(_allExcludes.value(basePath), basePath.mid(_localPath.size()), _wildcardsMatchSlash);
+}
+
+QSharedPointer<const ExcludedFiles::RegexSet> ExcludedFiles::regexSetFor(const QList<QByteArray> &excludes,
+    const QByteArray &relativeBasePath, bool wildcardsMatchSlash)
+{
+    static QMutex mutex;
+    static QHash<QByteArray, QWeakPointer<const RegexSet>> cache;
+
+    // Only the full path patterns depend on where the base path is
+    bool hasFullPath = false;
+    for (const auto &exclude : excludes) {
+        const auto slash = exclude.indexOf('/');
+        if (slash >= 0 && slash != exclude.size() - 1) {
+            hasFullPath = true;
+            break;
+        }
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    auto addField = [&hash](const QByteArray &field) {
+        hash.addData(QByteArray::number(field.size()) + ':');
+        hash.addData(field);
+    };
+    addField(hasFullPath ? relativeBasePath : QByteArray());
+    addField(wildcardsMatchSlash ? "1" : "0");
+    addField(OCC::Utility::fsCasePreserving() ? "1" : "0");
+    for (const auto &exclude : excludes)
+        addField(exclude);
+    const auto key = hash.result();
+
+    {
+        QMutexLocker lock(&mutex);
+        if (auto regexSet = cache.value(key).toStrongRef())
+            return regexSet;
+    }
+
+    // Compiling takes a while, don't block other threads meanwhile
+    auto regexSet = buildRegexSet(excludes, relativeBasePath, wildcardsMatchSlash);
+
+    QMutexLocker lock(&mutex);
+    if (auto other = cache.value(key).toStrongRef())
+        return other;
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->isNull())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+    cache.insert(key, regexSet);
+    return regexSet;
+}
+
+QSharedPointer<const ExcludedFiles::RegexSet> ExcludedFiles::buildRegexSet(const QList<QByteArray> &excludes,
+    const QByteArray &relativeBasePath, bool wildcardsMatchSlash)
+{
     // Build regular expressions for the different cases.
     //
-    // To compose the _bnameTraversalRegex, _fullTraversalRegex and _fullRegex
+    // To compose the bnameTraversalRegex, fullTraversalRegex and fullRegex
     // patterns we collect several subgroups of patterns here.
     //
     // * The "full" group will contain all patterns that contain a non-trailing
     //   slash. They only make sense in the fullRegex and fullTraversalRegex.
     // * The "bname" group contains all patterns without a non-trailing slash.
-    //   These need separate handling in the _fullRegex (slash-containing
+    //   These need separate handling in the fullRegex (slash-containing
     //   patterns must be anchored to the front, these don't need it)
     // * The "bnameTrigger" group contains the bname part of all patterns in the
-    //   "full" group. These and the "bname" group become _bnameTraversalRegex.
+    //   "full" group. These and the "bname" group become bnameTraversalRegex.
     //
     // To complicate matters, the exclude patterns have two binary attributes
     // meaning we'll end up with 4 variants:
@@ -721,7 +847,7 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
         pattern.append(appendMe);
     };
 
-    for (auto exclude : _allExcludes.value(basePath)) {
+    for (auto exclude : excludes) {
         if (exclude[0] == '\n')
             continue; // empty line
         if (exclude[0] == '\r')
@@ -744,22 +870,17 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
         auto &fullDir = removeExcluded ? fullDirRemove : fullDirKeep;
 
         if (fullPath) {
-            // The full pattern is matched against a path relative to _localPath, however exclude is
-            // relative to basePath at this point.
-            // We know for sure that both _localPath and basePath are absolute and that basePath is
-            // contained in _localPath. So we can simply remove it from the begining.
-            auto relPath = basePath.mid(_localPath.size());
             // Make exclude relative to _localPath
-            exclude.prepend(relPath);
+            exclude.prepend(relativeBasePath);
         }
-        auto regexExclude = convertToRegexpSyntax(QString::fromUtf8(exclude), _wildcardsMatchSlash);
+        auto regexExclude = convertToRegexpSyntax(QString::fromUtf8(exclude), wildcardsMatchSlash);
         if (!fullPath) {
             regexAppend(bnameFileDir, bnameDir, regexExclude, matchDirOnly);
         } else {
             regexAppend(fullFileDir, fullDir, regexExclude, matchDirOnly);
 
             // For activation, trigger on the 'bname' part of the full pattern.
-            QString bnameExclude = extractBnameTrigger(exclude, _wildcardsMatchSlash);
+            QString bnameExclude = extractBnameTrigger(exclude, wildcardsMatchSlash);
             auto regexBname = convertToRegexpSyntax(bnameExclude, true);
             regexAppend(bnameTriggerFileDir, bnameTriggerDir, regexBname, matchDirOnly);
         }
@@ -788,11 +909,12 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
     // (exclude)|(excluderemove)|(bname triggers).
     // If the third group matches, the fullActivatedRegex needs to be applied
     // to the full path.
-    _bnameTraversalRegexFile[basePath].setPattern(
+    QSharedPointer<RegexSet> regexSet(new RegexSet);
+    regexSet->bnameTraversalRegexFile.setPattern(
         "^(?P<exclude>" + bnameFileDirKeep + ")$|"
         + "^(?P<excluderemove>" + bnameFileDirRemove + ")$|"
         + "^(?P<trigger>" + bnameTriggerFileDir + ")$");
-    _bnameTraversalRegexDir[basePath].setPattern(
+    regexSet->bnameTraversalRegexDir.setPattern(
         "^(?P<exclude>" + bnameFileDirKeep + "|" + bnameDirKeep + ")$|"
         + "^(?P<excluderemove>" + bnameFileDirRemove + "|" + bnameDirRemove + ")$|"
         + "^(?P<trigger>" + bnameTriggerFileDir + "|" + bnameTriggerDir + ")$");
@@ -801,13 +923,13 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
     // the bname regex matches. Its basic form is (exclude)|(excluderemove)".
     // This pattern can be much simpler than fullRegex since we can assume a traversal
     // situation and doesn't need to look for bname patterns in parent paths.
-    _fullTraversalRegexFile[basePath].setPattern(
+    regexSet->fullTraversalRegexFile.setPattern(
         QLatin1String("")
         // Full patterns are anchored to the beginning
         + "^(?P<exclude>" + fullFileDirKeep + ")(?:$|/)"
         + "|"
         + "^(?P<excluderemove>" + fullFileDirRemove + ")(?:$|/)");
-    _fullTraversalRegexDir[basePath].setPattern(
+    regexSet->fullTraversalRegexDir.setPattern(
         QLatin1String("")
         + "^(?P<exclude>" + fullFileDirKeep + "|" + fullDirKeep + ")(?:$|/)"
         + "|"
@@ -815,7 +937,7 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
 
     // The full regex is applied to the full path and incorporates both bname and
     // full-path patterns. It has the form "(exclude)|(excluderemove)".
-    _fullRegexFile[basePath].setPattern(
+    regexSet->fullRegexFile.setPattern(
         QLatin1String("(?P<exclude>")
         // Full patterns are anchored to the beginning
         + "^(?:" + fullFileDirKeep + ")(?:$|/)" + "|"
@@ -831,7 +953,7 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
         + "(?:^|/)(?:" + bnameFileDirRemove + ")(?:$|/)" + "|"
         + "(?:^|/)(?:" + bnameDirRemove + ")/"
         + ")");
-    _fullRegexDir[basePath].setPattern(
+    regexSet->fullRegexDir.setPattern(
         QLatin1String("(?P<exclude>")
         + "^(?:" + fullFileDirKeep + "|" + fullDirKeep + ")(?:$|/)" + "|"
         + "(?:^|/)(?:" + bnameFileDirKeep + "|" + bnameDirKeep + ")(?:$|/)"
@@ -845,16 +967,17 @@ void ExcludedFiles::prepare(const BasePathByteArray & basePath)
     QRegularExpression::PatternOptions patternOptions = QRegularExpression::NoPatternOption;
     if (OCC::Utility::fsCasePreserving())
         patternOptions |= QRegularExpression::CaseInsensitiveOption;
-    _bnameTraversalRegexFile[basePath].setPatternOptions(patternOptions);
-    _bnameTraversalRegexFile[basePath].optimize();
-    _bnameTraversalRegexDir[basePath].setPatternOptions(patternOptions);
-    _bnameTraversalRegexDir[basePath].optimize();
-    _fullTraversalRegexFile[basePath].setPatternOptions(patternOptions);
-    _fullTraversalRegexFile[basePath].optimize();
-    _fullTraversalRegexDir[basePath].setPatternOptions(patternOptions);
-    _fullTraversalRegexDir[basePath].optimize();
-    _fullRegexFile[basePath].setPatternOptions(patternOptions);
-    _fullRegexFile[basePath].optimize();
-    _fullRegexDir[basePath].setPatternOptions(patternOptions);
-    _fullRegexDir[basePath].optimize();
+    regexSet->bnameTraversalRegexFile.setPatternOptions(patternOptions);
+    regexSet->bnameTraversalRegexFile.optimize();
+    regexSet->bnameTraversalRegexDir.setPatternOptions(patternOptions);
+    regexSet->bnameTraversalRegexDir.optimize();
+    regexSet->fullTraversalRegexFile.setPatternOptions(patternOptions);
+    regexSet->fullTraversalRegexFile.optimize();
+    regexSet->fullTraversalRegexDir.setPatternOptions(patternOptions);
+    regexSet->fullTraversalRegexDir.optimize();
+    regexSet->fullRegexFile.setPatternOptions(patternOptions);
+    regexSet->fullRegexFile.optimize();
+    regexSet->fullRegexDir.setPatternOptions(patternOptions);
+    regexSet->fullRegexDir.optimize();
+    return regexSet;
 }
@@ -25,8 +25,10 @@
 
 #include "csync.h"
 
+#include <QMap>
 #include <QObject>
 #include <QSet>
+#include <QSharedPointer>
 #include <QString>
 #include <QRegularExpression>
 
@@ -72,6 +74,7 @@ public:
      * Adds a new path to a file containing exclude patterns.
      *
      * Does not load the file. Use reloadExcludeFiles() afterwards.
+     * Adding a path that is already known does nothing.
      */
     void addExcludeFilePath(const QString &path);
     void addInTreeExcludeFilePath(const QString &path);
@@ -128,10 +131,13 @@ public:
 public slots:
     /**
      * Reloads the exclude patterns from the registered paths.
+     *
+     * Only the base paths whose patterns changed since the last load
+     * get new regular expressions.
      */
     bool reloadExcludeFiles();
     /**
-     * Loads the exclude patterns from file the registered base paths.
+     * Registers the file for the base path and loads the patterns of the base path.
      */
     bool loadExcludeFile(const QByteArray & basePath, const QString & file);
 
@@ -189,7 +195,7 @@ private:
      * Generate optimized regular expressions for the exclude patterns anchored to basePath.
      *
      * The optimization works in two steps: First, all supported patterns are put
-     * into _fullRegexFile/_fullRegexDir. These regexes can be applied to the full
+     * into fullRegexFile/fullRegexDir. These regexes can be applied to the full
      * path to determine whether it is excluded or not.
      *
      * The second is a performance optimization. The particularly common use
@@ -206,8 +212,8 @@ private:
      *   full("a/b/c/d") == traversal("a") || traversal("a/b") || traversal("a/b/c")
      *
      * The traversal matcher can be extremely fast because it has a fast early-out
-     * case: It checks the bname part of the path against _bnameTraversalRegex
-     * and only runs a simplified _fullTraversalRegex on the whole path if bname
+     * case: It checks the bname part of the path against bnameTraversalRegex
+     * and only runs a simplified fullTraversalRegex on the whole path if bname
      * activation for it was triggered.
      *
      * Note: The traversal matcher will return not-excluded on some paths that the
@@ -218,11 +224,44 @@ private:
 
     void prepare();
 
+    /**
+     * Collects the patterns of the base path from its files and manual excludes
+     * and prepares the base path again if they changed.
+     *
+     * Returns false if one of the files could not be read.
+     */
+    bool updateBasePath(const BasePathByteArray &basePath);
+
+    /// The regular expressions of a base path, see prepare()
+    struct RegexSet
+    {
+        QRegularExpression bnameTraversalRegexFile;
+        QRegularExpression bnameTraversalRegexDir;
+        QRegularExpression fullTraversalRegexFile;
+        QRegularExpression fullTraversalRegexDir;
+        QRegularExpression fullRegexFile;
+        QRegularExpression fullRegexDir;
+    };
+
+    /**
+     * The regular expressions for the patterns, compiled once per process.
+     *
+     * The sets are cached by their content, so all instances with the same
+     * patterns (and the same path prefix for full path patterns) share them.
+     */
+    static QSharedPointer<const RegexSet> regexSetFor(const QList<QByteArray> &excludes,
+        const QByteArray &relativeBasePath, bool wildcardsMatchSlash);
+
+    static QSharedPointer<const RegexSet> buildRegexSet(const QList<QByteArray> &excludes,
+        const QByteArray &relativeBasePath, bool wildcardsMatchSlash);
 
     QString _localPath;
     /// Files to load excludes from
     QMap<BasePathByteArray, QList<QString>> _excludeFiles;
 
+    /// Files of _excludeFiles that were found in the synced tree, they may go away again
+    QSet<QString> _inTreeExcludeFiles;
+
     /// Exclude patterns added with addManualExclude()
     QMap<BasePathByteArray, QList<QByteArray>> _manualExcludes;
 
@@ -230,12 +269,7 @@ private:
     QMap<BasePathByteArray, QList<QByteArray>> _allExcludes;
 
     /// see prepare()
-    QMap<BasePathByteArray, QRegularExpression> _bnameTraversalRegexFile;
-    QMap<BasePathByteArray, QRegularExpression> _bnameTraversalRegexDir;
-    QMap<BasePathByteArray, QRegularExpression> _fullTraversalRegexFile;
-    QMap<BasePathByteArray, QRegularExpression> _fullTraversalRegexDir;
-    QMap<BasePathByteArray, QRegularExpression> _fullRegexFile;
-    QMap<BasePathByteArray, QRegularExpression> _fullRegexDir;
+    QMap<BasePathByteArray, QSharedPointer<const RegexSet>> _regexSets;
 
     bool _excludeConflictFiles = true;
 
@@ -39,6 +39,8 @@
 #include <map>
 #include <set>
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include "common/syncjournaldb.h"
 #include "config_csync.h"
@@ -49,6 +51,8 @@
 #include "csync_exclude.h"
 #include "csync_macros.h"
 
+class CSyncSpillStore;
+
 /**
  * How deep to scan directories.
  */
@@ -99,6 +103,7 @@ public:
     {
     }
     ByteArrayRef left(int l) const { return ByteArrayRef(_arr, _begin, l); };
+    QByteArray toByteArray() const { return _begin == 0 && _size == _arr.size() ? _arr : _arr.mid(_begin, _size); }
     char at(int x) const { return _arr.at(_begin + x); }
     int size() const { return _size; }
     int length() const { return _size; }
@@ -114,12 +119,36 @@ struct ByteArrayRefHash { uint operator()(const ByteArrayRef &a) const { return
  */
 struct OCSYNC_EXPORT csync_s {
 
-  class FileMap : public std::unordered_map<ByteArrayRef, std::unique_ptr<csync_file_stat_t>, ByteArrayRefHash> {
+  using FileMapBase = std::unordered_map<ByteArrayRef, std::unique_ptr<csync_file_stat_t>, ByteArrayRefHash>;
+
+  /*
+   * The entries of one tree. Without a spill store all of them are in the map
+   * itself; with one, unchanged files may be in the store instead, see
+   * CSyncSpillStore. Use findFile() and findFileInMemory() for lookups.
+   */
+  class FileMap : public FileMapBase {
   public:
-      csync_file_stat_t *findFile(const ByteArrayRef &key) const {
+      explicit FileMap(csync_replica_e replica) : replica(replica) {}
+
+      /** Estimate of the heap memory held by the map and its entries */
+      qint64 bytesUsed() const;
+
+      /** The number of entries, including spilled ones */
+      qint64 totalSize() const;
+
+      /** Finds the entry, loading it back into memory if it was spilled */
+      csync_file_stat_t *findFile(const ByteArrayRef &key);
+
+      /** Finds the entry only if it is in memory */
+      csync_file_stat_t *findFileInMemory(const ByteArrayRef &key) const {
           auto it = find(key);
-          return it != end() ? it->second.get() : nullptr;
+          if (it != end())
+              return it->second.get();
+          it = reloaded.find(key);
+          return it != reloaded.end() ? it->second.get() : nullptr;
       }
+
+      /* Spilled files never have a mangled name, the map holds all candidates */
       csync_file_stat_t *findFileMangledName(const ByteArrayRef &key) const {
           auto it = begin();
           while (it != end()) {
@@ -131,6 +160,20 @@ struct OCSYNC_EXPORT csync_s {
           }
           return nullptr;
       }
+
+      void clear();
+
+      const csync_replica_e replica;
+
+      /* The spill store of the context, if it has one */
+      CSyncSpillStore *spill = nullptr;
+
+      /* Entries added since the last spill that may be spilled */
+      std::vector<ByteArrayRef> spillCandidates;
+
+      /* Spilled entries that lookups loaded back. They are kept apart, so
+       * lookups don't invalidate iterators of the map while it is walked. */
+      FileMapBase reloaded;
   };
 
   struct {
@@ -172,11 +215,11 @@ struct OCSYNC_EXPORT csync_s {
 
   struct {
     char *uri = nullptr;
-    FileMap files;
+    FileMap files{LOCAL_REPLICA};
   } local;
 
   struct {
-    FileMap files;
+    FileMap files{REMOTE_REPLICA};
     bool read_from_db = false;
     OCC::RemotePermissions root_perms; /* Permission of the root folder. (Since the root folder is not in the db tree, we need to keep a separate entry.) */
   } remote;
@@ -207,6 +250,13 @@ struct OCSYNC_EXPORT csync_s {
 
   bool upload_conflict_files = false;
 
+  /**
+   * Number of entries per tree above which unchanged files are moved to
+   * a temporary on-disk store to bound the memory use. 0 disables it.
+   */
+  qint64 spill_threshold = 0;
+  std::unique_ptr<CSyncSpillStore> spill;
+
   csync_s(const char *localUri, OCC::SyncJournalDb *statedb);
   ~csync_s();
   int reinitialize();
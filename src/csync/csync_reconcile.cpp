@@ -25,6 +25,7 @@
 #include "csync_reconcile.h"
 #include "csync_util.h"
 #include "csync_rename.h"
+#include "csync_spill.h"
 #include "common/c_jhash.h"
 #include "common/asserts.h"
 #include "common/syncjournalfilerecord.h"
@@ -466,18 +467,24 @@ static void _csync_merge_algorithm_visitor(csync_file_stat_t *cur, CSYNC * ctx)
 
 void csync_reconcile_updates(CSYNC *ctx) {
   csync_s::FileMap *tree = nullptr;
+  csync_s::FileMap *other_tree = nullptr;
 
   switch (ctx->current) {
     case LOCAL_REPLICA:
       tree = &ctx->local.files;
+      other_tree = &ctx->remote.files;
       break;
     case REMOTE_REPLICA:
       tree = &ctx->remote.files;
+      other_tree = &ctx->local.files;
       break;
     default:
       break;
   }
 
+  /* Lookups below load spilled entries into tree->reloaded, never into the map being walked */
+  csync_spill_prepare_reconcile(ctx, *tree, *other_tree);
+
   for (auto &pair : *tree) {
     _csync_merge_algorithm_visitor(pair.second.get(), ctx);
   }
@@ -0,0 +1,247 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "csync_spill.h"
+
+#include <QDataStream>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcSpill, "nextcloud.sync.csync.spill", QtInfoMsg)
+
+namespace {
+
+/* Spilled entries are unchanged files, only the fields these can have are stored */
+QByteArray serialize(const csync_file_stat_t &fs)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << qint64(fs.modtime) << qint64(fs.size) << quint64(fs.inode)
+           << fs.remotePerm.toString() << fs.etag << fs.file_id << fs.checksumHeader
+           << fs.directDownloadUrl << fs.directDownloadCookies;
+    return data;
+}
+
+std::unique_ptr<csync_file_stat_t> deserialize(const QByteArray &path, const QByteArray &data)
+{
+    std::unique_ptr<csync_file_stat_t> fs(new csync_file_stat_t);
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+    qint64 modtime = 0;
+    qint64 size = 0;
+    quint64 inode = 0;
+    QByteArray remotePerm;
+    stream >> modtime >> size >> inode >> remotePerm >> fs->etag >> fs->file_id
+        >> fs->checksumHeader >> fs->directDownloadUrl >> fs->directDownloadCookies;
+    fs->path = path;
+    fs->type = ItemTypeFile;
+    fs->modtime = modtime;
+    fs->size = size;
+    fs->inode = inode;
+    if (!remotePerm.isNull())
+        fs->remotePerm = OCC::RemotePermissions(remotePerm.constData());
+    fs->instruction = CSYNC_INSTRUCTION_NONE;
+    return fs;
+}
+
+csync_replica_e otherReplica(csync_replica_e replica)
+{
+    return replica == LOCAL_REPLICA ? REMOTE_REPLICA : LOCAL_REPLICA;
+}
+}
+
+CSyncSpillStore::CSyncSpillStore() = default;
+
+CSyncSpillStore::~CSyncSpillStore() = default;
+
+bool CSyncSpillStore::open()
+{
+    // An empty file name makes sqlite create a temporary database that is
+    // deleted when it is closed.
+    if (!_db.openOrCreateReadWrite(QString())) {
+        qCWarning(lcSpill) << "Could not create the spill database:" << _db.error();
+        return false;
+    }
+    for (const char *pragma : { "PRAGMA journal_mode=OFF;", "PRAGMA synchronous=OFF;", "PRAGMA cache_size=-8000;" }) {
+        OCC::SqlQuery query(pragma, _db);
+        query.exec();
+    }
+    OCC::SqlQuery create("CREATE TABLE spill(replica INTEGER, path BLOB, data BLOB, PRIMARY KEY(replica, path)) WITHOUT ROWID;", _db);
+    if (!create.exec()) {
+        qCWarning(lcSpill) << "Could not create the spill table:" << create.error();
+        return false;
+    }
+    return _insertQuery.initOrReset("INSERT OR REPLACE INTO spill (replica, path, data) VALUES (?1, ?2, ?3);", _db)
+        && _selectQuery.initOrReset("SELECT data FROM spill WHERE replica=?1 AND path=?2;", _db)
+        && _deleteQuery.initOrReset("DELETE FROM spill WHERE replica=?1 AND path=?2;", _db);
+}
+
+bool CSyncSpillStore::canSpill(const csync_file_stat_t &fs)
+{
+    return fs.type == ItemTypeFile
+        && fs.instruction == CSYNC_INSTRUCTION_NONE
+        && fs.error_status == CSYNC_STATUS_OK
+        && !fs.is_hidden
+        && !fs.isE2eEncrypted
+        && fs.e2eMangledName.isEmpty()
+        && fs.rename_path.isEmpty()
+        && fs.original_path.isEmpty();
+}
+
+bool CSyncSpillStore::add(csync_replica_e replica, const std::vector<std::unique_ptr<csync_file_stat_t>> &entries)
+{
+    if (!_db.transaction())
+        return false;
+    for (const auto &fs : entries) {
+        _insertQuery.reset_and_clear_bindings();
+        _insertQuery.bindValue(1, int(replica));
+        _insertQuery.bindValue(2, fs->path);
+        _insertQuery.bindValue(3, serialize(*fs));
+        if (!_insertQuery.exec()) {
+            qCWarning(lcSpill) << "Could not spill" << fs->path << _insertQuery.error();
+            _db.commit();
+            return false;
+        }
+        ++_count[replica];
+    }
+    return _db.commit();
+}
+
+std::unique_ptr<csync_file_stat_t> CSyncSpillStore::peek(csync_replica_e replica, const QByteArray &path)
+{
+    _selectQuery.reset_and_clear_bindings();
+    _selectQuery.bindValue(1, int(replica));
+    _selectQuery.bindValue(2, path);
+    if (!_selectQuery.exec() || !_selectQuery.next())
+        return nullptr;
+    return deserialize(path, _selectQuery.baValue(0));
+}
+
+std::unique_ptr<csync_file_stat_t> CSyncSpillStore::take(csync_replica_e replica, const QByteArray &path)
+{
+    auto fs = peek(replica, path);
+    if (!fs)
+        return nullptr;
+    _deleteQuery.reset_and_clear_bindings();
+    _deleteQuery.bindValue(1, int(replica));
+    _deleteQuery.bindValue(2, path);
+    if (_deleteQuery.exec())
+        --_count[replica];
+    return fs;
+}
+
+std::vector<QByteArray> CSyncSpillStore::unmatchedPaths(csync_replica_e replica)
+{
+    std::vector<QByteArray> paths;
+    OCC::SqlQuery query("SELECT path FROM spill s WHERE replica=?1 AND NOT EXISTS "
+                        "(SELECT 1 FROM spill o WHERE o.replica=?2 AND o.path=s.path);",
+        _db);
+    query.bindValue(1, int(replica));
+    query.bindValue(2, int(otherReplica(replica)));
+    if (!query.exec())
+        return paths;
+    while (query.next())
+        paths.push_back(query.baValue(0));
+    return paths;
+}
+
+int CSyncSpillStore::walk(csync_replica_e replica, const Visitor &visitor)
+{
+    OCC::SqlQuery query("SELECT s.path, s.data, o.data FROM spill s "
+                        "LEFT JOIN spill o ON o.replica=?2 AND o.path=s.path "
+                        "WHERE s.replica=?1 ORDER BY s.path;",
+        _db);
+    query.bindValue(1, int(replica));
+    query.bindValue(2, int(otherReplica(replica)));
+    if (!query.exec())
+        return -1;
+    while (query.next()) {
+        const QByteArray path = query.baValue(0);
+        auto entry = deserialize(path, query.baValue(1));
+        std::unique_ptr<csync_file_stat_t> other;
+        if (!query.nullValue(2))
+            other = deserialize(path, query.baValue(2));
+        if (visitor(entry.get(), other.get()) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void csync_spill_if_needed(CSYNC *ctx, csync_s::FileMap &files)
+{
+    if (ctx->spill_threshold <= 0 || qint64(files.size()) <= ctx->spill_threshold)
+        return;
+    // Spill in batches, a transaction per entry would be slow
+    const size_t batchSize = qBound<qint64>(1, ctx->spill_threshold / 4, 10000);
+    if (files.spillCandidates.size() < batchSize)
+        return;
+
+    if (!ctx->spill) {
+        std::unique_ptr<CSyncSpillStore> store(new CSyncSpillStore);
+        if (!store->open()) {
+            // Keep going with everything in memory
+            ctx->spill_threshold = 0;
+            files.spillCandidates.clear();
+            return;
+        }
+        qCInfo(lcSpill) << "Discovery trees exceed" << ctx->spill_threshold << "entries, moving unchanged files to disk";
+        ctx->spill = std::move(store);
+        ctx->local.files.spill = ctx->spill.get();
+        ctx->remote.files.spill = ctx->spill.get();
+    }
+
+    std::vector<std::unique_ptr<csync_file_stat_t>> entries;
+    entries.reserve(files.spillCandidates.size());
+    for (const auto &path : files.spillCandidates) {
+        auto it = files.find(path);
+        if (it == files.end() || !CSyncSpillStore::canSpill(*it->second))
+            continue;
+        entries.push_back(std::move(it->second));
+        files.erase(it);
+    }
+    files.spillCandidates.clear();
+
+    if (!ctx->spill->add(files.replica, entries)) {
+        // Put them back, memory is better than losing entries
+        for (auto &fs : entries) {
+            QByteArray path = fs->path;
+            files[path] = std::move(fs);
+        }
+    }
+}
+
+void csync_spill_prepare_reconcile(CSYNC *ctx, csync_s::FileMap &files, csync_s::FileMap &other)
+{
+    for (auto &entry : files.reloaded)
+        files[entry.first] = std::move(entry.second);
+    files.reloaded.clear();
+
+    if (!ctx->spill)
+        return;
+
+    // Spilled entries with an entry at the same path in the other tree are
+    // left alone by the reconcile, all others need a visit.
+    int loaded = 0;
+    for (const auto &path : ctx->spill->unmatchedPaths(files.replica)) {
+        if (other.findFileInMemory(path))
+            continue;
+        if (auto fs = ctx->spill->take(files.replica, path)) {
+            files[path] = std::move(fs);
+            ++loaded;
+        }
+    }
+    qCInfo(lcSpill) << "Loaded" << loaded << "spilled entries without a counterpart," << ctx->spill->count(files.replica) << "stay on disk";
+}
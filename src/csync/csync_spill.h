@@ -0,0 +1,100 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _CSYNC_SPILL_H
+#define _CSYNC_SPILL_H
+
+#include "csync_private.h"
+#include "common/ownsql.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Temporary on-disk storage for the unchanged files of the discovery trees
+ *
+ * Once a tree holds more than csync_s::spill_threshold entries, csync moves
+ * its unchanged files here. Those are the bulk of a large tree and the
+ * reconcile leaves them alone as long as the other tree has an entry at the
+ * same path, so they only need to be read back for the treewalk, which
+ * streams over them in path order.
+ *
+ * The entries live in a private sqlite database that sqlite deletes when
+ * the store is destroyed.
+ */
+class OCSYNC_EXPORT CSyncSpillStore
+{
+public:
+    using Visitor = std::function<int(csync_file_stat_t *entry, csync_file_stat_t *other)>;
+
+    CSyncSpillStore();
+    ~CSyncSpillStore();
+
+    /** Creates the temporary database, false if that failed. */
+    bool open();
+
+    /** Whether the entry may be moved to the store. */
+    static bool canSpill(const csync_file_stat_t &fs);
+
+    /** Stores the entries in a single transaction. */
+    bool add(csync_replica_e replica, const std::vector<std::unique_ptr<csync_file_stat_t>> &entries);
+
+    /** Removes the entry from the store and returns it, null if it isn't stored. */
+    std::unique_ptr<csync_file_stat_t> take(csync_replica_e replica, const QByteArray &path);
+
+    /** A copy of the entry that stays in the store, null if it isn't stored. */
+    std::unique_ptr<csync_file_stat_t> peek(csync_replica_e replica, const QByteArray &path);
+
+    qint64 count(csync_replica_e replica) const { return _count[replica]; }
+
+    /** Paths of the replica's entries that have no entry at the same path in the other replica's store. */
+    std::vector<QByteArray> unmatchedPaths(csync_replica_e replica);
+
+    /**
+     * Calls the visitor for each entry of the replica in path order, together
+     * with the other replica's stored entry at the same path, or null.
+     *
+     * Stops and returns -1 when the visitor returns a negative value.
+     */
+    int walk(csync_replica_e replica, const Visitor &visitor);
+
+private:
+    OCC::SqlDatabase _db;
+    OCC::SqlQuery _insertQuery;
+    OCC::SqlQuery _selectQuery;
+    OCC::SqlQuery _deleteQuery;
+    qint64 _count[2] = { 0, 0 };
+};
+
+/**
+ * Moves the spill candidates of the tree to the context's spill store once
+ * the tree has more than ctx->spill_threshold entries.
+ *
+ * Called by the update phase before it adds an entry: at that point no
+ * pointer to a file entry of the tree is held anymore.
+ */
+void csync_spill_if_needed(CSYNC *ctx, csync_s::FileMap &files);
+
+/**
+ * Loads the spilled entries of the tree that the reconcile has to look at
+ * back into memory: the ones without an entry at the same path in the
+ * other tree. Also moves entries that were loaded by lookups into the
+ * main map, so the reconcile pass visits them.
+ */
+void csync_spill_prepare_reconcile(CSYNC *ctx, csync_s::FileMap &files, csync_s::FileMap &other);
+
+#endif /* _CSYNC_SPILL_H */
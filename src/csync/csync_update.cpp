@@ -42,6 +42,7 @@
 #include "vio/csync_vio.h"
 
 #include "csync_rename.h"
+#include "csync_spill.h"
 
 #include "common/utility.h"
 #include "common/asserts.h"
@@ -451,16 +452,12 @@ out:
       csync_instruction_str(fs->instruction));
 
   QByteArray path = fs->path;
-  switch (ctx->current) {
-    case LOCAL_REPLICA:
-      ctx->local.files[path] = std::move(fs);
-      break;
-    case REMOTE_REPLICA:
-      ctx->remote.files[path] = std::move(fs);
-      break;
-    default:
-      break;
+  auto &files = ctx->current == LOCAL_REPLICA ? ctx->local.files : ctx->remote.files;
+  csync_spill_if_needed(ctx, files);
+  if (ctx->spill_threshold > 0 && CSyncSpillStore::canSpill(*fs)) {
+      files.spillCandidates.push_back(path);
   }
+  files[path] = std::move(fs);
 
   return 0;
 }
@@ -553,6 +550,10 @@ static bool fill_tree_from_db(CSYNC *ctx, const char *uri)
         }
 
         /* store into result list. */
+        csync_spill_if_needed(ctx, files);
+        if (ctx->spill_threshold > 0 && CSyncSpillStore::canSpill(*st)) {
+            files.spillCandidates.push_back(rec._path);
+        }
         files[rec._path] = std::move(st);
         ++count;
     };
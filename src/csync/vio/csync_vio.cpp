@@ -32,6 +32,20 @@
 #include "vio/csync_vio_local.h"
 #include "common/c_jhash.h"
 
+#include <atomic>
+
+static std::atomic<CSyncVioLocalBackend *> _local_backend{ nullptr };
+
+CSyncVioLocalBackend::~CSyncVioLocalBackend() = default;
+
+void csync_vio_local_set_backend(CSyncVioLocalBackend *backend) {
+  _local_backend.store(backend);
+}
+
+CSyncVioLocalBackend *csync_vio_local_backend() {
+  return _local_backend.load();
+}
+
 csync_vio_handle_t *csync_vio_opendir(CSYNC *ctx, const char *name) {
   switch(ctx->current) {
     case REMOTE_REPLICA:
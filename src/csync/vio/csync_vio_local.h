@@ -27,4 +27,35 @@ std::unique_ptr<csync_file_stat_t> OCSYNC_EXPORT csync_vio_local_readdir(csync_v
 
 int OCSYNC_EXPORT csync_vio_local_stat(const char *uri, csync_file_stat_t *buf);
 
+/**
+ * @brief Replaces the local file system for csync_vio_local_*
+ *
+ * Local discovery and the metadata lookups of the propagator go through
+ * csync_vio_local_opendir(), csync_vio_local_readdir() and
+ * csync_vio_local_stat(). When a backend is installed these calls are
+ * forwarded to it instead of the operating system; this makes it possible
+ * to benchmark discovery without measuring the disk and the page cache.
+ *
+ * The functions have the semantics of their csync_vio_local_* counterparts
+ * and may be called from several threads.
+ */
+class OCSYNC_EXPORT CSyncVioLocalBackend
+{
+public:
+    virtual ~CSyncVioLocalBackend();
+
+    virtual csync_vio_handle_t *opendir(const char *name) = 0;
+    virtual int closedir(csync_vio_handle_t *dhandle) = 0;
+    virtual std::unique_ptr<csync_file_stat_t> readdir(csync_vio_handle_t *dhandle) = 0;
+    virtual int stat(const char *uri, csync_file_stat_t *buf) = 0;
+};
+
+/**
+ * Installs a backend for all csync_vio_local_* calls, nullptr restores the
+ * operating system's file system. The caller keeps ownership. Must not be
+ * changed while directory handles are open.
+ */
+void OCSYNC_EXPORT csync_vio_local_set_backend(CSyncVioLocalBackend *backend);
+CSyncVioLocalBackend OCSYNC_EXPORT *csync_vio_local_backend();
+
 #endif /* _CSYNC_VIO_LOCAL_H */
@@ -51,6 +51,10 @@ struct dhandle_t {
 static int _csync_vio_local_stat_mb(const mbchar_t *wuri, csync_file_stat_t *buf);
 
 csync_vio_handle_t *csync_vio_local_opendir(const char *name) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->opendir(name);
+  }
+
   dhandle_t *handle = nullptr;
   mbchar_t *dirname = nullptr;
 
@@ -72,6 +76,10 @@ csync_vio_handle_t *csync_vio_local_opendir(const char *name) {
 }
 
 int csync_vio_local_closedir(csync_vio_handle_t *dhandle) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->closedir(dhandle);
+  }
+
   dhandle_t *handle = nullptr;
   int rc = -1;
 
@@ -90,6 +98,9 @@ int csync_vio_local_closedir(csync_vio_handle_t *dhandle) {
 }
 
 std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *dhandle) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->readdir(dhandle);
+  }
 
   dhandle_t *handle = nullptr;
 
@@ -145,6 +156,11 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *d
 
 int csync_vio_local_stat(const char *uri, csync_file_stat_t *buf)
 {
+    if (auto backend = csync_vio_local_backend()) {
+        *buf = csync_file_stat_t();
+        return backend->stat(uri, buf);
+    }
+
     mbchar_t *wuri = c_utf8_path_to_locale(uri);
     *buf = csync_file_stat_t();
     int rc = _csync_vio_local_stat_mb(wuri, buf);
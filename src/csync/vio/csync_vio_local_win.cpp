@@ -53,6 +53,10 @@ struct dhandle_t {
 static int _csync_vio_local_stat_mb(const mbchar_t *uri, csync_file_stat_t *buf);
 
 csync_vio_handle_t *csync_vio_local_opendir(const char *name) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->opendir(name);
+  }
+
   dhandle_t *handle = nullptr;
   mbchar_t *dirname = nullptr;
 
@@ -97,6 +101,10 @@ csync_vio_handle_t *csync_vio_local_opendir(const char *name) {
 }
 
 int csync_vio_local_closedir(csync_vio_handle_t *dhandle) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->closedir(dhandle);
+  }
+
   dhandle_t *handle = nullptr;
   int rc = -1;
 
@@ -140,6 +148,9 @@ static time_t FileTimeToUnixTime(FILETIME *filetime, DWORD *remainder)
 }
 
 std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *dhandle) {
+  if (auto backend = csync_vio_local_backend()) {
+      return backend->readdir(dhandle);
+  }
 
   dhandle_t *handle = nullptr;
   std::unique_ptr<csync_file_stat_t> file_stat;
@@ -216,6 +227,11 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *d
 
 int csync_vio_local_stat(const char *uri, csync_file_stat_t *buf)
 {
+    if (auto backend = csync_vio_local_backend()) {
+        *buf = csync_file_stat_t();
+        return backend->stat(uri, buf);
+    }
+
     mbchar_t *wuri = c_utf8_path_to_locale(uri);
     int rc = _csync_vio_local_stat_mb(wuri, buf);
     c_free_locale_string(wuri);
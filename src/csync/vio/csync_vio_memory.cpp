@@ -0,0 +1,210 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "vio/csync_vio_memory.h"
+
+#include <QList>
+
+#include <cerrno>
+#include <thread>
+
+namespace {
+
+struct MemoryDirHandle
+{
+    QByteArray path;
+    QList<QByteArray> names; // taken at opendir, like a directory stream
+    int next = 0;
+};
+
+QList<QByteArray> splitPath(const QByteArray &path)
+{
+    QList<QByteArray> parts = path.split('/');
+    parts.removeAll(QByteArray());
+    return parts;
+}
+}
+
+CSyncVioMemoryBackend::CSyncVioMemoryBackend()
+    : _root(new Node)
+{
+    _root->inode = _nextInode++;
+    resetCallCounts();
+    for (auto &latency : _latencyUsecs)
+        latency.store(0);
+}
+
+CSyncVioMemoryBackend::~CSyncVioMemoryBackend() = default;
+
+CSyncVioMemoryBackend::Node *CSyncVioMemoryBackend::find(const QByteArray &path) const
+{
+    Node *node = _root.get();
+    for (const auto &part : splitPath(path)) {
+        auto it = node->children.find(part);
+        if (it == node->children.end())
+            return nullptr;
+        node = it->second.get();
+    }
+    return node;
+}
+
+CSyncVioMemoryBackend::Node *CSyncVioMemoryBackend::create(const QByteArray &path, ItemType type)
+{
+    Node *node = _root.get();
+    const auto parts = splitPath(path);
+    for (int i = 0; i < parts.size(); ++i) {
+        auto &child = node->children[parts.at(i)];
+        if (!child) {
+            child.reset(new Node);
+            child->inode = _nextInode++;
+        }
+        node = child.get();
+        // Parents are always directories, replacing a file if there was one
+        if (i + 1 < parts.size() && node->type != ItemTypeDirectory) {
+            node->type = ItemTypeDirectory;
+            node->size = 0;
+        }
+    }
+    if (node->type != type)
+        node->children.clear();
+    node->type = type;
+    return node;
+}
+
+void CSyncVioMemoryBackend::mkdir(const QByteArray &path)
+{
+    QMutexLocker locker(&_mutex);
+    create(path, ItemTypeDirectory);
+}
+
+void CSyncVioMemoryBackend::addFile(const QByteArray &path, int64_t size, time_t modtime)
+{
+    QMutexLocker locker(&_mutex);
+    Node *node = create(path, ItemTypeFile);
+    node->size = size;
+    node->modtime = modtime;
+}
+
+bool CSyncVioMemoryBackend::remove(const QByteArray &path)
+{
+    auto parts = splitPath(path);
+    if (parts.isEmpty())
+        return false;
+    const QByteArray name = parts.takeLast();
+
+    QMutexLocker locker(&_mutex);
+    Node *parent = find(parts.join('/'));
+    return parent && parent->children.erase(name) > 0;
+}
+
+void CSyncVioMemoryBackend::setLatency(Syscall call, std::chrono::microseconds latency)
+{
+    _latencyUsecs[call].store(latency.count());
+}
+
+void CSyncVioMemoryBackend::resetCallCounts()
+{
+    for (auto &count : _calls)
+        count.store(0);
+}
+
+void CSyncVioMemoryBackend::enter(Syscall call)
+{
+    ++_calls[call];
+    const qint64 latency = _latencyUsecs[call].load();
+    if (latency > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(latency));
+}
+
+void CSyncVioMemoryBackend::fillStat(const Node &node, csync_file_stat_t *buf)
+{
+    buf->type = node.type;
+    buf->size = node.size;
+    buf->modtime = node.modtime;
+    buf->inode = node.inode;
+}
+
+csync_vio_handle_t *CSyncVioMemoryBackend::opendir(const char *name)
+{
+    enter(OpenDir);
+
+    QMutexLocker locker(&_mutex);
+    const Node *node = find(name);
+    if (!node) {
+        errno = ENOENT;
+        return nullptr;
+    }
+    if (node->type != ItemTypeDirectory) {
+        errno = ENOTDIR;
+        return nullptr;
+    }
+
+    auto handle = new MemoryDirHandle;
+    handle->path = name;
+    for (const auto &child : node->children)
+        handle->names.append(child.first);
+    return handle;
+}
+
+int CSyncVioMemoryBackend::closedir(csync_vio_handle_t *dhandle)
+{
+    enter(CloseDir);
+
+    if (!dhandle) {
+        errno = EBADF;
+        return -1;
+    }
+    delete static_cast<MemoryDirHandle *>(dhandle);
+    return 0;
+}
+
+std::unique_ptr<csync_file_stat_t> CSyncVioMemoryBackend::readdir(csync_vio_handle_t *dhandle)
+{
+    enter(ReadDir);
+
+    auto handle = static_cast<MemoryDirHandle *>(dhandle);
+    // The local backends stat every entry they return
+    if (handle->next < handle->names.size())
+        enter(Stat);
+
+    QMutexLocker locker(&_mutex);
+    while (handle->next < handle->names.size()) {
+        const QByteArray &name = handle->names.at(handle->next++);
+        const Node *node = find(handle->path + '/' + name);
+        if (!node)
+            continue; // removed since opendir
+
+        auto file_stat = std::make_unique<csync_file_stat_t>();
+        file_stat->path = name;
+        fillStat(*node, file_stat.get());
+        return file_stat;
+    }
+    return {};
+}
+
+int CSyncVioMemoryBackend::stat(const char *uri, csync_file_stat_t *buf)
+{
+    enter(Stat);
+
+    QMutexLocker locker(&_mutex);
+    const Node *node = find(uri);
+    if (!node) {
+        errno = ENOENT;
+        return -1;
+    }
+    fillStat(*node, buf);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _CSYNC_VIO_MEMORY_H
+#define _CSYNC_VIO_MEMORY_H
+
+#include "csync.h"
+#include "vio/csync_vio_local.h"
+
+#include <QMutex>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+
+/**
+ * @brief A local file system that only exists in memory
+ *
+ * Used to run local discovery against a deterministic tree: the directory
+ * listings don't depend on the disk or the page cache, and every call can be
+ * slowed down by a fixed latency to simulate network file systems.
+ *
+ * Paths are absolute and '/' separated, like the ones csync passes to the
+ * csync_vio_local_* functions. Directory listings are sorted by name.
+ */
+class OCSYNC_EXPORT CSyncVioMemoryBackend : public CSyncVioLocalBackend
+{
+public:
+    enum Syscall {
+        OpenDir,
+        ReadDir,
+        CloseDir,
+        Stat,
+        SyscallCount
+    };
+
+    CSyncVioMemoryBackend();
+    ~CSyncVioMemoryBackend() override;
+
+    /** Adds a directory, including missing parent directories. */
+    void mkdir(const QByteArray &path);
+
+    /** Adds or updates a file, including missing parent directories. */
+    void addFile(const QByteArray &path, int64_t size, time_t modtime);
+
+    /** Removes a file or a directory with its contents. */
+    bool remove(const QByteArray &path);
+
+    /** The time every call of the given kind takes at least. */
+    void setLatency(Syscall call, std::chrono::microseconds latency);
+
+    quint64 callCount(Syscall call) const { return _calls[call].load(); }
+    void resetCallCounts();
+
+    csync_vio_handle_t *opendir(const char *name) override;
+    int closedir(csync_vio_handle_t *dhandle) override;
+    std::unique_ptr<csync_file_stat_t> readdir(csync_vio_handle_t *dhandle) override;
+    int stat(const char *uri, csync_file_stat_t *buf) override;
+
+private:
+    struct Node
+    {
+        ItemType type = ItemTypeDirectory;
+        int64_t size = 0;
+        time_t modtime = 0;
+        uint64_t inode = 0;
+        std::map<QByteArray, std::unique_ptr<Node>> children;
+    };
+
+    // Both expect _mutex to be locked
+    Node *find(const QByteArray &path) const;
+    Node *create(const QByteArray &path, ItemType type);
+
+    void enter(Syscall call);
+    static void fillStat(const Node &node, csync_file_stat_t *buf);
+
+    mutable QMutex _mutex;
+    std::unique_ptr<Node> _root;
+    uint64_t _nextInode = 1;
+    std::array<std::atomic<qint64>, SyscallCount> _latencyUsecs;
+    std::array<std::atomic<quint64>, SyscallCount> _calls;
+};
+
+#endif /* _CSYNC_VIO_MEMORY_H */
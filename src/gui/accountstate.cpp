@@ -218,6 +218,10 @@ void AccountState::checkConnectivity()
 
     // If we never fetched credentials, do that now - otherwise connection attempts
     // make little sense, we might be missing client certs.
+    if (!_connectingSince.isValid() && !isConnected()) {
+        _connectingSince.start();
+    }
+
     if (!account()->credentials()->wasFetched()) {
         _waitingForNewCredentials = true;
         account()->credentials()->fetchFromKeychain();
@@ -298,6 +302,10 @@ void AccountState::slotConnectionValidatorResult(ConnectionValidator::Status sta
     switch (status) {
     case ConnectionValidator::Connected:
         if (_state != Connected) {
+            if (_connectingSince.isValid()) {
+                qCInfo(lcAccountState) << "Connected to" << _account->url().toString() << "after" << _connectingSince.elapsed() << "ms";
+                _connectingSince.invalidate();
+            }
             setState(Connected);
 
             // Get the Apps available on the server.
@@ -380,6 +388,9 @@ void AccountState::slotCredentialsFetched(AbstractCredentials *)
     // going before bothering the user for a password.
     qCInfo(lcAccountState) << "Fetched credentials for" << _account->url().toString()
                            << "attempting to connect";
+    if (_connectingSince.isValid()) {
+        qCInfo(lcAccountState) << "Credentials arrived after" << _connectingSince.elapsed() << "ms";
+    }
     _waitingForNewCredentials = false;
     checkConnectivity();
 }
@@ -194,6 +194,7 @@ private:
     QStringList _connectionErrors;
     bool _waitingForNewCredentials;
     QElapsedTimer _timeSinceLastETagCheck;
+    QElapsedTimer _connectingSince; // from the first credentials fetch or connection check until Connected
     QPointer<ConnectionValidator> _connectionValidator;
     QByteArray _notificationsEtagResponseHeader;
     QByteArray _navigationAppsEtagResponseHeader;
@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "adaptivepollinterval.h"
+
+#include <algorithm>
+
+using namespace std::chrono;
+
+namespace OCC {
+
+// The remote poll interval is at least five seconds, don't go below that
+static const milliseconds lowestInterval = seconds(5);
+
+AdaptivePollInterval::AdaptivePollInterval(milliseconds base, milliseconds maximum)
+{
+    setBounds(base, maximum);
+}
+
+void AdaptivePollInterval::setBounds(milliseconds base, milliseconds maximum)
+{
+    _base = std::max(base, lowestInterval);
+    _maximum = std::max(maximum, _base);
+    _interval = _base;
+}
+
+milliseconds AdaptivePollInterval::minimum() const
+{
+    return std::max(_base / 2, lowestInterval);
+}
+
+void AdaptivePollInterval::etagUnchanged()
+{
+    _interval = std::min(_interval * 3 / 2, _maximum);
+}
+
+void AdaptivePollInterval::remoteChanged()
+{
+    _interval = minimum();
+}
+
+void AdaptivePollInterval::localActivity()
+{
+    _interval = std::min(_interval, _base);
+}
+
+}
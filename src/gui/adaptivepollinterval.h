@@ -0,0 +1,59 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief The etag poll interval of a folder, adapted to how often it changes
+ *
+ * Starts at the configured remote poll interval. Every poll that finds the
+ * etag unchanged makes the interval longer, up to maximum(), so folders that
+ * are idle for a long time cost the server few requests. A remote change
+ * drops the interval to minimum(), as more changes tend to follow. Local
+ * activity brings a long interval back to the base interval.
+ *
+ * @ingroup gui
+ */
+class AdaptivePollInterval
+{
+public:
+    explicit AdaptivePollInterval(std::chrono::milliseconds base = std::chrono::seconds(30),
+        std::chrono::milliseconds maximum = std::chrono::minutes(10));
+
+    /** Sets the base and maximum interval and resets the interval to the base. */
+    void setBounds(std::chrono::milliseconds base, std::chrono::milliseconds maximum);
+
+    std::chrono::milliseconds interval() const { return _interval; }
+    std::chrono::milliseconds base() const { return _base; }
+    std::chrono::milliseconds minimum() const;
+    std::chrono::milliseconds maximum() const { return _maximum; }
+
+    /** A poll found the etag unchanged. */
+    void etagUnchanged();
+
+    /** A poll found the etag changed. */
+    void remoteChanged();
+
+    /** Something changed in the local folder or was synced. */
+    void localActivity();
+
+private:
+    std::chrono::milliseconds _base;
+    std::chrono::milliseconds _maximum;
+    std::chrono::milliseconds _interval;
+};
+
+}
@@ -187,6 +187,10 @@ Application::Application(int &argc, char **argv)
     setupLogging();
     setupTranslations();
 
+    const auto stallThreshold = StallWatchdog::configuredThreshold();
+    if (stallThreshold.count() > 0)
+        _stallWatchdog.reset(new StallWatchdog(stallThreshold));
+
     // The timeout is initialized with an environment variable, if not, override with the value from the config
     ConfigFile cfg;
     if (!AbstractNetworkJob::httpTimeout)
@@ -214,6 +218,15 @@ Application::Application(int &argc, char **argv)
             return;
         }
     }
+    qCInfo(lcApplication) << "Restored" << AccountManager::instance()->accounts().size() << "accounts after"
+                          << _startedAt.elapsed() << "ms";
+
+    // Start reading the credentials of all accounts now: the keychain answers
+    // while the gui and the folders are set up, and every account validates
+    // its connection as soon as its own credentials arrived.
+    for (const auto &accountState : AccountManager::instance()->accounts()) {
+        accountState->checkConnectivity();
+    }
 
     FolderMan::instance()->setSyncEnabled(true);
 
@@ -232,7 +245,10 @@ Application::Application(int &argc, char **argv)
     _gui->setupCloudProviders();
 #endif
 
+    QElapsedTimer folderSetupTimer;
+    folderSetupTimer.start();
     FolderMan::instance()->setupFolders();
+    qCInfo(lcApplication) << "Set up folders in" << folderSetupTimer.elapsed() << "ms," << _startedAt.elapsed() << "ms after start";
     _proxy.setupQtProxyFromConfig(); // folders have to be defined first, than we set up the Qt proxy.
 
     // Enable word wrapping of QInputDialog (#4197)
@@ -250,7 +266,7 @@ Application::Application(int &argc, char **argv)
         _gui.data(), &ownCloudGui::slotShowShareDialog);
 
     // startup procedure.
-    connect(&_checkConnectionTimer, &QTimer::timeout, this, &Application::slotCheckConnection);
+    connect(&_checkConnectionTimer, &CoalescedTimer::timeout, this, &Application::slotCheckConnection);
     _checkConnectionTimer.setInterval(ConnectionValidator::DefaultCallingIntervalMsec); // check for connection every 32 seconds.
     _checkConnectionTimer.start();
     // Also check immediately
@@ -280,6 +296,9 @@ Application::Application(int &argc, char **argv)
 
 Application::~Application()
 {
+    // notify() must not use the watchdog while the members are destroyed
+    _stallWatchdog.reset();
+
     // Make sure all folders are gone, otherwise removing the
     // accounts will remove the associated folders from the settings.
     if (_folderManager) {
@@ -292,6 +311,15 @@ Application::~Application()
     AccountManager::instance()->shutdown();
 }
 
+bool Application::notify(QObject *receiver, QEvent *event)
+{
+    if (!_stallWatchdog)
+        return SharedTools::QtSingleApplication::notify(receiver, event);
+
+    StallWatchdog::Dispatch dispatch(_stallWatchdog.data(), receiver, event);
+    return SharedTools::QtSingleApplication::notify(receiver, event);
+}
+
 void Application::slotAccountStateRemoved(AccountState *accountState)
 {
     if (_gui) {
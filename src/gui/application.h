@@ -31,6 +31,8 @@
 #include "progressdispatcher.h"
 #include "clientproxy.h"
 #include "folderman.h"
+#include "stallwatchdog.h"
+#include "timerwheel.h"
 
 class QMessageBox;
 class QSystemTrayIcon;
@@ -69,6 +71,8 @@ public:
 
     void showMainDialog();
 
+    bool notify(QObject *receiver, QEvent *event) override;
+
 public slots:
     // TODO: this should not be public
     void slotownCloudWizardDone(int);
@@ -121,12 +125,13 @@ private:
     ClientProxy _proxy;
 
     QNetworkConfigurationManager _networkConfigurationManager;
-    QTimer _checkConnectionTimer;
+    CoalescedTimer _checkConnectionTimer;
 
 #if defined(WITH_CRASHREPORTER)
     QScopedPointer<CrashReporter::Handler> _crashHandler;
 #endif
     QScopedPointer<FolderMan> _folderManager;
+    QScopedPointer<StallWatchdog> _stallWatchdog;
 };
 
 } // namespace OCC
@@ -427,6 +427,11 @@ void WebFlowCredentials::slotFinished(QNetworkReply *reply) {
 }
 
 void WebFlowCredentials::fetchFromKeychainHelper() {
+    // The entries don't depend on each other, so the reads go to the
+    // keychain together instead of waiting for each other.
+    _keychainReadTimer.start();
+    _pendingKeychainReads = 4;
+
     // Read client cert from keychain
     auto job = new KeychainChunk::ReadJob(_account,
                                           _user + clientCertificatePEMC,
@@ -434,6 +439,39 @@ void WebFlowCredentials::fetchFromKeychainHelper() {
                                           this);
     connect(job, &KeychainChunk::ReadJob::finished, this, &WebFlowCredentials::slotReadClientCertPEMJobDone);
     job->start();
+
+    // Load key too
+    job = new KeychainChunk::ReadJob(_account,
+                                     _user + clientKeyPEMC,
+                                     _keychainMigration,
+                                     this);
+    connect(job, &KeychainChunk::ReadJob::finished, this, &WebFlowCredentials::slotReadClientKeyPEMJobDone);
+    job->start();
+
+    // Start fetching client CA certs
+    _clientSslCaCertificates.clear();
+    readSingleClientCaCertPEM();
+
+    // And the actual server password
+    const QString kck = keychainKey(
+        _account->url().toString(),
+        _user,
+        _keychainMigration ? QString() : _account->id());
+
+    auto passwordJob = new ReadPasswordJob(Theme::instance()->appName(), this);
+#if defined(KEYCHAINCHUNK_ENABLE_INSECURE_FALLBACK)
+    addSettingsToJob(_account, passwordJob);
+#endif
+    passwordJob->setInsecureFallback(false);
+    passwordJob->setKey(kck);
+    connect(passwordJob, &Job::finished, this, &WebFlowCredentials::slotReadPasswordJobDone);
+    passwordJob->start();
+}
+
+void WebFlowCredentials::keychainReadFinished()
+{
+    if (--_pendingKeychainReads == 0)
+        slotKeychainReadsDone();
 }
 
 void WebFlowCredentials::slotReadClientCertPEMJobDone(KeychainChunk::ReadJob *readJob)
@@ -446,13 +484,7 @@ void WebFlowCredentials::slotReadClientCertPEMJobDone(KeychainChunk::ReadJob *re
         }
     }
 
-    // Load key too
-    auto job = new KeychainChunk::ReadJob(_account,
-                                          _user + clientKeyPEMC,
-                                          _keychainMigration,
-                                          this);
-    connect(job, &KeychainChunk::ReadJob::finished, this, &WebFlowCredentials::slotReadClientKeyPEMJobDone);
-    job->start();
+    keychainReadFinished();
 }
 
 void WebFlowCredentials::slotReadClientKeyPEMJobDone(KeychainChunk::ReadJob *readJob)
@@ -477,10 +509,7 @@ void WebFlowCredentials::slotReadClientKeyPEMJobDone(KeychainChunk::ReadJob *rea
         qCWarning(lcWebFlowCredentials) << "Unable to read client key" << readJob->errorString();
     }
 
-    // Start fetching client CA certs
-    _clientSslCaCertificates.clear();
-
-    readSingleClientCaCertPEM();
+    keychainReadFinished();
 }
 
 void WebFlowCredentials::readSingleClientCaCertPEM()
@@ -520,26 +549,26 @@ void WebFlowCredentials::slotReadClientCaCertsPEMJobDone(KeychainChunk::ReadJob
         }
     }
 
-    // Now fetch the actual server password
-    const QString kck = keychainKey(
-        _account->url().toString(),
-        _user,
-        _keychainMigration ? QString() : _account->id());
-
-    auto job = new ReadPasswordJob(Theme::instance()->appName(), this);
-#if defined(KEYCHAINCHUNK_ENABLE_INSECURE_FALLBACK)
-    addSettingsToJob(_account, job);
-#endif
-    job->setInsecureFallback(false);
-    job->setKey(kck);
-    connect(job, &Job::finished, this, &WebFlowCredentials::slotReadPasswordJobDone);
-    job->start();
+    keychainReadFinished();
 }
 
 void WebFlowCredentials::slotReadPasswordJobDone(Job *incomingJob) {
-    auto job = qobject_cast<ReadPasswordJob *>(incomingJob);
+    // Kept for slotKeychainReadsDone, which deletes it later
+    _passwordReadJob = qobject_cast<ReadPasswordJob *>(incomingJob);
+    _passwordReadJob->setAutoDelete(false);
+    keychainReadFinished();
+}
+
+void WebFlowCredentials::slotKeychainReadsDone() {
+    // This may run inside the finished() signal of the job, which QtKeychain
+    // still uses after emitting it
+    ReadPasswordJob *job = _passwordReadJob;
+    _passwordReadJob = nullptr;
+    job->deleteLater();
     QKeychain::Error error = job->error();
 
+    qCInfo(lcWebFlowCredentials) << "Read keychain entries of" << _user << "in" << _keychainReadTimer.elapsed() << "ms";
+
     // If we could not find the entry try the old entries
     if (!_keychainMigration && error == QKeychain::EntryNotFound) {
         _keychainMigration = true;
@@ -1,6 +1,7 @@
 #ifndef WEBFLOWCREDENTIALS_H
 #define WEBFLOWCREDENTIALS_H
 
+#include <QElapsedTimer>
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QNetworkRequest>
@@ -15,6 +16,7 @@ class QAuthenticator;
 
 namespace QKeychain {
     class Job;
+    class ReadPasswordJob;
 }
 
 namespace OCC {
@@ -72,6 +74,7 @@ private slots:
     void slotReadClientKeyPEMJobDone(KeychainChunk::ReadJob *readJob);
     void slotReadClientCaCertsPEMJobDone(KeychainChunk::ReadJob *readJob);
     void slotReadPasswordJobDone(QKeychain::Job *incomingJob);
+    void slotKeychainReadsDone();
 
     void slotWriteClientCertPEMJobDone(KeychainChunk::WriteJob *writeJob);
     void slotWriteClientKeyPEMJobDone(KeychainChunk::WriteJob *writeJob);
@@ -100,14 +103,18 @@ private:
 protected:
     /** Reads data from keychain locations
      *
-     * Goes through
-     *   slotReadClientCertPEMJobDone to
-     *   slotReadClientKeyPEMJobDone to
-     *   slotReadClientCaCertsPEMJobDone to
-     *   slotReadJobDone
+     * Starts these at the same time:
+     *   slotReadClientCertPEMJobDone
+     *   slotReadClientKeyPEMJobDone
+     *   slotReadClientCaCertsPEMJobDone, reading one CA cert after the other
+     *   slotReadPasswordJobDone
+     * and continues in slotKeychainReadsDone once all of them finished.
      */
     void fetchFromKeychainHelper();
 
+    /// Counts a finished keychain read, continues when it was the last one
+    void keychainReadFinished();
+
     /// Wipes legacy keychain locations
     void deleteKeychainEntries(bool oldKeychainEntries = false);
 
@@ -122,6 +129,10 @@ protected:
     bool _ready = false;
     bool _credentialsValid = false;
     bool _keychainMigration = false;
+    int _pendingKeychainReads = 0;
+    // The finished password read, kept until all reads finished
+    QKeychain::ReadPasswordJob *_passwordReadJob = nullptr;
+    QElapsedTimer _keychainReadTimer;
 
     WebFlowCredentialsDialog *_askDialog = nullptr;
 };
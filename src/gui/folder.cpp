@@ -62,6 +62,9 @@ Folder::Folder(const FolderDefinition &definition,
     _timeSinceLastSyncStart.start();
     _timeSinceLastSyncDone.start();
 
+    ConfigFile cfg;
+    _pollInterval.setBounds(cfg.remotePollInterval(), cfg.maxRemotePollInterval());
+
     SyncResult::Status status = SyncResult::NotYetStarted;
     if (definition.paused) {
         status = SyncResult::Paused;
@@ -102,6 +105,8 @@ Folder::Folder(const FolderDefinition &definition,
     connect(_engine.data(), &SyncEngine::aboutToPropagate,
         this, &Folder::slotLogPropagationStart);
     connect(_engine.data(), &SyncEngine::syncError, this, &Folder::slotSyncError);
+    connect(&_engine->writeQuiescenceTracker(), &WriteQuiescenceTracker::fileBecameQuiescent,
+        this, &Folder::slotFileBecameQuiescent);
 
     _scheduleSelfTimer.setSingleShot(true);
     _scheduleSelfTimer.setInterval(SyncEngine::minimumFileAgeForUpload);
@@ -292,6 +297,7 @@ void Folder::slotRunEtagJob()
 
     _requestEtagJob = new RequestEtagJob(account, remotePath(), this);
     _requestEtagJob->setTimeout(60 * 1000);
+    _timeSinceLastEtagCheck.start();
     // check if the etag is different when retrieved
     QObject::connect(_requestEtagJob.data(), &RequestEtagJob::etagRetrieved, this, &Folder::etagRetrieved);
     FolderMan::instance()->slotScheduleETagJob(alias(), _requestEtagJob);
@@ -306,12 +312,25 @@ void Folder::etagRetrieved(const QString &etag)
     if (_lastEtag != etag) {
         qCInfo(lcFolder) << "Compare etag with previous etag: last:" << _lastEtag << ", received:" << etag << "-> CHANGED";
         _lastEtag = etag;
+        _pollInterval.remoteChanged();
+        emit pollIntervalChanged();
         slotScheduleThisFolder();
+    } else {
+        _pollInterval.etagUnchanged();
+        qCDebug(lcFolder) << "Etag unchanged, next poll in" << _pollInterval.interval().count() << "msec";
     }
 
     _accountState->tagLastSuccessfullETagRequest();
 }
 
+std::chrono::milliseconds Folder::msecUntilEtagPollDue() const
+{
+    auto sinceLastCheck = msecSinceLastSync();
+    if (_timeSinceLastEtagCheck.isValid())
+        sinceLastCheck = std::min(sinceLastCheck, std::chrono::milliseconds(_timeSinceLastEtagCheck.elapsed()));
+    return std::max(_pollInterval.interval() - sinceLastCheck, std::chrono::milliseconds(0));
+}
+
 void Folder::etagRetrievedFromSyncEngine(const QString &etag)
 {
     qCInfo(lcFolder) << "Root etag from during sync:" << etag;
@@ -496,6 +515,9 @@ void Folder::slotWatchedPathChanged(const QString &path)
     }
 #endif
 
+    // Lets uploads notice whether the file is still growing
+    _engine->writeQuiescenceTracker().slotFileChanged(relativePath.toString());
+
     // Check that the mtime actually changed.
     SyncJournalFileRecord record;
     if (_journal.getFileRecord(relativePathBytes, &record)
@@ -507,6 +529,8 @@ void Folder::slotWatchedPathChanged(const QString &path)
 
     warnOnNewExcludedItem(record, relativePath);
 
+    _pollInterval.localActivity();
+    emit pollIntervalChanged();
     emit watchedFileChangedExternally(path);
 
     // Also schedule this folder for a sync, but only after some delay:
@@ -514,6 +538,25 @@ void Folder::slotWatchedPathChanged(const QString &path)
     scheduleThisFolderSoon();
 }
 
+void Folder::slotWatchedFileWritten(const QString &path)
+{
+    if (path.startsWith(this->path()))
+        _engine->writeQuiescenceTracker().slotFileWritten(path.mid(this->path().size()));
+}
+
+void Folder::slotWatchedFileClosed(const QString &path)
+{
+    if (path.startsWith(this->path()))
+        _engine->writeQuiescenceTracker().slotFileClosed(path.mid(this->path().size()));
+}
+
+void Folder::slotFileBecameQuiescent(const QString &relativePath)
+{
+    qCInfo(lcFolder) << "Scheduling sync for" << relativePath << "which is no longer being written to";
+    _localDiscoveryPaths.insert(relativePath.toUtf8());
+    scheduleThisFolderSoon();
+}
+
 void Folder::saveToSettings() const
 {
     // Remove first to make sure we don't get duplicates
@@ -728,6 +771,11 @@ void Folder::setSyncOptions()
         opt._targetChunkUploadDuration = cfgFile.targetChunkUploadDuration();
     }
 
+    QByteArray discoverySpillThresholdEnv = qgetenv("OWNCLOUD_DISCOVERY_SPILL_THRESHOLD");
+    if (!discoverySpillThresholdEnv.isEmpty()) {
+        opt._discoverySpillThreshold = discoverySpillThresholdEnv.toLongLong();
+    }
+
     _engine->setSyncOptions(opt);
 }
 
@@ -820,18 +868,19 @@ void Folder::slotSyncFinished(bool success)
     // bug: This function uses many different criteria for "sync was successful" - investigate!
     if ((_syncResult.status() == SyncResult::Success
             || _syncResult.status() == SyncResult::Problem)
-        && success) {
+        && success && !_engine->lastSyncResumedPlan()) {
         if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly) {
             _timeSinceLastFullLocalDiscovery.start();
         }
         qCDebug(lcFolder) << "Sync success, forgetting last sync's local discovery path list";
     } else {
         // On overall-failure we can't forget about last sync's local discovery
-        // paths yet, reuse them for the next sync again.
+        // paths yet, reuse them for the next sync again. Neither after resuming
+        // a sync plan, which did no local discovery.
         // C++17: Could use std::set::merge().
         _localDiscoveryPaths.insert(
             _previousLocalDiscoveryPaths.begin(), _previousLocalDiscoveryPaths.end());
-        qCDebug(lcFolder) << "Sync failed, keeping last sync's local discovery path list";
+        qCDebug(lcFolder) << "Sync failed or resumed a plan, keeping last sync's local discovery path list";
     }
     _previousLocalDiscoveryPaths.clear();
 
@@ -878,6 +927,8 @@ void Folder::slotEmitFinishedDelayed()
                || _syncResult.firstItemRenamed()
                || _syncResult.firstItemUpdated()
                || _syncResult.firstNewConflictItem())) {
+        _pollInterval.localActivity();
+        emit pollIntervalChanged();
         slotRunEtagJob();
     }
 }
@@ -1020,6 +1071,17 @@ void Folder::scheduleThisFolderSoon()
     }
 }
 
+void Folder::syncPathNow(const QString &relativePath)
+{
+    _engine->prioritizePath(relativePath);
+    if (isBusy())
+        return;
+
+    _localDiscoveryPaths.insert(relativePath.toUtf8());
+    _journal.avoidReadFromDbOnNextSync(relativePath);
+    FolderMan::instance()->scheduleFolderNext(this);
+}
+
 void Folder::setSaveBackwardsCompatible(bool save)
 {
     _saveBackwardsCompatible = save;
@@ -1039,6 +1101,10 @@ void Folder::registerFolderWatcher()
         this, &Folder::slotNextSyncFullLocalDiscovery);
     connect(_folderWatcher.data(), &FolderWatcher::becameUnreliable,
         this, &Folder::slotWatcherUnreliable);
+    connect(_folderWatcher.data(), &FolderWatcher::fileWritten,
+        this, &Folder::slotWatchedFileWritten);
+    connect(_folderWatcher.data(), &FolderWatcher::fileClosedAfterWrite,
+        this, &Folder::slotWatchedFileClosed);
     _folderWatcher->init(path());
     _folderWatcher->startNotificatonTest(path() + QLatin1String(".owncloudsync.log"));
 }
@@ -21,6 +21,7 @@
 #include "progressdispatcher.h"
 #include "common/syncjournaldb.h"
 #include "networkjobs.h"
+#include "adaptivepollinterval.h"
 
 #include <csync.h>
 
@@ -187,6 +188,10 @@ public:
 
     RequestEtagJob *etagJob() { return _requestEtagJob; }
     std::chrono::milliseconds msecSinceLastSync() const { return std::chrono::milliseconds(_timeSinceLastSyncDone.elapsed()); }
+    const AdaptivePollInterval &pollInterval() const { return _pollInterval; }
+    /** Whether the poll interval passed since the last sync and the last etag check */
+    bool isEtagPollDue() const { return msecUntilEtagPollDue().count() == 0; }
+    std::chrono::milliseconds msecUntilEtagPollDue() const;
     std::chrono::milliseconds msecLastSyncDuration() const { return _lastSyncDuration; }
     int consecutiveFollowUpSyncs() const { return _consecutiveFollowUpSyncs; }
     int consecutiveFailingSyncs() const { return _consecutiveFailingSyncs; }
@@ -217,6 +222,14 @@ public:
       */
     void scheduleThisFolderSoon();
 
+    /** Gets the folder-relative path and everything below it synced as soon as possible.
+      *
+      * A running sync propagates it before the remaining items. Otherwise
+      * this folder is synced next, with the path discovered locally and on
+      * the server, and it is propagated first.
+      */
+    void syncPathNow(const QString &relativePath);
+
     /**
       * Migration: When this flag is true, this folder will save to
       * the backwards-compatible 'Folders' section in the config file.
@@ -239,6 +252,9 @@ signals:
     void syncPausedChanged(Folder *, bool paused);
     void canSyncChanged();
 
+    /** The poll interval changed, the next etag poll may be due earlier. */
+    void pollIntervalChanged();
+
     /**
      * Fires for each change inside this folder that wasn't caused
      * by sync activity.
@@ -320,6 +336,13 @@ private slots:
     /** Warn users about an unreliable folder watcher */
     void slotWatcherUnreliable(const QString &message);
 
+    /** Pass write and close notifications of the folder watcher on to the write quiescence tracker */
+    void slotWatchedFileWritten(const QString &path);
+    void slotWatchedFileClosed(const QString &path);
+
+    /** A file whose upload waited for its writer can be synced now */
+    void slotFileBecameQuiescent(const QString &relativePath);
+
 private:
     bool reloadExcludes();
 
@@ -352,6 +375,8 @@ private:
     bool _csyncUnavail;
     QPointer<RequestEtagJob> _requestEtagJob;
     QString _lastEtag;
+    AdaptivePollInterval _pollInterval;
+    QElapsedTimer _timeSinceLastEtagCheck;
     QElapsedTimer _timeSinceLastSyncDone;
     QElapsedTimer _timeSinceLastSyncStart;
     QElapsedTimer _timeSinceLastFullLocalDiscovery;
@@ -46,8 +46,14 @@ Q_LOGGING_CATEGORY(lcFolderMan, "nextcloud.gui.folder.manager", QtInfoMsg)
 
 FolderMan *FolderMan::_instance = nullptr;
 
+// While a sync retry is pending the time scheduler has to check often,
+// otherwise it only looks for expired force sync intervals.
+static const std::chrono::milliseconds timeSchedulerRetryInterval = std::chrono::seconds(5);
+static const std::chrono::milliseconds timeSchedulerIdleInterval = std::chrono::minutes(1);
+
 FolderMan::FolderMan(QObject *parent)
     : QObject(parent)
+    , _folderPathIndex((Utility::isWindows() || Utility::isMac()) ? Qt::CaseInsensitive : Qt::CaseSensitive)
     , _lockWatcher(new LockWatcher)
     , _navigationPaneHelper(this)
 {
@@ -57,19 +63,21 @@ FolderMan::FolderMan(QObject *parent)
     _socketApi.reset(new SocketApi);
 
     ConfigFile cfg;
-    std::chrono::milliseconds polltime = cfg.remotePollInterval();
+    // Folders with recent remote changes poll faster than the configured
+    // interval. Each timeout picks the time until the next folder is due.
+    const auto polltime = AdaptivePollInterval(cfg.remotePollInterval()).minimum();
     qCInfo(lcFolderMan) << "setting remote poll timer interval to" << polltime.count() << "msec";
-    _etagPollTimer.setInterval(polltime.count());
-    QObject::connect(&_etagPollTimer, &QTimer::timeout, this, &FolderMan::slotEtagPollTimerTimeout);
+    _etagPollTimer.setInterval(polltime);
+    QObject::connect(&_etagPollTimer, &CoalescedTimer::timeout, this, &FolderMan::slotEtagPollTimerTimeout);
     _etagPollTimer.start();
 
     _startScheduledSyncTimer.setSingleShot(true);
     connect(&_startScheduledSyncTimer, &QTimer::timeout,
         this, &FolderMan::slotStartScheduledFolderSync);
 
-    _timeScheduler.setInterval(5000);
+    _timeScheduler.setInterval(timeSchedulerRetryInterval);
     _timeScheduler.setSingleShot(false);
-    connect(&_timeScheduler, &QTimer::timeout,
+    connect(&_timeScheduler, &CoalescedTimer::timeout,
         this, &FolderMan::slotScheduleFolderByTime);
     _timeScheduler.start();
 
@@ -107,6 +115,7 @@ void FolderMan::unloadFolder(Folder *f)
     _socketApi->slotUnregisterPath(f->alias());
 
     _folderMap.remove(f->alias());
+    _folderPathIndex.remove(f->cleanPath(), f);
 
     disconnect(f, &Folder::syncStarted,
         this, &FolderMan::slotFolderSyncStarted);
@@ -116,6 +125,8 @@ void FolderMan::unloadFolder(Folder *f)
         this, &FolderMan::slotForwardFolderSyncStateChange);
     disconnect(f, &Folder::syncPausedChanged,
         this, &FolderMan::slotFolderSyncPaused);
+    disconnect(f, &Folder::pollIntervalChanged,
+        this, &FolderMan::slotFolderPollIntervalChanged);
     disconnect(&f->syncEngine().syncFileStatusTracker(), &SyncFileStatusTracker::fileStatusChanged,
         _socketApi.data(), &SocketApi::broadcastStatusPushMessage);
     disconnect(f, &Folder::watchedFileChangedExternally,
@@ -786,6 +797,38 @@ void FolderMan::slotEtagPollTimerTimeout()
     qCInfo(lcFolderMan) << "Number of folders that don't use push notifications:" << foldersToRun.size();
 
     runEtagJobsIfPossible(foldersToRun);
+
+    // Sleep until the next folder is due. Folders that are due now were
+    // just polled or are busy, they are due again after their interval.
+    // Without folders to poll, wake up after the longest interval.
+    const ConfigFile cfg;
+    const AdaptivePollInterval defaultInterval(cfg.remotePollInterval(), cfg.maxRemotePollInterval());
+    auto nextPoll = defaultInterval.maximum();
+    for (auto folder : qAsConst(foldersToRun)) {
+        auto untilDue = folder->msecUntilEtagPollDue();
+        if (untilDue.count() == 0)
+            untilDue = folder->pollInterval().interval();
+        nextPoll = std::min(nextPoll, untilDue);
+    }
+    nextPoll = std::max(nextPoll, defaultInterval.minimum());
+    _etagPollTimer.start(nextPoll);
+}
+
+void FolderMan::slotFolderPollIntervalChanged()
+{
+    auto folder = qobject_cast<Folder *>(sender());
+    if (!folder || pushNotificationsFilesReady(folder->accountState()->account().data()))
+        return;
+
+    // The timer was armed for the intervals before the change: wake up
+    // earlier if the folder is now due before that.
+    auto untilDue = folder->msecUntilEtagPollDue();
+    untilDue = std::max(untilDue, AdaptivePollInterval(ConfigFile().remotePollInterval()).minimum());
+    const auto remaining = _etagPollTimer.remainingTime();
+    if (remaining >= 0 && remaining <= untilDue.count())
+        return;
+    qCInfo(lcFolderMan) << "Poll interval of" << folder->alias() << "dropped, next etag poll in" << untilDue.count() << "msec";
+    _etagPollTimer.start(untilDue);
 }
 
 void FolderMan::runEtagJobsIfPossible(const QList<Folder *> &folderMap)
@@ -797,9 +840,6 @@ void FolderMan::runEtagJobsIfPossible(const QList<Folder *> &folderMap)
 
 void FolderMan::runEtagJobIfPossible(Folder *folder)
 {
-    const ConfigFile cfg;
-    const auto polltime = cfg.remotePollInterval();
-
     qCInfo(lcFolderMan) << "Run etag job on folder" << folder;
 
     if (!folder) {
@@ -821,9 +861,9 @@ void FolderMan::runEtagJobIfPossible(Folder *folder)
         qCInfo(lcFolderMan) << "Can not run etag job: Folder is busy";
         return;
     }
-    // When not using push notifications, make sure polltime is reached
+    // When not using push notifications, make sure the folder's poll interval is reached
     if (!pushNotificationsFilesReady(folder->accountState()->account().data())) {
-        if (folder->msecSinceLastSync() < polltime) {
+        if (!folder->isEtagPollDue()) {
             qCInfo(lcFolderMan) << "Can not run etag job: Polltime not reached";
             return;
         }
@@ -881,7 +921,15 @@ void FolderMan::slotWatchedFileUnlocked(const QString &path)
 
 void FolderMan::slotScheduleFolderByTime()
 {
+    bool retryPending = false;
     for (const auto &f : qAsConst(_folderMap)) {
+        // Retry a couple of times after failure; or regularly if requested
+        bool syncAgain =
+            (f->consecutiveFailingSyncs() > 0 && f->consecutiveFailingSyncs() < 3)
+            || f->syncEngine().isAnotherSyncNeeded() == DelayedFollowUp;
+        // Keep checking often for folders that can't be scheduled right now
+        retryPending |= syncAgain;
+
         // Never schedule if syncing is disabled or when we're currently
         // querying the server for etags
         if (!f->canSync() || f->etagJob()) {
@@ -901,10 +949,6 @@ void FolderMan::slotScheduleFolderByTime()
             continue;
         }
 
-        // Retry a couple of times after failure; or regularly if requested
-        bool syncAgain =
-            (f->consecutiveFailingSyncs() > 0 && f->consecutiveFailingSyncs() < 3)
-            || f->syncEngine().isAnotherSyncNeeded() == DelayedFollowUp;
         auto syncAgainDelay = std::chrono::seconds(10); // 10s for the first retry-after-fail
         if (f->consecutiveFailingSyncs() > 1)
             syncAgainDelay = std::chrono::seconds(60); // 60s for each further attempt
@@ -921,6 +965,10 @@ void FolderMan::slotScheduleFolderByTime()
 
         // Do we want to retry failing syncs or another-sync-needed runs more often?
     }
+
+    const auto interval = retryPending ? timeSchedulerRetryInterval : timeSchedulerIdleInterval;
+    if (_timeScheduler.interval() != interval.count())
+        _timeScheduler.start(interval);
 }
 
 void FolderMan::slotFolderSyncStarted()
@@ -947,6 +995,9 @@ void FolderMan::slotFolderSyncFinished(const SyncResult &)
     _lastSyncFolder = _currentSyncFolder;
     _currentSyncFolder = nullptr;
 
+    // The sync may want a retry, look for it soon
+    _timeScheduler.start(timeSchedulerRetryInterval);
+
     startScheduledSyncSoon();
 }
 
@@ -1001,6 +1052,7 @@ Folder *FolderMan::addFolderInternal(FolderDefinition folderDefinition,
 
     qCInfo(lcFolderMan) << "Adding folder to Folder Map " << folder << folder->alias();
     _folderMap[folder->alias()] = folder;
+    _folderPathIndex.insert(folder->cleanPath(), folder);
     if (folder->syncPaused()) {
         _disabledFolders.insert(folder);
     }
@@ -1011,6 +1063,7 @@ Folder *FolderMan::addFolderInternal(FolderDefinition folderDefinition,
     connect(folder, &Folder::syncStateChange, this, &FolderMan::slotForwardFolderSyncStateChange);
     connect(folder, &Folder::syncPausedChanged, this, &FolderMan::slotFolderSyncPaused);
     connect(folder, &Folder::canSyncChanged, this, &FolderMan::slotFolderCanSyncChanged);
+    connect(folder, &Folder::pollIntervalChanged, this, &FolderMan::slotFolderPollIntervalChanged);
     connect(&folder->syncEngine().syncFileStatusTracker(), &SyncFileStatusTracker::fileStatusChanged,
         _socketApi.data(), &SocketApi::broadcastStatusPushMessage);
     connect(folder, &Folder::watchedFileChangedExternally,
@@ -1023,15 +1076,11 @@ Folder *FolderMan::addFolderInternal(FolderDefinition folderDefinition,
 
 Folder *FolderMan::folderForPath(const QString &path)
 {
-    QString absolutePath = QDir::cleanPath(path) + QLatin1Char('/');
-
-    const auto folders = this->map().values();
-    const auto it = std::find_if(folders.cbegin(), folders.cend(), [absolutePath](const auto *folder) {
-        const QString folderPath = folder->cleanPath() + QLatin1Char('/');
-        return absolutePath.startsWith(folderPath, (Utility::isWindows() || Utility::isMac()) ? Qt::CaseInsensitive : Qt::CaseSensitive);
-    });
-
-    return it != folders.cend() ? *it : nullptr;
+    // Most paths are clean already, only the others need the copy
+    if (path.contains(QLatin1String("..")) || (Utility::isWindows() && path.contains(QLatin1Char('\\')))) {
+        return _folderPathIndex.findLongestPrefix(QDir::cleanPath(path));
+    }
+    return _folderPathIndex.findLongestPrefix(path);
 }
 
 QStringList FolderMan::findFileInLocalFolders(const QString &relPath, const AccountPtr acc)
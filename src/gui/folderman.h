@@ -23,7 +23,9 @@
 #include "folder.h"
 #include "folderwatcher.h"
 #include "navigationpanehelper.h"
+#include "pathtrie.h"
 #include "syncfileitem.h"
+#include "timerwheel.h"
 
 class TestFolderMan;
 
@@ -49,7 +51,7 @@ class LockWatcher;
  *   (_folderWatchers and Folder::slotWatchedPathChanged())
  *
  * - The folder etag on the server has changed
- *   (_etagPollTimer)
+ *   (_etagPollTimer, polling each folder at its Folder::pollInterval())
  *
  * - The locks of a monitored file are released
  *   (_lockWatcher and slotWatchedFileUnlocked())
@@ -251,6 +253,7 @@ private slots:
     // slot to take the next folder from queue and start syncing.
     void slotStartScheduledFolderSync();
     void slotEtagPollTimerTimeout();
+    void slotFolderPollIntervalChanged();
 
     void slotRemoveFoldersForAccount(AccountState *accountState);
 
@@ -312,13 +315,15 @@ private:
 
     QSet<Folder *> _disabledFolders;
     Folder::Map _folderMap;
+    /// The folders by their cleanPath(), for folderForPath()
+    PathTrie<Folder *> _folderPathIndex;
     QString _folderConfigPath;
     Folder *_currentSyncFolder = nullptr;
     QPointer<Folder> _lastSyncFolder;
     bool _syncEnabled = true;
 
     /// Starts regular etag query jobs
-    QTimer _etagPollTimer;
+    CoalescedTimer _etagPollTimer;
     /// The currently running etag query
     QPointer<RequestEtagJob> _currentEtagJob;
 
@@ -326,7 +331,7 @@ private:
     QScopedPointer<LockWatcher> _lockWatcher;
 
     /// Occasionally schedules folders
-    QTimer _timeScheduler;
+    CoalescedTimer _timeScheduler;
 
     /// Scheduled folders that should be synced as soon as possible
     QQueue<Folder *> _scheduledFolders;
@@ -932,7 +932,7 @@ void FolderStatusModel::slotSetProgress(const ProgressInfo &progress)
     quint64 estimatedUpBw = 0;
     quint64 estimatedDownBw = 0;
     QString allFilenames;
-    foreach (const ProgressInfo::ProgressItem &citm, progress._currentItems) {
+    for (const auto &citm : progress.currentItems()) {
         if (curItemProgress == -1 || (ProgressInfo::isSizeDependent(citm._item)
                                          && biggerItemSize < citm._item._size)) {
             curItemProgress = citm._progress.completed();
@@ -940,9 +940,9 @@ void FolderStatusModel::slotSetProgress(const ProgressInfo &progress)
             biggerItemSize = citm._item._size;
         }
         if (citm._item._direction != SyncFileItem::Up) {
-            estimatedDownBw += progress.fileProgress(citm._item).estimatedBandwidth;
+            estimatedDownBw += citm._progress.estimates().estimatedBandwidth;
         } else {
-            estimatedUpBw += progress.fileProgress(citm._item).estimatedBandwidth;
+            estimatedUpBw += citm._progress.estimates().estimatedBandwidth;
         }
         auto fileName = QFileInfo(citm._item._file).fileName();
         if (allFilenames.length() > 0) {
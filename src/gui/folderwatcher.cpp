@@ -39,6 +39,10 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcFolderWatcher, "nextcloud.gui.folderwatcher", QtInfoMsg)
 
+// Writes to a file that is still open are reported at most this often.
+// The WriteQuiescenceTracker only needs to know that the writer is active.
+static const qint64 writeReportInterval = 1000; // ms
+
 FolderWatcher::FolderWatcher(Folder *folder)
     : QObject(folder)
     , _folder(folder)
@@ -190,4 +194,33 @@ void FolderWatcher::changeDetected(const QStringList &paths)
     }
 }
 
+void FolderWatcher::writeDetected(const QString &path, bool closed)
+{
+    // Every write() of an application causes a call, so the rate limit comes
+    // before the exclude matching
+    const qint64 now = _timer.elapsed();
+    if (closed) {
+        _lastWriteReports.remove(path);
+    } else {
+        auto it = _lastWriteReports.find(path);
+        if (it != _lastWriteReports.end() && now - *it < writeReportInterval)
+            return;
+        if (it == _lastWriteReports.end() && _lastWriteReports.size() >= 1000) {
+            // Forget about writers whose close we missed
+            for (auto old = _lastWriteReports.begin(); old != _lastWriteReports.end();) {
+                old = now - *old < writeReportInterval ? std::next(old) : _lastWriteReports.erase(old);
+            }
+        }
+        _lastWriteReports[path] = now;
+    }
+
+    if (pathIsIgnored(path))
+        return;
+    if (closed) {
+        emit fileClosedAfterWrite(path);
+    } else {
+        emit fileWritten(path);
+    }
+}
+
 } // namespace OCC
@@ -104,11 +104,25 @@ signals:
      */
     void becameUnreliable(const QString &message);
 
+    /**
+     * Emitted when data was written to a file that is still open.
+     *
+     * Only reported by watchers that can see writes as they happen (inotify).
+     * These don't cause pathChanged(), the close of the file does.
+     */
+    void fileWritten(const QString &path);
+
+    /** Emitted when a file that was open for writing got closed. */
+    void fileClosedAfterWrite(const QString &path);
+
 protected slots:
     // called from the implementations to indicate a change in path
     void changeDetected(const QString &path);
     void changeDetected(const QStringList &paths);
 
+    // called from the implementations for writes to a file and its close
+    void writeDetected(const QString &path, bool closed);
+
 private slots:
     void startNotificationTestWhenReady();
 
@@ -119,6 +133,8 @@ private:
     QScopedPointer<FolderWatcherPrivate> _d;
     QElapsedTimer _timer;
     QSet<QString> _lastPaths;
+    // When a write to the path was last reported, see writeDetected()
+    QHash<QString, qint64> _lastWriteReports;
     Folder *_folder;
     bool _isReliable = true;
 
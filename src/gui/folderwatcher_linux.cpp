@@ -75,7 +75,7 @@ void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
         return;
 
     int wd = inotify_add_watch(_fd, path.toUtf8().constData(),
-        IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR);
+        IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR);
     if (wd > -1) {
         _watchToPath.insert(wd, path);
         _pathToWatch.insert(path, wd);
@@ -176,7 +176,18 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
             || fileName.startsWith(".sync_")) {
             continue;
         }
+        if (event->mask & IN_MODIFY) {
+            // Writes in progress don't trigger a sync, closing the file does.
+            // Our own downloads into ".name.~1a2b3c" temporary files don't
+            // need to go through the exclude matching for every write.
+            if (fileName.startsWith('.') && fileName.contains(".~"))
+                continue;
+            _parent->writeDetected(_watchToPath[event->wd] + '/' + fileName, false);
+            continue;
+        }
         const QString p = _watchToPath[event->wd] + '/' + fileName;
+        if (event->mask & IN_CLOSE_WRITE)
+            _parent->writeDetected(p, true);
         _parent->changeDetected(p);
 
         if ((event->mask & (IN_MOVED_TO | IN_CREATE))
@@ -15,43 +15,108 @@
 #include "lockwatcher.h"
 #include "filesystem.h"
 
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QStringList>
 #include <QTimer>
 
 using namespace OCC;
 
 Q_LOGGING_CATEGORY(lcLockWatcher, "nextcloud.gui.lockwatcher", QtInfoMsg)
 
-static const int check_frequency = 20 * 1000; // ms
+// The interval files used to be probed at, for counting the saved probes
+static const qint64 fixed_check_frequency = 20 * 1000; // ms
+
+// Files are probed soon after they were added, then with a growing interval
+qint64 LockWatcher::firstCheckDelay = 5 * 1000;
+qint64 LockWatcher::maxPollingInterval = fixed_check_frequency;
 
 LockWatcher::LockWatcher(QObject *parent)
     : QObject(parent)
+    , _isFileLocked(&FileSystem::isFileLocked)
 {
+    QElapsedTimer clock;
+    clock.start();
+    _now = [clock] { return clock.elapsed(); };
+    _timer.setSingleShot(true);
     connect(&_timer, &QTimer::timeout,
         this, &LockWatcher::checkFiles);
-    _timer.start(check_frequency);
 }
 
 void LockWatcher::addFile(const QString &path)
 {
+    if (_watchedFiles.contains(path))
+        return;
+
     qCInfo(lcLockWatcher) << "Watching for lock of" << path << "being released";
-    _watchedPaths.insert(path);
+    WatchedFile file;
+    file.watchedSince = _now();
+    file.interval = firstCheckDelay;
+    file.nextProbe = file.watchedSince + file.interval;
+    _watchedFiles.insert(path, file);
+    scheduleTimer();
+}
+
+bool LockWatcher::probeFile(const QString &path)
+{
+    auto it = _watchedFiles.find(path);
+    if (it == _watchedFiles.end())
+        return false;
+
+    ++_probeCount;
+    ++it->probes;
+    const auto now = _now();
+    if (_isFileLocked(path)) {
+        it->interval = qMin(it->interval * 2, maxPollingInterval);
+        it->nextProbe = now + it->interval;
+        return false;
+    }
+
+    // Polling every file at the fixed interval would have needed a probe per interval
+    const auto fixedProbes = qMax<qint64>(1, (now - it->watchedSince) / fixed_check_frequency);
+    const auto saved = qMax<qint64>(0, fixedProbes - it->probes);
+    _savedProbeCount += saved;
+    qCInfo(lcLockWatcher) << "Lock of" << path << "was released after" << it->probes << "probes,"
+                          << saved << "saved," << _savedProbeCount << "saved in total";
+    _watchedFiles.erase(it);
+    return true;
+}
+
+void LockWatcher::scheduleTimer()
+{
+    if (_watchedFiles.isEmpty()) {
+        _timer.stop();
+        return;
+    }
+    qint64 next = -1;
+    for (const auto &file : qAsConst(_watchedFiles)) {
+        if (next < 0 || file.nextProbe < next)
+            next = file.nextProbe;
+    }
+    _timer.start(static_cast<int>(qMax<qint64>(0, next - _now())));
 }
 
 void LockWatcher::checkFiles()
 {
-    QSet<QString> unlocked;
+    QStringList unlocked;
+    const auto now = _now();
 
-    foreach (const QString &path, _watchedPaths) {
-        if (!FileSystem::isFileLocked(path)) {
-            qCInfo(lcLockWatcher) << "Lock of" << path << "was released";
-            emit fileUnlocked(path);
-            unlocked.insert(path);
+    for (auto it = _watchedFiles.cbegin(); it != _watchedFiles.cend(); ++it) {
+        if (it->nextProbe <= now)
+            unlocked.append(it.key());
+    }
+    // Probing removes the unlocked files, collecting the due ones first
+    // also ensures that calling back into addFile from connected slots
+    // isn't a problem.
+    for (auto it = unlocked.begin(); it != unlocked.end();) {
+        if (probeFile(*it)) {
+            ++it;
+        } else {
+            it = unlocked.erase(it);
         }
     }
+    scheduleTimer();
 
-    // Doing it this way instead of with a QMutableSetIterator
-    // ensures that calling back into addFile from connected
-    // slots isn't a problem.
-    _watchedPaths.subtract(unlocked);
+    for (const auto &path : qAsConst(unlocked))
+        emit fileUnlocked(path);
 }
@@ -16,12 +16,13 @@
 
 #include "config.h"
 
-#include <QList>
+#include <QHash>
 #include <QObject>
 #include <QString>
-#include <QSet>
 #include <QTimer>
 
+#include <functional>
+
 namespace OCC {
 
 /**
@@ -35,6 +36,9 @@ namespace OCC {
  * becomes available again. To do that, we need to regularly check whether
  * the file is still being locked.
  *
+ * Each file is probed with a backoff: soon after it was added, then less
+ * and less often, but at least every maxPollingInterval.
+ *
  * @ingroup gui
  */
 
@@ -51,6 +55,22 @@ public:
      */
     void addFile(const QString &path);
 
+    /** The number of lock probes done */
+    qint64 probeCount() const { return _probeCount; }
+
+    /** The number of probes saved compared to probing every file at a fixed interval */
+    qint64 savedProbeCount() const { return _savedProbeCount; }
+
+    /** Replaces FileSystem::isFileLocked(), for tests */
+    void setLockProbe(std::function<bool(const QString &)> probe) { _isFileLocked = std::move(probe); }
+
+    /** Replaces the monotonic clock in ms the probes are scheduled by, for tests */
+    void setClock(std::function<qint64()> clock) { _now = std::move(clock); }
+
+    static qint64 firstCheckDelay; // in ms
+    // The longest interval between probes of a file
+    static qint64 maxPollingInterval; // in ms
+
 signals:
     /** Emitted when one of the watched files is no longer
      *  being locked. */
@@ -60,7 +80,23 @@ private slots:
     void checkFiles();
 
 private:
-    QSet<QString> _watchedPaths;
+    struct WatchedFile
+    {
+        qint64 watchedSince = 0;
+        qint64 nextProbe = 0;
+        qint64 interval = 0;
+        qint64 probes = 0;
+    };
+
+    /** Probes the file, true and stops watching it if it isn't locked anymore. */
+    bool probeFile(const QString &path);
+    void scheduleTimer();
+
+    QHash<QString, WatchedFile> _watchedFiles;
     QTimer _timer;
+    std::function<qint64()> _now;
+    qint64 _probeCount = 0;
+    qint64 _savedProbeCount = 0;
+    std::function<bool(const QString &)> _isFileLocked;
 };
 }
@@ -0,0 +1,172 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <QString>
+#include <QStringRef>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace OCC {
+
+/**
+ * @brief Maps paths to values and finds the value of the longest prefix of a path
+ *
+ * The paths are split at '/' into components and stored as a tree of
+ * components, so a lookup costs one map lookup per component of the
+ * searched path and does not allocate.
+ *
+ * Empty and "." components are ignored except for the first one, which is
+ * empty for absolute unix paths. Paths with ".." components must be cleaned
+ * with QDir::cleanPath() before they are passed in.
+ *
+ * @ingroup gui
+ */
+template <typename T>
+class PathTrie
+{
+public:
+    explicit PathTrie(Qt::CaseSensitivity caseSensitivity)
+        : _less{ caseSensitivity }
+        , _root(new Node(_less))
+    {
+    }
+
+    /** Stores the value for the path, replacing the value stored before. */
+    void insert(const QString &path, const T &value)
+    {
+        auto node = _root.get();
+        forEachComponent(path, [&](const QStringRef &component) {
+            auto it = node->children.find(component);
+            if (it == node->children.end())
+                it = node->children.emplace(component.toString(), std::unique_ptr<Node>(new Node(_less))).first;
+            node = it->second.get();
+            return true;
+        });
+        if (!node->hasValue)
+            ++_size;
+        node->value = value;
+        node->hasValue = true;
+    }
+
+    /** Removes the path if it is stored with the value. */
+    bool remove(const QString &path, const T &value)
+    {
+        std::vector<std::pair<Node *, typename Node::Children::iterator>> trail;
+        auto node = _root.get();
+        bool found = true;
+        forEachComponent(path, [&](const QStringRef &component) {
+            auto it = node->children.find(component);
+            if (it == node->children.end()) {
+                found = false;
+                return false;
+            }
+            trail.emplace_back(node, it);
+            node = it->second.get();
+            return true;
+        });
+        if (!found || !node->hasValue || !(node->value == value))
+            return false;
+        node->hasValue = false;
+        node->value = T();
+        --_size;
+
+        // Drop the nodes that lead nowhere now
+        for (auto step = trail.rbegin(); step != trail.rend(); ++step) {
+            const auto &child = step->second->second;
+            if (child->hasValue || !child->children.empty())
+                break;
+            step->first->children.erase(step->second);
+        }
+        return true;
+    }
+
+    /** The value of the longest stored prefix of the path, or T() if there is none. */
+    T findLongestPrefix(const QString &path) const
+    {
+        const Node *node = _root.get();
+        const Node *found = node->hasValue ? node : nullptr;
+        forEachComponent(path, [&](const QStringRef &component) {
+            auto it = node->children.find(component);
+            if (it == node->children.end())
+                return false;
+            node = it->second.get();
+            if (node->hasValue)
+                found = node;
+            return true;
+        });
+        return found ? found->value : T();
+    }
+
+    int size() const { return _size; }
+
+    void clear()
+    {
+        _root.reset(new Node(_less));
+        _size = 0;
+    }
+
+private:
+    struct Less
+    {
+        using is_transparent = void;
+        Qt::CaseSensitivity caseSensitivity;
+
+        bool operator()(const QString &a, const QString &b) const { return a.compare(b, caseSensitivity) < 0; }
+        bool operator()(const QString &a, const QStringRef &b) const { return a.compare(b, caseSensitivity) < 0; }
+        bool operator()(const QStringRef &a, const QString &b) const { return a.compare(b, caseSensitivity) < 0; }
+    };
+
+    struct Node
+    {
+        explicit Node(const Less &less)
+            : children(less)
+        {
+        }
+
+        using Children = std::map<QString, std::unique_ptr<Node>, Less>;
+
+        T value = T();
+        bool hasValue = false;
+        Children children;
+    };
+
+    /** Calls f for the components of the path until it returns false. */
+    template <typename F>
+    static void forEachComponent(const QString &path, F f)
+    {
+        const int size = path.size();
+        int start = 0;
+        bool first = true;
+        while (start <= size) {
+            int end = path.indexOf(QLatin1Char('/'), start);
+            if (end < 0)
+                end = size;
+            const auto component = path.midRef(start, end - start);
+            if (first || (!component.isEmpty() && component != QLatin1String("."))) {
+                if (!f(component))
+                    return;
+            }
+            first = false;
+            start = end + 1;
+        }
+    }
+
+    Less _less;
+    std::unique_ptr<Node> _root;
+    int _size = 0;
+};
+
+}
@@ -13,11 +13,7 @@
  */
 
 #include "sharee.h"
-#include "ocsshareejob.h"
-
-#include <QJsonObject>
-#include <QJsonDocument>
-#include <QJsonArray>
+#include "shareecache.h"
 
 namespace OCC {
 
@@ -69,40 +65,69 @@ Sharee::Type Sharee::type() const
 ShareeModel::ShareeModel(const AccountPtr &account, const QString &type, QObject *parent)
     : QAbstractListModel(parent)
     , _account(account)
+    , _cache(ShareeCache::forAccount(account))
     , _type(type)
 {
+    connect(_cache.data(), &ShareeCache::shareesFetched, this, &ShareeModel::slotShareesFetched);
+    connect(_cache.data(), &ShareeCache::fetchFailed, this, &ShareeModel::slotFetchFailed);
+}
+
+ShareeModel::~ShareeModel()
+{
+    stopWaitingForSearch();
 }
 
 void ShareeModel::fetch(const QString &search, const ShareeSet &blacklist, LookupMode lookupMode)
 {
-    _search = search;
     _shareeBlacklist = blacklist;
-    auto *job = new OcsShareeJob(_account);
-    connect(job, &OcsShareeJob::shareeJobFinished, this, &ShareeModel::shareesFetched);
-    connect(job, &OcsJob::ocsError, this, &ShareeModel::displayErrorMessage);
-    job->getSharees(_search, _type, 1, 50, lookupMode == GlobalSearch ? true : false);
+    if (_waitingForSearch && isCurrentSearch(search, _type, lookupMode == GlobalSearch))
+        return;
+
+    stopWaitingForSearch();
+    _search = search;
+    _lookupMode = lookupMode;
+
+    QVector<QSharedPointer<Sharee>> sharees;
+    if (_cache->lookup(_search, _type, _lookupMode == GlobalSearch, &sharees)) {
+        shareesFetched(sharees);
+        return;
+    }
+    _waitingForSearch = true;
+    _cache->fetch(_search, _type, _lookupMode == GlobalSearch);
 }
 
-void ShareeModel::shareesFetched(const QJsonDocument &reply)
+void ShareeModel::stopWaitingForSearch()
 {
-    QVector<QSharedPointer<Sharee>> newSharees;
+    // Superseded searches that no other model waits for are aborted
+    if (_waitingForSearch && _cache)
+        _cache->cancel(_search, _type, _lookupMode == GlobalSearch);
+    _waitingForSearch = false;
+}
 
-    {
-        const QStringList shareeTypes {"users", "groups", "emails", "remotes", "circles", "rooms"};
-
-        const auto appendSharees = [this, &shareeTypes](const QJsonObject &data, QVector<QSharedPointer<Sharee>>& out) {
-            for (const auto &shareeType : shareeTypes) {
-                const auto category = data.value(shareeType).toArray();
-                for (const auto &sharee : category) {
-                    out.append(parseSharee(sharee.toObject()));
-                }
-            }
-        };
+bool ShareeModel::isCurrentSearch(const QString &search, const QString &itemType, bool globalSearch) const
+{
+    // The cache is shared by all models of the account
+    return search == _search && itemType == _type && globalSearch == (_lookupMode == GlobalSearch);
+}
+
+void ShareeModel::slotShareesFetched(const QString &search, const QString &itemType, bool globalSearch, const QVector<QSharedPointer<Sharee>> &sharees)
+{
+    if (isCurrentSearch(search, itemType, globalSearch)) {
+        _waitingForSearch = false;
+        shareesFetched(sharees);
+    }
+}
 
-        appendSharees(reply.object().value("ocs").toObject().value("data").toObject(), newSharees);
-        appendSharees(reply.object().value("ocs").toObject().value("data").toObject().value("exact").toObject(), newSharees);
+void ShareeModel::slotFetchFailed(const QString &search, const QString &itemType, bool globalSearch, int code, const QString &message)
+{
+    if (isCurrentSearch(search, itemType, globalSearch)) {
+        _waitingForSearch = false;
+        emit displayErrorMessage(code, message);
     }
+}
 
+void ShareeModel::shareesFetched(const QVector<QSharedPointer<Sharee>> &newSharees)
+{
     // Filter sharees that we have already shared with
     QVector<QSharedPointer<Sharee>> filteredSharees;
     foreach (const auto &sharee, newSharees) {
@@ -123,15 +148,6 @@ void ShareeModel::shareesFetched(const QJsonDocument &reply)
     shareesReady();
 }
 
-QSharedPointer<Sharee> ShareeModel::parseSharee(const QJsonObject &data)
-{
-    const QString displayName = data.value("label").toString();
-    const QString shareWith = data.value("value").toObject().value("shareWith").toString();
-    Sharee::Type type = (Sharee::Type)data.value("value").toObject().value("shareType").toInt();
-
-    return QSharedPointer<Sharee>(new Sharee(shareWith, displayName, type));
-}
-
 
 // Helper function for setNewSharees   (could be a lambda when we can use them)
 static QSharedPointer<Sharee> shareeFromModelIndex(const QModelIndex &idx)
@@ -23,6 +23,7 @@
 #include <QVariant>
 #include <QSharedPointer>
 #include <QVector>
+#include <QPointer>
 
 #include "accountfwd.h"
 
@@ -31,6 +32,8 @@ class QJsonObject;
 
 namespace OCC {
 
+class ShareeCache;
+
 Q_DECLARE_LOGGING_CATEGORY(lcSharing)
 
 class Sharee
@@ -72,6 +75,7 @@ public:
     };
 
     explicit ShareeModel(const AccountPtr &account, const QString &type, QObject *parent = nullptr);
+    ~ShareeModel() override;
 
     using ShareeSet = QVector<QSharedPointer<Sharee>>; // FIXME: make it a QSet<Sharee> when Sharee can be compared
     void fetch(const QString &search, const ShareeSet &blacklist, LookupMode lookupMode);
@@ -87,15 +91,21 @@ signals:
     void displayErrorMessage(int code, const QString &);
 
 private slots:
-    void shareesFetched(const QJsonDocument &reply);
+    void slotShareesFetched(const QString &search, const QString &itemType, bool globalSearch, const QVector<QSharedPointer<Sharee>> &sharees);
+    void slotFetchFailed(const QString &search, const QString &itemType, bool globalSearch, int code, const QString &message);
 
 private:
-    QSharedPointer<Sharee> parseSharee(const QJsonObject &data);
+    void shareesFetched(const QVector<QSharedPointer<Sharee>> &newSharees);
     void setNewSharees(const QVector<QSharedPointer<Sharee>> &newSharees);
+    bool isCurrentSearch(const QString &search, const QString &itemType, bool globalSearch) const;
+    void stopWaitingForSearch();
 
     AccountPtr _account;
+    QPointer<ShareeCache> _cache;
     QString _search;
     QString _type;
+    LookupMode _lookupMode = LocalSearch;
+    bool _waitingForSearch = false; // the cache fetches the current search for us
 
     QVector<QSharedPointer<Sharee>> _sharees;
     QVector<QSharedPointer<Sharee>> _shareeBlacklist;
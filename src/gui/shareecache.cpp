@@ -0,0 +1,178 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "shareecache.h"
+#include "sharee.h"
+#include "ocsshareejob.h"
+#include "account.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+
+#include <algorithm>
+
+namespace OCC {
+
+qint64 ShareeCache::timeToLive = 2 * 60 * 1000;
+
+// Enough for the searches of a typing session in a couple of share dialogs
+static const int maxEntries = 200;
+
+ShareeCache *ShareeCache::forAccount(const AccountPtr &account)
+{
+    auto cache = account->findChild<ShareeCache *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!cache)
+        cache = new ShareeCache(account.data());
+    return cache;
+}
+
+ShareeCache::ShareeCache(Account *account)
+    : QObject(account)
+    , _account(account)
+{
+}
+
+ShareeCache::~ShareeCache() = default;
+
+QString ShareeCache::cacheKey(const QString &search, const QString &itemType, bool globalSearch)
+{
+    return itemType + (globalSearch ? QLatin1String("/global/") : QLatin1String("/local/")) + search;
+}
+
+bool ShareeCache::lookup(const QString &search, const QString &itemType, bool globalSearch, ShareeList *sharees)
+{
+    // Only the result of the very same search is reused: the server also
+    // matches on attributes we don't see (email, LDAP attributes), may
+    // restrict the enumeration and adds synthetic exact matches, so a
+    // longer search can't be filtered from a shorter one's result.
+    auto it = _entries.find(cacheKey(search, itemType, globalSearch));
+    if (it == _entries.end())
+        return false;
+    if (it->age.hasExpired(timeToLive)) {
+        _entries.erase(it);
+        return false;
+    }
+    *sharees = it->sharees;
+    return true;
+}
+
+void ShareeCache::fetch(const QString &search, const QString &itemType, bool globalSearch)
+{
+    // A running job for the same search answers this one as well
+    auto it = _runningJobs.find(cacheKey(search, itemType, globalSearch));
+    if (it != _runningJobs.end() && it->job) {
+        ++it->waiters;
+        return;
+    }
+    startJob({ search, itemType, globalSearch });
+}
+
+void ShareeCache::cancel(const QString &search, const QString &itemType, bool globalSearch)
+{
+    auto it = _runningJobs.find(cacheKey(search, itemType, globalSearch));
+    if (it == _runningJobs.end() || --it->waiters > 0)
+        return;
+
+    auto job = it->job;
+    _runningJobs.erase(it);
+    if (!job)
+        return;
+    // The job deletes itself once the aborted reply finished
+    disconnect(job, nullptr, this, nullptr);
+    if (job->reply())
+        job->reply()->abort();
+}
+
+void ShareeCache::startJob(const Request &request)
+{
+    const QString key = cacheKey(request.search, request.itemType, request.globalSearch);
+    auto *job = new OcsShareeJob(_account->sharedFromThis());
+    connect(job, &OcsShareeJob::shareeJobFinished, this, [this, request](const QJsonDocument &reply) {
+        jobFinished(request, reply);
+    });
+    connect(job, &OcsJob::ocsError, this, [this, request](int code, const QString &message) {
+        jobFailed(request, code, message);
+    });
+    connect(job, &QObject::destroyed, this, [this, request, key] {
+        // Neither a result nor an error
+        auto it = _runningJobs.find(key);
+        if (it != _runningJobs.end() && it->job.isNull())
+            jobFailed(request, 0, tr("The sharee search did not finish."));
+    });
+    _runningJobs.insert(key, { job, 1 });
+    job->getSharees(request.search, request.itemType, 1, resultsPerPage, request.globalSearch);
+}
+
+void ShareeCache::jobFinished(const Request &request, const QJsonDocument &reply)
+{
+    const QString key = cacheKey(request.search, request.itemType, request.globalSearch);
+    _runningJobs.remove(key);
+
+    const QStringList shareeTypes {"users", "groups", "emails", "remotes", "circles", "rooms"};
+    const auto data = reply.object().value("ocs").toObject().value("data").toObject();
+    const auto exact = data.value("exact").toObject();
+
+    Entry entry;
+    for (const auto &shareeType : shareeTypes) {
+        for (const auto &sharee : data.value(shareeType).toArray())
+            entry.sharees.append(parseSharee(sharee.toObject()));
+    }
+    for (const auto &shareeType : shareeTypes) {
+        for (const auto &sharee : exact.value(shareeType).toArray())
+            entry.sharees.append(parseSharee(sharee.toObject()));
+    }
+    entry.age.start();
+
+    const auto sharees = entry.sharees;
+    insert(key, std::move(entry));
+    emit shareesFetched(request.search, request.itemType, request.globalSearch, sharees);
+}
+
+void ShareeCache::jobFailed(const Request &request, int code, const QString &message)
+{
+    const QString key = cacheKey(request.search, request.itemType, request.globalSearch);
+    _runningJobs.remove(key);
+
+    emit fetchFailed(request.search, request.itemType, request.globalSearch, code, message);
+}
+
+void ShareeCache::insert(const QString &key, Entry entry)
+{
+    if (_entries.size() >= maxEntries) {
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            if (it->age.hasExpired(timeToLive)) {
+                it = _entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (_entries.size() >= maxEntries) {
+        auto oldest = std::max_element(_entries.begin(), _entries.end(), [](const Entry &a, const Entry &b) {
+            return a.age.elapsed() < b.age.elapsed();
+        });
+        _entries.erase(oldest);
+    }
+    _entries.insert(key, std::move(entry));
+}
+
+QSharedPointer<Sharee> ShareeCache::parseSharee(const QJsonObject &data)
+{
+    const QString displayName = data.value("label").toString();
+    const QString shareWith = data.value("value").toObject().value("shareWith").toString();
+    Sharee::Type type = (Sharee::Type)data.value("value").toObject().value("shareType").toInt();
+
+    return QSharedPointer<Sharee>(new Sharee(shareWith, displayName, type));
+}
+}
@@ -0,0 +1,117 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SHAREECACHE_H
+#define SHAREECACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "accountfwd.h"
+
+class QJsonDocument;
+class QJsonObject;
+
+namespace OCC {
+
+class Sharee;
+class OcsShareeJob;
+
+/**
+ * @brief Caches the results of sharee searches of an account
+ *
+ * Searching sharees can be expensive for the server, for example with an
+ * LDAP user backend. Going back to a search, for example when the user
+ * deletes a character or reopens the share dialog, reuses its result, and
+ * a search that is started again while it is still running joins the
+ * running one. A running search that nobody waits for anymore is aborted.
+ *
+ * Results are kept for timeToLive milliseconds.
+ *
+ * There is one cache per account, see forAccount().
+ *
+ * @ingroup gui
+ */
+class ShareeCache : public QObject
+{
+    Q_OBJECT
+public:
+    using ShareeList = QVector<QSharedPointer<Sharee>>;
+
+    /** The cache of the account, created on first use and deleted with the account. */
+    static ShareeCache *forAccount(const AccountPtr &account);
+
+    explicit ShareeCache(Account *account);
+    ~ShareeCache() override;
+
+    /** Sets sharees to the cached result of the same search, if there is one. */
+    bool lookup(const QString &search, const QString &itemType, bool globalSearch, ShareeList *sharees);
+
+    /**
+     * Gets the result of the search from the server, unless a running
+     * fetch will answer it. Emits shareesFetched() or fetchFailed().
+     */
+    void fetch(const QString &search, const QString &itemType, bool globalSearch);
+
+    /**
+     * The caller of fetch() doesn't wait for the result anymore, e.g. because
+     * the user typed on. The search is aborted if nobody else waits for it.
+     */
+    void cancel(const QString &search, const QString &itemType, bool globalSearch);
+
+    /** Parses a sharee of a sharee search result */
+    static QSharedPointer<Sharee> parseSharee(const QJsonObject &data);
+
+    static qint64 timeToLive; // in ms
+    static const int resultsPerPage = 50;
+
+signals:
+    void shareesFetched(const QString &search, const QString &itemType, bool globalSearch, const OCC::ShareeCache::ShareeList &sharees);
+    void fetchFailed(const QString &search, const QString &itemType, bool globalSearch, int code, const QString &message);
+
+private:
+    struct Entry
+    {
+        ShareeList sharees;
+        QElapsedTimer age;
+    };
+
+    struct Request
+    {
+        QString search;
+        QString itemType;
+        bool globalSearch;
+    };
+
+    struct RunningJob
+    {
+        QPointer<OcsShareeJob> job;
+        int waiters = 0; // the fetch() calls it answers
+    };
+
+    static QString cacheKey(const QString &search, const QString &itemType, bool globalSearch);
+    void startJob(const Request &request);
+    void jobFinished(const Request &request, const QJsonDocument &reply);
+    void jobFailed(const Request &request, int code, const QString &message);
+    void insert(const QString &key, Entry entry);
+
+    Account *_account; // the parent
+    QHash<QString, Entry> _entries;
+    QHash<QString, RunningJob> _runningJobs;
+};
+}
+
+#endif // SHAREECACHE_H
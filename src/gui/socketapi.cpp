@@ -37,6 +37,8 @@
 #ifndef OWNCLOUD_TEST
 #include "sharemanager.h"
 #endif
+#include "stallwatchdog.h"
+#include "timerwheel.h"
 
 #include <array>
 #include <QBitArray>
@@ -762,6 +764,18 @@ void SocketApi::command_MOVE_ITEM(const QString &localFile, SocketListener *)
     solver.setRemoteVersionFilename(target);
 }
 
+void SocketApi::command_SYNC_PATH_NOW(const QString &localFile, SocketListener *listener)
+{
+    const auto fileData = FileData::get(localFile);
+    if (!fileData.folder || !fileData.folder->canSync()) {
+        listener->sendMessage(QLatin1String("SYNC_PATH_NOW:NOP:") + QDir::toNativeSeparators(localFile));
+        return;
+    }
+
+    fileData.folder->syncPathNow(fileData.folderRelativePath);
+    listener->sendMessage(QLatin1String("SYNC_PATH_NOW:OK:") + QDir::toNativeSeparators(localFile));
+}
+
 void SocketApi::emailPrivateLink(const QString &link)
 {
     Utility::openEmailComposer(
@@ -793,6 +807,22 @@ void SocketApi::command_GET_STRINGS(const QString &argument, SocketListener *lis
     listener->sendMessage(QString("GET_STRINGS:END"));
 }
 
+void SocketApi::command_GET_EVENT_LOOP_STATS(const QString &, SocketListener *listener)
+{
+    listener->sendMessage(QString("GET_EVENT_LOOP_STATS:BEGIN"));
+    if (auto watchdog = StallWatchdog::instance()) {
+        for (const auto &line : watchdog->summary())
+            listener->sendMessage(QString("STAT:%1").arg(line));
+    }
+    auto wheel = TimerWheel::instance();
+    listener->sendMessage(QString("STAT:wakeups: %1/min budget=%2/min total=%3 timers=%4")
+                              .arg(wheel->wakeupsPerMinute())
+                              .arg(TimerWheel::idleWakeupBudget)
+                              .arg(wheel->totalWakeups())
+                              .arg(wheel->activeTimers()));
+    listener->sendMessage(QString("GET_EVENT_LOOP_STATS:END"));
+}
+
 void SocketApi::sendSharingContextMenuOptions(const FileData &fileData, SocketListener *listener, bool enabled)
 {
     auto record = fileData.journalRecord();
@@ -110,6 +110,11 @@ private:
     Q_INVOKABLE void command_DELETE_ITEM(const QString &localFile, SocketListener *listener);
     Q_INVOKABLE void command_MOVE_ITEM(const QString &localFile, SocketListener *listener);
 
+    /** Sync the file or folder before anything else, see Folder::syncPathNow()
+     * Replies with SYNC_PATH_NOW:OK:[path] or SYNC_PATH_NOW:NOP:[path]
+     */
+    Q_INVOKABLE void command_SYNC_PATH_NOW(const QString &localFile, SocketListener *listener);
+
     // Windows Shell / Explorer pinning fallbacks, see issue: https://github.com/nextcloud/desktop/issues/1599
 #ifdef Q_OS_WIN
     Q_INVOKABLE void command_COPYASPATH(const QString &localFile, SocketListener *listener);
@@ -123,6 +128,9 @@ private:
     /** Sends translated/branded strings that may be useful to the integration */
     Q_INVOKABLE void command_GET_STRINGS(const QString &argument, SocketListener *listener);
 
+    // Statistics of the event loop stall watchdog, if it is enabled, and timer wakeups
+    Q_INVOKABLE void command_GET_EVENT_LOOP_STATS(const QString &argument, SocketListener *listener);
+
     // Sends the context menu options relating to sharing to listener
     void sendSharingContextMenuOptions(const FileData &fileData, SocketListener *listener, bool enabled);
 
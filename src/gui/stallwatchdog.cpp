@@ -0,0 +1,307 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "stallwatchdog.h"
+
+#include <QEvent>
+#include <QLoggingCategory>
+#include <QMetaEnum>
+#include <QNetworkReply>
+#include <private/qobject_p.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcStallWatchdog, "nextcloud.gui.stallwatchdog", QtInfoMsg)
+
+// Upper bounds of the histogram buckets in milliseconds, the last bucket is open
+static const qint64 histogramBounds[] = { 16, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+static const int histogramBuckets = sizeof(histogramBounds) / sizeof(histogramBounds[0]) + 1;
+
+static const qint64 nsecsPerMsec = 1000 * 1000;
+
+StallWatchdog *StallWatchdog::_instance = nullptr;
+
+// A QMetaCallEvent's signal id only counts the signals of the class hierarchy
+static QMetaMethod signalByIndex(const QMetaObject *metaObject, int signalIndex)
+{
+    for (int i = 0; i < metaObject->methodCount(); ++i) {
+        const auto method = metaObject->method(i);
+        if (method.methodType() == QMetaMethod::Signal && signalIndex-- == 0)
+            return method;
+    }
+    return QMetaMethod();
+}
+
+std::chrono::milliseconds StallWatchdog::configuredThreshold()
+{
+    bool ok = false;
+    const auto threshold = qEnvironmentVariableIntValue("OWNCLOUD_STALL_WATCHDOG", &ok);
+    return std::chrono::milliseconds(ok && threshold > 0 ? threshold : 0);
+}
+
+StallWatchdog *StallWatchdog::instance()
+{
+    return _instance;
+}
+
+StallWatchdog::StallWatchdog(std::chrono::milliseconds threshold, QObject *parent)
+    : QObject(parent)
+    , _thresholdNsecs(threshold.count() * nsecsPerMsec)
+    , _monitor(this)
+{
+    _clock.start();
+    _instance = this;
+
+    // A steady tick whose lateness is the event loop latency. It also
+    // keeps nested event loops from looking like a stall.
+    _latencyTimer.setTimerType(Qt::PreciseTimer);
+    _latencyTimer.setInterval(100);
+    connect(&_latencyTimer, &QTimer::timeout, this, &StallWatchdog::slotProbeLatency);
+    _latencyTimer.start();
+    _lastProbe = _clock.nsecsElapsed();
+
+    _summaryTimer.setInterval(std::chrono::minutes(10));
+    connect(&_summaryTimer, &QTimer::timeout, this, &StallWatchdog::slotLogSummary);
+    _summaryTimer.start();
+
+    _monitor.start(QThread::LowPriority);
+    qCInfo(lcStallWatchdog) << "Reporting event loop stalls longer than" << threshold.count() << "ms";
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    _monitor.stop();
+    _monitor.wait();
+    if (_instance == this)
+        _instance = nullptr;
+
+    for (const auto &line : summary())
+        qCInfo(lcStallWatchdog) << qPrintable(line);
+}
+
+StallWatchdog::Dispatch::Dispatch(StallWatchdog *watchdog, QObject *receiver, QEvent *event)
+    : _watchdog(watchdog && receiver && event && QThread::currentThread() == watchdog->thread() ? watchdog : nullptr)
+{
+    if (_watchdog)
+        _watchdog->dispatchStarted(receiver, event);
+}
+
+StallWatchdog::Dispatch::~Dispatch()
+{
+    if (_watchdog)
+        _watchdog->dispatchFinished();
+}
+
+void StallWatchdog::dispatchStarted(QObject *receiver, QEvent *event)
+{
+    const qint64 now = _clock.nsecsElapsed();
+    if (!_frames.isEmpty()) {
+        auto &parent = _frames.last();
+        parent.busy += now - parent.segmentStart;
+    }
+
+    // The receiver may be deleted while handling the event, keep what's needed
+    Frame frame{ receiver->metaObject()->className(), receiver->objectName(), event->type(), now, 0, {}, {}, {} };
+    if (event->type() == QEvent::MetaCall) {
+        const auto metaCall = static_cast<QMetaCallEvent *>(event);
+        // Connections to functors and lambdas have no method index
+        const int slot = metaCall->id();
+        if (slot >= 0 && slot < receiver->metaObject()->methodCount())
+            frame.slot = receiver->metaObject()->method(slot).methodSignature();
+
+        // A deleted sender is disconnected, only ask a connected one for its signal
+        const QObject *sender = metaCall->sender();
+        if (sender && metaCall->signalId() >= 0 && QObjectPrivate::get(receiver)->senderList().contains(const_cast<QObject *>(sender))) {
+            const auto signal = signalByIndex(sender->metaObject(), metaCall->signalId());
+            if (signal.isValid())
+                frame.signal = QByteArray(sender->metaObject()->className()) + "::" + signal.methodSignature();
+        }
+    }
+    if (qobject_cast<QNetworkReply *>(receiver)) {
+        // Set by AbstractNetworkJob, the reply classes are the same for all jobs
+        frame.job = receiver->property("networkJobClass").toByteArray();
+    }
+    _frames.append(frame);
+    _busyClass.store(_frames.last().className, std::memory_order_relaxed);
+    _busySince.store(now, std::memory_order_release);
+}
+
+void StallWatchdog::dispatchFinished()
+{
+    if (_frames.isEmpty())
+        return;
+
+    const qint64 now = _clock.nsecsElapsed();
+    const Frame frame = _frames.takeLast();
+    const qint64 busy = frame.busy + now - frame.segmentStart;
+
+    if (_frames.isEmpty()) {
+        _busySince.store(0, std::memory_order_release);
+    } else {
+        auto &parent = _frames.last();
+        parent.segmentStart = now;
+        _busyClass.store(parent.className, std::memory_order_relaxed);
+        _busySince.store(now, std::memory_order_release);
+    }
+
+    if (busy < _thresholdNsecs)
+        return;
+
+    const qint64 msecs = busy / nsecsPerMsec;
+    _stalls.add(msecs);
+    auto &culprit = _culprits[culpritKey(frame)];
+    ++culprit.count;
+    culprit.totalMsecs += msecs;
+    culprit.maxMsecs = std::max(culprit.maxMsecs, msecs);
+
+    const QString description = describe(frame);
+    qCWarning(lcStallWatchdog) << "Event loop blocked for" << msecs << "ms by" << qPrintable(description);
+    emit stallDetected(description, msecs);
+}
+
+QString StallWatchdog::describe(const Frame &frame)
+{
+    const char *eventName = QMetaEnum::fromType<QEvent::Type>().valueToKey(frame.eventType);
+    QString description = QString::fromLatin1(frame.className);
+    if (!frame.objectName.isEmpty())
+        description += QLatin1Char('(') + frame.objectName + QLatin1Char(')');
+    description += QLatin1String(" handling ");
+    description += eventName ? QString::fromLatin1(eventName) : QString::number(frame.eventType);
+    if (!frame.slot.isEmpty())
+        description += QLatin1String(" of ") + QString::fromLatin1(frame.slot);
+    if (!frame.signal.isEmpty())
+        description += QLatin1String(" from ") + QString::fromLatin1(frame.signal);
+    if (!frame.job.isEmpty())
+        description += QLatin1String(" for ") + QString::fromLatin1(frame.job);
+    return description;
+}
+
+QByteArray StallWatchdog::culpritKey(const Frame &frame)
+{
+    if (!frame.job.isEmpty())
+        return frame.job;
+    if (!frame.slot.isEmpty())
+        return frame.className + QByteArrayLiteral("::") + frame.slot;
+    if (!frame.signal.isEmpty())
+        return frame.className + QByteArrayLiteral(" from ") + frame.signal;
+    return QByteArray(frame.className);
+}
+
+void StallWatchdog::slotProbeLatency()
+{
+    const qint64 now = _clock.nsecsElapsed();
+    const qint64 lateness = now - _lastProbe - _latencyTimer.interval() * nsecsPerMsec;
+    _lastProbe = now;
+    _latency.add(std::max<qint64>(lateness, 0) / nsecsPerMsec);
+}
+
+void StallWatchdog::slotLogSummary()
+{
+    if (_stalls.count() == _stallsAtLastSummary)
+        return;
+    _stallsAtLastSummary = _stalls.count();
+    for (const auto &line : summary())
+        qCInfo(lcStallWatchdog) << qPrintable(line);
+}
+
+QStringList StallWatchdog::summary() const
+{
+    QStringList lines;
+    lines.append(QStringLiteral("threshold: %1 ms").arg(_thresholdNsecs / nsecsPerMsec));
+    lines.append(QStringLiteral("latency: %1").arg(_latency.toString()));
+    lines.append(QStringLiteral("stalls: %1").arg(_stalls.toString()));
+
+    QVector<QPair<QByteArray, Culprit>> culprits;
+    for (auto it = _culprits.cbegin(); it != _culprits.cend(); ++it)
+        culprits.append(qMakePair(it.key(), it.value()));
+    std::sort(culprits.begin(), culprits.end(), [](const auto &a, const auto &b) {
+        return a.second.totalMsecs > b.second.totalMsecs;
+    });
+    for (const auto &culprit : qAsConst(culprits)) {
+        lines.append(QStringLiteral("culprit: %1 count=%2 total=%3ms max=%4ms")
+                         .arg(QString::fromLatin1(culprit.first))
+                         .arg(culprit.second.count)
+                         .arg(culprit.second.totalMsecs)
+                         .arg(culprit.second.maxMsecs));
+    }
+    return lines;
+}
+
+StallWatchdog::Histogram::Histogram()
+    : _counts(histogramBuckets, 0)
+{
+}
+
+void StallWatchdog::Histogram::add(qint64 msecs)
+{
+    const auto bucket = std::lower_bound(std::begin(histogramBounds), std::end(histogramBounds), msecs);
+    ++_counts[int(bucket - std::begin(histogramBounds))];
+}
+
+quint64 StallWatchdog::Histogram::count() const
+{
+    return std::accumulate(_counts.cbegin(), _counts.cend(), quint64(0));
+}
+
+QString StallWatchdog::Histogram::toString() const
+{
+    QStringList buckets;
+    for (int i = 0; i < histogramBuckets; ++i) {
+        const QString bound = i + 1 < histogramBuckets
+            ? QStringLiteral("<=%1ms").arg(histogramBounds[i])
+            : QStringLiteral(">%1ms").arg(histogramBounds[i - 1]);
+        buckets.append(QStringLiteral("%1:%2").arg(bound).arg(_counts.at(i)));
+    }
+    return buckets.join(QLatin1Char(' '));
+}
+
+StallWatchdog::MonitorThread::MonitorThread(StallWatchdog *watchdog)
+    : _watchdog(watchdog)
+{
+    setObjectName(QStringLiteral("StallWatchdog_Thread"));
+}
+
+void StallWatchdog::MonitorThread::stop()
+{
+    QMutexLocker locker(&_mutex);
+    _stopped = true;
+    _wakeUp.wakeAll();
+}
+
+void StallWatchdog::MonitorThread::run()
+{
+    const auto interval = static_cast<unsigned long>(std::max<qint64>(_watchdog->_thresholdNsecs / nsecsPerMsec / 2, 10));
+    qint64 reported = 0;
+
+    QMutexLocker locker(&_mutex);
+    while (!_stopped) {
+        _wakeUp.wait(&_mutex, interval);
+        if (_stopped)
+            break;
+
+        const qint64 busySince = _watchdog->_busySince.load(std::memory_order_acquire);
+        if (busySince == 0 || busySince == reported)
+            continue;
+        const qint64 blocked = _watchdog->_clock.nsecsElapsed() - busySince;
+        if (blocked < _watchdog->_thresholdNsecs)
+            continue;
+
+        // Logged while the stall is still going on, the GUI thread may never return
+        reported = busySince;
+        qCWarning(lcStallWatchdog) << "Event loop blocked for" << blocked / nsecsPerMsec
+                                   << "ms so far, dispatching to" << _watchdog->_busyClass.load(std::memory_order_relaxed);
+    }
+}
+}
@@ -0,0 +1,166 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <chrono>
+
+class QEvent;
+
+namespace OCC {
+
+/**
+ * @brief Finds out what blocks the event loop of the GUI thread
+ *
+ * The propagator, the journal and the socket api all run on the GUI thread,
+ * so a slot that takes long freezes the whole client. The watchdog is fed
+ * by Application::notify() and measures how long each event dispatch keeps
+ * the thread busy, excluding the time spent in nested event loops. Dispatches
+ * that take longer than the threshold are logged with the receiver's class,
+ * object name and event type, the slot and signal of queued calls and the
+ * job of network replies, and counted per culprit.
+ *
+ * A timer measures the event loop latency. A helper thread reports stalls
+ * that are still going on, so hangs that never return are logged too.
+ *
+ * The watchdog is opt-in: it only runs if OWNCLOUD_STALL_WATCHDOG is set to
+ * the threshold in milliseconds. The collected numbers are logged
+ * periodically and can be queried through the socket api.
+ *
+ * @ingroup gui
+ */
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+public:
+    /** The threshold configured in the environment, zero if the watchdog is disabled. */
+    static std::chrono::milliseconds configuredThreshold();
+
+    /** The running watchdog, if any. */
+    static StallWatchdog *instance();
+
+    explicit StallWatchdog(std::chrono::milliseconds threshold, QObject *parent = nullptr);
+    ~StallWatchdog() override;
+
+    /** Measures the dispatch of one event on the watchdog's thread while in scope. */
+    class Dispatch
+    {
+    public:
+        Dispatch(StallWatchdog *watchdog, QObject *receiver, QEvent *event);
+        ~Dispatch();
+
+    private:
+        StallWatchdog *_watchdog;
+    };
+
+    /** Counts durations in exponentially growing buckets. */
+    class Histogram
+    {
+    public:
+        Histogram();
+        void add(qint64 msecs);
+        quint64 count() const;
+        QString toString() const;
+
+    private:
+        QVector<quint64> _counts;
+    };
+
+    /** Number of dispatches that took longer than the threshold. */
+    quint64 stallCount() const { return _stalls.count(); }
+
+    /** Human readable statistics, one line per entry. */
+    QStringList summary() const;
+
+signals:
+    /** A dispatch blocked the event loop for longer than the threshold. */
+    void stallDetected(const QString &culprit, qint64 msecs);
+
+private slots:
+    void slotProbeLatency();
+    void slotLogSummary();
+
+private:
+    struct Frame
+    {
+        const char *className;
+        QString objectName;
+        int eventType;
+        qint64 segmentStart; // nsecs, when this frame last got the thread back
+        qint64 busy; // nsecs spent in this frame outside of nested dispatches
+        QByteArray slot; // the slot invoked by a MetaCall, if it is a method
+        QByteArray signal; // Sender::signal() that queued a MetaCall, if known
+        QByteArray job; // the network job class of a reply
+    };
+
+    struct Culprit
+    {
+        quint64 count = 0;
+        qint64 totalMsecs = 0;
+        qint64 maxMsecs = 0;
+    };
+
+    void dispatchStarted(QObject *receiver, QEvent *event);
+    void dispatchFinished();
+
+    static QString describe(const Frame &frame);
+    static QByteArray culpritKey(const Frame &frame);
+
+    // Reports stalls that are still going on
+    class MonitorThread : public QThread
+    {
+    public:
+        explicit MonitorThread(StallWatchdog *watchdog);
+        void stop();
+
+    protected:
+        void run() override;
+
+    private:
+        StallWatchdog *_watchdog;
+        QMutex _mutex;
+        QWaitCondition _wakeUp;
+        bool _stopped = false;
+    };
+
+    const qint64 _thresholdNsecs;
+    QElapsedTimer _clock;
+    QVector<Frame> _frames;
+
+    // Shared with the monitor thread
+    std::atomic<qint64> _busySince{ 0 };
+    std::atomic<const char *> _busyClass{ nullptr };
+
+    QTimer _latencyTimer;
+    qint64 _lastProbe = 0;
+    Histogram _latency;
+    Histogram _stalls;
+    QHash<QByteArray, Culprit> _culprits;
+    quint64 _stallsAtLastSummary = 0;
+    QTimer _summaryTimer;
+
+    MonitorThread _monitor;
+
+    static StallWatchdog *_instance;
+};
+}
@@ -0,0 +1,166 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "timerwheel.h"
+
+#include <QLoggingCategory>
+#include <QPointer>
+
+#include <algorithm>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcTimerWheel, "nextcloud.gui.timerwheel", QtInfoMsg)
+
+static const qint64 minuteMsec = 60 * 1000;
+static const qint64 maximumSlackMsec = 30 * 1000;
+
+TimerWheel *TimerWheel::_instance = nullptr;
+
+TimerWheel *TimerWheel::instance()
+{
+    if (!_instance) {
+        _instance = new TimerWheel();
+    }
+    return _instance;
+}
+
+TimerWheel::TimerWheel()
+{
+    _clock.start();
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::CoarseTimer);
+    connect(&_timer, &QTimer::timeout, this, &TimerWheel::slotWakeup);
+}
+
+int TimerWheel::wakeupsPerMinute()
+{
+    pruneWakeups(now());
+    return _recentWakeups.size();
+}
+
+int TimerWheel::activeTimers() const
+{
+    return static_cast<int>(std::count_if(_timers.begin(), _timers.end(),
+        [](CoalescedTimer *timer) { return timer->isActive(); }));
+}
+
+void TimerWheel::add(CoalescedTimer *timer)
+{
+    if (!_timers.contains(timer))
+        _timers.append(timer);
+    reschedule();
+}
+
+void TimerWheel::remove(CoalescedTimer *timer)
+{
+    _timers.removeOne(timer);
+    reschedule();
+}
+
+void TimerWheel::reschedule()
+{
+    qint64 wakeAt = -1;
+    for (auto timer : qAsConst(_timers)) {
+        if (!timer->isActive())
+            continue;
+        const auto latest = timer->_deadline + timer->slack();
+        if (wakeAt < 0 || latest < wakeAt)
+            wakeAt = latest;
+    }
+    if (wakeAt < 0) {
+        _timer.stop();
+        return;
+    }
+    _timer.start(static_cast<int>(qMax<qint64>(0, wakeAt - now())));
+}
+
+void TimerWheel::slotWakeup()
+{
+    const auto wakeup = now();
+    ++_totalWakeups;
+    _recentWakeups.enqueue(wakeup);
+    pruneWakeups(wakeup);
+
+    // Collect the due timers first, their handlers may start, stop or delete timers
+    QVector<QPointer<CoalescedTimer>> due;
+    for (auto timer : qAsConst(_timers)) {
+        if (!timer->isActive() || timer->_deadline > wakeup)
+            continue;
+        due.append(timer);
+        timer->_deadline = timer->_singleShot ? -1 : wakeup + timer->_interval;
+    }
+    for (const auto &timer : qAsConst(due)) {
+        if (timer)
+            emit timer->timeout();
+    }
+
+    if (_recentWakeups.size() > idleWakeupBudget
+        && (_lastBudgetWarning < 0 || wakeup - _lastBudgetWarning > minuteMsec)) {
+        qCInfo(lcTimerWheel) << "Woke up" << _recentWakeups.size() << "times in the last minute, the idle budget is"
+                             << idleWakeupBudget << "with" << activeTimers() << "timers running";
+        _lastBudgetWarning = wakeup;
+    }
+
+    reschedule();
+}
+
+void TimerWheel::pruneWakeups(qint64 now)
+{
+    while (!_recentWakeups.isEmpty() && now - _recentWakeups.head() >= minuteMsec)
+        _recentWakeups.dequeue();
+}
+
+CoalescedTimer::CoalescedTimer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CoalescedTimer::~CoalescedTimer()
+{
+    TimerWheel::instance()->remove(this);
+}
+
+qint64 CoalescedTimer::slack() const
+{
+    return qMin<qint64>(_interval / 4, maximumSlackMsec);
+}
+
+int CoalescedTimer::remainingTime() const
+{
+    if (!isActive())
+        return -1;
+    return static_cast<int>(qMax<qint64>(_deadline - TimerWheel::instance()->now(), 0));
+}
+
+void CoalescedTimer::start()
+{
+    auto wheel = TimerWheel::instance();
+    _deadline = wheel->now() + _interval;
+    wheel->add(this);
+}
+
+void CoalescedTimer::start(int msec)
+{
+    _interval = msec;
+    start();
+}
+
+void CoalescedTimer::stop()
+{
+    if (!isActive())
+        return;
+    _deadline = -1;
+    TimerWheel::instance()->reschedule();
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+#include <QVector>
+
+#include <chrono>
+
+namespace OCC {
+
+class CoalescedTimer;
+
+/**
+ * @brief Drives the periodic timers of the client from a single timer
+ *
+ * An idle client still does regular work: it polls etags, checks the
+ * connection, refreshes notifications and user info and looks for folders
+ * that need a sync. Every one of these timers waking the process up on its
+ * own costs battery life on laptops and density on VDI hosts.
+ *
+ * The wheel lets each CoalescedTimer fire a bit late, by up to a quarter of
+ * its interval, and wakes up once for all timers that are due within that
+ * window. Periodic timers restart from the time they fired, so timers that
+ * were coalesced once stay aligned.
+ *
+ * The wakeups are counted. When an idle client wakes up more often than
+ * idleWakeupBudget times a minute, that is logged.
+ *
+ * @ingroup gui
+ */
+class TimerWheel : public QObject
+{
+    Q_OBJECT
+public:
+    static TimerWheel *instance();
+
+    /** Wakeups per minute an idle client is expected to stay below. */
+    static const int idleWakeupBudget = 6;
+
+    /** The number of wakeups in the last minute. */
+    int wakeupsPerMinute();
+
+    /** The number of wakeups since the start. */
+    qint64 totalWakeups() const { return _totalWakeups; }
+
+    /** The number of timers that are running. */
+    int activeTimers() const;
+
+private:
+    friend class CoalescedTimer;
+
+    TimerWheel();
+
+    qint64 now() const { return _clock.elapsed(); }
+    void add(CoalescedTimer *timer);
+    void remove(CoalescedTimer *timer);
+    void reschedule();
+    void slotWakeup();
+    void pruneWakeups(qint64 now);
+
+    static TimerWheel *_instance;
+
+    QTimer _timer;
+    QElapsedTimer _clock;
+    QVector<CoalescedTimer *> _timers;
+    QQueue<qint64> _recentWakeups;
+    qint64 _totalWakeups = 0;
+    qint64 _lastBudgetWarning = -1;
+};
+
+/**
+ * @brief A timer with the interface of QTimer that fires through the TimerWheel
+ *
+ * Meant for periodic background work that does not need to happen at an
+ * exact time.
+ *
+ * @ingroup gui
+ */
+class CoalescedTimer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CoalescedTimer(QObject *parent = nullptr);
+    ~CoalescedTimer() override;
+
+    void setInterval(int msec) { _interval = msec; }
+    void setInterval(std::chrono::milliseconds interval) { _interval = static_cast<int>(interval.count()); }
+    int interval() const { return _interval; }
+
+    void setSingleShot(bool singleShot) { _singleShot = singleShot; }
+    bool isSingleShot() const { return _singleShot; }
+
+    bool isActive() const { return _deadline >= 0; }
+
+    /** Msecs until the timer is due, or -1 if it isn't active, like QTimer::remainingTime(). */
+    int remainingTime() const;
+
+    /** How late the timer may fire. */
+    qint64 slack() const;
+
+    void start(std::chrono::milliseconds interval)
+    {
+        setInterval(interval);
+        start();
+    }
+
+public slots:
+    void start();
+    void start(int msec);
+    void stop();
+
+signals:
+    void timeout();
+
+private:
+    friend class TimerWheel;
+
+    int _interval = 0;
+    bool _singleShot = false;
+    qint64 _deadline = -1;
+};
+
+}
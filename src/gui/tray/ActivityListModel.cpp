@@ -38,6 +38,11 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcActivity, "nextcloud.gui.activity", QtInfoMsg)
 
+static const char activitiesPathC[] = "ocs/v2.php/apps/activity/api/v2/activity";
+static const int activitiesPageSize = 50;
+static const int successStatusCode = 200;
+static const int notModifiedStatusCode = 304;
+
 ActivityListModel::ActivityListModel(AccountState *accountState, QObject *parent)
     : QAbstractListModel(parent)
     , _accountState(accountState)
@@ -249,13 +254,13 @@ void ActivityListModel::startFetchJob()
     if (!_accountState->isConnected()) {
         return;
     }
-    auto *job = new JsonApiJob(_accountState->account(), QLatin1String("ocs/v2.php/apps/activity/api/v2/activity"), this);
+    auto *job = new JsonApiJob(_accountState->account(), QLatin1String(activitiesPathC), this);
     QObject::connect(job, &JsonApiJob::jsonReceived,
         this, &ActivityListModel::slotActivitiesReceived);
 
     QUrlQuery params;
     params.addQueryItem(QLatin1String("since"), QString::number(_currentItem));
-    params.addQueryItem(QLatin1String("limit"), QString::number(50));
+    params.addQueryItem(QLatin1String("limit"), QString::number(activitiesPageSize));
     job->addQueryParams(params);
 
     _currentlyFetching = true;
@@ -263,6 +268,66 @@ void ActivityListModel::startFetchJob()
     job->start();
 }
 
+void ActivityListModel::startFetchNewJob()
+{
+    if (!_accountState->isConnected()) {
+        return;
+    }
+    auto *job = new JsonApiJob(_accountState->account(), QLatin1String(activitiesPathC), this);
+    QObject::connect(job, &JsonApiJob::jsonReceived,
+        this, &ActivityListModel::slotNewActivitiesReceived);
+
+    // An ETag is only valid for the query it was sent for, which changes
+    // whenever newer activities arrive
+    const auto since = _newestActivityId;
+    QObject::connect(job, &JsonApiJob::etagResponseHeaderReceived,
+        this, [this, since](const QByteArray &value, int statusCode) {
+            if (statusCode == successStatusCode) {
+                _newActivitiesEtag = value;
+                _newActivitiesEtagSince = since;
+            }
+        });
+
+    // Only the activities newer than the newest one we have, oldest first
+    QUrlQuery params;
+    params.addQueryItem(QLatin1String("since"), QString::number(since));
+    params.addQueryItem(QLatin1String("sort"), QLatin1String("asc"));
+    params.addQueryItem(QLatin1String("limit"), QString::number(activitiesPageSize));
+    job->addQueryParams(params);
+    if (!_newActivitiesEtag.isEmpty() && _newActivitiesEtagSince == since) {
+        job->addRawHeader("If-None-Match", _newActivitiesEtag);
+    }
+
+    _currentlyFetching = true;
+    qCDebug(lcActivity) << "Checking for activities newer than" << _newestActivityId << "for" << _accountState->account()->displayName();
+    job->start();
+}
+
+Activity ActivityListModel::activityFromJson(const QJsonObject &json)
+{
+    Activity a;
+    a._type = Activity::ActivityType;
+    a._objectType = json.value("object_type").toString();
+    a._accName = _accountState->account()->displayName();
+    a._id = json.value("activity_id").toInt();
+    a._fileAction = json.value("type").toString();
+    a._subject = json.value("subject").toString();
+    a._message = json.value("message").toString();
+    a._file = json.value("object_name").toString();
+    a._link = QUrl(json.value("link").toString());
+    a._dateTime = QDateTime::fromString(json.value("datetime").toString(), Qt::ISODate);
+    a._icon = json.value("icon").toString();
+
+    if (!a._icon.isEmpty()) {
+        auto *iconJob = new IconJob(QUrl(a._icon));
+        iconJob->setProperty("activityId", a._id);
+        connect(iconJob, &IconJob::jobFinished, this, &ActivityListModel::slotIconDownloaded);
+    }
+
+    _newestActivityId = qMax(_newestActivityId, a._id);
+    return a;
+}
+
 void ActivityListModel::slotActivitiesReceived(const QJsonDocument &json, int statusCode)
 {
     auto activities = json.object().value("ocs").toObject().value("data").toArray();
@@ -283,26 +348,7 @@ void ActivityListModel::slotActivitiesReceived(const QJsonDocument &json, int st
     oldestDate = oldestDate.addDays(_maxActivitiesDays * -1);
 
     foreach (auto activ, activities) {
-        auto json = activ.toObject();
-
-        Activity a;
-        a._type = Activity::ActivityType;
-        a._objectType = json.value("object_type").toString();
-        a._accName = ast->account()->displayName();
-        a._id = json.value("activity_id").toInt();
-        a._fileAction = json.value("type").toString();
-        a._subject = json.value("subject").toString();
-        a._message = json.value("message").toString();
-        a._file = json.value("object_name").toString();
-        a._link = QUrl(json.value("link").toString());
-        a._dateTime = QDateTime::fromString(json.value("datetime").toString(), Qt::ISODate);
-        a._icon = json.value("icon").toString();
-
-        if (!a._icon.isEmpty()) {
-            auto *iconJob = new IconJob(QUrl(a._icon));
-            iconJob->setProperty("activityId", a._id);
-            connect(iconJob, &IconJob::jobFinished, this, &ActivityListModel::slotIconDownloaded);
-        }
+        auto a = activityFromJson(activ.toObject());
 
         list.append(a);
         _currentItem = list.last()._id;
@@ -324,6 +370,68 @@ void ActivityListModel::slotActivitiesReceived(const QJsonDocument &json, int st
     combineActivityLists();
 }
 
+void ActivityListModel::slotNewActivitiesReceived(const QJsonDocument &json, int statusCode)
+{
+    _currentlyFetching = false;
+    if (!_accountState) {
+        return;
+    }
+
+    if (statusCode == notModifiedStatusCode) {
+        qCDebug(lcActivity) << "No new activities for" << _accountState->account()->displayName();
+        return;
+    }
+
+    auto activities = json.object().value("ocs").toObject().value("data").toArray();
+    if (activities.size() >= activitiesPageSize) {
+        // There may be more new activities than we asked for, start over
+        qCInfo(lcActivity) << "Many new activities for" << _accountState->account()->displayName() << ", fetching all again";
+        resetActivities();
+        startFetchJob();
+        return;
+    }
+
+    ActivityList list;
+    foreach (auto activ, activities) {
+        list.append(activityFromJson(activ.toObject()));
+    }
+
+    emit activityJobStatusCode(statusCode);
+
+    if (!list.isEmpty()) {
+        insertNewActivities(list);
+    }
+}
+
+void ActivityListModel::insertNewActivities(ActivityList list)
+{
+    std::sort(list.begin(), list.end());
+    _totalActivitiesFetched += list.size();
+
+    if (_activityLists.size() + list.size() > _maxActivities) {
+        // Drops the oldest entries and adds the entry for more activities
+        _activityLists = list + _activityLists;
+        _activityLists.erase(_activityLists.begin() + _maxActivities, _activityLists.end());
+        _showMoreActivitiesAvailableEntry = true;
+        combineActivityLists();
+        return;
+    }
+
+    // The new activities are the newest, they go before the first one shown
+    const auto row = _activityLists.isEmpty() ? -1 : _finalList.indexOf(_activityLists.first());
+    if (row < 0) {
+        _activityLists = list + _activityLists;
+        combineActivityLists();
+        return;
+    }
+    beginInsertRows(QModelIndex(), row, row + list.size() - 1);
+    for (int i = 0; i < list.size(); ++i) {
+        _finalList.insert(row + i, list.at(i));
+    }
+    _activityLists = list + _activityLists;
+    endInsertRows();
+}
+
 void ActivityListModel::slotIconDownloaded(QByteArray iconData)
 {
     for (auto i = 0; i < _activityLists.count(); i++) {
@@ -562,13 +670,29 @@ void ActivityListModel::fetchMore(const QModelIndex &)
     }
 }
 
-void ActivityListModel::slotRefreshActivity()
+void ActivityListModel::resetActivities()
 {
     _activityLists.clear();
     _doneFetching = false;
     _currentItem = 0;
+    _newestActivityId = 0;
+    _newActivitiesEtag.clear();
+    _newActivitiesEtagSince = 0;
     _totalActivitiesFetched = 0;
     _showMoreActivitiesAvailableEntry = false;
+}
+
+void ActivityListModel::slotRefreshActivity()
+{
+    // Once activities are shown, only the newer ones are fetched
+    if (canFetchActivities() && !_activityLists.isEmpty() && _newestActivityId > 0) {
+        if (!_currentlyFetching) {
+            startFetchNewJob();
+        }
+        return;
+    }
+
+    resetActivities();
 
     if (canFetchActivities()) {
         startFetchJob();
@@ -583,9 +707,6 @@ void ActivityListModel::slotRemoveAccount()
     _finalList.clear();
     _activityLists.clear();
     _currentlyFetching = false;
-    _doneFetching = false;
-    _currentItem = 0;
-    _totalActivitiesFetched = 0;
-    _showMoreActivitiesAvailableEntry = false;
+    resetActivities();
 }
 }
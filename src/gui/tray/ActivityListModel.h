@@ -20,6 +20,7 @@
 #include "ActivityData.h"
 
 class QJsonDocument;
+class QJsonObject;
 
 namespace OCC {
 
@@ -84,6 +85,7 @@ public slots:
 
 private slots:
     void slotActivitiesReceived(const QJsonDocument &json, int statusCode);
+    void slotNewActivitiesReceived(const QJsonDocument &json, int statusCode);
     void slotIconDownloaded(QByteArray iconData);
 
 signals:
@@ -95,6 +97,12 @@ protected:
 
 private:
     void startFetchJob();
+    /// Asks the server for activities newer than the newest one shown
+    void startFetchNewJob();
+    Activity activityFromJson(const QJsonObject &json);
+    /// Inserts rows for the new activities without rebuilding the model
+    void insertNewActivities(ActivityList list);
+    void resetActivities();
     void combineActivityLists();
     bool canFetchActivities() const;
 
@@ -109,6 +117,9 @@ private:
     bool _currentlyFetching = false;
     bool _doneFetching = false;
     int _currentItem = 0;
+    qlonglong _newestActivityId = 0;
+    QByteArray _newActivitiesEtag;
+    qlonglong _newActivitiesEtagSince = 0; // the since of the query the ETag was sent for
 
     int _totalActivitiesFetched = 0;
     int _maxActivities = 100;
@@ -38,7 +38,7 @@ User::User(AccountStatePtr &account, const bool &isCurrent, QObject *parent)
     connect(ProgressDispatcher::instance(), &ProgressDispatcher::syncError,
         this, &User::slotAddError);
 
-    connect(&_notificationCheckTimer, &QTimer::timeout,
+    connect(&_notificationCheckTimer, &CoalescedTimer::timeout,
         this, &User::slotRefresh);
 
     connect(_account.data(), &AccountState::stateChanged,
@@ -10,6 +10,7 @@
 #include "ActivityListModel.h"
 #include "accountmanager.h"
 #include "folderman.h"
+#include "timerwheel.h"
 #include <chrono>
 
 namespace OCC {
@@ -86,7 +87,7 @@ private:
     ActivityListModel *_activityModel;
     ActivityList _blacklistedNotifications;
 
-    QTimer _notificationCheckTimer;
+    CoalescedTimer _notificationCheckTimer;
     QHash<AccountState *, QElapsedTimer> _timeSinceLastCheck;
 
     QElapsedTimer _guiLogTimer;
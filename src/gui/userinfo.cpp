@@ -43,7 +43,7 @@ UserInfo::UserInfo(AccountState *accountState, bool allowDisconnectedAccountStat
 {
     connect(accountState, &AccountState::stateChanged,
         this, &UserInfo::slotAccountStateChanged);
-    connect(&_jobRestartTimer, &QTimer::timeout, this, &UserInfo::slotFetchInfo);
+    connect(&_jobRestartTimer, &CoalescedTimer::timeout, this, &UserInfo::slotFetchInfo);
     _jobRestartTimer.setSingleShot(true);
 }
 
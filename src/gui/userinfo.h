@@ -22,6 +22,8 @@
 #include <QTimer>
 #include <QDateTime>
 
+#include "timerwheel.h"
+
 namespace OCC {
 class AccountState;
 class JsonApiJob;
@@ -102,7 +104,7 @@ private:
 
     qint64 _lastQuotaTotalBytes;
     qint64 _lastQuotaUsedBytes;
-    QTimer _jobRestartTimer;
+    CoalescedTimer _jobRestartTimer;
     QDateTime _lastInfoReceived; // the time at which the user info and quota was received last
     bool _active; // if we should check at regular interval (when the UI is visible)
     QPointer<JsonApiJob> _job; // the currently running job
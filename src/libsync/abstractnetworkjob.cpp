@@ -57,6 +57,9 @@ AbstractNetworkJob::AbstractNetworkJob(AccountPtr account, const QString &path,
     _timer.setInterval((httpTimeout ? httpTimeout : 300) * 1000); // default to 5 minutes.
     connect(&_timer, &QTimer::timeout, this, &AbstractNetworkJob::slotTimeout);
 
+    if (HarRecorder::instance())
+        _created.start();
+
     connect(this, &AbstractNetworkJob::networkActivity, this, &AbstractNetworkJob::resetTimeout);
 
     // Network activity on the propagator jobs (GET/PUT) keeps all requests alive.
@@ -118,6 +121,8 @@ void AbstractNetworkJob::setupConnections(QNetworkReply *reply)
 QNetworkReply *AbstractNetworkJob::addTimer(QNetworkReply *reply)
 {
     reply->setProperty("timer", QVariant::fromValue(&_timer));
+    // Lets the stall watchdog tell which job a busy reply belongs to
+    reply->setProperty("networkJobClass", QByteArray(metaObject()->className()));
     return reply;
 }
 
@@ -139,6 +144,14 @@ void AbstractNetworkJob::adoptRequest(QNetworkReply *reply)
     setReply(reply);
     setupConnections(reply);
     newReplyHook(reply);
+
+    if (HarRecorder::instance()) {
+        _harRequest.start(_created);
+        connect(reply, &QNetworkReply::metaDataChanged, this, [this] { _harRequest.markFirstByte(); });
+        connect(reply, &QNetworkReply::readyRead, this, [this] { _harRequest.markFirstByte(); });
+        connect(reply, &QNetworkReply::uploadProgress, this, [this](qint64 sent, qint64) { _harRequest.bytesSent = sent; });
+        connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 received, qint64) { _harRequest.bytesReceived = received; });
+    }
 }
 
 QUrl AbstractNetworkJob::makeAccountUrl(const QString &relativePath) const
@@ -155,18 +168,34 @@ void AbstractNetworkJob::slotFinished()
 {
     _timer.stop();
 
+    if (auto har = HarRecorder::instance()) {
+        int retry = _redirectCount;
+#if (QT_VERSION >= 0x050800)
+        retry += _http2ResendCount;
+#endif
+        const qint64 bodySize = _requestBody && !_requestBody->isSequential() ? _requestBody->size() : -1;
+        har->record(*_reply, _harRequest, metaObject()->className(), path(), bodySize, retry);
+    }
+
     if (_reply->error() == QNetworkReply::SslHandshakeFailedError) {
         qCWarning(lcNetworkJob) << "SslHandshakeFailedError: " << errorString() << " : can be caused by a webserver wanting SSL client certificates";
     }
 
 #if (QT_VERSION >= 0x050800)
+    const bool http2WasUsed = _reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+    if (http2WasUsed && !_account->isHttp2Supported()) {
+        // Whether HTTP/2 is used is only known once the server answered
+        qCInfo(lcNetworkJob) << "Server" << _reply->request().url().host() << "answered with HTTP/2";
+        _account->setHttp2Supported(true);
+    }
+
     // Qt doesn't yet transparently resend HTTP2 requests, do so here
     const auto maxHttp2Resends = 5;
     QByteArray verb = requestVerb(*reply());
-    if (_reply->error() == QNetworkReply::ContentReSendError
-        && _reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool()) {
+    if (_reply->error() == QNetworkReply::ContentReSendError && http2WasUsed) {
+        _account->http2StreamCapacity().streamRefused();
 
-        if ((_requestBody && !_requestBody->isSequential()) || verb.isEmpty()) {
+        if ((_requestBody && _requestBody->isSequential()) || verb.isEmpty()) {
             qCWarning(lcNetworkJob) << "Can't resend HTTP2 request, verb or body not suitable"
                                     << _reply->request().url() << verb << _requestBody;
         } else if (_http2ResendCount >= maxHttp2Resends) {
@@ -189,6 +218,8 @@ void AbstractNetworkJob::slotFinished()
                 _requestBody);
             return;
         }
+    } else if (http2WasUsed && _reply->error() == QNetworkReply::NoError) {
+        _account->http2StreamCapacity().streamSucceeded();
     }
 #endif
 
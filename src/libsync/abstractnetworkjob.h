@@ -24,6 +24,8 @@
 #include <QDateTime>
 #include <QTimer>
 #include "accountfwd.h"
+#include "common/memorycounters.h"
+#include "harrecorder.h"
 
 class QUrl;
 
@@ -198,6 +200,12 @@ private:
     //
     // Reparented to the currently running QNetworkReply.
     QPointer<QIODevice> _requestBody;
+
+    // Only used while requests are recorded to a HAR file
+    QElapsedTimer _created;
+    HarRecorder::Request _harRequest;
+
+    MemoryCounters::Instance<MemoryCounters::NetworkJobs> _instanceCounter;
 };
 
 /**
@@ -60,6 +60,24 @@ void AccessManager::setRawCookie(const QByteArray &rawCookie, const QUrl &url)
     jar->setCookiesFromUrl(cookieList, url);
 }
 
+/* Whether requests may use HTTP/2 if the server offers it during the TLS handshake.
+ *
+ * Qt before 5.15 loses requests on HTTP/2 connections, see: https://github.com/owncloud/client/pull/7620
+ *   and: https://github.com/nextcloud/desktop/pull/1806
+ * Issue: https://github.com/nextcloud/desktop/issues/1503
+ * OWNCLOUD_HTTP2_ENABLED=1 enables it for older Qt as well, OWNCLOUD_HTTP2_ENABLED=0 disables it.
+ */
+static bool http2Allowed()
+{
+    static const bool allowed = [] {
+        const QByteArray env = qgetenv("OWNCLOUD_HTTP2_ENABLED");
+        if (!env.isEmpty())
+            return env.toInt() == 1;
+        return QT_VERSION >= QT_VERSION_CHECK(5, 15, 0);
+    }();
+    return allowed;
+}
+
 static QByteArray generateRequestId()
 {
     // Use a UUID with the starting and ending curly brace removed.
@@ -98,15 +116,8 @@ QNetworkReply *AccessManager::createRequest(QNetworkAccessManager::Operation op,
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 9, 4)
     // only enable HTTP2 with Qt 5.9.4 because old Qt have too many bugs (e.g. QTBUG-64359 is fixed in >= Qt 5.9.4)
-
-    /* Disable http2 for now due to Qt bug but allow enabling it via env var, see: https://github.com/owncloud/client/pull/7620
-     *   and: https://github.com/nextcloud/desktop/pull/1806
-     * Issue: https://github.com/nextcloud/desktop/issues/1503
-     */
     if (newRequest.url().scheme() == "https") { // Not for "http": QTBUG-61397
-        static const bool http2EnabledEnv = qEnvironmentVariableIntValue("OWNCLOUD_HTTP2_ENABLED") == 1;
-
-        newRequest.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, http2EnabledEnv);
+        newRequest.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, http2Allowed());
     }
 #endif
 
@@ -21,6 +21,7 @@
 #include "capabilities.h"
 #include "theme.h"
 #include "pushnotifications.h"
+#include "hostrequestscheduler.h"
 
 #include "common/asserts.h"
 #include "clientsideencryption.h"
@@ -304,18 +305,22 @@ QNetworkReply *Account::sendRawRequest(const QByteArray &verb, const QUrl &url,
 {
     req.setUrl(url);
     req.setSslConfiguration(this->getOrCreateSslConfig());
+    QNetworkReply *reply = nullptr;
     if (verb == "HEAD" && !data) {
-        return _am->head(req);
+        reply = _am->head(req);
     } else if (verb == "GET" && !data) {
-        return _am->get(req);
+        reply = _am->get(req);
     } else if (verb == "POST") {
-        return _am->post(req, data);
+        reply = _am->post(req, data);
     } else if (verb == "PUT") {
-        return _am->put(req, data);
+        reply = _am->put(req, data);
     } else if (verb == "DELETE" && !data) {
-        return _am->deleteResource(req);
+        reply = _am->deleteResource(req);
+    } else {
+        reply = _am->sendCustomRequest(req, verb, data);
     }
-    return _am->sendCustomRequest(req, verb, data);
+    HostRequestScheduler::instance()->trackReply(this, reply);
+    return reply;
 }
 
 SimpleNetworkJob *Account::sendRequest(const QByteArray &verb, const QUrl &url, QNetworkRequest req, QIODevice *data)
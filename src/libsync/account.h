@@ -35,6 +35,7 @@
 #include <memory>
 #include "capabilities.h"
 #include "clientsideencryption.h"
+#include "http2streamcapacity.h"
 
 class QSettings;
 class QNetworkReply;
@@ -228,6 +229,9 @@ public:
     bool isHttp2Supported() { return _http2Supported; }
     void setHttp2Supported(bool value) { _http2Supported = value; }
 
+    /** How many requests the server's HTTP/2 connection takes in parallel */
+    Http2StreamCapacity &http2StreamCapacity() { return _http2StreamCapacity; }
+
     void clearCookieJar();
     void lendCookieJarTo(QNetworkAccessManager *guest);
     QString cookieJarPath();
@@ -320,6 +324,7 @@ private:
     QSharedPointer<QNetworkAccessManager> _am;
     QScopedPointer<AbstractCredentials> _credentials;
     bool _http2Supported = false;
+    Http2StreamCapacity _http2StreamCapacity;
 
     /// Certificates that were explicitly rejected by the user
     QList<QSslCertificate> _rejectedCertificates;
@@ -175,6 +175,26 @@ bool Capabilities::chunkingNg() const
     return _capabilities["dav"].toMap()["chunking"].toByteArray() >= "1.0";
 }
 
+bool Capabilities::bulkUpload() const
+{
+    static const auto bulkUpload = qgetenv("OWNCLOUD_BULK_UPLOAD");
+    if (bulkUpload == "0")
+        return false;
+    if (bulkUpload == "1")
+        return true;
+    return _capabilities["dav"].toMap()["bulkupload"].toByteArray() >= "1.0";
+}
+
+bool Capabilities::deltaChunking() const
+{
+    static const auto deltaChunking = qgetenv("OWNCLOUD_DELTA_CHUNKING");
+    if (deltaChunking == "0")
+        return false;
+    if (deltaChunking == "1")
+        return true;
+    return _capabilities["dav"].toMap()["deltachunking"].toByteArray() >= "1.0";
+}
+
 PushNotificationTypes Capabilities::availablePushNotifications() const
 {
     if (!_capabilities.contains("notify_push")) {
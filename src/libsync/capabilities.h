@@ -57,6 +57,12 @@ public:
     bool shareResharing() const;
     bool chunkingNg() const;
 
+    /// Whether many small files may be uploaded in one multipart request
+    bool bulkUpload() const;
+
+    /// Whether a chunked upload may only send the changed ranges of a modified file
+    bool deltaChunking() const;
+
     /// Returns which kind of push notfications are available
     PushNotificationTypes availablePushNotifications() const;
 
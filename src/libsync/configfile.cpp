@@ -56,6 +56,7 @@ Q_LOGGING_CATEGORY(lcConfigFile, "nextcloud.sync.configfile", QtInfoMsg)
 
 //static const char caCertsKeyC[] = "CaCertificates"; only used from account.cpp
 static const char remotePollIntervalC[] = "remotePollInterval";
+static const char maxRemotePollIntervalC[] = "maxRemotePollInterval";
 static const char forceSyncIntervalC[] = "forceSyncInterval";
 static const char fullLocalDiscoveryIntervalC[] = "fullLocalDiscoveryInterval";
 static const char notificationRefreshIntervalC[] = "notificationRefreshInterval";
@@ -497,6 +498,25 @@ void ConfigFile::setRemotePollInterval(chrono::milliseconds interval, const QStr
     settings.sync();
 }
 
+chrono::milliseconds ConfigFile::maxRemotePollInterval(const QString &connection) const
+{
+    auto pollInterval = remotePollInterval(connection);
+
+    QString con(connection);
+    if (connection.isEmpty())
+        con = defaultConnection();
+    QSettings settings(configFile(), QSettings::IniFormat);
+    settings.beginGroup(con);
+
+    auto defaultInterval = chrono::minutes(10);
+    auto interval = millisecondsValue(settings, maxRemotePollIntervalC, defaultInterval);
+    if (interval < pollInterval) {
+        qCWarning(lcConfigFile) << "Maximum remote poll interval is less than the remote poll interval, reverting to" << pollInterval.count();
+        interval = pollInterval;
+    }
+    return interval;
+}
+
 chrono::milliseconds ConfigFile::forceSyncInterval(const QString &connection) const
 {
     auto pollInterval = remotePollInterval(connection);
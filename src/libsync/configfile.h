@@ -67,6 +67,9 @@ public:
     /* Set poll interval. Value in milliseconds has to be larger than 5000 */
     void setRemotePollInterval(std::chrono::milliseconds interval, const QString &connection = QString());
 
+    /* Longest interval the poll interval of a folder without remote changes grows to, in milliseconds */
+    std::chrono::milliseconds maxRemotePollInterval(const QString &connection = QString()) const;
+
     /* Interval to check for new notifications */
     std::chrono::milliseconds notificationRefreshInterval(const QString &connection = QString()) const;
 
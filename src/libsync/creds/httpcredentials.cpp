@@ -184,18 +184,34 @@ void HttpCredentials::fetchFromKeychain()
 
 void HttpCredentials::fetchFromKeychainHelper()
 {
-    // Read client cert from keychain
-    const QString kck = keychainKey(
-        _account->url().toString(),
-        _user + clientCertificatePEMC,
-        _keychainMigration ? QString() : _account->id());
+    // The entries don't depend on each other, so the reads go to the
+    // keychain together instead of waiting for each other.
+    auto startReadJob = [this](const QString &user, void (HttpCredentials::*slot)(QKeychain::Job *)) {
+        const QString kck = keychainKey(
+            _account->url().toString(),
+            user,
+            _keychainMigration ? QString() : _account->id());
+
+        auto *job = new ReadPasswordJob(Theme::instance()->appName());
+        addSettingsToJob(_account, job);
+        job->setInsecureFallback(false);
+        job->setKey(kck);
+        connect(job, &Job::finished, this, slot);
+        job->start();
+    };
 
-    auto *job = new ReadPasswordJob(Theme::instance()->appName());
-    addSettingsToJob(_account, job);
-    job->setInsecureFallback(false);
-    job->setKey(kck);
-    connect(job, &Job::finished, this, &HttpCredentials::slotReadClientCertPEMJobDone);
-    job->start();
+    _keychainReadTimer.start();
+    _pendingKeychainReads = 3;
+    _keychainBackendUnavailable = false;
+    startReadJob(_user + clientCertificatePEMC, &HttpCredentials::slotReadClientCertPEMJobDone);
+    startReadJob(_user + clientKeyPEMC, &HttpCredentials::slotReadClientKeyPEMJobDone);
+    startReadJob(_user, &HttpCredentials::slotReadJobDone);
+}
+
+void HttpCredentials::keychainReadFinished()
+{
+    if (--_pendingKeychainReads == 0)
+        slotKeychainReadsDone();
 }
 
 void HttpCredentials::deleteOldKeychainEntries()
@@ -219,15 +235,10 @@ void HttpCredentials::slotReadClientCertPEMJobDone(QKeychain::Job *incoming)
     Q_ASSERT(!incoming->insecureFallback()); // If insecureFallback is set, the next test would be pointless
     if (_retryOnKeyChainError && (incoming->error() == QKeychain::NoBackendAvailable
             || incoming->error() == QKeychain::OtherError)) {
-        // Could be that the backend was not yet available. Wait some extra seconds.
-        // (Issues #4274 and #6522)
-        // (For kwallet, the error is OtherError instead of NoBackendAvailable, maybe a bug in QtKeychain)
-        qCInfo(lcHttpCredentials) << "Backend unavailable (yet?) Retrying in a few seconds." << incoming->errorString();
-        QTimer::singleShot(10000, this, &HttpCredentials::fetchFromKeychainHelper);
-        _retryOnKeyChainError = false;
-        return;
+        // Retried in slotKeychainReadsDone
+        qCInfo(lcHttpCredentials) << "Backend unavailable (yet?)" << incoming->errorString();
+        _keychainBackendUnavailable = true;
     }
-    _retryOnKeyChainError = false;
 #endif
 
     // Store PEM in memory
@@ -239,18 +250,7 @@ void HttpCredentials::slotReadClientCertPEMJobDone(QKeychain::Job *incoming)
         }
     }
 
-    // Load key too
-    const QString kck = keychainKey(
-        _account->url().toString(),
-        _user + clientKeyPEMC,
-        _keychainMigration ? QString() : _account->id());
-
-    auto *job = new ReadPasswordJob(Theme::instance()->appName());
-    addSettingsToJob(_account, job);
-    job->setInsecureFallback(false);
-    job->setKey(kck);
-    connect(job, &Job::finished, this, &HttpCredentials::slotReadClientKeyPEMJobDone);
-    job->start();
+    keychainReadFinished();
 }
 
 void HttpCredentials::slotReadClientKeyPEMJobDone(QKeychain::Job *incoming)
@@ -274,18 +274,7 @@ void HttpCredentials::slotReadClientKeyPEMJobDone(QKeychain::Job *incoming)
         }
     }
 
-    // Now fetch the actual server password
-    const QString kck = keychainKey(
-        _account->url().toString(),
-        _user,
-        _keychainMigration ? QString() : _account->id());
-
-    auto *job = new ReadPasswordJob(Theme::instance()->appName());
-    addSettingsToJob(_account, job);
-    job->setInsecureFallback(false);
-    job->setKey(kck);
-    connect(job, &Job::finished, this, &HttpCredentials::slotReadJobDone);
-    job->start();
+    keychainReadFinished();
 }
 
 
@@ -299,9 +288,36 @@ bool HttpCredentials::stillValid(QNetworkReply *reply)
 
 void HttpCredentials::slotReadJobDone(QKeychain::Job *incomingJob)
 {
-    auto *job = static_cast<ReadPasswordJob *>(incomingJob);
+    // Kept for slotKeychainReadsDone, which deletes it later
+    _passwordReadJob = static_cast<ReadPasswordJob *>(incomingJob);
+    _passwordReadJob->setAutoDelete(false);
+    keychainReadFinished();
+}
+
+void HttpCredentials::slotKeychainReadsDone()
+{
+    // This may run inside the finished() signal of the job, which QtKeychain
+    // still uses after emitting it
+    ReadPasswordJob *job = _passwordReadJob;
+    _passwordReadJob = nullptr;
+    job->deleteLater();
     QKeychain::Error error = job->error();
 
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+    if (_keychainBackendUnavailable) {
+        // Could be that the backend was not yet available. Wait some extra seconds.
+        // (Issues #4274 and #6522)
+        // (For kwallet, the error is OtherError instead of NoBackendAvailable, maybe a bug in QtKeychain)
+        qCInfo(lcHttpCredentials) << "Backend unavailable (yet?) Retrying in a few seconds.";
+        QTimer::singleShot(10000, this, &HttpCredentials::fetchFromKeychainHelper);
+        _retryOnKeyChainError = false;
+        return;
+    }
+    _retryOnKeyChainError = false;
+#endif
+
+    qCInfo(lcHttpCredentials) << "Read keychain entries of" << _user << "in" << _keychainReadTimer.elapsed() << "ms";
+
     // If we can't find the credentials at the keys that include the account id,
     // try to read them from the legacy locations that don't have a account id.
     if (!_keychainMigration && error == QKeychain::EntryNotFound) {
@@ -16,6 +16,7 @@
 #ifndef MIRALL_CREDS_HTTP_CREDENTIALS_H
 #define MIRALL_CREDS_HTTP_CREDENTIALS_H
 
+#include <QElapsedTimer>
 #include <QMap>
 #include <QSslCertificate>
 #include <QSslKey>
@@ -48,15 +49,15 @@ namespace OCC {
    1) First, AccountState will attempt to load the certificate from the keychain
 
    ---->  fetchFromKeychain
-                |                           }
-                v                            }
-          slotReadClientCertPEMJobDone       }     There are first 3 QtKeychain jobs to fetch
-                |                             }   the TLS client keys, if any, and the password
-                v                            }      (or refresh token
-          slotReadClientKeyPEMJobDone        }
-                |                           }
-                v
-            slotReadJobDone
+                |
+                +--------------------+-----------------------------+
+                v                    v                             v
+          slotReadClientCertPEMJobDone  slotReadClientKeyPEMJobDone  slotReadJobDone
+                |                    |                             |
+                +--------------------+-----------------------------+
+                |     The 3 QtKeychain jobs fetching the TLS client keys, if any,
+                v     and the password (or refresh token) run at the same time
+            slotKeychainReadsDone
                 |        |
                 |        +-------> emit fetched()   if OAuth is not used
                 |
@@ -113,6 +114,7 @@ private Q_SLOTS:
     void slotReadClientCertPEMJobDone(QKeychain::Job *);
     void slotReadClientKeyPEMJobDone(QKeychain::Job *);
     void slotReadJobDone(QKeychain::Job *);
+    void slotKeychainReadsDone();
 
     void slotWriteClientCertPEMJobDone();
     void slotWriteClientKeyPEMJobDone();
@@ -121,13 +123,14 @@ private Q_SLOTS:
 protected:
     /** Reads data from keychain locations
      *
-     * Goes through
-     *   slotReadClientCertPEMJobDone to
-     *   slotReadClientCertPEMJobDone to
-     *   slotReadJobDone
+     * Starts the reads of the client certificate, its key and the password
+     * together, slotKeychainReadsDone is called once all three finished.
      */
     void fetchFromKeychainHelper();
 
+    /// Counts a finished keychain read, continues when it was the last one
+    void keychainReadFinished();
+
     /// Wipes legacy keychain locations
     void deleteOldKeychainEntries();
 
@@ -142,6 +145,11 @@ protected:
     QSslCertificate _clientSslCertificate;
     bool _keychainMigration = false;
     bool _retryOnKeyChainError = true; // true if we haven't done yet any reading from keychain
+    int _pendingKeychainReads = 0;
+    bool _keychainBackendUnavailable = false;
+    // The finished password read, kept until all reads finished
+    QKeychain::ReadPasswordJob *_passwordReadJob = nullptr;
+    QElapsedTimer _keychainReadTimer;
 };
 
 
@@ -276,10 +276,14 @@ void DiscoverySingleDirectoryJob::start()
           << "http://owncloud.org/ns:checksums";
     if (_isRootPath)
         props << "http://owncloud.org/ns:data-fingerprint";
-    if (_account->serverVersionInt() >= Account::makeServerVersion(10, 0, 0)) {
+    if (_account->serverVersionInt() >= Account::makeServerVersion(10, 0, 0)
+        && _account->capabilities().shareAPI()) {
         // Server older than 10.0 have performances issue if we ask for the share-types on every PROPFIND
+        // Without the sharing API no file can be shared
         props << "http://owncloud.org/ns:share-types";
     }
+    for (const auto &prop : _skippedProperties)
+        props.removeAll(prop);
 
     lsColJob->setProperties(props);
 
@@ -409,6 +413,10 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, con
             file_stat->remotePerm.unsetPermission(RemotePermissions::IsMounted);
             file_stat->remotePerm.setPermission(RemotePermissions::IsMountedSub);
         }
+        if (file_stat->remotePerm.hasPermission(RemotePermissions::IsMounted))
+            _mountPoints.append(file);
+        if (file_stat->type != ItemTypeDirectory)
+            _hasFileEntry = true;
 
         QStringRef fileRef(&file);
         int slashPos = file.lastIndexOf(QLatin1Char('/'));
@@ -418,6 +426,9 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, con
         _results.push_back(std::move(file_stat));
     }
 
+    if (map.contains("downloadURL") || map.contains("dDC"))
+        _hasDirectDownload = true;
+
     //This works in concerto with the RequestEtagJob and the Folder object to check if the remote folder changed.
     if (map.contains("getetag")) {
         _etagConcatenation += map.value("getetag");
@@ -441,6 +452,9 @@ void DiscoverySingleDirectoryJob::lsJobFinishedWithoutErrorSlot()
         deleteLater();
         return;
     }
+    _receivedBytes = _lsColJob->receivedBytes();
+    _parseNsecs = _lsColJob->parseNsecs();
+    _entryCount = _lsColJob->entryCount();
     emit etag(_firstEtag);
     emit etagConcatenation(_etagConcatenation);
     emit finishedWithResult();
@@ -470,6 +484,30 @@ void DiscoverySingleDirectoryJob::lsJobFinishedWithErrorSlot(QNetworkReply *r)
     deleteLater();
 }
 
+DiscoveryMainThread::~DiscoveryMainThread()
+{
+    if (_listingCount == 0)
+        return;
+    qCInfo(lcDiscovery) << "Remote discovery read" << _listingCount << "listings with" << _entryCount << "entries:"
+                        << _receivedBytes << "bytes," << (_entryCount ? _receivedBytes / _entryCount : 0) << "bytes per entry,"
+                        << _parseNsecs / 1000000 << "ms parsing," << (_entryCount ? _parseNsecs / 1000 / _entryCount : 0) << "us per entry;"
+                        << _listingsWithoutDirectDownload << "listings without direct download properties";
+}
+
+bool DiscoveryMainThread::directDownloadInSubtree(const QString &path) const
+{
+    QString dir = path;
+    forever {
+        auto it = _directDownloadSubtrees.constFind(dir);
+        if (it != _directDownloadSubtrees.constEnd())
+            return *it;
+        const int slashPos = dir.lastIndexOf(QLatin1Char('/'));
+        if (slashPos < 0)
+            return true;
+        dir.truncate(slashPos);
+    }
+}
+
 void DiscoveryMainThread::setupHooks(DiscoveryJob *discoveryJob, const QString &pathPrefix)
 {
     _discoveryJob = discoveryJob;
@@ -518,6 +556,10 @@ void DiscoveryMainThread::doOpendirSlot(const QString &subPath, DiscoveryDirecto
     if (!_firstFolderProcessed) {
         _singleDirJob->setIsRootPath();
     }
+    if (!directDownloadInSubtree(fullPath)) {
+        _singleDirJob->setSkippedProperties({ "http://owncloud.org/ns:downloadURL", "http://owncloud.org/ns:dDC" });
+        _listingsWithoutDirectDownload++;
+    }
 
     _singleDirJob->start();
 }
@@ -532,6 +574,29 @@ void DiscoveryMainThread::singleDirectoryJobResultSlot()
     _currentDiscoveryDirectoryResult->list = _singleDirJob->takeResults();
     _currentDiscoveryDirectoryResult->code = 0;
 
+    _listingCount++;
+    _entryCount += _singleDirJob->_entryCount;
+    _receivedBytes += _singleDirJob->_receivedBytes;
+    _parseNsecs += _singleDirJob->_parseNsecs;
+    // Discovery is depth first, so what a listing tells about its storage is
+    // kept per subtree: the listings below it don't carry direct download
+    // properties as 404 propstats, the mount points in it are asked again.
+    // Only files have direct download properties, a listing of folders tells
+    // nothing about them.
+    const QString &path = _currentDiscoveryDirectoryResult->path;
+    const bool inherited = directDownloadInSubtree(path);
+    if (_singleDirJob->_hasDirectDownload) {
+        if (!inherited)
+            _directDownloadSubtrees.insert(path, true);
+    } else if (_singleDirJob->_hasFileEntry && inherited) {
+        qCDebug(lcDiscovery) << "No direct download urls in" << path << ", not requesting them below it";
+        _directDownloadSubtrees.insert(path, false);
+    }
+    if (!directDownloadInSubtree(path)) {
+        for (const auto &mountPoint : qAsConst(_singleDirJob->_mountPoints))
+            _directDownloadSubtrees.insert(path + QLatin1Char('/') + mountPoint, true);
+    }
+
     qCDebug(lcDiscovery) << "Have" << _currentDiscoveryDirectoryResult->list.size() << "results for " << _currentDiscoveryDirectoryResult->path;
 
     _currentDiscoveryDirectoryResult = nullptr; // the sync thread owns it now
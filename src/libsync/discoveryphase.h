@@ -19,6 +19,7 @@
 #include <QStringList>
 #include <csync.h>
 #include <QMap>
+#include <QSet>
 #include "networkjobs.h"
 #include <QMutex>
 #include <QWaitCondition>
@@ -57,6 +58,8 @@ public:
     explicit DiscoverySingleDirectoryJob(const AccountPtr &account, const QString &path, QObject *parent = nullptr);
     // Specify thgat this is the root and we need to check the data-fingerprint
     void setIsRootPath() { _isRootPath = true; }
+    // Properties that are not requested, see DiscoveryMainThread::_directDownloadSubtrees
+    void setSkippedProperties(const QSet<QByteArray> &properties) { _skippedProperties = properties; }
     void start();
     void abort();
     std::deque<std::unique_ptr<csync_file_stat_t>> &&takeResults() { return std::move(_results); }
@@ -89,9 +92,20 @@ private:
     // If set, the discovery will finish with an error
     QString _error;
     QPointer<LsColJob> _lsColJob;
+    QSet<QByteArray> _skippedProperties;
 
 public:
     QByteArray _dataFingerprint;
+    // Whether any entry had a direct download url or cookie
+    bool _hasDirectDownload = false;
+    // Whether any entry is not a directory
+    bool _hasFileEntry = false;
+    // The entries that are mount points, relative to the listed directory
+    QStringList _mountPoints;
+    // Size of the listing and time spent parsing it, from the LsColJob
+    qint64 _receivedBytes = 0;
+    qint64 _parseNsecs = 0;
+    int _entryCount = 0;
 };
 
 // Lives in main thread. Deleted by the SyncEngine
@@ -108,6 +122,19 @@ class DiscoveryMainThread : public QObject
     qint64 *_currentGetSizeResult;
     bool _firstFolderProcessed;
 
+    // Whether the listings below a remote path should ask for direct download
+    // urls and cookies. They are offered for every file of a storage or for
+    // none, so they are not requested below a directory whose listing had
+    // none, except below the mount points of other storages in it.
+    // Only paths that differ from their parent's value are kept.
+    QHash<QString, bool> _directDownloadSubtrees;
+    bool directDownloadInSubtree(const QString &path) const;
+    int _listingCount = 0;
+    int _listingsWithoutDirectDownload = 0;
+    int _entryCount = 0;
+    qint64 _receivedBytes = 0;
+    qint64 _parseNsecs = 0;
+
 public:
     DiscoveryMainThread(AccountPtr account)
         : QObject()
@@ -117,6 +144,7 @@ public:
         , _firstFolderProcessed(false)
     {
     }
+    ~DiscoveryMainThread() override;
     void abort();
 
     QByteArray _dataFingerprint;
@@ -116,7 +116,6 @@ bool FileSystem::verifyFileUnchanged(const QString &fileName,
     return true;
 }
 
-#ifdef Q_OS_WIN
 static qint64 getSizeWithCsync(const QString &filename)
 {
     qint64 result = 0;
@@ -128,10 +127,12 @@ static qint64 getSizeWithCsync(const QString &filename)
     }
     return result;
 }
-#endif
 
 qint64 FileSystem::getSize(const QString &filename)
 {
+    if (csync_vio_local_backend()) {
+        return getSizeWithCsync(filename);
+    }
 #ifdef Q_OS_WIN
     if (isLnkFile(filename)) {
         // Use csync to get the file size. Qt seems unable to get at it.
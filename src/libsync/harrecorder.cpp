@@ -0,0 +1,213 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "harrecorder.h"
+#include "abstractnetworkjob.h"
+#include "theme.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrlQuery>
+
+#include <memory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcHarRecorder, "nextcloud.sync.harrecorder", QtInfoMsg)
+
+static const QByteArray harFooter = QByteArrayLiteral("\n]}}\n");
+
+// Buffered entries are written after this delay or once they reach the size
+static const int flushDelayMsecs = 1000;
+static const int maxPendingBytes = 64 * 1024;
+
+HarRecorder *HarRecorder::instance()
+{
+    static const std::unique_ptr<HarRecorder> recorder = []() -> std::unique_ptr<HarRecorder> {
+        const auto fileName = qEnvironmentVariable("OWNCLOUD_HAR_FILE");
+        if (fileName.isEmpty())
+            return nullptr;
+        std::unique_ptr<HarRecorder> recorder(new HarRecorder(fileName));
+        if (!recorder->isOpen())
+            return nullptr;
+        return recorder;
+    }();
+    return recorder.get();
+}
+
+HarRecorder::HarRecorder(const QString &fileName)
+    : _file(fileName)
+{
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcHarRecorder) << "Could not open" << fileName << "for recording requests:" << _file.errorString();
+        return;
+    }
+
+    const QJsonObject creator{
+        { QStringLiteral("name"), Theme::instance()->appName() },
+        { QStringLiteral("version"), Theme::instance()->version() },
+    };
+    const QByteArray header = "{\"log\":{\"version\":\"1.2\",\"creator\":"
+        + QJsonDocument(creator).toJson(QJsonDocument::Compact)
+        + ",\"entries\":[";
+    _file.write(header);
+    _footerPos = _file.pos();
+    _file.write(harFooter);
+    _file.flush();
+    qCInfo(lcHarRecorder) << "Recording requests to" << fileName;
+}
+
+HarRecorder::~HarRecorder()
+{
+    flush();
+}
+
+QString HarRecorder::redactedUrl(const QUrl &url)
+{
+    QUrl result = url;
+    // Query values may carry tokens, for example of direct download urls
+    if (result.hasQuery()) {
+        QUrlQuery query(result);
+        auto items = query.queryItems();
+        for (auto &item : items)
+            item.second = QStringLiteral("redacted");
+        query.setQueryItems(items);
+        result.setQuery(query);
+    }
+    return result.toString(QUrl::RemoveUserInfo);
+}
+
+void HarRecorder::Request::start(const QElapsedTimer &jobCreated)
+{
+    started = QDateTime::currentDateTimeUtc();
+    elapsed.start();
+    queuedMsecs = jobCreated.isValid() ? jobCreated.elapsed() : 0;
+    firstByteMsecs = -1;
+    bytesSent = 0;
+    bytesReceived = 0;
+}
+
+void HarRecorder::Request::markFirstByte()
+{
+    if (firstByteMsecs < 0 && elapsed.isValid())
+        firstByteMsecs = elapsed.elapsed();
+}
+
+void HarRecorder::record(const QNetworkReply &reply, const Request &request,
+    const char *jobType, const QString &path, qint64 requestBodySize, int retry)
+{
+    const qint64 total = request.elapsed.isValid() ? request.elapsed.elapsed() : 0;
+    // Replies that fail before any response still took the whole time waiting
+    const qint64 wait = request.firstByteMsecs >= 0 ? request.firstByteMsecs : total;
+    const bool http2 = reply.attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+    const QString httpVersion = http2 ? QStringLiteral("HTTP/2") : QStringLiteral("HTTP/1.1");
+
+    qint64 requestSize = request.bytesSent > 0 ? request.bytesSent : requestBodySize;
+    if (requestSize < 0)
+        requestSize = reply.request().header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    // Bodies that are read in readyRead only show up in the download progress
+    const qint64 responseSize = std::max(request.bytesReceived, reply.bytesAvailable());
+
+    const QJsonArray empty;
+    const QJsonObject harRequest{
+        { QStringLiteral("method"), QString::fromLatin1(requestVerb(reply)) },
+        { QStringLiteral("url"), redactedUrl(reply.request().url()) },
+        { QStringLiteral("httpVersion"), httpVersion },
+        { QStringLiteral("cookies"), empty },
+        { QStringLiteral("headers"), empty },
+        { QStringLiteral("queryString"), empty },
+        { QStringLiteral("headersSize"), -1 },
+        { QStringLiteral("bodySize"), requestSize },
+    };
+    const QJsonObject harResponse{
+        { QStringLiteral("status"), reply.attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() },
+        { QStringLiteral("statusText"), reply.attribute(QNetworkRequest::HttpReasonPhraseAttribute).toString() },
+        { QStringLiteral("httpVersion"), httpVersion },
+        { QStringLiteral("cookies"), empty },
+        { QStringLiteral("headers"), empty },
+        { QStringLiteral("content"), QJsonObject{
+                                         { QStringLiteral("size"), responseSize },
+                                         { QStringLiteral("mimeType"), reply.header(QNetworkRequest::ContentTypeHeader).toString() },
+                                     } },
+        { QStringLiteral("redirectURL"), redactedUrl(reply.attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl()) },
+        { QStringLiteral("headersSize"), -1 },
+        { QStringLiteral("bodySize"), responseSize },
+    };
+    const QJsonObject timings{
+        { QStringLiteral("send"), 0 },
+        { QStringLiteral("wait"), wait },
+        { QStringLiteral("receive"), total - wait },
+    };
+    QJsonObject entry{
+        { QStringLiteral("startedDateTime"), request.started.toString(Qt::ISODateWithMs) },
+        { QStringLiteral("time"), total },
+        { QStringLiteral("request"), harRequest },
+        { QStringLiteral("response"), harResponse },
+        { QStringLiteral("cache"), QJsonObject() },
+        { QStringLiteral("timings"), timings },
+        { QStringLiteral("_jobType"), QString::fromLatin1(jobType) },
+        { QStringLiteral("_path"), path },
+        { QStringLiteral("_http2"), http2 },
+        { QStringLiteral("_retry"), retry },
+        { QStringLiteral("_queuedMsecs"), request.queuedMsecs },
+    };
+    if (reply.error() != QNetworkReply::NoError)
+        entry.insert(QStringLiteral("_error"), reply.errorString());
+
+    const QByteArray json = QJsonDocument(entry).toJson(QJsonDocument::Compact);
+
+    QMutexLocker locker(&_mutex);
+    if (!_file.isOpen())
+        return;
+    _pending += _entryCount == 0 ? "\n" : ",\n";
+    _pending += json;
+    ++_entryCount;
+
+    // Not a seek, write and flush on the GUI thread for every request
+    if (_pending.size() >= maxPendingBytes) {
+        writePending();
+    } else if (!_flushScheduled) {
+        _flushScheduled = true;
+        QTimer::singleShot(flushDelayMsecs, this, &HarRecorder::flush);
+    }
+}
+
+void HarRecorder::flush()
+{
+    QMutexLocker locker(&_mutex);
+    _flushScheduled = false;
+    writePending();
+}
+
+void HarRecorder::writePending()
+{
+    if (_pending.isEmpty() || !_file.isOpen())
+        return;
+    // Overwrite the footer so the file stays valid JSON after every write
+    _file.seek(_footerPos);
+    _file.write(_pending);
+    _footerPos = _file.pos();
+    _file.write(harFooter);
+    _file.flush();
+    _pending.clear();
+}
+
+int HarRecorder::entryCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _entryCount;
+}
+}
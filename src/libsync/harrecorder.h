@@ -0,0 +1,99 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef HARRECORDER_H
+#define HARRECORDER_H
+
+#include "owncloudlib.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QObject>
+
+class QNetworkReply;
+class QUrl;
+
+namespace OCC {
+
+/**
+ * @brief Writes the requests of all network jobs to a HAR file
+ *
+ * The HTTP Archive format (HAR 1.2) is understood by browser developer
+ * tools and many analysis tools. Every request sent by an AbstractNetworkJob
+ * becomes one entry with method, url, status, request and response sizes,
+ * time to first byte and total time. Non-standard fields carry the job type,
+ * the job's path, whether HTTP/2 was used, the retry number of the request
+ * and the time the job waited between its creation and sending the request.
+ *
+ * Headers and bodies are not recorded and the values of query parameters
+ * are redacted, so the file contains no credentials or access tokens.
+ *
+ * The recorder is opt-in: it only runs if OWNCLOUD_HAR_FILE is set to the
+ * file name. Entries are buffered and written about once a second, the
+ * file is valid JSON after every write.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT HarRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    /** The recorder configured in the environment, null if recording is disabled. */
+    static HarRecorder *instance();
+
+    explicit HarRecorder(const QString &fileName);
+    ~HarRecorder() override;
+
+    bool isOpen() const { return _file.isOpen(); }
+
+    /** Timing and size information of one request, kept by the job. */
+    struct Request
+    {
+        void start(const QElapsedTimer &jobCreated);
+        void markFirstByte();
+
+        QDateTime started;
+        QElapsedTimer elapsed;
+        qint64 queuedMsecs = 0;
+        qint64 firstByteMsecs = -1;
+        qint64 bytesSent = 0;
+        qint64 bytesReceived = 0;
+    };
+
+    /** Adds an entry for a finished request. */
+    void record(const QNetworkReply &reply, const Request &request,
+        const char *jobType, const QString &path, qint64 requestBodySize, int retry);
+
+    int entryCount() const;
+
+    /** Writes the buffered entries to the file. */
+    void flush();
+
+    /** The url as recorded: without user info and with redacted query values. */
+    static QString redactedUrl(const QUrl &url);
+
+private:
+    void writePending();
+
+    mutable QMutex _mutex;
+    QFile _file;
+    qint64 _footerPos = 0;
+    int _entryCount = 0;
+    // Entries not written yet, with their separators
+    QByteArray _pending;
+    bool _flushScheduled = false;
+};
+}
+
+#endif // HARRECORDER_H
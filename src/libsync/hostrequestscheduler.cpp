@@ -0,0 +1,140 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "hostrequestscheduler.h"
+#include "account.h"
+
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QUrl>
+
+#include <memory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcHostScheduler, "nextcloud.sync.hostscheduler", QtInfoMsg)
+
+HostRequestScheduler *HostRequestScheduler::instance()
+{
+    static HostRequestScheduler scheduler;
+    return &scheduler;
+}
+
+QString HostRequestScheduler::hostKey(const QUrl &url)
+{
+    const QString scheme = url.scheme().toLower();
+    const int port = url.port(scheme == QLatin1String("https") ? 443 : 80);
+    return scheme + QLatin1String("://") + url.host().toLower() + QLatin1Char(':') + QString::number(port);
+}
+
+void HostRequestScheduler::trackReply(const Account *account, QNetworkReply *reply)
+{
+    const QString key = hostKey(account->url());
+    auto &host = _hosts[key];
+    ++host.inFlight;
+    ++host.accountsInFlight[account];
+
+    // Count the end once, whether the reply finishes or is deleted unfinished
+    auto done = std::make_shared<bool>(false);
+    auto finish = [this, key, account, done] {
+        if (*done)
+            return;
+        *done = true;
+        requestFinished(key, account);
+    };
+    connect(reply, &QNetworkReply::finished, this, finish);
+    connect(reply, &QObject::destroyed, this, finish);
+}
+
+void HostRequestScheduler::requestFinished(const QString &key, const Account *account)
+{
+    auto it = _hosts.find(key);
+    if (it == _hosts.end())
+        return;
+    auto &host = *it;
+    --host.inFlight;
+    if (--host.accountsInFlight[account] <= 0)
+        host.accountsInFlight.remove(account);
+
+    if (host.inFlight <= 0 && host.waiting.isEmpty())
+        _hosts.erase(it);
+
+    // The waiting accounts stay queued until they got their request in, so
+    // an account above its fair share can't take the free slot in between.
+    emit hostCapacityAvailable(key);
+}
+
+void HostRequestScheduler::stopWaiting(const Account *account)
+{
+    auto it = _hosts.find(hostKey(account->url()));
+    if (it == _hosts.end())
+        return;
+    it->waiting.removeAll(account);
+    if (it->inFlight <= 0 && it->waiting.isEmpty())
+        _hosts.erase(it);
+}
+
+bool HostRequestScheduler::mayStartRequest(const Account *account, int hostBudget)
+{
+    const QString key = hostKey(account->url());
+    auto it = _hosts.find(key);
+    if (it == _hosts.end()) {
+        // Nothing in flight and nobody waiting. Only trackReply() and
+        // refusals add hosts, so a granted request that is never sent
+        // doesn't leave an entry behind.
+        if (hostBudget > 0)
+            return true;
+        it = _hosts.insert(key, Host());
+    }
+    auto &host = *it;
+
+    bool othersWaiting = false;
+    int contenders = 1;
+    for (auto waiter : host.waiting) {
+        if (waiter != account) {
+            othersWaiting = true;
+            if (!host.accountsInFlight.contains(waiter))
+                ++contenders;
+        }
+    }
+    for (auto it = host.accountsInFlight.cbegin(); it != host.accountsInFlight.cend(); ++it) {
+        if (it.key() != account)
+            ++contenders;
+    }
+
+    const int fairShare = qMax(1, hostBudget / contenders);
+    if (host.inFlight < hostBudget
+        && (!othersWaiting || host.accountsInFlight.value(account) < fairShare)) {
+        host.waiting.removeAll(account);
+        if (host.inFlight <= 0 && host.waiting.isEmpty())
+            _hosts.erase(it);
+        return true;
+    }
+
+    if (!host.waiting.contains(account)) {
+        qCDebug(lcHostScheduler) << "Request budget of" << key << "used up:" << host.inFlight << "of" << hostBudget
+                                 << "in flight, fair share" << fairShare << "for" << contenders << "accounts";
+        host.waiting.append(account);
+    }
+    return false;
+}
+
+int HostRequestScheduler::requestsInFlight(const QString &host) const
+{
+    return _hosts.value(host).inFlight;
+}
+
+int HostRequestScheduler::requestsInFlight(const Account *account) const
+{
+    return _hosts.value(hostKey(account->url())).accountsInFlight.value(account);
+}
+}
@@ -0,0 +1,98 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef HOSTREQUESTSCHEDULER_H
+#define HOSTREQUESTSCHEDULER_H
+
+#include "owncloudlib.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class QNetworkReply;
+class QUrl;
+
+namespace OCC {
+
+class Account;
+
+/**
+ * @brief Shares a request budget between the accounts on the same server
+ *
+ * Every account has its own network access manager, so several accounts on
+ * one server each open their own connections, and each propagator only
+ * limits its own parallelism. The accounts can't share a network access
+ * manager because its cookie jar holds the session cookies of one user.
+ *
+ * Instead all requests sent through Account::sendRawRequest() are counted
+ * per host here, and the propagators ask before they start another job.
+ * A host's budget is the number of parallel requests a single account
+ * would use. When several accounts compete for it, each gets a fair share:
+ * a refused account is queued, and while it waits the others can't go
+ * above their share. hostCapacityAvailable() tells the refused accounts
+ * when to ask again.
+ *
+ * All methods must be called from the main thread.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT HostRequestScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    static HostRequestScheduler *instance();
+
+    /** The scheme, host and port of the url: requests with the same key go to the same server. */
+    static QString hostKey(const QUrl &url);
+
+    /** Counts the reply against the budget of the account's host until it finishes. */
+    void trackReply(const Account *account, QNetworkReply *reply);
+
+    /**
+     * Whether the account may start another request to its host.
+     *
+     * False when the host already has hostBudget requests in flight, or when
+     * the account has its fair share of them while other accounts wait.
+     * The account is then put in the host's queue and hostCapacityAvailable()
+     * is emitted once one of the host's requests finishes.
+     */
+    bool mayStartRequest(const Account *account, int hostBudget);
+
+    /** Takes the account out of its host's queue, for when it doesn't want to start requests anymore. */
+    void stopWaiting(const Account *account);
+
+    int requestsInFlight(const QString &host) const;
+    int requestsInFlight(const Account *account) const;
+
+    /** The number of hosts with requests in flight or waiting accounts. */
+    int hostCount() const { return _hosts.size(); }
+
+signals:
+    /** A request to the host finished, accounts that were refused may ask again. */
+    void hostCapacityAvailable(const QString &host);
+
+private:
+    struct Host
+    {
+        int inFlight = 0;
+        QHash<const Account *, int> accountsInFlight;
+        QList<const Account *> waiting;
+    };
+
+    void requestFinished(const QString &hostKey, const Account *account);
+
+    QHash<QString, Host> _hosts;
+};
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "http2streamcapacity.h"
+
+#include <QLoggingCategory>
+#include <QtGlobal>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcHttp2Capacity, "nextcloud.sync.http2capacity", QtInfoMsg)
+
+constexpr int Http2StreamCapacity::initialStreams;
+constexpr int Http2StreamCapacity::minimumStreams;
+constexpr int Http2StreamCapacity::maximumStreams;
+
+void Http2StreamCapacity::streamSucceeded()
+{
+    if (++_successes < _streams)
+        return;
+    _successes = 0;
+    if (_streams < maximumStreams)
+        ++_streams;
+}
+
+void Http2StreamCapacity::streamRefused()
+{
+    _successes = 0;
+    const int streams = qMax(minimumStreams, _streams / 2);
+    if (streams != _streams) {
+        qCInfo(lcHttp2Capacity) << "HTTP/2 stream refused, lowering the parallel requests from" << _streams << "to" << streams;
+        _streams = streams;
+    }
+}
+}
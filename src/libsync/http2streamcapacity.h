@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef HTTP2STREAMCAPACITY_H
+#define HTTP2STREAMCAPACITY_H
+
+#include "owncloudlib.h"
+
+namespace OCC {
+
+/**
+ * @brief Estimates how many parallel requests the server's HTTP/2 connection takes
+ *
+ * With HTTP/2 all requests to a server are streams on one connection, so
+ * the useful number of parallel requests is bounded by the streams the
+ * server allows at once rather than by connections. Qt doesn't tell us the
+ * server's SETTINGS_MAX_CONCURRENT_STREAMS, so the limit is found like a
+ * congestion window: every window of requests that went through grows it
+ * by one, a stream the server refused halves it.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT Http2StreamCapacity
+{
+public:
+    /// Where the estimate starts
+    static constexpr int initialStreams = 20;
+    /// As many requests as HTTP/1 would send over its six connections
+    static constexpr int minimumStreams = 6;
+    /// Qt never opens more streams on one connection
+    static constexpr int maximumStreams = 100;
+
+    int streams() const { return _streams; }
+
+    /** A request sent as HTTP/2 stream finished. */
+    void streamSucceeded();
+
+    /** A request had to be resent because the server refused or reset its stream. */
+    void streamRefused();
+
+private:
+    int _streams = initialStreams;
+    int _successes = 0;
+};
+}
+
+#endif
@@ -111,6 +111,8 @@ bool RequestEtagJob::finished()
             }
         }
         emit etagRetrieved(etag);
+    } else {
+        emit finishedWithError(reply());
     }
     return true;
 }
@@ -164,134 +166,175 @@ bool MkColJob::finished()
 }
 
 /*********************************************************************************************/
-// supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
-static QString readContentsAsString(QXmlStreamReader &reader)
-{
-    QString result;
-    int level = 0;
-    do {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        if (type == QXmlStreamReader::StartElement) {
-            level++;
-            result += "<" + reader.name().toString() + ">";
-        } else if (type == QXmlStreamReader::Characters) {
-            result += reader.text();
-        } else if (type == QXmlStreamReader::EndElement) {
-            level--;
-            if (level < 0) {
-                break;
-            }
-            result += "</" + reader.name().toString() + ">";
-        }
 
-    } while (!reader.atEnd());
-    return result;
+LsColXMLParser::LsColXMLParser() = default;
+
+bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    start(fileInfo, expectedPath);
+    return addData(xml) && finish();
 }
 
+void LsColXMLParser::start(QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    _reader.clear();
+    _started = true;
+    _reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
+    _fileInfo = fileInfo;
+    _expectedPath = expectedPath;
+    _folders.clear();
+    _currentHref.clear();
+    _currentTmpProperties.clear();
+    _currentHttp200Properties.clear();
+    _currentPropsHaveHttp200 = false;
+    _insidePropstat = false;
+    _insideProp = false;
+    _insideMultiStatus = false;
+    _capture = Capture::None;
+}
 
-LsColXMLParser::LsColXMLParser() = default;
+bool LsColXMLParser::addData(const QByteArray &data)
+{
+    _reader.addData(data);
+    return parseAvailable();
+}
 
-bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+bool LsColXMLParser::finish()
+{
+    if (_reader.hasError()) {
+        // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
+        qCWarning(lcLsColJob) << "ERROR" << _reader.errorString();
+        return false;
+    } else if (!_insideMultiStatus) {
+        qCWarning(lcLsColJob) << "ERROR no WebDAV response?";
+        return false;
+    }
+    emit directoryListingSubfolders(_folders);
+    emit finishedWithoutError();
+    return true;
+}
+
+// Reads the tokens that are available. Element contents are collected
+// token by token, so parsing can stop at any point and resume when the
+// next piece of the reply arrived.
+bool LsColXMLParser::parseAvailable()
 {
-    // Parse DAV response
-    QXmlStreamReader reader(xml);
-    reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
-
-    QStringList folders;
-    QString currentHref;
-    QMap<QString, QString> currentTmpProperties;
-    QMap<QString, QString> currentHttp200Properties;
-    bool currentPropsHaveHttp200 = false;
-    bool insidePropstat = false;
-    bool insideProp = false;
-    bool insideMultiStatus = false;
-
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
+    while (true) {
+        QXmlStreamReader::TokenType type = _reader.readNext();
+        if (type == QXmlStreamReader::Invalid) {
+            // Running out of data is only an error once the reply is complete, see finish()
+            return _reader.error() == QXmlStreamReader::PrematureEndOfDocumentError;
+        }
+        if (type == QXmlStreamReader::EndDocument)
+            return true;
+
+        if (_capture != Capture::None) {
+            // supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
+            if (type == QXmlStreamReader::StartElement) {
+                _captureLevel++;
+                if (_capture == Capture::Property)
+                    _captureText += "<" + _reader.name().toString() + ">";
+            } else if (type == QXmlStreamReader::Characters) {
+                _captureText += _reader.text();
+            } else if (type == QXmlStreamReader::EndElement) {
+                _captureLevel--;
+                if (_captureLevel < 0) {
+                    if (!captureFinished())
+                        return false;
+                } else if (_capture == Capture::Property) {
+                    _captureText += "</" + _reader.name().toString() + ">";
+                }
+            }
+            continue;
+        }
+
+        QString name = _reader.name().toString();
         // Start elements with DAV:
-        if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
+        if (type == QXmlStreamReader::StartElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
             if (name == QLatin1String("href")) {
-                // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
-                // but the result will have URL encoding..
-                QString hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(reader.readElementText().toUtf8()))
-                        .adjusted(QUrl::NormalizePathSegments)
-                        .path();
-                if (!hrefString.startsWith(expectedPath)) {
-                    qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << expectedPath;
-                    return false;
-                }
-                currentHref = hrefString;
+                _capture = Capture::Href;
             } else if (name == QLatin1String("response")) {
             } else if (name == QLatin1String("propstat")) {
-                insidePropstat = true;
-            } else if (name == QLatin1String("status") && insidePropstat) {
-                QString httpStatus = reader.readElementText();
-                if (httpStatus.startsWith("HTTP/1.1 200")) {
-                    currentPropsHaveHttp200 = true;
-                } else {
-                    currentPropsHaveHttp200 = false;
-                }
+                _insidePropstat = true;
+            } else if (name == QLatin1String("status") && _insidePropstat) {
+                _capture = Capture::Status;
             } else if (name == QLatin1String("prop")) {
-                insideProp = true;
+                _insideProp = true;
                 continue;
             } else if (name == QLatin1String("multistatus")) {
-                insideMultiStatus = true;
+                _insideMultiStatus = true;
                 continue;
             }
         }
 
-        if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
+        if (type == QXmlStreamReader::StartElement && _capture == Capture::None && _insidePropstat && _insideProp) {
             // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
-            if (name == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
-                folders.append(currentHref);
-            } else if (name == QLatin1String("size")) {
-                bool ok = false;
-                auto s = propertyContent.toLongLong(&ok);
-                if (ok && fileInfo) {
-                    (*fileInfo)[currentHref].size = s;
-                }
-            } else if (name == QLatin1String("fileid")) {
-                (*fileInfo)[currentHref].fileId = propertyContent.toUtf8();
-            }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
+            _capture = Capture::Property;
+            _captureName = name;
+        }
+        if (_capture != Capture::None) {
+            _captureLevel = 0;
+            _captureText.clear();
+            continue;
         }
 
         // End elements with DAV:
         if (type == QXmlStreamReader::EndElement) {
-            if (reader.namespaceUri() == QLatin1String("DAV:")) {
-                if (reader.name() == "response") {
-                    if (currentHref.endsWith('/')) {
-                        currentHref.chop(1);
+            if (_reader.namespaceUri() == QLatin1String("DAV:")) {
+                if (_reader.name() == "response") {
+                    if (_currentHref.endsWith('/')) {
+                        _currentHref.chop(1);
                     }
-                    emit directoryListingIterated(currentHref, currentHttp200Properties);
-                    currentHref.clear();
-                    currentHttp200Properties.clear();
-                } else if (reader.name() == "propstat") {
-                    insidePropstat = false;
-                    if (currentPropsHaveHttp200) {
-                        currentHttp200Properties = QMap<QString, QString>(currentTmpProperties);
+                    emit directoryListingIterated(_currentHref, _currentHttp200Properties);
+                    _currentHref.clear();
+                    _currentHttp200Properties.clear();
+                } else if (_reader.name() == "propstat") {
+                    _insidePropstat = false;
+                    if (_currentPropsHaveHttp200) {
+                        _currentHttp200Properties = QMap<QString, QString>(_currentTmpProperties);
                     }
-                    currentTmpProperties.clear();
-                    currentPropsHaveHttp200 = false;
-                } else if (reader.name() == "prop") {
-                    insideProp = false;
+                    _currentTmpProperties.clear();
+                    _currentPropsHaveHttp200 = false;
+                } else if (_reader.name() == "prop") {
+                    _insideProp = false;
                 }
             }
         }
     }
+}
 
-    if (reader.hasError()) {
-        // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
-        qCWarning(lcLsColJob) << "ERROR" << reader.errorString() << xml;
-        return false;
-    } else if (!insideMultiStatus) {
-        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << xml;
-        return false;
-    } else {
-        emit directoryListingSubfolders(folders);
-        emit finishedWithoutError();
+bool LsColXMLParser::captureFinished()
+{
+    const auto capture = _capture;
+    _capture = Capture::None;
+
+    if (capture == Capture::Href) {
+        // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
+        // but the result will have URL encoding..
+        QString hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(_captureText.toUtf8()))
+                .adjusted(QUrl::NormalizePathSegments)
+                .path();
+        if (!hrefString.startsWith(_expectedPath)) {
+            qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << _expectedPath;
+            return false;
+        }
+        _currentHref = hrefString;
+    } else if (capture == Capture::Status) {
+        _currentPropsHaveHttp200 = _captureText.startsWith("HTTP/1.1 200");
+    } else if (capture == Capture::Property) {
+        const QString &propertyContent = _captureText;
+        if (_captureName == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
+            _folders.append(_currentHref);
+        } else if (_captureName == QLatin1String("size")) {
+            bool ok = false;
+            auto s = propertyContent.toLongLong(&ok);
+            if (ok && _fileInfo) {
+                (*_fileInfo)[_currentHref].size = s;
+            }
+        } else if (_captureName == QLatin1String("fileid")) {
+            (*_fileInfo)[_currentHref].fileId = propertyContent.toUtf8();
+        }
+        _currentTmpProperties.insert(_captureName, propertyContent);
     }
     return true;
 }
@@ -359,34 +402,73 @@ void LsColJob::start()
     AbstractNetworkJob::start();
 }
 
-// TODO: Instead of doing all in this slot, we should iteratively parse in readyRead(). This
-// would allow us to be more asynchronous in processing while data is coming from the network,
-// not all in one big blob at the end.
-bool LsColJob::finished()
+void LsColJob::newReplyHook(QNetworkReply *reply)
 {
-    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
-                       << replyStatusString();
+    // A new reply, for example after a redirect, starts a new listing
+    _parser.reset(new LsColXMLParser);
+    _parseFailed = false;
+    _receivedBytes = 0;
+    _parseNsecs = 0;
+    _entryCount = 0;
+    _folderInfos.clear();
+    connect(_parser.data(), &LsColXMLParser::directoryListingSubfolders,
+        this, &LsColJob::directoryListingSubfolders);
+    connect(_parser.data(), &LsColXMLParser::directoryListingIterated,
+        this, &LsColJob::directoryListingIterated);
+    connect(_parser.data(), &LsColXMLParser::directoryListingIterated,
+        this, [this] { ++_entryCount; });
+    connect(_parser.data(), &LsColXMLParser::finishedWithError,
+        this, &LsColJob::finishedWithError);
+    connect(_parser.data(), &LsColXMLParser::finishedWithoutError,
+        this, &LsColJob::finishedWithoutError);
+    connect(reply, &QIODevice::readyRead, this, &LsColJob::slotReadyRead);
+}
 
+bool LsColJob::isListingReply() const
+{
     QString contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
     int httpCode = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    if (httpCode == 207 && contentType.contains("application/xml; charset=utf-8")) {
-        LsColXMLParser parser;
-        connect(&parser, &LsColXMLParser::directoryListingSubfolders,
-            this, &LsColJob::directoryListingSubfolders);
-        connect(&parser, &LsColXMLParser::directoryListingIterated,
-            this, &LsColJob::directoryListingIterated);
-        connect(&parser, &LsColXMLParser::finishedWithError,
-            this, &LsColJob::finishedWithError);
-        connect(&parser, &LsColXMLParser::finishedWithoutError,
-            this, &LsColJob::finishedWithoutError);
+    return httpCode == 207 && contentType.contains("application/xml; charset=utf-8");
+}
 
+bool LsColJob::parseData(const QByteArray &data)
+{
+    if (!_parser->isStarted()) {
         QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/webdav/folder"
-        if (!parser.parse(reply()->readAll(), &_folderInfos, expectedPath)) {
+        _parser->start(&_folderInfos, expectedPath);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    _receivedBytes += data.size();
+    bool ok = _parser->addData(data);
+    _parseNsecs += timer.nsecsElapsed();
+    return ok;
+}
+
+// The listing is parsed while it arrives, so large folders are not held
+// in memory as a whole and most of the parsing is done when the reply ends.
+void LsColJob::slotReadyRead()
+{
+    if (_parseFailed || !isListingReply())
+        return;
+    if (!parseData(reply()->readAll())) {
+        // Reported in finished(), the reply is still running
+        _parseFailed = true;
+    }
+}
+
+bool LsColJob::finished()
+{
+    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
+                       << replyStatusString();
+
+    if (isListingReply() && !_parseFailed) {
+        if (!parseData(reply()->readAll()) || !_parser->finish()) {
             // XML parse error
             emit finishedWithError(reply());
         }
     } else {
-        // wrong content type, wrong HTTP code or any other network error
+        // wrong content type, wrong HTTP code, XML parse error or any other network error
         emit finishedWithError(reply());
     }
 
@@ -20,6 +20,7 @@
 
 #include <QBuffer>
 #include <QUrlQuery>
+#include <QXmlStreamReader>
 #include <functional>
 
 class QUrl;
@@ -85,11 +86,55 @@ public:
                QHash<QString, ExtraFolderInfo> *sizes,
                const QString &expectedPath);
 
+    /** Prepares parsing a reply that arrives in pieces with addData() and finish(). */
+    void start(QHash<QString, ExtraFolderInfo> *sizes, const QString &expectedPath);
+
+    /** Parses the next piece of the reply, emitting the responses that are complete.
+     *
+     * Returns false if the xml is invalid.
+     */
+    bool addData(const QByteArray &data);
+
+    /** Checks that the reply was complete and emits the final signals, false on error. */
+    bool finish();
+
+    /** Whether start() was called */
+    bool isStarted() const { return _started; }
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
+
+private:
+    // The element whose text is being collected
+    enum class Capture {
+        None,
+        Href,
+        Status,
+        Property
+    };
+
+    bool parseAvailable();
+    bool captureFinished();
+
+    QXmlStreamReader _reader;
+    bool _started = false;
+    QHash<QString, ExtraFolderInfo> *_fileInfo = nullptr;
+    QString _expectedPath;
+    QStringList _folders;
+    QString _currentHref;
+    QMap<QString, QString> _currentTmpProperties;
+    QMap<QString, QString> _currentHttp200Properties;
+    bool _currentPropsHaveHttp200 = false;
+    bool _insidePropstat = false;
+    bool _insideProp = false;
+    bool _insideMultiStatus = false;
+    Capture _capture = Capture::None;
+    int _captureLevel = 0;
+    QString _captureName;
+    QString _captureText;
 };
 
 class OWNCLOUDSYNC_EXPORT LsColJob : public AbstractNetworkJob
@@ -112,18 +157,38 @@ public:
     void setProperties(QList<QByteArray> properties);
     QList<QByteArray> properties() const;
 
+    /// Bytes of the listing after Qt decompressed them
+    qint64 receivedBytes() const { return _receivedBytes; }
+    /// Time spent in the xml parser
+    qint64 parseNsecs() const { return _parseNsecs; }
+    /// Number of responses in the listing, including the one for the collection itself
+    int entryCount() const { return _entryCount; }
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
 
+protected:
+    void newReplyHook(QNetworkReply *reply) override;
+
 private slots:
     bool finished() override;
+    void slotReadyRead();
 
 private:
+    /// Whether the reply is a listing that can be parsed
+    bool isListingReply() const;
+    bool parseData(const QByteArray &data);
+
     QList<QByteArray> _properties;
     QUrl _url; // Used instead of path() if the url is specified in the constructor
+    QScopedPointer<LsColXMLParser> _parser;
+    bool _parseFailed = false;
+    qint64 _receivedBytes = 0;
+    qint64 _parseNsecs = 0;
+    int _entryCount = 0;
 };
 
 /**
@@ -335,6 +400,8 @@ public:
 
 signals:
     void etagRetrieved(const QString &etag);
+    /// Emitted instead of etagRetrieved() if the server didn't reply with a listing
+    void finishedWithError(QNetworkReply *reply);
 
 private slots:
     bool finished() override;
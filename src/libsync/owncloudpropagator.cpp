@@ -14,6 +14,7 @@
  */
 
 #include "owncloudpropagator.h"
+#include "owncloudpropagator_p.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
 #include "propagatedownload.h"
@@ -25,6 +26,7 @@
 #include "filesystem.h"
 #include "common/utility.h"
 #include "account.h"
+#include "hostrequestscheduler.h"
 #include "common/asserts.h"
 
 #ifdef Q_OS_WIN
@@ -40,6 +42,7 @@
 #include <QObject>
 #include <QTimerEvent>
 #include <qmath.h>
+#include <algorithm>
 
 namespace OCC {
 
@@ -73,7 +76,11 @@ qint64 freeSpaceLimit()
     return value;
 }
 
-OwncloudPropagator::~OwncloudPropagator() = default;
+OwncloudPropagator::~OwncloudPropagator()
+{
+    // Don't hold back the other accounts on the server
+    HostRequestScheduler::instance()->stopWaiting(_account.data());
+}
 
 
 int OwncloudPropagator::maximumActiveTransferJob()
@@ -87,19 +94,49 @@ int OwncloudPropagator::maximumActiveTransferJob()
     return qMin(3, qCeil(hardMaximumActiveJob() / 2.));
 }
 
-/* The maximum number of active jobs in parallel  */
-int OwncloudPropagator::hardMaximumActiveJob()
+/* The number of parallel requests to the account's server, shared by all accounts on it */
+static int hostRequestBudget(const AccountPtr &account)
 {
-    if (!_syncOptions._parallelNetworkJobs)
-        return 1;
     static int max = qgetenv("OWNCLOUD_MAX_PARALLEL").toUInt();
     if (max)
         return max;
-    if (_account->isHttp2Supported())
-        return 20;
+    if (account->isHttp2Supported())
+        return account->http2StreamCapacity().streams();
     return 6; // (Qt cannot do more anyway)
 }
 
+/* The maximum number of active jobs in parallel  */
+int OwncloudPropagator::hardMaximumActiveJob()
+{
+    if (!_syncOptions._parallelNetworkJobs)
+        return 1;
+    return hostRequestBudget(_account);
+}
+
+bool OwncloudPropagator::hostAllowsAnotherJob()
+{
+    if (HostRequestScheduler::instance()->mayStartRequest(_account.data(), hostRequestBudget(_account))) {
+        _waitingForHostCapacity = false;
+        return true;
+    }
+    // Rescheduled once a request to the server finishes
+    _waitingForHostCapacity = true;
+    return false;
+}
+
+/** Whether @a file is @a directory or lies below it. The empty path is the root. */
+static bool isInSubtree(const QString &file, const QString &directory)
+{
+    return directory.isEmpty() || file == directory
+        || (file.startsWith(directory) && file.at(directory.size()) == QLatin1Char('/'));
+}
+
+bool PropagateItemJob::prioritize(const QString &path)
+{
+    // Removals may depend on other items having been moved away first
+    return _item->_instruction != CSYNC_INSTRUCTION_REMOVE && isInSubtree(_item->destination(), path);
+}
+
 PropagateItemJob::~PropagateItemJob()
 {
     if (auto p = propagator()) {
@@ -169,11 +206,7 @@ static SyncJournalErrorBlacklistRecord createBlacklistEntry(
     return entry;
 }
 
-/** Updates, creates or removes a blacklist entry for the given item.
- *
- * May adjust the status or item._errorString.
- */
-static void blacklistUpdate(SyncJournalDb *journal, SyncFileItem &item)
+void blacklistUpdate(SyncJournalDb *journal, SyncFileItem &item)
 {
     SyncJournalErrorBlacklistRecord oldEntry = journal->errorBlacklistEntry(item._file);
 
@@ -506,6 +539,11 @@ void OwncloudPropagator::start(const SyncFileItemVector &items,
     }
 
     connect(_rootJob.data(), &PropagatorJob::finished, this, &OwncloudPropagator::emitFinished);
+    connect(HostRequestScheduler::instance(), &HostRequestScheduler::hostCapacityAvailable, this, [this](const QString &host) {
+        // Stays waiting until a job that is ready to start gets its request in
+        if (_waitingForHostCapacity && host == HostRequestScheduler::hostKey(_account->url()))
+            scheduleNextJob();
+    });
 
     scheduleNextJob();
 }
@@ -521,6 +559,19 @@ void OwncloudPropagator::setSyncOptions(const SyncOptions &syncOptions)
     _chunkSize = syncOptions._initialChunkSize;
 }
 
+void OwncloudPropagator::prioritize(const QString &path)
+{
+    if (!_rootJob || _abortRequested.fetchAndAddRelaxed(0))
+        return;
+
+    if (_rootJob->prioritize(path)) {
+        qCInfo(lcPropagator) << "Prioritizing the propagation of" << path;
+        scheduleNextJob();
+    } else {
+        qCInfo(lcPropagator) << "Nothing left to propagate for" << path;
+    }
+}
+
 bool OwncloudPropagator::localFileNameClash(const QString &relFile)
 {
     bool re = false;
@@ -627,7 +678,11 @@ void OwncloudPropagator::scheduleNextJobImpl()
         // one that is likely finished quickly, we can launch another one.
         // When a job finishes another one will "move up" to be one of the first 3 and then
         // be counted too.
-        for (int i = 0; i < maximumActiveTransferJob() && i < _activeJobList.count(); i++) {
+        // With HTTP/2 every job is a stream on the same connection and a slow transfer
+        // holds no connection, so all jobs are counted and the quick ones can fill up
+        // the streams the server takes.
+        const int countedJobs = _account->isHttp2Supported() ? _activeJobList.count() : maximumActiveTransferJob();
+        for (int i = 0; i < countedJobs && i < _activeJobList.count(); i++) {
             if (_activeJobList.at(i)->isLikelyFinishedQuickly()) {
                 likelyFinishedQuicklyCount++;
             }
@@ -792,6 +847,22 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
         _state = Running;
     }
 
+    // Prioritized jobs go before any new work of the running jobs
+    _prioritizedJobs = qMin(_prioritizedJobs, _jobsToDo.size());
+    if (_prioritizedJobs > 0
+        && std::none_of(_runningJobs.cbegin(), _runningJobs.cend(),
+               [](PropagatorJob *job) { return job->parallelism() == WaitForFinished; })) {
+        PropagatorJob *nextJob = _jobsToDo.first();
+        if (nextJob->sendsRequests() && !propagator()->hostAllowsAnotherJob()) {
+            return false;
+        }
+        --_prioritizedJobs;
+        _jobsToDo.remove(0);
+        // Ask it for more work before the other running jobs
+        _runningJobs.prepend(nextJob);
+        return possiblyRunNextJob(nextJob);
+    }
+
     // Ask all the running composite jobs if they have something new to schedule.
     for (auto runningJob : qAsConst(_runningJobs)) {
         ASSERT(runningJob->_state == Running);
@@ -813,6 +884,27 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     while (_jobsToDo.isEmpty() && !_tasksToDo.isEmpty()) {
         SyncFileItemPtr nextTask = _tasksToDo.first();
         _tasksToDo.remove(0);
+
+        // Pack consecutive small uploads into a single bulk upload request
+        if (PropagateUploadBulk::canUpload(propagator(), *nextTask)) {
+            const int batchSize = propagator()->syncOptions()._bulkUploadBatchSize;
+            const qint64 batchBytes = propagator()->syncOptions()._bulkUploadBatchBytes;
+            SyncFileItemVector batch;
+            batch.append(nextTask);
+            qint64 bytes = nextTask->_size;
+            while (batch.size() < batchSize && !_tasksToDo.isEmpty()
+                && bytes + _tasksToDo.first()->_size <= batchBytes
+                && PropagateUploadBulk::canUpload(propagator(), *_tasksToDo.first())) {
+                bytes += _tasksToDo.first()->_size;
+                batch.append(_tasksToDo.first());
+                _tasksToDo.remove(0);
+            }
+            if (batch.size() > 1) {
+                appendJob(new PropagateUploadBulk(propagator(), batch));
+                break;
+            }
+        }
+
         PropagatorJob *job = propagator()->createJob(nextTask);
         if (!job) {
             qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
@@ -821,9 +913,15 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
         appendJob(job);
         break;
     }
-    // Then run the next job
+    // Then run the next job. The server's request budget is only asked now
+    // that a job that sends requests is ready to start, so that the
+    // propagator doesn't hold a place in the server's queue while it has
+    // nothing to send. Local jobs and composite jobs don't need it.
     if (!_jobsToDo.isEmpty()) {
         PropagatorJob *nextJob = _jobsToDo.first();
+        if (nextJob->sendsRequests() && !propagator()->hostAllowsAnotherJob()) {
+            return false;
+        }
         _jobsToDo.remove(0);
         _runningJobs.append(nextJob);
         return possiblyRunNextJob(nextJob);
@@ -839,6 +937,43 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     return false;
 }
 
+bool PropagatorCompositeJob::prioritize(const QString &path)
+{
+    bool found = false;
+    auto prioritizeJob = [&path, &found](PropagatorJob *job) {
+        const bool matches = job->prioritize(path);
+        found |= matches;
+        return matches;
+    };
+
+    // Running composite jobs are asked for new work in order
+    std::stable_partition(_runningJobs.begin(), _runningJobs.end(), prioritizeJob);
+    auto end = std::stable_partition(_jobsToDo.begin(), _jobsToDo.end(), prioritizeJob);
+    _prioritizedJobs = int(std::distance(_jobsToDo.begin(), end));
+
+    // Tasks are only turned into jobs once all jobs are started, do it now for
+    // the matching ones so that they don't wait for that.
+    QVector<PropagatorJob *> taskJobs;
+    for (auto it = _tasksToDo.begin(); it != _tasksToDo.end();) {
+        const auto &item = *it;
+        if (item->_instruction == CSYNC_INSTRUCTION_REMOVE || !isInSubtree(item->destination(), path)) {
+            ++it;
+            continue;
+        }
+        if (auto job = propagator()->createJob(item)) {
+            job->setAssociatedComposite(this);
+            taskJobs.append(job);
+        }
+        it = _tasksToDo.erase(it);
+    }
+    if (!taskJobs.isEmpty()) {
+        found = true;
+        _jobsToDo = taskJobs + _jobsToDo;
+        _prioritizedJobs += taskJobs.size();
+    }
+    return found;
+}
+
 void PropagatorCompositeJob::slotSubJobFinished(SyncFileItem::Status status)
 {
     auto *subJob = static_cast<PropagatorJob *>(sender());
@@ -915,6 +1050,19 @@ PropagatorJob::JobParallelism PropagateDirectory::parallelism()
 }
 
 
+bool PropagateDirectory::prioritize(const QString &path)
+{
+    const auto directory = _item->destination();
+    if (!directory.isEmpty() && _item->_instruction != CSYNC_INSTRUCTION_REMOVE && isInSubtree(directory, path)) {
+        // Everything in here is part of the prioritized tree
+        return true;
+    }
+    if (!isInSubtree(path, directory)) {
+        return false;
+    }
+    return _subJobs.prioritize(path);
+}
+
 bool PropagateDirectory::scheduleSelfOrChild()
 {
     if (_state == Finished) {
@@ -926,6 +1074,9 @@ bool PropagateDirectory::scheduleSelfOrChild()
     }
 
     if (_firstJob && _firstJob->_state == NotYetStarted) {
+        if (_firstJob->sendsRequests() && !propagator()->hostAllowsAnotherJob()) {
+            return false;
+        }
         return _firstJob->scheduleSelfOrChild();
     }
 
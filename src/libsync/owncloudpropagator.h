@@ -48,6 +48,7 @@ qint64 freeSpaceLimit();
 
 class SyncJournalDb;
 class OwncloudPropagator;
+class WriteQuiescenceTracker;
 class PropagatorCompositeJob;
 
 /**
@@ -102,6 +103,13 @@ public:
      */
     virtual qint64 committedDiskSpace() const { return 0; }
 
+    /** Whether starting this job sends requests to the server.
+     *
+     * Only such jobs count against the server's request budget, see
+     * OwncloudPropagator::hostAllowsAnotherJob().
+     */
+    virtual bool sendsRequests() const { return false; }
+
     /** Set the associated composite job
      *
      * Used only from PropagatorCompositeJob itself, when a job is added
@@ -110,6 +118,17 @@ public:
      */
     void setAssociatedComposite(PropagatorCompositeJob *job) { _associatedComposite = job; }
 
+    /** Schedule the work for @a path and everything below it first
+     *
+     * Returns whether this job has such work. Composite jobs move it ahead
+     * of their other pending jobs.
+     */
+    virtual bool prioritize(const QString &path)
+    {
+        Q_UNUSED(path);
+        return false;
+    }
+
 public slots:
     /*
      * Asynchronous abort requires emit of abortFinished() signal,
@@ -146,6 +165,9 @@ protected:
      * becoming composite jobs themselves.
      */
     PropagatorCompositeJob *_associatedComposite = nullptr;
+
+private:
+    MemoryCounters::Instance<MemoryCounters::PropagatorJobs> _instanceCounter;
 };
 
 /*
@@ -185,6 +207,8 @@ public:
     }
     ~PropagateItemJob();
 
+    bool prioritize(const QString &path) override;
+
     bool scheduleSelfOrChild() override
     {
         if (_state != NotYetStarted) {
@@ -217,6 +241,7 @@ public:
     QVector<PropagatorJob *> _runningJobs;
     SyncFileItem::Status _hasError; // NoStatus,  or NormalError / SoftError if there was an error
     quint64 _abortsCount;
+    int _prioritizedJobs = 0; // number of jobs at the start of _jobsToDo that go before the running jobs
 
     explicit PropagatorCompositeJob(OwncloudPropagator *propagator)
         : PropagatorJob(propagator)
@@ -237,6 +262,7 @@ public:
 
     bool scheduleSelfOrChild() override;
     JobParallelism parallelism() override;
+    bool prioritize(const QString &path) override;
 
     /*
      * Abort synchronously or asynchronously - some jobs
@@ -303,6 +329,7 @@ public:
 
     bool scheduleSelfOrChild() override;
     JobParallelism parallelism() override;
+    bool prioritize(const QString &path) override;
     void abort(PropagatorJob::AbortType abortType) override
     {
         if (_firstJob)
@@ -390,6 +417,12 @@ public:
     const SyncOptions &syncOptions() const;
     void setSyncOptions(const SyncOptions &syncOptions);
 
+    /** Propagate the items at or below @a path before all others
+     *
+     * Running jobs are not interrupted, the next free slots go to these items.
+     */
+    void prioritize(const QString &path);
+
     QAtomicInt _downloadLimit;
     QAtomicInt _uploadLimit;
     BandwidthManager _bandwidthManager;
@@ -402,11 +435,22 @@ public:
         Jobs add themself to the list when they do an assynchronous operation.
         Jobs can be several time on the list (example, when several chunks are uploaded in parallel)
      */
-    QList<PropagateItemJob *> _activeJobList;
+    QList<PropagatorJob *> _activeJobList;
 
     /** We detected that another sync is required after this one */
     bool _anotherSyncNeeded;
 
+    /** The server rejected a bulk upload request as a whole.
+     *
+     * Set when the bulk upload endpoint turns out to be unavailable even though
+     * the capabilities advertised it. All remaining uploads of this sync then
+     * use individual PUT requests.
+     */
+    bool _bulkUploadDisabled = false;
+
+    /** Decides whether uploads of files that are still being written wait, may be null */
+    WriteQuiescenceTracker *_writeQuiescenceTracker = nullptr;
+
     /** Per-folder quota guesses.
      *
      * This starts out empty. When an upload in a folder fails due to insufficent
@@ -435,6 +479,12 @@ public:
     /* The maximum number of active jobs in parallel  */
     int hardMaximumActiveJob();
 
+    /** Whether the request budget shared with other accounts on the server allows another job.
+     *
+     * See HostRequestScheduler.
+     */
+    bool hostAllowsAnotherJob();
+
     /** Check whether a download would clash with an existing file
      * in filesystems that are only case-preserving.
      */
@@ -549,6 +599,7 @@ private:
     AccountPtr _account;
     QScopedPointer<PropagateDirectory> _rootJob;
     SyncOptions _syncOptions;
+    bool _waitingForHostCapacity = false;
 };
 
 
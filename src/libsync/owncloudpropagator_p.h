@@ -55,6 +55,12 @@ inline QByteArray getEtagFromReply(QNetworkReply *reply)
     return ret;
 }
 
+/** Updates, creates or removes a blacklist entry for the given item.
+ *
+ * May adjust the status or item._errorString.
+ */
+void blacklistUpdate(SyncJournalDb *journal, SyncFileItem &item);
+
 /**
  * Given an error from the network, map to a SyncFileItem::Status error
  */
@@ -137,11 +137,13 @@ void ProgressInfo::reset()
     _status = Starting;
 
     _currentItems.clear();
+    _currentItemSlots.clear();
     _currentDiscoveredRemoteFolder.clear();
     _currentDiscoveredLocalFolder.clear();
     _sizeProgress = Progress();
     _fileProgress = Progress();
     _totalSizeOfCompletedJobs = 0;
+    _completedSizeOfCurrentItems = 0;
 
     // Historically, these starting estimates were way lower, but that lead
     // to gross overestimation of ETA when a good estimate wasn't available.
@@ -225,12 +227,27 @@ void ProgressInfo::setProgressComplete(const SyncFileItem &item)
         return;
     }
 
-    _currentItems.remove(item._file);
+    auto it = _currentItemSlots.find(item._file);
+    if (it != _currentItemSlots.end()) {
+        const int slot = it.value();
+        const auto &current = _currentItems.at(slot);
+        if (isSizeDependent(current._item))
+            _completedSizeOfCurrentItems -= current._progress._completed;
+        _currentItemSlots.erase(it);
+
+        const int last = _currentItems.size() - 1;
+        if (slot != last) {
+            _currentItems[slot] = std::move(_currentItems[last]);
+            _currentItemSlots[_currentItems.at(slot)._item._file] = slot;
+        }
+        _currentItems.removeLast();
+    }
+
     _fileProgress.setCompleted(_fileProgress._completed + item._affectedItems);
     if (ProgressInfo::isSizeDependent(item)) {
         _totalSizeOfCompletedJobs += item._size;
     }
-    recomputeCompletedSize();
+    _sizeProgress.setCompleted(_totalSizeOfCompletedJobs + _completedSizeOfCurrentItems);
     _lastCompletedItem = item;
 }
 
@@ -240,13 +257,31 @@ void ProgressInfo::setProgressItem(const SyncFileItem &item, quint64 completed)
         return;
     }
 
-    _currentItems[item._file]._item = item;
-    _currentItems[item._file]._progress._total = item._size;
-    _currentItems[item._file]._progress.setCompleted(completed);
-    recomputeCompletedSize();
+    // Called for every chunk of every transfer: one lookup and no iteration
+    // over the other items. The item is updated on every call, its status and
+    // instruction can change while it is being propagated.
+    ProgressItem *current;
+    auto it = _currentItemSlots.constFind(item._file);
+    if (it == _currentItemSlots.constEnd()) {
+        _currentItemSlots.insert(item._file, _currentItems.size());
+        _currentItems.append(ProgressItem{ item, Progress() });
+        current = &_currentItems.last();
+    } else {
+        current = &_currentItems[it.value()];
+        current->_item = item;
+    }
+
+    const quint64 previous = current->_progress._completed;
+    current->_progress._total = item._size;
+    current->_progress.setCompleted(completed);
+    if (isSizeDependent(current->_item)) {
+        _completedSizeOfCurrentItems += current->_progress._completed - previous;
+        _sizeProgress.setCompleted(_totalSizeOfCompletedJobs + _completedSizeOfCurrentItems);
+    }
 
     // This seems dubious!
-    _lastCompletedItem = SyncFileItem();
+    if (!_lastCompletedItem.isEmpty())
+        _lastCompletedItem = SyncFileItem();
 }
 
 ProgressInfo::Estimates ProgressInfo::totalProgress() const
@@ -326,7 +361,10 @@ bool ProgressInfo::trustEta() const
 
 ProgressInfo::Estimates ProgressInfo::fileProgress(const SyncFileItem &item) const
 {
-    return _currentItems[item._file]._progress.estimates();
+    auto it = _currentItemSlots.constFind(item._file);
+    if (it == _currentItemSlots.constEnd())
+        return Progress().estimates();
+    return _currentItems.at(it.value())._progress.estimates();
 }
 
 void ProgressInfo::updateEstimates()
@@ -335,10 +373,8 @@ void ProgressInfo::updateEstimates()
     _fileProgress.update();
 
     // Update progress of all running items.
-    QMutableHashIterator<QString, ProgressItem> it(_currentItems);
-    while (it.hasNext()) {
-        it.next();
-        it.value()._progress.update();
+    for (auto &current : _currentItems) {
+        current._progress.update();
     }
 
     _maxFilesPerSecond = qMax(_fileProgress._progressPerSec,
@@ -347,16 +383,6 @@ void ProgressInfo::updateEstimates()
         _maxBytesPerSecond);
 }
 
-void ProgressInfo::recomputeCompletedSize()
-{
-    quint64 r = _totalSizeOfCompletedJobs;
-    foreach (const ProgressItem &i, _currentItems) {
-        if (isSizeDependent(i._item))
-            r += i._progress._completed;
-    }
-    _sizeProgress.setCompleted(r);
-}
-
 ProgressInfo::Estimates ProgressInfo::Progress::estimates() const
 {
     Estimates est;
@@ -18,6 +18,7 @@
 #include "owncloudlib.h"
 #include <QObject>
 #include <QHash>
+#include <QVector>
 #include <QTime>
 #include <QQueue>
 #include <QElapsedTimer>
@@ -167,7 +168,14 @@ public:
         SyncFileItem _item;
         Progress _progress;
     };
-    QHash<QString, ProgressItem> _currentItems;
+
+    /**
+     * The items that are currently in progress, in no particular order.
+     *
+     * The vector is implicitly shared: observers that want to keep the
+     * current state can copy it cheaply and won't see later changes.
+     */
+    const QVector<ProgressItem> &currentItems() const { return _currentItems; }
 
     SyncFileItem _lastCompletedItem;
 
@@ -213,9 +221,10 @@ private slots:
     void updateEstimates();
 
 private:
-    // Sets the completed size by summing finished jobs with the progress
-    // of active ones.
-    void recomputeCompletedSize();
+    // Dense storage of the items in progress. An item keeps its slot until it
+    // completes, then the last item is moved into the free slot.
+    QVector<ProgressItem> _currentItems;
+    QHash<QString, int> _currentItemSlots;
 
     // Triggers the update() slot every second once propagation started.
     QTimer _updateEstimatesTimer;
@@ -226,6 +235,9 @@ private:
     // All size from completed jobs only.
     quint64 _totalSizeOfCompletedJobs;
 
+    // The completed size of the size dependent items in progress.
+    quint64 _completedSizeOfCurrentItems;
+
     // The fastest observed rate of files per second in this sync.
     double _maxFilesPerSecond;
     double _maxBytesPerSecond;
@@ -263,6 +263,7 @@ void GETFileJob::slotReadyRead()
 {
     if (!reply())
         return;
+    _bufferedBytes.set(reply()->bytesAvailable());
     int bufferSize = qMin(1024 * 8ll, reply()->bytesAvailable());
     QByteArray buffer(bufferSize, Qt::Uninitialized);
 
@@ -299,6 +300,7 @@ void GETFileJob::slotReadyRead()
             return;
         }
     }
+    _bufferedBytes.set(reply()->bytesAvailable());
 
     if (reply()->isFinished() && reply()->bytesAvailable() == 0) {
         qCDebug(lcGetJob) << "Actually finished!";
@@ -44,6 +44,7 @@ class GETFileJob : public AbstractNetworkJob
     QPointer<BandwidthManager> _bandwidthManager;
     bool _hasEmittedFinishedSignal;
     time_t _lastModified;
+    MemoryCounters::Bytes<MemoryCounters::DownloadBufferBytes> _bufferedBytes; // in the reply
 
     /// Will be set to true once we've seen a 2xx response header
     bool _saveBodyToFile = false;
@@ -164,6 +165,7 @@ public:
 
     // We think it might finish quickly because it is a small file.
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
+    bool sendsRequests() const override { return true; }
 
     /**
      * Whether an existing folder with the same name may be deleted before
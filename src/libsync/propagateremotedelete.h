@@ -66,6 +66,7 @@ public:
     void abort(PropagatorJob::AbortType abortType) override;
 
     bool isLikelyFinishedQuickly() override { return !_item->isDirectory(); }
+    bool sendsRequests() const override { return true; }
 
 private slots:
     void slotDeleteJobFinished();
@@ -42,6 +42,7 @@ public:
 
     // Creating a directory should be fast.
     bool isLikelyFinishedQuickly() override { return true; }
+    bool sendsRequests() const override { return true; }
 
     /**
      * Whether an existing entity with the same name may be deleted before
@@ -58,6 +58,7 @@ public:
     void start() override;
     void abort(PropagatorJob::AbortType abortType) override;
     JobParallelism parallelism() override { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+    bool sendsRequests() const override { return true; }
 
     /**
      * Rename the directory in the selective sync list
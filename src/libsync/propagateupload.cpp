@@ -25,6 +25,7 @@
 #include "propagatorjobs.h"
 #include "common/checksums.h"
 #include "syncengine.h"
+#include "writequiescencetracker.h"
 #include "propagateremotedelete.h"
 #include "common/asserts.h"
 #include "networkjobs.h"
@@ -56,7 +57,7 @@ Q_LOGGING_CATEGORY(lcPropagateUpload, "nextcloud.sync.propagator.upload", QtInfo
  * manager. If that delay between file-change notification and sync
  * has passed, we should accept the file for upload here.
  */
-static bool fileIsStillChanging(const SyncFileItem &item)
+bool fileIsStillChanging(const SyncFileItem &item)
 {
     const QDateTime modtime = Utility::qDateTimeFromTime_t(item._modtime);
     const qint64 msSinceMod = modtime.msecsTo(QDateTime::currentDateTimeUtc());
@@ -66,6 +67,12 @@ static bool fileIsStillChanging(const SyncFileItem &item)
         && msSinceMod > -10000;
 }
 
+bool uploadWaitsForWriter(OwncloudPropagator *propagator, const SyncFileItem &item)
+{
+    auto tracker = propagator->_writeQuiescenceTracker;
+    return tracker && tracker->shouldDeferUpload(item._file, item._size);
+}
+
 PUTFileJob::~PUTFileJob()
 {
     // Make sure that we destroy the QNetworkReply before our _device of which it keeps an internal pointer.
@@ -213,6 +220,12 @@ void PropagateUploadFileCommon::setDeleteExisting(bool enabled)
 
 void PropagateUploadFileCommon::start()
 {
+    // The tracker schedules another sync once the writer is done
+    if (uploadWaitsForWriter(propagator(), *_item)) {
+        done(SyncFileItem::SoftError, tr("The file is still being written to"));
+        return;
+    }
+
     const auto rootPath = [=]() {
         const auto result = propagator()->_remoteFolder;
         if (result.startsWith('/')) {
@@ -456,6 +469,7 @@ UploadDevice::~UploadDevice()
 bool UploadDevice::prepareAndOpen(const QString &fileName, qint64 start, qint64 size)
 {
     _data.clear();
+    _dataBytes.set(0);
     _read = 0;
 
     QFile file(fileName);
@@ -467,6 +481,7 @@ bool UploadDevice::prepareAndOpen(const QString &fileName, qint64 start, qint64
 
     size = qBound(0ll, size, FileSystem::getSize(fileName) - start);
     _data.resize(size);
+    _dataBytes.set(size);
     auto read = file.read(_data.data(), size);
     if (read != size) {
         setErrorString(file.errorString());
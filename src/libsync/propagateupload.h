@@ -19,6 +19,7 @@
 #include <QBuffer>
 #include <QFile>
 #include <QElapsedTimer>
+#include <QJsonObject>
 
 
 namespace OCC {
@@ -28,6 +29,18 @@ Q_DECLARE_LOGGING_CATEGORY(lcPropagateUpload)
 
 class BandwidthManager;
 
+/**
+ * Whether the item's modification time is so recent that the file is
+ * likely still being written to.
+ */
+bool fileIsStillChanging(const SyncFileItem &item);
+
+/**
+ * Whether the propagator's write quiescence tracker defers the upload
+ * of the item because the file is still being written to.
+ */
+bool uploadWaitsForWriter(OwncloudPropagator *propagator, const SyncFileItem &item);
+
 /**
  * @brief The UploadDevice class
  * @ingroup libsync
@@ -61,6 +74,7 @@ signals:
 private:
     // The file data
     QByteArray _data;
+    MemoryCounters::Bytes<MemoryCounters::UploadBufferBytes> _dataBytes;
     // Position in the data
     qint64 _read;
 
@@ -149,6 +163,47 @@ signals:
 
 };
 
+/**
+ * @brief The BulkUploadJob class uploads many files in one multipart request
+ *
+ * The request body is a multipart/related document with one part per file,
+ * see PropagateUploadBulk. The server replies with a JSON object mapping each
+ * X-File-Path to its result.
+ *
+ * @ingroup libsync
+ */
+class BulkUploadJob : public AbstractNetworkJob
+{
+    Q_OBJECT
+
+private:
+    QIODevice *_device;
+    QByteArray _boundary;
+    QJsonObject _results;
+
+public:
+    // Takes ownership of the device
+    explicit BulkUploadJob(AccountPtr account, std::unique_ptr<QIODevice> device,
+        const QByteArray &boundary, QObject *parent = nullptr)
+        : AbstractNetworkJob(account, QStringLiteral("remote.php/dav/bulk"), parent)
+        , _device(device.release())
+        , _boundary(boundary)
+    {
+        _device->setParent(this);
+    }
+    ~BulkUploadJob();
+
+    void start() override;
+    bool finished() override;
+
+    /** The per-file results, keyed by the X-File-Path of the part. */
+    const QJsonObject &results() const { return _results; }
+
+signals:
+    void finishedSignal();
+    void uploadProgress(qint64, qint64);
+};
+
 /**
  * @brief This job implements the asynchronous PUT
  *
@@ -248,6 +303,7 @@ public:
     void startUploadFile();
     void callUnlockFolder();
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
+    bool sendsRequests() const override { return true; }
 
 private slots:
     void slotComputeContentChecksum();
@@ -382,6 +438,15 @@ private:
     };
     QMap<int, ServerChunkInfo> _serverChunks;
 
+    // Delta chunking: when the server still has the version described by the
+    // stored block manifest, only the changed blocks are sent and the MOVE
+    // tells the server which ranges to take from the existing file.
+    SyncJournalDb::BlockManifest _blockManifest; /// manifest of the file being uploaded
+    QVector<QPair<quint64, quint64>> _deltaRanges; /// (offset, length) of the changed data left to send
+    QByteArray _deltaReusedRanges; /// value of the OC-Delta-Ranges header
+    quint64 _deltaSize = 0; /// amount of changed data
+    bool _isDelta = false;
+
     /**
      * Return the URL of a chunk.
      * If chunk == -1, returns the URL of the parent folder containing the chunks
@@ -399,9 +464,11 @@ public:
 private:
     void startNewUpload();
     void startNextChunk();
+    void computeDeltaRanges();
 public slots:
     void abort(AbortType abortType) override;
 private slots:
+    void slotBlockHashesComputed(const QByteArray &blockHashes);
     void slotPropfindFinished();
     void slotPropfindFinishedWithError();
     void slotPropfindIterate(const QString &name, const QMap<QString, QString> &properties);
@@ -411,4 +478,55 @@ private slots:
     void slotMoveJobFinished();
     void slotUploadProgress(qint64, qint64);
 };
+
+/**
+ * @ingroup libsync
+ *
+ * Propagation job uploading a batch of small new files with a single
+ * BulkUploadJob.
+ *
+ * The per-request overhead dominates the upload time of small files, so
+ * PropagatorCompositeJob packs consecutive eligible tasks (see canUpload())
+ * into one of these jobs when the server advertises the bulk upload
+ * capability. Every item still gets its own status, blacklist and journal
+ * handling.
+ *
+ * If the server rejects the request as a whole because it doesn't know
+ * the endpoint, the items are handed back to the associated composite
+ * and uploaded with individual PUT requests.
+ */
+class PropagateUploadBulk : public PropagatorJob
+{
+    Q_OBJECT
+
+public:
+    PropagateUploadBulk(OwncloudPropagator *propagator, const SyncFileItemVector &items);
+    ~PropagateUploadBulk() override;
+
+    /** Whether the item may be uploaded as part of a bulk upload. */
+    static bool canUpload(OwncloudPropagator *propagator, const SyncFileItem &item);
+
+    bool scheduleSelfOrChild() override;
+    void abort(PropagatorJob::AbortType abortType) override;
+    bool sendsRequests() const override { return true; }
+
+    const SyncFileItemVector &items() const { return _items; }
+
+private slots:
+    void start();
+    void slotUploadProgress(qint64 sent, qint64 total);
+    void slotBulkUploadFinished();
+
+private:
+    /** Equivalent of PropagateItemJob::done() for a single item of the batch. */
+    void itemDone(const SyncFileItemPtr &item, SyncFileItem::Status status, const QString &errorString = QString());
+    void finalize();
+
+    SyncFileItemVector _items;
+    // The items in transit, keyed by their X-File-Path
+    QHash<QString, SyncFileItemPtr> _pendingItems;
+    QPointer<BulkUploadJob> _job;
+    MemoryCounters::Bytes<MemoryCounters::UploadBufferBytes> _bodyBytes;
+    SyncFileItem::Status _hasError = SyncFileItem::NoStatus;
+};
 }
@@ -0,0 +1,449 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "config.h"
+#include "propagateupload.h"
+#include "owncloudpropagator_p.h"
+#include "networkjobs.h"
+#include "account.h"
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+#include "common/utility.h"
+#include "common/checksums.h"
+#include "common/asserts.h"
+#include "filesystem.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QUuid>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcBulkUploadJob, "nextcloud.sync.networkjob.bulkupload", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPropagateUploadBulk, "nextcloud.sync.propagator.upload.bulk", QtInfoMsg)
+
+BulkUploadJob::~BulkUploadJob()
+{
+    // Make sure that we destroy the QNetworkReply before our _device of which it keeps an internal pointer.
+    setReply(nullptr);
+}
+
+void BulkUploadJob::start()
+{
+    QNetworkRequest req;
+    req.setRawHeader("Content-Type", "multipart/related; boundary=" + _boundary);
+    req.setPriority(QNetworkRequest::LowPriority); // Long uploads must not block non-propagation jobs.
+
+    sendRequest("POST", makeAccountUrl(path()), req, _device);
+
+    if (reply()->error() != QNetworkReply::NoError) {
+        qCWarning(lcBulkUploadJob) << " Network error: " << reply()->errorString();
+    }
+
+    connect(reply(), &QNetworkReply::uploadProgress, this, &BulkUploadJob::uploadProgress);
+    connect(this, &AbstractNetworkJob::networkActivity, account().data(), &Account::propagatorNetworkActivity);
+    AbstractNetworkJob::start();
+}
+
+bool BulkUploadJob::finished()
+{
+    qCInfo(lcBulkUploadJob) << "POST of" << reply()->request().url().toString() << "FINISHED WITH STATUS"
+                            << replyStatusString()
+                            << reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+                            << reply()->attribute(QNetworkRequest::HttpReasonPhraseAttribute);
+
+    if (reply()->error() == QNetworkReply::NoError) {
+        QJsonParseError jsonParseError;
+        _results = QJsonDocument::fromJson(reply()->readAll(), &jsonParseError).object();
+        if (jsonParseError.error != QJsonParseError::NoError) {
+            qCWarning(lcBulkUploadJob) << "Invalid JSON reply from the bulk upload:" << jsonParseError.errorString();
+        }
+    }
+
+    emit finishedSignal();
+    return true;
+}
+
+/** Checksum of a file that was already read into memory.
+ *
+ * Falls back to reading the file again for checksum types that can only be
+ * computed from disk.
+ */
+static QByteArray checksumOfData(const QByteArray &data, const QByteArray &checksumType, const QString &filePath)
+{
+    if (checksumType == checkSumMD5C)
+        return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    if (checksumType == checkSumSHA1C)
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+    return ComputeChecksum::computeNow(filePath, checksumType);
+}
+
+/* The more severe error of an item decides the status of the whole batch */
+static int errorSeverity(SyncFileItem::Status status)
+{
+    switch (status) {
+    case SyncFileItem::FatalError:
+        return 4;
+    case SyncFileItem::NormalError:
+        return 3;
+    case SyncFileItem::DetailError:
+        return 2;
+    case SyncFileItem::BlacklistedError:
+        return 1;
+    case SyncFileItem::SoftError:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+PropagateUploadBulk::PropagateUploadBulk(OwncloudPropagator *propagator, const SyncFileItemVector &items)
+    : PropagatorJob(propagator)
+    , _items(items)
+{
+}
+
+PropagateUploadBulk::~PropagateUploadBulk()
+{
+    // Deleted while the request is running, e.g. when the sync is aborted
+    propagator()->_activeJobList.removeOne(this);
+}
+
+bool PropagateUploadBulk::canUpload(OwncloudPropagator *propagator, const SyncFileItem &item)
+{
+    if (propagator->_bulkUploadDisabled
+        || propagator->syncOptions()._bulkUploadBatchSize < 2) {
+        return false;
+    }
+
+    const auto account = propagator->account();
+    if (!account->capabilities().bulkUpload()
+        // The encryption helper needs to lock the folder for each upload
+        || account->capabilities().clientSideEncryptionAvailable()) {
+        return false;
+    }
+
+    // Only new files: modifications need an If-Match precondition and
+    // type changes need the existing entity deleted first.
+    if (item._direction != SyncFileItem::Up
+        || item._instruction != CSYNC_INSTRUCTION_NEW
+        || item.isDirectory()
+        || item._size > propagator->smallFileSize()) {
+        return false;
+    }
+
+    // These need special headers, see PropagateUploadFileCommon::headers()
+    if (item._file.contains(".sys.admin#recall#")
+        || propagator->_journal->conflictRecord(item._file.toUtf8()).isValid()) {
+        return false;
+    }
+
+    return true;
+}
+
+bool PropagateUploadBulk::scheduleSelfOrChild()
+{
+    if (_state != NotYetStarted) {
+        return false;
+    }
+    qCInfo(lcPropagateUploadBulk) << "Starting bulk upload of" << _items.size() << "files by" << this;
+
+    _state = Running;
+    QMetaObject::invokeMethod(this, "start");
+    return true;
+}
+
+void PropagateUploadBulk::start()
+{
+    if (propagator()->_abortRequested.fetchAndAddRelaxed(0)) {
+        return;
+    }
+
+    const QByteArray boundary = "boundary_" + QUuid::createUuid().toRfc4122().toHex();
+    const QByteArray contentChecksumType = OCC::contentChecksumType();
+    const auto supportedTransmissionChecksums =
+        propagator()->account()->capabilities().supportedChecksumTypes();
+
+    QByteArray body;
+    for (const auto &item : qAsConst(_items)) {
+        if (propagator()->hasCaseClashAccessibilityProblem(item->_file)) {
+            itemDone(item, SyncFileItem::NormalError, tr("File %1 cannot be uploaded because another file with the same name, differing only in case, exists").arg(QDir::toNativeSeparators(item->_file)));
+            continue;
+        }
+
+        if (uploadWaitsForWriter(propagator(), *item)) {
+            itemDone(item, SyncFileItem::SoftError, tr("The file is still being written to"));
+            continue;
+        }
+
+        const QString filePath = propagator()->getFilePath(item->_file);
+        if (!FileSystem::fileExists(filePath)) {
+            itemDone(item, SyncFileItem::SoftError, tr("File Removed (start upload) %1").arg(filePath));
+            continue;
+        }
+
+        // Files that grew since the discovery don't blow up the body,
+        // they are uploaded on their own or with the next batch
+        const qint64 fileSize = FileSystem::getSize(filePath);
+        if (fileSize > qint64(propagator()->smallFileSize())
+            || (!_pendingItems.isEmpty() && body.size() + fileSize > propagator()->syncOptions()._bulkUploadBatchBytes)) {
+            item->_size = fileSize;
+            _associatedComposite->appendTask(item);
+            continue;
+        }
+
+        item->_modtime = FileSystem::getModTime(filePath);
+        if (fileIsStillChanging(*item)) {
+            propagator()->_anotherSyncNeeded = true;
+            itemDone(item, SyncFileItem::SoftError, tr("Local file changed during sync."));
+            continue;
+        }
+
+        QFile file(filePath);
+        QString openError;
+        if (!FileSystem::openAndSeekFileSharedRead(&file, &openError, 0)) {
+            itemDone(item, SyncFileItem::NormalError, openError);
+            continue;
+        }
+        const QByteArray data = file.readAll();
+        file.close();
+        item->_size = data.size();
+
+        const quint64 quotaGuess = propagator()->_folderQuota.value(
+            QFileInfo(item->_file).path(), std::numeric_limits<quint64>::max());
+        if (item->_size > quotaGuess) {
+            // Necessary for blacklisting logic
+            item->_httpErrorCode = 507;
+            emit propagator()->insufficientRemoteStorage();
+            itemDone(item, SyncFileItem::DetailError, tr("Upload of %1 exceeds the quota for the folder").arg(Utility::octetsToString(item->_size)));
+            continue;
+        }
+
+        // Maybe the discovery already computed the content checksum?
+        QByteArray existingChecksumType, existingChecksum;
+        parseChecksumHeader(item->_checksumHeader, &existingChecksumType, &existingChecksum);
+        if (existingChecksumType != contentChecksumType || contentChecksumType.isEmpty()) {
+            existingChecksum = contentChecksumType.isEmpty()
+                ? QByteArray()
+                : checksumOfData(data, contentChecksumType, filePath);
+            item->_checksumHeader = makeChecksumHeader(contentChecksumType, existingChecksum);
+        }
+
+        QByteArray transmissionChecksumHeader;
+        if (supportedTransmissionChecksums.contains(contentChecksumType)) {
+            transmissionChecksumHeader = item->_checksumHeader;
+        } else if (uploadChecksumEnabled()) {
+            const auto transmissionChecksumType = propagator()->account()->capabilities().uploadChecksumType();
+            if (!transmissionChecksumType.isEmpty()) {
+                transmissionChecksumHeader = makeChecksumHeader(transmissionChecksumType,
+                    checksumOfData(data, transmissionChecksumType, filePath));
+            }
+        }
+        if (item->_checksumHeader.isEmpty()) {
+            item->_checksumHeader = transmissionChecksumHeader;
+        }
+
+        const QString remotePath = propagator()->_remoteFolder + item->_file;
+        body += "--" + boundary + "\r\n";
+        body += "X-File-Path: " + remotePath.toUtf8() + "\r\n";
+        body += "X-File-Mtime: " + QByteArray::number(qint64(item->_modtime)) + "\r\n";
+        body += "X-File-MD5: " + QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex() + "\r\n";
+        if (!transmissionChecksumHeader.isEmpty()) {
+            body += "OC-Checksum: " + transmissionChecksumHeader + "\r\n";
+        }
+        body += "Content-Length: " + QByteArray::number(data.size()) + "\r\n";
+        body += "\r\n";
+        body += data;
+        body += "\r\n";
+
+        _pendingItems.insert(remotePath, item);
+    }
+
+    if (_pendingItems.isEmpty()) {
+        finalize();
+        return;
+    }
+    body += "--" + boundary + "--\r\n";
+
+    auto device = std::make_unique<QBuffer>();
+    device->setData(body);
+    _bodyBytes.set(body.size());
+    _job = new BulkUploadJob(propagator()->account(), std::move(device), boundary, this);
+    connect(_job.data(), &BulkUploadJob::finishedSignal, this, &PropagateUploadBulk::slotBulkUploadFinished);
+    connect(_job.data(), &BulkUploadJob::uploadProgress, this, &PropagateUploadBulk::slotUploadProgress);
+    _job->start();
+    propagator()->_activeJobList.append(this);
+}
+
+void PropagateUploadBulk::slotUploadProgress(qint64 sent, qint64 total)
+{
+    if (total <= 0)
+        return;
+    // The body is almost all file data, each file gets its share of it
+    for (const auto &item : qAsConst(_pendingItems))
+        propagator()->reportProgress(*item, quint64(item->_size * qMin(sent, total) / total));
+}
+
+void PropagateUploadBulk::slotBulkUploadFinished()
+{
+    auto *job = qobject_cast<BulkUploadJob *>(sender());
+    ASSERT(job);
+
+    propagator()->_activeJobList.removeOne(this);
+    _bodyBytes.set(0);
+
+    const QNetworkReply::NetworkError err = job->reply()->error();
+    const int httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (err != QNetworkReply::NoError
+        && (httpErrorCode == 404 || httpErrorCode == 405 || httpErrorCode == 501)
+        && !propagator()->_abortRequested.fetchAndAddRelaxed(0)) {
+        // The server does not know the endpoint after all. Upload the
+        // files one by one, and don't try again during this sync.
+        qCWarning(lcPropagateUploadBulk) << "Bulk upload rejected with" << httpErrorCode
+                                         << ", falling back to individual uploads";
+        propagator()->_bulkUploadDisabled = true;
+        for (const auto &item : qAsConst(_pendingItems)) {
+            _associatedComposite->appendTask(item);
+        }
+        _pendingItems.clear();
+        finalize();
+        return;
+    }
+
+    if (err != QNetworkReply::NoError) {
+        const SyncFileItem::Status status = classifyError(err, httpErrorCode, &propagator()->_anotherSyncNeeded);
+        const QString errorString = job->errorStringParsingBody();
+        for (const auto &item : qAsConst(_pendingItems)) {
+            item->_httpErrorCode = httpErrorCode;
+            itemDone(item, status, errorString);
+        }
+        _pendingItems.clear();
+        finalize();
+        return;
+    }
+
+    const QJsonObject &results = job->results();
+    for (auto it = _pendingItems.constBegin(); it != _pendingItems.constEnd(); ++it) {
+        const auto &item = it.value();
+        const QJsonObject result = results.value(it.key()).toObject();
+        item->_responseTimeStamp = job->responseTimestamp();
+
+        if (result.isEmpty()) {
+            itemDone(item, SyncFileItem::NormalError, tr("The server did not report a result for this file"));
+            continue;
+        }
+        if (result.value(QStringLiteral("error")).toBool()) {
+            item->_httpErrorCode = result.value(QStringLiteral("status")).toInt(httpErrorCode);
+            itemDone(item, SyncFileItem::NormalError, result.value(QStringLiteral("message")).toString());
+            continue;
+        }
+
+        item->_etag = parseEtag(result.value(QStringLiteral("etag")).toString().toUtf8().constData());
+        item->_fileId = result.value(QStringLiteral("fileid")).toString().toUtf8();
+        if (item->_etag.isEmpty()) {
+            itemDone(item, SyncFileItem::NormalError, tr("The server did not acknowledge the last chunk. (No e-tag was present)"));
+            continue;
+        }
+
+        const QString filePath = propagator()->getFilePath(item->_file);
+        if (!FileSystem::verifyFileUnchanged(filePath, item->_size, item->_modtime)) {
+            propagator()->_anotherSyncNeeded = true;
+            itemDone(item, SyncFileItem::SoftError, tr("Local file changed during sync."));
+            continue;
+        }
+
+        // Update the quota, if known
+        auto quotaIt = propagator()->_folderQuota.find(QFileInfo(item->_file).path());
+        if (quotaIt != propagator()->_folderQuota.end())
+            quotaIt.value() -= item->_size;
+
+        if (!propagator()->_journal->setFileRecord(item->toSyncJournalFileRecordWithInode(filePath))) {
+            itemDone(item, SyncFileItem::FatalError, tr("Error writing metadata to the database"));
+            continue;
+        }
+        itemDone(item, SyncFileItem::Success);
+    }
+    _pendingItems.clear();
+    propagator()->_journal->commit("bulk upload");
+
+    finalize();
+}
+
+void PropagateUploadBulk::itemDone(const SyncFileItemPtr &item, SyncFileItem::Status status, const QString &errorString)
+{
+    item->_status = status;
+    if (item->_errorString.isEmpty()) {
+        item->_errorString = errorString;
+    }
+
+    if (propagator()->_abortRequested.fetchAndAddRelaxed(0) && (item->_status == SyncFileItem::NormalError
+                                                                   || item->_status == SyncFileItem::FatalError)) {
+        // an abort request is ongoing. Change the status to Soft-Error
+        item->_status = SyncFileItem::SoftError;
+    }
+
+    // Blacklist handling, like in PropagateItemJob::done()
+    switch (item->_status) {
+    case SyncFileItem::SoftError:
+    case SyncFileItem::FatalError:
+    case SyncFileItem::NormalError:
+    case SyncFileItem::DetailError:
+        blacklistUpdate(propagator()->_journal, *item);
+        break;
+    case SyncFileItem::Success:
+        if (item->_hasBlacklistEntry) {
+            propagator()->_journal->wipeErrorBlacklistEntry(item->_file);
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (item->hasErrorStatus()) {
+        if (errorSeverity(item->_status) > errorSeverity(_hasError))
+            _hasError = item->_status;
+        qCWarning(lcPropagator) << "Could not complete propagation of" << item->destination() << "by" << this << "with status" << item->_status << "and error:" << item->_errorString;
+    } else {
+        qCInfo(lcPropagator) << "Completed propagation of" << item->destination() << "by" << this << "with status" << item->_status;
+    }
+    emit propagator()->itemCompleted(item);
+
+    if (item->_status == SyncFileItem::FatalError) {
+        // Abort all remaining jobs.
+        propagator()->abort();
+    }
+}
+
+void PropagateUploadBulk::finalize()
+{
+    if (_state == Finished)
+        return;
+    _state = Finished;
+    emit finished(_hasError == SyncFileItem::NoStatus ? SyncFileItem::Success : _hasError);
+}
+
+void PropagateUploadBulk::abort(PropagatorJob::AbortType abortType)
+{
+    if (_job && _job->reply() && _job->reply()->isRunning()) {
+        if (abortType == AbortType::Asynchronous) {
+            connect(_job->reply(), &QNetworkReply::finished, this, [this] { emit abortFinished(); });
+        }
+        _job->reply()->abort();
+    } else if (abortType == AbortType::Asynchronous) {
+        emit abortFinished();
+    }
+}
+}
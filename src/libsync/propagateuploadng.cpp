@@ -26,6 +26,7 @@
 #include "propagateremotemove.h"
 #include "propagateremotedelete.h"
 #include "common/asserts.h"
+#include "common/checksums.h"
 
 #include <QNetworkAccessManager>
 #include <QFileInfo>
@@ -52,6 +53,8 @@ QUrl PropagateUploadFileNG::chunkUrl(int chunk)
 
      *----> doStartUpload()
             Check the db: is there an entry?
+            (If not, and the server supports delta chunking, the block
+            hashes are computed first: slotBlockHashesComputed())
               /               \
              no                yes
             /                   \
@@ -83,8 +86,9 @@ void PropagateUploadFileNG::doStartUpload()
     propagator()->_activeJobList.append(this);
 
     const SyncJournalDb::UploadInfo progressInfo = propagator()->_journal->getUploadInfo(_item->_file);
-    if (progressInfo._valid && progressInfo.isChunked() && progressInfo._modtime == _item->_modtime
-            && progressInfo._size == qint64(_item->_size)) {
+    // Delta uploads can't be resumed: their chunks don't cover a contiguous range
+    if (progressInfo._valid && progressInfo.isChunked() && !progressInfo._isDelta
+            && progressInfo._modtime == _item->_modtime && progressInfo._size == qint64(_item->_size)) {
         _transferId = progressInfo._transferid;
         auto url = chunkUrl();
         auto job = new LsColJob(propagator()->account(), url, this);
@@ -107,9 +111,92 @@ void PropagateUploadFileNG::doStartUpload()
         // startNewUpload will reset the _transferId and the UploadInfo in the db.
     }
 
+    if (propagator()->account()->capabilities().deltaChunking() && !_uploadingEncrypted) {
+        auto computeHashes = new ComputeBlockHashes(this);
+        connect(computeHashes, &ComputeBlockHashes::done,
+            this, &PropagateUploadFileNG::slotBlockHashesComputed);
+        connect(computeHashes, &ComputeBlockHashes::done,
+            computeHashes, &QObject::deleteLater);
+        computeHashes->start(_fileToUpload._path, propagator()->syncOptions()._deltaBlockSize);
+        return;
+    }
+
     startNewUpload();
 }
 
+void PropagateUploadFileNG::slotBlockHashesComputed(const QByteArray &blockHashes)
+{
+    if (propagator()->_abortRequested.fetchAndAddRelaxed(0))
+        return;
+
+    const qint64 blockSize = propagator()->syncOptions()._deltaBlockSize;
+    const qint64 blockCount = (qint64(_fileToUpload._size) + blockSize - 1) / blockSize;
+    // If the count doesn't match, the file is being changed. The upload will notice that.
+    if (!blockHashes.isNull() && blockHashes.size() == blockCount * ComputeBlockHashes::hashSize) {
+        _blockManifest._size = _fileToUpload._size;
+        _blockManifest._blockSize = blockSize;
+        _blockManifest._blockHashes = blockHashes;
+        _blockManifest._valid = true;
+        computeDeltaRanges();
+    }
+
+    startNewUpload();
+}
+
+void PropagateUploadFileNG::computeDeltaRanges()
+{
+    _isDelta = false;
+    _deltaRanges.clear();
+
+    if (_item->_instruction != CSYNC_INSTRUCTION_SYNC)
+        return;
+    const auto previous = propagator()->_journal->getBlockManifest(_item->_file);
+    if (!previous._valid || previous._etag != _item->_etag || previous._blockSize != _blockManifest._blockSize)
+        return;
+
+    const int hashSize = ComputeBlockHashes::hashSize;
+    const int blockCount = _blockManifest._blockHashes.size() / hashSize;
+    const int previousBlockCount = previous._blockHashes.size() / hashSize;
+    const quint64 blockSize = _blockManifest._blockSize;
+    const quint64 fileSize = _blockManifest._size;
+
+    // Merge adjacent blocks into ranges
+    QVector<QPair<quint64, quint64>> reused;
+    auto addBlock = [](QVector<QPair<quint64, quint64>> &ranges, quint64 offset, quint64 length) {
+        if (!ranges.isEmpty() && ranges.last().first + ranges.last().second == offset) {
+            ranges.last().second += length;
+        } else {
+            ranges.append(qMakePair(offset, length));
+        }
+    };
+    for (int i = 0; i < blockCount; ++i) {
+        const quint64 offset = i * blockSize;
+        const quint64 length = qMin(blockSize, fileSize - offset);
+        const bool unchanged = i < previousBlockCount
+            && std::memcmp(previous._blockHashes.constData() + i * hashSize,
+                   _blockManifest._blockHashes.constData() + i * hashSize, hashSize) == 0;
+        addBlock(unchanged ? reused : _deltaRanges, offset, length);
+    }
+
+    if (reused.isEmpty()) {
+        // Nothing to gain, do a normal upload
+        _deltaRanges.clear();
+        return;
+    }
+
+    _isDelta = true;
+    _deltaSize = 0;
+    for (const auto &range : qAsConst(_deltaRanges))
+        _deltaSize += range.second;
+    QByteArrayList reusedStrings;
+    for (const auto &range : qAsConst(reused))
+        reusedStrings.append(QByteArray::number(range.first) + '-' + QByteArray::number(range.first + range.second - 1));
+    _deltaReusedRanges = reusedStrings.join(',');
+
+    qCInfo(lcPropagateUpload) << "Delta upload of" << _item->_file << ": sending" << _deltaSize
+                              << "of" << fileSize << "bytes in" << _deltaRanges.size() << "ranges";
+}
+
 void PropagateUploadFileNG::slotPropfindIterate(const QString &name, const QMap<QString, QString> &properties)
 {
     if (name == chunkUrl().path()) {
@@ -239,6 +326,7 @@ void PropagateUploadFileNG::startNewUpload()
     pi._modtime = _item->_modtime;
     pi._contentChecksum = _item->_checksumHeader;
     pi._size = _item->_size;
+    pi._isDelta = _isDelta;
     propagator()->_journal->setUploadInfo(_item->_file, pi);
     propagator()->_journal->commit("Upload info");
     QMap<QByteArray, QByteArray> headers;
@@ -278,8 +366,23 @@ void PropagateUploadFileNG::startNextChunk()
     quint64 fileSize = _fileToUpload._size;
     ENFORCE(fileSize >= _sent, "Sent data exceeds file size");
 
-    // prevent situation that chunk size is bigger then required one to send
-    _currentChunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
+    quint64 chunkOffset = _sent;
+    if (_isDelta) {
+        // The chunks carry the changed ranges, a range may need several chunks
+        _currentChunkSize = 0;
+        if (!_deltaRanges.isEmpty()) {
+            auto &range = _deltaRanges.first();
+            chunkOffset = range.first;
+            _currentChunkSize = qMin(propagator()->_chunkSize, range.second);
+            range.first += _currentChunkSize;
+            range.second -= _currentChunkSize;
+            if (range.second == 0)
+                _deltaRanges.removeFirst();
+        }
+    } else {
+        // prevent situation that chunk size is bigger then required one to send
+        _currentChunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
+    }
 
     if (_currentChunkSize == 0) {
         Q_ASSERT(_jobs.isEmpty()); // There should be no running job anymore
@@ -301,6 +404,10 @@ void PropagateUploadFileNG::startNextChunk()
             headers[checkSumHeaderC] = _transmissionChecksumHeader;
         }
         headers["OC-Total-Length"] = QByteArray::number(fileSize);
+        if (_isDelta) {
+            // The server takes these ranges from the current version of the destination
+            headers["OC-Delta-Ranges"] = _deltaReusedRanges;
+        }
 
         auto job = new MoveJob(propagator()->account(), Utility::concatUrlPath(chunkUrl(), "/.file"),
             destination, headers, this);
@@ -316,7 +423,7 @@ void PropagateUploadFileNG::startNextChunk()
     auto device = std::make_unique<UploadDevice>(&propagator()->_bandwidthManager);
     const QString fileName = _fileToUpload._path;
 
-    if (!device->prepareAndOpen(fileName, _sent, _currentChunkSize)) {
+    if (!device->prepareAndOpen(fileName, chunkOffset, _currentChunkSize)) {
         qCWarning(lcPropagateUpload) << "Could not prepare upload device: " << device->errorString();
 
         // If the file is currently locked, we want to retry the sync
@@ -330,7 +437,7 @@ void PropagateUploadFileNG::startNextChunk()
     }
 
     QMap<QByteArray, QByteArray> headers;
-    headers["OC-Chunk-Offset"] = QByteArray::number(_sent);
+    headers["OC-Chunk-Offset"] = QByteArray::number(chunkOffset);
 
     _sent += _currentChunkSize;
     QUrl url = chunkUrl(_currentChunk);
@@ -403,7 +510,7 @@ void PropagateUploadFileNG::slotPutFinished()
                                   << propagator()->_chunkSize << "bytes";
     }
 
-    _finished = _sent == _item->_size;
+    _finished = _sent == (_isDelta ? _deltaSize : _item->_size);
 
     // Check if the file still exists
     const QString fullFilePath(propagator()->getFilePath(_item->_file));
@@ -450,6 +557,10 @@ void PropagateUploadFileNG::slotMoveJobFinished()
     _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
     if (err != QNetworkReply::NoError) {
+        if (_isDelta) {
+            // Don't try again with a base the server may not have
+            propagator()->_journal->setBlockManifest(_item->_file, SyncJournalDb::BlockManifest());
+        }
         commonErrorHandling(job);
         return;
     }
@@ -479,6 +590,11 @@ void PropagateUploadFileNG::slotMoveJobFinished()
         return;
     }
     _item->_responseTimeStamp = job->responseTimestamp();
+
+    if (_blockManifest._valid) {
+        _blockManifest._etag = _item->_etag;
+        propagator()->_journal->setBlockManifest(_item->_file, _blockManifest);
+    }
     finalize();
 }
 
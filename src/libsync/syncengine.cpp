@@ -77,6 +77,7 @@ SyncEngine::SyncEngine(AccountPtr account, const QString &localPath,
     , _backInTimeFiles(0)
     , _uploadLimit(0)
     , _downloadLimit(0)
+    , _syncPlan(journal)
     , _anotherSyncNeeded(NoFollowUpSync)
 {
     qRegisterMetaType<SyncFileItem>("SyncFileItem");
@@ -95,6 +96,7 @@ SyncEngine::SyncEngine(AccountPtr account, const QString &localPath,
     _csync_ctx->exclude_traversal_fn = _excludedFiles->csyncTraversalMatchFun();
 
     _syncFileStatusTracker.reset(new SyncFileStatusTracker(this));
+    _writeQuiescenceTracker.reset(new WriteQuiescenceTracker(localPath));
 
     _clearTouchedFilesTimer.setSingleShot(true);
     _clearTouchedFilesTimer.setInterval(30 * 1000);
@@ -265,46 +267,35 @@ static bool isFileModifyingInstruction(csync_instructions_e instruction)
         || instruction == CSYNC_INSTRUCTION_REMOVE;
 }
 
-void SyncEngine::deleteStaleDownloadInfos(const SyncFileItemVector &syncItems)
+void SyncEngine::deleteStaleEntries(const SyncFileItemVector &syncItems)
 {
-    // Find all downloadinfo paths that we want to preserve.
-    QSet<QString> download_file_paths;
-    foreach (const SyncFileItemPtr &it, syncItems) {
-        if (it->_direction == SyncFileItem::Down
-            && it->_type == ItemTypeFile
-            && isFileTransferInstruction(it->_instruction)) {
-            download_file_paths.insert(it->_file);
+    // Find all paths whose transfer state and blacklist entries we want to preserve.
+    SyncJournalDb::StaleEntryKeepList keep;
+    for (const auto &it : syncItems) {
+        if (it->_hasBlacklistEntry)
+            keep.errorBlacklist.append(it->_file);
+        if (it->_type != ItemTypeFile || !isFileTransferInstruction(it->_instruction))
+            continue;
+        if (it->_direction == SyncFileItem::Down) {
+            keep.downloadInfos.append(it->_file);
+        } else if (it->_direction == SyncFileItem::Up) {
+            keep.uploadInfos.append(it->_file);
         }
     }
 
-    // Delete from journal and from filesystem.
-    const QVector<SyncJournalDb::DownloadInfo> deleted_infos =
-        _journal->getAndDeleteStaleDownloadInfos(download_file_paths);
-    foreach (const SyncJournalDb::DownloadInfo &deleted_info, deleted_infos) {
+    // Delete from journal.
+    const auto stale = _journal->deleteStaleEntries(keep);
+
+    // Delete the temporary files of the stale downloads.
+    for (const auto &deleted_info : stale.downloadInfos) {
         const QString tmppath = _propagator->getFilePath(deleted_info._tmpfile);
         qCInfo(lcEngine) << "Deleting stale temporary file: " << tmppath;
         FileSystem::remove(tmppath);
     }
-}
-
-void SyncEngine::deleteStaleUploadInfos(const SyncFileItemVector &syncItems)
-{
-    // Find all blacklisted paths that we want to preserve.
-    QSet<QString> upload_file_paths;
-    foreach (const SyncFileItemPtr &it, syncItems) {
-        if (it->_direction == SyncFileItem::Up
-            && it->_type == ItemTypeFile
-            && isFileTransferInstruction(it->_instruction)) {
-            upload_file_paths.insert(it->_file);
-        }
-    }
-
-    // Delete from journal.
-    auto ids = _journal->deleteStaleUploadInfos(upload_file_paths);
 
     // Delete the stales chunk on the server.
     if (account()->capabilities().chunkingNg()) {
-        foreach (uint transferId, ids) {
+        for (uint transferId : stale.uploadTransferIds) {
             if (!transferId)
                 continue; // Was not a chunked upload
             QUrl url = Utility::concatUrlPath(account()->url(), QLatin1String("remote.php/dav/uploads/") + account()->davUser() + QLatin1Char('/') + QString::number(transferId));
@@ -313,19 +304,6 @@ void SyncEngine::deleteStaleUploadInfos(const SyncFileItemVector &syncItems)
     }
 }
 
-void SyncEngine::deleteStaleErrorBlacklistEntries(const SyncFileItemVector &syncItems)
-{
-    // Find all blacklisted paths that we want to preserve.
-    QSet<QString> blacklist_file_paths;
-    foreach (const SyncFileItemPtr &it, syncItems) {
-        if (it->_hasBlacklistEntry)
-            blacklist_file_paths.insert(it->_file);
-    }
-
-    // Delete from journal.
-    _journal->deleteStaleErrorBlacklistEntries(blacklist_file_paths);
-}
-
 #if (QT_VERSION < 0x050600)
 template <typename T>
 constexpr typename std::add_const<T>::type &qAsConst(T &t) noexcept { return t; }
@@ -413,6 +391,15 @@ int SyncEngine::treewalkFile(csync_file_stat_t *file, csync_file_stat_t *other,
         }
     }
 
+    // Remember the server permissions checkForPermission() needs: the ones
+    // of the folders and of the files that change on either side.
+    if (remote
+        && (file->type == ItemTypeDirectory
+            || instruction != CSYNC_INSTRUCTION_NONE
+            || (other && other->instruction != CSYNC_INSTRUCTION_NONE))) {
+        _remotePermissions.insert(fileUtf8, file->remotePerm);
+    }
+
     // key is the handle that the SyncFileItem will have in the map.
     QString key = fileUtf8;
     if (instruction == CSYNC_INSTRUCTION_RENAME) {
@@ -785,6 +772,8 @@ void SyncEngine::startSync()
     _clearTouchedFilesTimer.stop();
 
     _progressInfo->reset();
+    MemoryCounters::resetHighWater();
+    _memoryPhase = QStringLiteral("discovery");
 
     if (!QDir(_localPath).exists()) {
         _anotherSyncNeeded = DelayedFollowUp;
@@ -852,12 +841,32 @@ void SyncEngine::startSync()
     _excludedFiles->setExcludeConflictFiles(!_account->capabilities().uploadConflictFiles());
 
     _csync_ctx->read_remote_from_db = true;
+    _csync_ctx->spill_threshold = _syncOptions._discoverySpillThreshold;
 
     _lastLocalDiscoveryStyle = _localDiscoveryStyle;
     _csync_ctx->should_discover_locally_fn = [this](const QByteArray &path) {
         return shouldDiscoverLocally(path);
     };
 
+    _resumingSyncPlan = false;
+    _discoveredRootEtag.clear();
+
+    // An interrupted sync left a plan behind: if the server didn't change
+    // in the meantime, propagate what is left of it without a discovery.
+    // Encrypted folders need the metadata fetched below, they always rediscover.
+    if (_syncOptions._syncPlanMinimumItems > 0
+        && !_account->capabilities().clientSideEncryptionAvailable()
+        && _syncPlan.isStored()) {
+        qCInfo(lcEngine) << "Checking whether the stored sync plan can be resumed";
+        _syncPlanEtagJob = new RequestEtagJob(_account, _remotePath, this);
+        connect(_syncPlanEtagJob.data(), &RequestEtagJob::etagRetrieved, this, &SyncEngine::slotSyncPlanEtagReceived);
+        connect(_syncPlanEtagJob.data(), &RequestEtagJob::finishedWithError, this, [this] {
+            slotSyncPlanEtagReceived(QString());
+        });
+        _syncPlanEtagJob->start();
+        return;
+    }
+
     // If needed, make sure we have up to date E2E information before the
     // discovery phase, otherwise we start right away
     if (_account->capabilities().clientSideEncryptionAvailable()) {
@@ -1009,6 +1018,9 @@ void SyncEngine::slotFolderDiscovered(bool local, const QString &folder)
 
 void SyncEngine::slotRootEtagReceived(const QString &e)
 {
+    if (_discoveredRootEtag.isEmpty()) {
+        _discoveredRootEtag = e;
+    }
     if (_remoteRootEtag.isEmpty()) {
         qCDebug(lcEngine) << "Root etag:" << e;
         _remoteRootEtag = e;
@@ -1021,6 +1033,113 @@ void SyncEngine::slotNewItem(const SyncFileItemPtr &item)
     _progressInfo->adjustTotalsForFile(*item);
 }
 
+/**
+ * Puts the TYPE_CHANGE instructions first, followed by the REMOVE instructions,
+ * and sorts each of these groups and the remaining items by destination.
+ *
+ * The propagator expects the items in this order.
+ */
+static void sortSyncItems(SyncFileItemVector &syncItems, bool &hasChange, int &lastChangeInstruction,
+    bool &hasDelete, int &lastDeleteInstruction)
+{
+    hasChange = false;
+    hasDelete = false;
+    lastChangeInstruction = 0;
+    lastDeleteInstruction = 0;
+
+    // Only if list is populated, can be empty under certain circumstances
+    // Get CHANGE instructions to the top first
+    if (syncItems.count() > 0) {
+        std::sort(syncItems.begin(), syncItems.end(),
+            [](SyncFileItemVector::const_reference &a, SyncFileItemVector::const_reference &b) -> bool {
+				return ((a->_instruction == CSYNC_INSTRUCTION_TYPE_CHANGE) && (b->_instruction != CSYNC_INSTRUCTION_TYPE_CHANGE));
+            });
+        if (syncItems.at(0)->_instruction == CSYNC_INSTRUCTION_TYPE_CHANGE) {
+            hasChange = true;
+            lastChangeInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin(), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_TYPE_CHANGE; }));
+        }
+        if (hasChange) {
+            std::sort(syncItems.begin(), syncItems.begin() + lastChangeInstruction);
+            if (syncItems.count() > lastChangeInstruction) {
+                std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end(),
+                    [](SyncFileItemVector::const_reference &a, SyncFileItemVector::const_reference &b) -> bool {
+                        return ((a->_instruction == CSYNC_INSTRUCTION_REMOVE) && (b->_instruction != CSYNC_INSTRUCTION_REMOVE));
+                    });
+                if (syncItems.at(lastChangeInstruction + 1)->_instruction == CSYNC_INSTRUCTION_REMOVE) {
+                    hasDelete = true;
+                    lastDeleteInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_REMOVE; }));
+                    std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.begin() + lastDeleteInstruction);
+                    if (syncItems.count() > lastDeleteInstruction) {
+                        std::sort(syncItems.begin() + (lastDeleteInstruction + 1), syncItems.end());
+                    }
+                } else {
+                    std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end());
+                }
+            }
+        } else if (syncItems.at(0)->_instruction == CSYNC_INSTRUCTION_REMOVE) {
+            hasDelete = true;
+            lastDeleteInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin(), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_REMOVE; }));
+            std::sort(syncItems.begin(), syncItems.begin() + lastDeleteInstruction);
+			if (syncItems.count() > lastDeleteInstruction) {
+                std::sort(syncItems.begin() + (lastDeleteInstruction + 1), syncItems.end());
+            }
+        } else {
+            std::sort(syncItems.begin(), syncItems.end());
+        }
+    }
+}
+
+void SyncEngine::slotSyncPlanEtagReceived(const QString &etag)
+{
+    if (csync_abort_requested(_csync_ctx.data())) {
+        qCInfo(lcEngine) << "Sync aborted while checking the stored sync plan";
+        finalize(false);
+        return;
+    }
+
+    bool ok = false;
+    const auto selectiveSyncBlackList = _journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, &ok);
+    SyncFileItemVector syncItems;
+    if (!etag.isEmpty() && ok && _syncPlan.matches(etag, selectiveSyncBlackList)) {
+        // Without a reliable folder watcher since the last full local discovery,
+        // e.g. after a restart, every item is compared with its local file
+        syncItems = _syncPlan.loadPendingItems(_localPath, [this](const QString &path) {
+            return shouldDiscoverLocally(path.toUtf8());
+        });
+    }
+    if (syncItems.isEmpty()) {
+        qCInfo(lcEngine) << "Not resuming the stored sync plan";
+        _syncPlan.clear();
+        slotStartDiscovery();
+        return;
+    }
+
+    qCInfo(lcEngine) << "#### Resuming the propagation of an interrupted sync with" << syncItems.size() << "items";
+    _resumingSyncPlan = true;
+    _discoveredRootEtag = etag;
+    // Changes that happened since the plan was made, and items dropped
+    // from it, are picked up by a regular sync right after this one.
+    _anotherSyncNeeded = ImmediateFollowUp;
+    _needsUpdate = true;
+    _seenFiles.clear();
+    _temporarilyUnavailablePaths.clear();
+    _renamedFolders.clear();
+    _stopWatch.start();
+
+    for (const auto &item : qAsConst(syncItems)) {
+        slotNewItem(item);
+    }
+
+    bool hasChange = false;
+    bool hasDelete = false;
+    int lastChangeInstruction = 0;
+    int lastDeleteInstruction = 0;
+    sortSyncItems(syncItems, hasChange, lastChangeInstruction, hasDelete, lastDeleteInstruction);
+
+    _journal->commitIfNeededAndStartNewTransaction("Sync plan resumed");
+    startPropagation(syncItems, hasChange, lastChangeInstruction, hasDelete, lastDeleteInstruction);
+}
+
 void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
 {
     if (discoveryResult < 0) {
@@ -1028,6 +1147,8 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
         return;
     }
     qCInfo(lcEngine) << "#### Discovery end #################################################### " << _stopWatch.addLapTime(QLatin1String("Discovery Finished")) << "ms";
+    logMemoryUsage(QStringLiteral("discovery"));
+    _memoryPhase = QStringLiteral("reconcile");
 
     // Sanity check
     if (!_journal->isConnected()) {
@@ -1044,7 +1165,7 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     // See: https://github.com/nextcloud/desktop/issues/1433
     // It's still unclear why we can get an empty FileMap even though folder isn't empty
     // For now: Re-check if folder is really empty, if not bail out
-    if (_csync_ctx.data()->local.files.empty() && QDir(_localPath).entryInfoList(QDir::NoDotAndDotDot).count() > 0) {
+    if (_csync_ctx.data()->local.files.totalSize() == 0 && QDir(_localPath).entryInfoList(QDir::NoDotAndDotDot).count() > 0) {
         qCWarning(lcEngine) << "Received local tree with empty FileMap but sync folder isn't empty. Won't reconcile.";
         finalize(false);
         return;
@@ -1061,6 +1182,8 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     }
 
     qCInfo(lcEngine) << "#### Reconcile end #################################################### " << _stopWatch.addLapTime(QLatin1String("Reconcile Finished")) << "ms";
+    logMemoryUsage(QStringLiteral("reconcile"));
+    _memoryPhase = QStringLiteral("post-reconcile");
 
     _hasNoneFiles = false;
     _hasRemoveFile = false;
@@ -1070,6 +1193,7 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     _seenFiles.clear();
     _temporarilyUnavailablePaths.clear();
     _renamedFolders.clear();
+    _remotePermissions.clear();
 
     if (csync_walk_local_tree(_csync_ctx.data(), [this](csync_file_stat_t *f, csync_file_stat_t *o) { return treewalkFile(f, o, false); }) < 0) {
         qCWarning(lcEngine) << "Error in local treewalk.";
@@ -1150,53 +1274,31 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     bool hasDelete = false;
     int lastChangeInstruction = 0;
     int lastDeleteInstruction = 0;
-
-    // Only if list is populated, can be empty under certain circumstances
-    // Get CHANGE instructions to the top first
-    if (syncItems.count() > 0) {
-        std::sort(syncItems.begin(), syncItems.end(),
-            [](SyncFileItemVector::const_reference &a, SyncFileItemVector::const_reference &b) -> bool {
-				return ((a->_instruction == CSYNC_INSTRUCTION_TYPE_CHANGE) && (b->_instruction != CSYNC_INSTRUCTION_TYPE_CHANGE));
-            });
-        if (syncItems.at(0)->_instruction == CSYNC_INSTRUCTION_TYPE_CHANGE) {
-            hasChange = true;
-            lastChangeInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin(), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_TYPE_CHANGE; }));
-        }
-        if (hasChange) {
-            std::sort(syncItems.begin(), syncItems.begin() + lastChangeInstruction);
-            if (syncItems.count() > lastChangeInstruction) {
-                std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end(),
-                    [](SyncFileItemVector::const_reference &a, SyncFileItemVector::const_reference &b) -> bool {
-                        return ((a->_instruction == CSYNC_INSTRUCTION_REMOVE) && (b->_instruction != CSYNC_INSTRUCTION_REMOVE));
-                    });
-                if (syncItems.at(lastChangeInstruction + 1)->_instruction == CSYNC_INSTRUCTION_REMOVE) {
-                    hasDelete = true;
-                    lastDeleteInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_REMOVE; }));
-                    std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.begin() + lastDeleteInstruction);
-                    if (syncItems.count() > lastDeleteInstruction) {
-                        std::sort(syncItems.begin() + (lastDeleteInstruction + 1), syncItems.end());
-                    }
-                } else {
-                    std::sort(syncItems.begin() + (lastChangeInstruction + 1), syncItems.end());
-                }
-            }
-        } else if (syncItems.at(0)->_instruction == CSYNC_INSTRUCTION_REMOVE) {
-            hasDelete = true;
-            lastDeleteInstruction = std::distance(syncItems.begin(), std::find_if(syncItems.begin(), syncItems.end(), [](SyncFileItemVector::const_reference &a) -> bool { return a->_instruction != CSYNC_INSTRUCTION_REMOVE; }));
-            std::sort(syncItems.begin(), syncItems.begin() + lastDeleteInstruction);
-			if (syncItems.count() > lastDeleteInstruction) {
-                std::sort(syncItems.begin() + (lastDeleteInstruction + 1), syncItems.end());
-            }
-        } else {
-            std::sort(syncItems.begin(), syncItems.end());
-        }
-    }
+    sortSyncItems(syncItems, hasChange, lastChangeInstruction, hasDelete, lastDeleteInstruction);
 
     //std::sort(syncItems.begin(), syncItems.end());
 
     // make sure everything is allowed
     checkForPermission(syncItems);
+    _remotePermissions.clear();
+
+    // Keep the plan so that an interrupted propagation can continue without a new discovery
+    if (_syncOptions._syncPlanMinimumItems > 0
+        && syncItems.size() >= _syncOptions._syncPlanMinimumItems
+        && !_account->capabilities().clientSideEncryptionAvailable()) {
+        bool ok = false;
+        const auto selectiveSyncBlackList = _journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, &ok);
+        _syncPlan.save(syncItems, _discoveredRootEtag, selectiveSyncBlackList);
+    } else {
+        _syncPlan.clear();
+    }
 
+    startPropagation(syncItems, hasChange, lastChangeInstruction, hasDelete, lastDeleteInstruction);
+}
+
+void SyncEngine::startPropagation(SyncFileItemVector &syncItems, bool hasChange, int lastChangeInstruction,
+    bool hasDelete, int lastDeleteInstruction)
+{
     // Re-init the csync context to free memory
     _csync_ctx->reinitialize();
     _localDiscoveryPaths.clear();
@@ -1227,6 +1329,7 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     _propagator = QSharedPointer<OwncloudPropagator>(
         new OwncloudPropagator(_account, _localPath, _remotePath, _journal));
     _propagator->setSyncOptions(_syncOptions);
+    _propagator->_writeQuiescenceTracker = _writeQuiescenceTracker.data();
     connect(_propagator.data(), &OwncloudPropagator::itemCompleted,
         this, &SyncEngine::slotItemCompleted);
     connect(_propagator.data(), &OwncloudPropagator::progress,
@@ -1241,10 +1344,11 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     // apply the network limits to the propagator
     setNetworkLimits(_uploadLimit, _downloadLimit);
 
-    deleteStaleDownloadInfos(syncItems);
-    deleteStaleUploadInfos(syncItems);
-    deleteStaleErrorBlacklistEntries(syncItems);
-    _journal->commit("post stale entry removal");
+    // A resumed plan only contains part of the items, everything else is not stale
+    if (!_resumingSyncPlan) {
+        deleteStaleEntries(syncItems);
+        _journal->commit("post stale entry removal");
+    }
 
     // Emit the started signal only after the propagator has been set up.
     if (_needsUpdate)
@@ -1252,7 +1356,13 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
 
     _propagator->start(syncItems, hasChange, lastChangeInstruction, hasDelete, lastDeleteInstruction);
 
+    for (const auto &path : qAsConst(_priorityPaths)) {
+        _propagator->prioritize(path);
+    }
+
     qCInfo(lcEngine) << "#### Post-Reconcile end #################################################### " << _stopWatch.addLapTime(QLatin1String("Post-Reconcile Finished")) << "ms";
+    logMemoryUsage(QStringLiteral("post-reconcile"));
+    _memoryPhase = QStringLiteral("propagation");
 }
 
 void SyncEngine::slotCleanPollsJobAborted(const QString &error)
@@ -1284,6 +1394,14 @@ void SyncEngine::slotItemCompleted(const SyncFileItemPtr &item)
 {
     _progressInfo->setProgressComplete(*item);
 
+    // Items cut short by an abort or deferred uploads stay pending in the sync plan
+    const bool deferred = item->_status == SyncFileItem::SoftError
+        && _writeQuiescenceTracker->isUploadDeferred(item->_file);
+    if (!(_propagator && _propagator->_abortRequested.load() && item->_status == SyncFileItem::SoftError)
+        && !deferred) {
+        _syncPlan.itemCompleted(*item);
+    }
+
     if (item->_status == SyncFileItem::FatalError) {
         csyncError(item->_errorString);
     }
@@ -1298,12 +1416,21 @@ void SyncEngine::slotFinished(bool success)
         _anotherSyncNeeded = ImmediateFollowUp;
     }
 
-    if (success) {
-        _journal->setDataFingerprint(_discoveryMainThread->_dataFingerprint);
+    // Only an aborted propagation leaves work behind that is worth resuming
+    if (!_propagator->_abortRequested.load()) {
+        _syncPlan.clear();
     }
 
-    if (!_journal->postSyncCleanup(_seenFiles, _temporarilyUnavailablePaths)) {
-        qCDebug(lcEngine) << "Cleaning of synced ";
+    // Without a discovery there is neither a fingerprint nor a list of
+    // seen files, the follow-up sync of a resumed plan takes care of that.
+    if (!_resumingSyncPlan) {
+        if (success) {
+            _journal->setDataFingerprint(_discoveryMainThread->_dataFingerprint);
+        }
+
+        if (!_journal->postSyncCleanup(_seenFiles, _temporarilyUnavailablePaths)) {
+            qCDebug(lcEngine) << "Cleaning of synced ";
+        }
     }
 
     conflictRecordMaintenance();
@@ -1325,12 +1452,20 @@ void SyncEngine::finalize(bool success)
     _thread.quit();
     _thread.wait();
 
+    // The phase the sync finished or failed in
+    logMemoryUsage(_memoryPhase);
     _csync_ctx->reinitialize();
     _journal->close();
 
     qCInfo(lcEngine) << "CSync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
     _stopWatch.stop();
 
+    if (_writeQuiescenceTracker->deferredUploads() > 0) {
+        qCInfo(lcEngine) << "So far deferred" << _writeQuiescenceTracker->deferredUploads()
+                         << "uploads of files that were still being written, avoided uploading"
+                         << _writeQuiescenceTracker->wastedBytesAvoided() << "bytes";
+    }
+
     s_anySyncRunning = false;
     _syncRunning = false;
     emit finished(success);
@@ -1343,10 +1478,23 @@ void SyncEngine::finalize(bool success)
     _uniqueErrors.clear();
     _localDiscoveryPaths.clear();
     _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
+    _priorityPaths.clear();
 
     _clearTouchedFilesTimer.start();
 }
 
+void SyncEngine::logMemoryUsage(const QString &phase)
+{
+    const qint64 treeBytes = _csync_ctx->local.files.bytesUsed() + _csync_ctx->remote.files.bytesUsed();
+    const QString usage = QStringLiteral("%1, discoveryTreeBytes=%2, journalCacheBytes=%3")
+                              .arg(MemoryCounters::toString())
+                              .arg(treeBytes)
+                              .arg(_journal->pageCacheBytes());
+    qCInfo(lcEngine) << "Memory after" << phase << qPrintable(usage);
+    emit memoryUsage(phase, usage);
+    MemoryCounters::resetHighWater();
+}
+
 void SyncEngine::slotProgress(const SyncFileItem &item, quint64 current)
 {
     _progressInfo->setProgressItem(item, current);
@@ -1377,64 +1525,135 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
     bool selectiveListOk = false;
     auto selectiveSyncBlackList = _journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, &selectiveListOk);
     std::sort(selectiveSyncBlackList.begin(), selectiveSyncBlackList.end());
-    SyncFileItemPtr needle;
 
-    for (SyncFileItemVector::iterator it = syncItems.begin(); it != syncItems.end(); ++it) {
-        if ((*it)->_direction != SyncFileItem::Up
-            || !isFileModifyingInstruction((*it)->_instruction)) {
-            // Currently we only check server-side permissions
-            continue;
-        }
-
-        // Do not propagate anything in the server if it is in the selective sync blacklist
-        const QString path = (*it)->destination() + QLatin1Char('/');
+    // A folder whose contents get the same treatment as the folder itself.
+    // The contents directly follow the folder in the sorted items, so a
+    // single pass over the items handles them as they come.
+    enum class Scope {
+        None,
+        Blacklisted, // in the selective sync blacklist: ignore the contents
+        NoSubFolders, // new folder in a folder without the permission to add subfolders
+        Restored, // removed folder that may not be removed: restore the contents
+        RemovedShare, // removed top level share: leave the contents alone
+        MoveError, // folder that may not be moved: error for the contents
+    };
+    Scope scope = Scope::None;
+    QString scopePath;
+    QString scopeError;
+    // The folders of a blacklisted scope that contain the current item, outermost first
+    QVector<SyncFileItemPtr> blacklistedDirs;
+
+    const auto isInside = [](const QString &path, const QString &folder) {
+        return path.size() > folder.size() && path.at(folder.size()) == QLatin1Char('/') && path.startsWith(folder);
+    };
 
-        // if reading the selective sync list from db failed, lets ignore all rather than nothing.
-        if (!selectiveListOk || std::binary_search(selectiveSyncBlackList.constBegin(), selectiveSyncBlackList.constEnd(), path)) {
-            (*it)->_instruction = CSYNC_INSTRUCTION_IGNORE;
-            (*it)->_status = SyncFileItem::FileIgnored;
-            (*it)->_errorString = tr("Ignored because of the \"choose what to sync\" blacklist");
+    for (SyncFileItemVector::iterator it = syncItems.begin(); it != syncItems.end(); ++it) {
+        if (scope != Scope::None) {
+            const bool byDestination = scope == Scope::NoSubFolders || scope == Scope::MoveError;
+            if ((byDestination ? (*it)->destination() : (*it)->_file).startsWith(scopePath)) {
+                switch (scope) {
+                case Scope::Blacklisted: {
+                    while (!isInside((*it)->_file, blacklistedDirs.last()->destination()))
+                        blacklistedDirs.removeLast();
 
-            if ((*it)->isDirectory()) {
-                auto it_base = it;
-                for (SyncFileItemVector::iterator it_next = it + 1; it_next != syncItems.end() && (*it_next)->_file.startsWith(path); ++it_next) {
-                    it = it_next;
                     // We want to ignore almost all instructions for items inside selective-sync excluded folders.
                     //The exception are DOWN/REMOVE actions that remove local files and folders that are
                     //guaranteed to be up-to-date with their server copies.
                     if ((*it)->_direction == SyncFileItem::Down && (*it)->_instruction == CSYNC_INSTRUCTION_REMOVE) {
                         // We need to keep the "delete" items. So we need to un-ignore parent directories
+                        const QString &base = blacklistedDirs.first()->destination();
                         QString parentDir = (*it)->_file;
-                        do {
+                        for (int dir = blacklistedDirs.size() - 1; dir >= 0; --dir) {
                             parentDir = QFileInfo(parentDir).path();
-                            if (parentDir.isEmpty() || !parentDir.startsWith((*it_base)->destination())) {
+                            if (parentDir.isEmpty() || !parentDir.startsWith(base)) {
                                 break;
                             }
-                            // Find the parent directory in the syncItems vector. Since the vector
-                            // is sorted we can use a lower_bound, but we need a fake
-                            // SyncFileItemPtr needle to compare against
-                            if (!needle)
-                                needle = SyncFileItemPtr::create();
-                            needle->_file = parentDir;
-                            auto parent_it = std::lower_bound(it_base, it, needle);
-                            if (parent_it == syncItems.end() || (*parent_it)->destination() != parentDir) {
+                            // The parent directory is the innermost folder of the scope, if it is an item at all
+                            const auto &parent = blacklistedDirs.at(dir);
+                            if (parent->destination() != parentDir) {
                                 break;
                             }
-                            ASSERT((*parent_it)->isDirectory());
-                            if ((*parent_it)->_instruction != CSYNC_INSTRUCTION_IGNORE) {
+                            if (parent->_instruction != CSYNC_INSTRUCTION_IGNORE) {
                                 break; // already changed
                             }
-                            (*parent_it)->_instruction = CSYNC_INSTRUCTION_UPDATE_METADATA;
-                            (*parent_it)->_status = SyncFileItem::NoStatus;
-                            (*parent_it)->_errorString.clear();
-
-                        } while (true);
-                        continue;
+                            parent->_instruction = CSYNC_INSTRUCTION_UPDATE_METADATA;
+                            parent->_status = SyncFileItem::NoStatus;
+                            parent->_errorString.clear();
+                        }
+                    } else {
+                        (*it)->_instruction = CSYNC_INSTRUCTION_IGNORE;
+                        (*it)->_status = SyncFileItem::FileIgnored;
+                        (*it)->_errorString = tr("Ignored because of the \"choose what to sync\" blacklist");
+                    }
+                    if ((*it)->isDirectory())
+                        blacklistedDirs.append(*it);
+                    break;
+                }
+                case Scope::NoSubFolders:
+                    if ((*it)->_instruction == CSYNC_INSTRUCTION_RENAME) {
+                        // The file was most likely moved in this directory.
+                        // If the file was read only or could not be moved or removed, it should
+                        // be restored. Do that in the next sync by not considering as a rename
+                        // but delete and upload. It will then be restored if needed.
+                        _journal->avoidRenamesOnNextSync((*it)->_file);
+                        _anotherSyncNeeded = ImmediateFollowUp;
+                        qCWarning(lcEngine) << "Moving of " << (*it)->_file << " canceled because no permission to add parent folder";
                     }
-                    (*it)->_instruction = CSYNC_INSTRUCTION_IGNORE;
-                    (*it)->_status = SyncFileItem::FileIgnored;
-                    (*it)->_errorString = tr("Ignored because of the \"choose what to sync\" blacklist");
+                    (*it)->_instruction = CSYNC_INSTRUCTION_ERROR;
+                    (*it)->_status = SyncFileItem::SoftError;
+                    (*it)->_errorString = tr("Not allowed because you don't have permission to add parent folder");
+                    break;
+                case Scope::Restored:
+                    if ((*it)->_instruction != CSYNC_INSTRUCTION_REMOVE) {
+                        qCWarning(lcEngine) << "non-removed job within a removed folder"
+                                            << (*it)->_file << (*it)->_instruction;
+                        break;
+                    }
+
+                    qCWarning(lcEngine) << "checkForPermission: RESTORING" << (*it)->_file;
+
+                    (*it)->_instruction = CSYNC_INSTRUCTION_NEW;
+                    (*it)->_direction = SyncFileItem::Down;
+                    (*it)->_isRestoration = true;
+                    (*it)->_errorString = tr("Not allowed to remove, restoring");
+                    break;
+                case Scope::RemovedShare:
+                    // The propagator sees that these are inside the removed share
+                    break;
+                case Scope::MoveError:
+                    (*it)->_instruction = CSYNC_INSTRUCTION_ERROR;
+                    (*it)->_status = SyncFileItem::NormalError;
+                    (*it)->_errorString = scopeError;
+                    qCWarning(lcEngine) << "checkForPermission: ERROR MOVING" << (*it)->_file;
+                    break;
+                case Scope::None:
+                    break;
                 }
+                continue;
+            }
+            scope = Scope::None;
+            blacklistedDirs.clear();
+        }
+
+        if ((*it)->_direction != SyncFileItem::Up
+            || !isFileModifyingInstruction((*it)->_instruction)) {
+            // Currently we only check server-side permissions
+            continue;
+        }
+
+        // Do not propagate anything in the server if it is in the selective sync blacklist
+        const QString path = (*it)->destination() + QLatin1Char('/');
+
+        // if reading the selective sync list from db failed, lets ignore all rather than nothing.
+        if (!selectiveListOk || std::binary_search(selectiveSyncBlackList.constBegin(), selectiveSyncBlackList.constEnd(), path)) {
+            (*it)->_instruction = CSYNC_INSTRUCTION_IGNORE;
+            (*it)->_status = SyncFileItem::FileIgnored;
+            (*it)->_errorString = tr("Ignored because of the \"choose what to sync\" blacklist");
+
+            if ((*it)->isDirectory()) {
+                scope = Scope::Blacklisted;
+                scopePath = path;
+                blacklistedDirs.append(*it);
             }
             continue;
         }
@@ -1454,22 +1673,8 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
                 (*it)->_status = SyncFileItem::NormalError;
                 (*it)->_errorString = tr("Not allowed because you don't have permission to add subfolders to that folder");
 
-                for (SyncFileItemVector::iterator it_next = it + 1; it_next != syncItems.end() && (*it_next)->destination().startsWith(path); ++it_next) {
-                    it = it_next;
-                    if ((*it)->_instruction == CSYNC_INSTRUCTION_RENAME) {
-                        // The file was most likely moved in this directory.
-                        // If the file was read only or could not be moved or removed, it should
-                        // be restored. Do that in the next sync by not considering as a rename
-                        // but delete and upload. It will then be restored if needed.
-                        _journal->avoidRenamesOnNextSync((*it)->_file);
-                        _anotherSyncNeeded = ImmediateFollowUp;
-                        qCWarning(lcEngine) << "Moving of " << (*it)->_file << " canceled because no permission to add parent folder";
-                    }
-                    (*it)->_instruction = CSYNC_INSTRUCTION_ERROR;
-                    (*it)->_status = SyncFileItem::SoftError;
-                    (*it)->_errorString = tr("Not allowed because you don't have permission to add parent folder");
-                }
-
+                scope = Scope::NoSubFolders;
+                scopePath = path;
             } else if (!(*it)->isDirectory() && !perms.hasPermission(RemotePermissions::CanAddFile)) {
                 qCWarning(lcEngine) << "checkForPermission: ERROR" << (*it)->_file;
                 (*it)->_instruction = CSYNC_INSTRUCTION_ERROR;
@@ -1492,12 +1697,11 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
                 // Take the things to write to the db from the "other" node (i.e: info from server).
                 // Do a lookup into the csync remote tree to get the metadata we need to restore.
                 ASSERT(_csync_ctx->status != CSYNC_STATUS_INIT);
-                auto csyncIt = _csync_ctx->remote.files.find((*it)->_file.toUtf8());
-                if (csyncIt != _csync_ctx->remote.files.end()) {
-                    (*it)->_modtime = csyncIt->second->modtime;
-                    (*it)->_size = csyncIt->second->size;
-                    (*it)->_fileId = csyncIt->second->file_id;
-                    (*it)->_etag = csyncIt->second->etag;
+                if (auto remoteFile = _csync_ctx->remote.files.findFile((*it)->_file.toUtf8())) {
+                    (*it)->_modtime = remoteFile->modtime;
+                    (*it)->_size = remoteFile->size;
+                    (*it)->_fileId = remoteFile->file_id;
+                    (*it)->_etag = remoteFile->etag;
                 }
                 (*it)->_errorString = tr("Not allowed to upload this file because it is read-only on the server, restoring");
                 continue;
@@ -1519,23 +1723,8 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
 
                 if ((*it)->isDirectory()) {
                     // restore all sub items
-                    for (SyncFileItemVector::iterator it_next = it + 1;
-                         it_next != syncItems.end() && (*it_next)->_file.startsWith(path); ++it_next) {
-                        it = it_next;
-
-                        if ((*it)->_instruction != CSYNC_INSTRUCTION_REMOVE) {
-                            qCWarning(lcEngine) << "non-removed job within a removed folder"
-                                                << (*it)->_file << (*it)->_instruction;
-                            continue;
-                        }
-
-                        qCWarning(lcEngine) << "checkForPermission: RESTORING" << (*it)->_file;
-
-                        (*it)->_instruction = CSYNC_INSTRUCTION_NEW;
-                        (*it)->_direction = SyncFileItem::Down;
-                        (*it)->_isRestoration = true;
-                        (*it)->_errorString = tr("Not allowed to remove, restoring");
-                    }
+                    scope = Scope::Restored;
+                    scopePath = path;
                 }
             } else if (perms.hasPermission(RemotePermissions::IsShared)
                 && perms.hasPermission(RemotePermissions::CanDelete)) {
@@ -1551,10 +1740,8 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
                         (*it)->_errorString = tr("Local files and share folder removed.");
                     }
 
-                    for (SyncFileItemVector::iterator it_next = it + 1;
-                         it_next != syncItems.end() && (*it_next)->_file.startsWith(path); ++it_next) {
-                        it = it_next;
-                    }
+                    scope = Scope::RemovedShare;
+                    scopePath = path;
                 }
             }
             break;
@@ -1627,14 +1814,9 @@ void SyncEngine::checkForPermission(SyncFileItemVector &syncItems)
 
 
                 if ((*it)->isDirectory()) {
-                    for (SyncFileItemVector::iterator it_next = it + 1;
-                         it_next != syncItems.end() && (*it_next)->destination().startsWith(path); ++it_next) {
-                        it = it_next;
-                        (*it)->_instruction = CSYNC_INSTRUCTION_ERROR;
-                        (*it)->_status = SyncFileItem::NormalError;
-                        (*it)->_errorString = errorString;
-                        qCWarning(lcEngine) << "checkForPermission: ERROR MOVING" << (*it)->_file;
-                    }
+                    scope = Scope::MoveError;
+                    scopePath = path;
+                    scopeError = errorString;
                 }
             }
             break;
@@ -1661,11 +1843,9 @@ RemotePermissions SyncEngine::getPermissions(const QString &file) const
     if (file == QLatin1String(""))
         return _csync_ctx->remote.root_perms;
 
-    auto it = _csync_ctx->remote.files.find(file.toUtf8());
-    if (it != _csync_ctx->remote.files.end()) {
-        return it->second->remotePerm;
-    }
-    return {};
+    // Collected during the treewalk, so this doesn't need to look into the
+    // remote tree and possibly the spill store for every item.
+    return _remotePermissions.value(file);
 }
 
 void SyncEngine::restoreOldFiles(SyncFileItemVector &syncItems)
@@ -1776,6 +1956,18 @@ bool SyncEngine::shouldDiscoverLocally(const QByteArray &path) const
     return false;
 }
 
+void SyncEngine::prioritizePath(const QString &path)
+{
+    if (!_priorityPaths.contains(path))
+        _priorityPaths.append(path);
+
+    if (_propagator) {
+        _propagator->prioritize(path);
+    } else {
+        qCInfo(lcEngine) << "Will propagate" << path << "first";
+    }
+}
+
 void SyncEngine::abort()
 {
     if (_propagator)
@@ -1784,6 +1976,11 @@ void SyncEngine::abort()
     // Sets a flag for the update phase
     csync_request_abort(_csync_ctx.data());
 
+    // Stops checking whether the sync plan can be resumed
+    if (_syncPlanEtagJob && _syncPlanEtagJob->reply()) {
+        _syncPlanEtagJob->reply()->abort();
+    }
+
     // Aborts the discovery phase job
     if (_discoveryMainThread) {
         _discoveryMainThread->abort();
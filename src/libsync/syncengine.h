@@ -39,6 +39,8 @@
 #include "accountfwd.h"
 #include "discoveryphase.h"
 #include "common/checksums.h"
+#include "syncplan.h"
+#include "writequiescencetracker.h"
 
 class QProcess;
 
@@ -83,6 +85,7 @@ public:
     ExcludedFiles &excludedFiles() { return *_excludedFiles; }
     Utility::StopWatch &stopWatch() { return _stopWatch; }
     SyncFileStatusTracker &syncFileStatusTracker() { return *_syncFileStatusTracker; }
+    WriteQuiescenceTracker &writeQuiescenceTracker() { return *_writeQuiescenceTracker; }
 
     /* Returns whether another sync is needed to complete the sync */
     AnotherSyncNeeded isAnotherSyncNeeded() { return _anotherSyncNeeded; }
@@ -125,6 +128,18 @@ public:
     /** Access the last sync run's local discovery style */
     LocalDiscoveryStyle lastLocalDiscoveryStyle() const { return _lastLocalDiscoveryStyle; }
 
+    /** Whether the last sync run resumed a stored SyncPlan and did no discovery */
+    bool lastSyncResumedPlan() const { return _resumingSyncPlan; }
+
+    /**
+     * Propagate the folder-relative path and everything below it before
+     * the other items.
+     *
+     * If the sync is propagating, this applies right away. Otherwise it
+     * applies once the current or next sync starts propagating.
+     */
+    void prioritizePath(const QString &path);
+
 signals:
     void csyncUnavailable();
 
@@ -139,6 +154,9 @@ signals:
 
     void transmissionProgress(const ProgressInfo &progress);
 
+    /// At the end of each sync phase, with the live object counts and memory use.
+    void memoryUsage(const QString &phase, const QString &usage);
+
     /// We've produced a new sync error of a type.
     void syncError(const QString &message, ErrorCategory category);
 
@@ -174,6 +192,9 @@ private slots:
     void slotFolderDiscovered(bool local, const QString &folder);
     void slotRootEtagReceived(const QString &);
 
+    /** Resumes the stored sync plan if the server root is unchanged, see SyncPlan. */
+    void slotSyncPlanEtagReceived(const QString &etag);
+
     /** Called when a SyncFileItem gets accepted for a sync.
      *
      * Mostly done in initial creation inside treewalkFile but
@@ -202,6 +223,9 @@ private slots:
 
 private:
     void handleSyncError(CSYNC *ctx, const char *state);
+
+    // Logs the memory counters and their high-water marks for the phase that just ended
+    void logMemoryUsage(const QString &phase);
     void csyncError(const QString &message);
 
     QString journalDbFilePath() const;
@@ -209,19 +233,18 @@ private:
     int treewalkFile(csync_file_stat_t *file, csync_file_stat_t *other, bool);
     bool checkErrorBlacklisting(SyncFileItem &item);
 
-    // Cleans up unnecessary downloadinfo entries in the journal as well
-    // as their temporary files.
-    void deleteStaleDownloadInfos(const SyncFileItemVector &syncItems);
-
-    // Removes stale uploadinfos from the journal.
-    void deleteStaleUploadInfos(const SyncFileItemVector &syncItems);
-
-    // Removes stale error blacklist entries from the journal.
-    void deleteStaleErrorBlacklistEntries(const SyncFileItemVector &syncItems);
+    // Cleans up unnecessary downloadinfo, uploadinfo and error blacklist entries
+    // in the journal, as well as the temporary files and server chunks of the
+    // stale transfers.
+    void deleteStaleEntries(const SyncFileItemVector &syncItems);
 
     // Removes stale and adds missing conflict records after sync
     void conflictRecordMaintenance();
 
+    // Sets up the propagator and starts propagating the sorted items
+    void startPropagation(SyncFileItemVector &syncItems, bool hasChange, int lastChangeInstruction,
+        bool hasDelete, int lastDeleteInstruction);
+
     // cleanup and emit the finished signal
     void finalize(bool success);
 
@@ -237,10 +260,17 @@ private:
     QString _localPath;
     QString _remotePath;
     QString _remoteRootEtag;
+    QString _discoveredRootEtag; // of the current run
     SyncJournalDb *_journal;
     QPointer<DiscoveryMainThread> _discoveryMainThread;
     QSharedPointer<OwncloudPropagator> _propagator;
 
+    SyncPlan _syncPlan;
+    QPointer<RequestEtagJob> _syncPlanEtagJob;
+
+    // true if the current run propagates a stored sync plan instead of discovering
+    bool _resumingSyncPlan = false;
+
     // After a sync, only the syncdb entries whose filenames appear in this
     // set will be kept. See _temporarilyUnavailablePaths.
     QSet<QString> _seenFiles;
@@ -261,7 +291,9 @@ private:
 
     QScopedPointer<ExcludedFiles> _excludedFiles;
     QScopedPointer<SyncFileStatusTracker> _syncFileStatusTracker;
+    QScopedPointer<WriteQuiescenceTracker> _writeQuiescenceTracker;
     Utility::StopWatch _stopWatch;
+    QString _memoryPhase; // the running phase, for logMemoryUsage()
 
     // maps the origin and the target of the folders that have been renamed
     QHash<QString, QString> _renamedFolders;
@@ -274,6 +306,10 @@ private:
     void checkForPermission(SyncFileItemVector &syncItems);
     RemotePermissions getPermissions(const QString &file) const;
 
+    // The server permissions of the remote folders and of the changed items,
+    // collected by the treewalk for checkForPermission()
+    QHash<QString, RemotePermissions> _remotePermissions;
+
     /**
      * Instead of downloading files from the server, upload the files to the server
      */
@@ -314,6 +350,9 @@ private:
     LocalDiscoveryStyle _lastLocalDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     LocalDiscoveryStyle _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     std::set<QByteArray> _localDiscoveryPaths;
+
+    /** Paths to propagate first once the propagation starts, see prioritizePath() */
+    QStringList _priorityPaths;
 };
 }
 
@@ -247,6 +247,9 @@ public:
 
     QString _directDownloadUrl;
     QString _directDownloadCookies;
+
+private:
+    MemoryCounters::Instance<MemoryCounters::SyncFileItems> _instanceCounter;
 };
 
 inline bool operator<(const SyncFileItemPtr &item1, const SyncFileItemPtr &item2)
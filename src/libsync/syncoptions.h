@@ -59,6 +59,40 @@ struct SyncOptions
 
     /** Whether parallel network jobs are allowed. */
     bool _parallelNetworkJobs = true;
+
+    /** Maximum number of small files packed into one bulk upload request.
+     *
+     * Only used if the server supports bulk uploads. Values below 2
+     * disable bulk uploads.
+     */
+    int _bulkUploadBatchSize = 100;
+
+    /** Maximum size of the files packed into one bulk upload request.
+     *
+     * The request body is built in memory.
+     */
+    qint64 _bulkUploadBatchBytes = 10 * 1000 * 1000; // 10MB
+
+    /** Size of the blocks compared to find the changed parts of a file.
+     *
+     * Only used for chunked uploads if the server supports delta chunking.
+     */
+    qint64 _deltaBlockSize = 1024 * 1024;
+
+    /** Minimum number of items a sync run needs for its plan to be stored.
+     *
+     * Stored plans allow resuming an interrupted propagation without a new
+     * discovery, see SyncPlan. Values below 1 disable this.
+     */
+    int _syncPlanMinimumItems = 1000;
+
+    /** Number of entries a discovery tree holds in memory before its unchanged
+     * files are moved to a temporary on-disk store.
+     *
+     * Bounds the memory needed to sync very large folders at some cost in
+     * speed. Values below 1 keep the trees in memory.
+     */
+    qint64 _discoverySpillThreshold = 0;
 };
 
 
@@ -0,0 +1,255 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "syncplan.h"
+#include "filesystem.h"
+#include "common/syncjournaldb.h"
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcSyncPlan, "nextcloud.sync.syncplan", QtInfoMsg)
+
+// Increase when the serialized format changes, older plans are then discarded
+static const qint32 syncPlanVersion = 1;
+
+static QByteArray serializeItem(const SyncFileItem &item)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << syncPlanVersion
+           << item._file << item._renameTarget << item._encryptedFileName << item._originalFile
+           << qint32(item._type) << qint32(item._direction) << qint32(item._status)
+           << bool(item._serverHasIgnoredFiles) << bool(item._hasBlacklistEntry)
+           << bool(item._errorMayBeBlacklisted) << bool(item._isRestoration)
+           << item._remotePerm.isNull() << item._remotePerm.toString()
+           << item._errorString << qint32(item._instruction)
+           << qint64(item._modtime) << item._etag << item._size << item._inode << item._fileId
+           << item._checksumHeader << item._previousSize << qint64(item._previousModtime)
+           << item._directDownloadUrl << item._directDownloadCookies << item._affectedItems;
+    return data;
+}
+
+static SyncFileItemPtr deserializeItem(const QByteArray &data)
+{
+    QDataStream stream(data);
+    qint32 version = 0;
+    stream >> version;
+    if (version != syncPlanVersion)
+        return SyncFileItemPtr();
+
+    SyncFileItemPtr item(new SyncFileItem);
+    qint32 type, direction, status, instruction;
+    bool serverHasIgnoredFiles, hasBlacklistEntry, errorMayBeBlacklisted, isRestoration, nullPerm;
+    QByteArray perm;
+    qint64 modtime, previousModtime;
+    stream >> item->_file >> item->_renameTarget >> item->_encryptedFileName >> item->_originalFile
+        >> type >> direction >> status
+        >> serverHasIgnoredFiles >> hasBlacklistEntry
+        >> errorMayBeBlacklisted >> isRestoration
+        >> nullPerm >> perm
+        >> item->_errorString >> instruction
+        >> modtime >> item->_etag >> item->_size >> item->_inode >> item->_fileId
+        >> item->_checksumHeader >> item->_previousSize >> previousModtime
+        >> item->_directDownloadUrl >> item->_directDownloadCookies >> item->_affectedItems;
+    if (stream.status() != QDataStream::Ok)
+        return SyncFileItemPtr();
+
+    item->_type = static_cast<ItemType>(type);
+    item->_direction = static_cast<SyncFileItem::Direction>(direction);
+    item->_status = static_cast<SyncFileItem::Status>(status);
+    item->_serverHasIgnoredFiles = serverHasIgnoredFiles;
+    item->_hasBlacklistEntry = hasBlacklistEntry;
+    item->_errorMayBeBlacklisted = errorMayBeBlacklisted;
+    item->_isRestoration = isRestoration;
+    if (!nullPerm)
+        item->_remotePerm = RemotePermissions(perm.constData());
+    item->_instruction = static_cast<csync_instructions_e>(instruction);
+    item->_modtime = modtime;
+    item->_previousModtime = previousModtime;
+    return item;
+}
+
+SyncPlan::SyncPlan(SyncJournalDb *journal)
+    : _journal(journal)
+{
+}
+
+void SyncPlan::save(const SyncFileItemVector &items, const QString &rootEtag, const QStringList &selectiveSyncBlackList)
+{
+    QByteArray header;
+    {
+        QDataStream stream(&header, QIODevice::WriteOnly);
+        stream << syncPlanVersion << rootEtag << selectiveSyncBlackList;
+    }
+
+    _ids.clear();
+    QVector<QByteArray> serialized;
+    serialized.reserve(items.size());
+    for (const auto &item : items) {
+        _ids.insert(item.data(), serialized.size());
+        serialized.append(serializeItem(*item));
+    }
+    _journal->setSyncPlan(header, serialized);
+    qCInfo(lcSyncPlan) << "Stored sync plan with" << serialized.size() << "items";
+}
+
+bool SyncPlan::readHeader(QString *rootEtag, QStringList *selectiveSyncBlackList)
+{
+    const auto header = _journal->syncPlanHeader();
+    if (header.isEmpty())
+        return false;
+    QDataStream stream(header);
+    qint32 version = 0;
+    stream >> version;
+    if (version != syncPlanVersion)
+        return false;
+    stream >> *rootEtag >> *selectiveSyncBlackList;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool SyncPlan::isStored()
+{
+    QString rootEtag;
+    QStringList blackList;
+    return readHeader(&rootEtag, &blackList);
+}
+
+bool SyncPlan::matches(const QString &rootEtag, const QStringList &selectiveSyncBlackList)
+{
+    QString storedEtag;
+    QStringList storedBlackList;
+    if (!readHeader(&storedEtag, &storedBlackList))
+        return false;
+    if (storedEtag.isEmpty() || storedEtag != rootEtag) {
+        qCInfo(lcSyncPlan) << "Root etag changed since the sync plan was made" << storedEtag << rootEtag;
+        return false;
+    }
+    if (storedBlackList != selectiveSyncBlackList) {
+        qCInfo(lcSyncPlan) << "Selective sync list changed since the sync plan was made";
+        return false;
+    }
+    return true;
+}
+
+SyncFileItemVector SyncPlan::loadPendingItems(const QString &localPath,
+    const std::function<bool(const QString &)> &mayHaveChangedLocally)
+{
+    _ids.clear();
+    SyncFileItemVector items;
+    int dropped = 0;
+    const auto pending = _journal->pendingSyncPlanItems();
+    for (const auto &entry : pending) {
+        auto item = deserializeItem(entry.second);
+        if (!item) {
+            qCWarning(lcSyncPlan) << "Unreadable sync plan entry" << entry.first;
+            ++dropped;
+            continue;
+        }
+        const bool checkLocally = mayHaveChangedLocally(item->_file)
+            || (!item->_renameTarget.isEmpty() && mayHaveChangedLocally(item->_renameTarget));
+        if (checkLocally && !isStillApplicable(*item, localPath)) {
+            qCInfo(lcSyncPlan) << "Not resuming" << item->_file << item->_instruction << "the local file changed";
+            ++dropped;
+            continue;
+        }
+        _ids.insert(item.data(), entry.first);
+        items.append(item);
+    }
+    qCInfo(lcSyncPlan) << "Sync plan has" << items.size() << "pending items," << dropped << "dropped";
+    return items;
+}
+
+bool SyncPlan::isStillApplicable(const SyncFileItem &item, const QString &localPath)
+{
+    switch (item._instruction) {
+    case CSYNC_INSTRUCTION_NONE:
+    case CSYNC_INSTRUCTION_IGNORE:
+    case CSYNC_INSTRUCTION_ERROR:
+        return false;
+    default:
+        break;
+    }
+
+    const QString path = localPath + item._file;
+    const bool exists = FileSystem::fileExists(path);
+    const bool isDirectory = item._type == ItemTypeDirectory;
+
+    if (item._direction == SyncFileItem::Up) {
+        // The discovered values are the ones of the local file
+        switch (item._instruction) {
+        case CSYNC_INSTRUCTION_REMOVE:
+            return !exists;
+        case CSYNC_INSTRUCTION_NEW:
+        case CSYNC_INSTRUCTION_SYNC:
+        case CSYNC_INSTRUCTION_CONFLICT:
+        case CSYNC_INSTRUCTION_TYPE_CHANGE:
+            if (!exists)
+                return false;
+            if (isDirectory)
+                return QFileInfo(path).isDir();
+            return FileSystem::getSize(path) == qint64(item._size)
+                && FileSystem::getModTime(path) == item._modtime;
+        case CSYNC_INSTRUCTION_RENAME:
+            return !exists && FileSystem::fileExists(localPath + item._renameTarget);
+        default:
+            return true;
+        }
+    }
+
+    if (item._direction != SyncFileItem::Down)
+        return true;
+
+    switch (item._instruction) {
+    case CSYNC_INSTRUCTION_NEW:
+        // A directory may have been created before the sync was interrupted
+        return !exists || (isDirectory && QFileInfo(path).isDir());
+    case CSYNC_INSTRUCTION_SYNC:
+    case CSYNC_INSTRUCTION_CONFLICT:
+    case CSYNC_INSTRUCTION_TYPE_CHANGE:
+        if (!exists)
+            return false;
+        if (isDirectory)
+            return QFileInfo(path).isDir();
+        return FileSystem::getSize(path) == qint64(item._previousSize)
+            && FileSystem::getModTime(path) == item._previousModtime;
+    case CSYNC_INSTRUCTION_REMOVE:
+        // Recursive local removals need a fresh look at the directory contents
+        if (!exists || isDirectory)
+            return false;
+        return FileSystem::getSize(path) == qint64(item._size)
+            && FileSystem::getModTime(path) == item._modtime;
+    case CSYNC_INSTRUCTION_RENAME:
+        return exists && !FileSystem::fileExists(localPath + item._renameTarget);
+    default:
+        return true;
+    }
+}
+
+void SyncPlan::itemCompleted(const SyncFileItem &item)
+{
+    auto it = _ids.find(&item);
+    if (it == _ids.end())
+        return;
+    _journal->setSyncPlanItemDone(it.value());
+    _ids.erase(it);
+}
+
+void SyncPlan::clear()
+{
+    _ids.clear();
+    _journal->clearSyncPlan();
+}
+}
@@ -0,0 +1,87 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SYNCPLAN_H
+#define SYNCPLAN_H
+
+#include "owncloudlib.h"
+#include "syncfileitem.h"
+
+#include <QHash>
+#include <QStringList>
+
+#include <functional>
+
+namespace OCC {
+
+class SyncJournalDb;
+
+/**
+ * @brief The list of operations a sync run decided to do, kept in the journal
+ *
+ * Discovery of a large tree can take a long time. If the client is stopped
+ * while propagating, the next sync would have to repeat it before doing the
+ * remaining work. The SyncEngine therefore stores the items it is about to
+ * propagate and marks them as done as they complete.
+ *
+ * When the next sync starts and the server's root etag as well as the
+ * selective sync list are still the same, the pending items are propagated
+ * directly. The local side of the items is reconciled with the plan first:
+ * items below paths the folder watcher reported as changed, or all items
+ * when the watcher didn't run the whole time (e.g. the client was stopped),
+ * are checked against their local file. Items whose local side changed
+ * since the plan was made are dropped and left to the regular sync that
+ * always follows a resumed one.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SyncPlan
+{
+public:
+    explicit SyncPlan(SyncJournalDb *journal);
+
+    /** Store the items of a sync run that is about to be propagated. */
+    void save(const SyncFileItemVector &items, const QString &rootEtag, const QStringList &selectiveSyncBlackList);
+
+    /** Whether the journal contains a plan with pending items. */
+    bool isStored();
+
+    /** Whether the stored plan was made for this server state. */
+    bool matches(const QString &rootEtag, const QStringList &selectiveSyncBlackList);
+
+    /**
+     * Read the pending items of the stored plan.
+     *
+     * The items for which @a mayHaveChangedLocally is true are compared with
+     * the local files in @a localPath, the ones that no longer fit are left out.
+     */
+    SyncFileItemVector loadPendingItems(const QString &localPath,
+        const std::function<bool(const QString &)> &mayHaveChangedLocally);
+
+    /** Mark an item of the plan as done, it won't be resumed. */
+    void itemCompleted(const SyncFileItem &item);
+
+    /** Forget the stored plan. */
+    void clear();
+
+private:
+    bool readHeader(QString *rootEtag, QStringList *selectiveSyncBlackList);
+    static bool isStillApplicable(const SyncFileItem &item, const QString &localPath);
+
+    SyncJournalDb *_journal;
+
+    // The journal ids of the items of the plan in progress
+    QHash<const SyncFileItem *, int> _ids;
+};
+}
+
+#endif // SYNCPLAN_H
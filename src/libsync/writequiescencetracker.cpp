@@ -0,0 +1,153 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "writequiescencetracker.h"
+#include "filesystem.h"
+
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcWriteQuiescence, "nextcloud.sync.writequiescence", QtInfoMsg)
+
+WriteQuiescenceTracker::WriteQuiescenceTracker(const QString &localPath, QObject *parent)
+    : QObject(parent)
+    , _localPath(localPath)
+{
+    _sampleTimer.setInterval(std::chrono::seconds(2));
+    connect(&_sampleTimer, &QTimer::timeout, this, &WriteQuiescenceTracker::slotSample);
+}
+
+void WriteQuiescenceTracker::setSampleInterval(std::chrono::milliseconds interval)
+{
+    _sampleTimer.setInterval(interval);
+}
+
+WriteQuiescenceTracker::Entry &WriteQuiescenceTracker::touch(const QString &relativePath)
+{
+    auto &entry = _entries[relativePath];
+    entry.lastEvent.start();
+    if (!_sampleTimer.isActive())
+        _sampleTimer.start();
+    return entry;
+}
+
+void WriteQuiescenceTracker::slotFileWritten(const QString &relativePath)
+{
+    // Called for every write, so this must stay cheap: no sampling here
+    touch(relativePath).writerOpen = true;
+}
+
+void WriteQuiescenceTracker::slotFileClosed(const QString &relativePath)
+{
+    auto &entry = touch(relativePath);
+    entry.writerOpen = false;
+    resample(relativePath, entry);
+}
+
+void WriteQuiescenceTracker::slotFileChanged(const QString &relativePath)
+{
+    auto &entry = touch(relativePath);
+    if (entry.size < 0)
+        resample(relativePath, entry);
+}
+
+bool WriteQuiescenceTracker::resample(const QString &relativePath, Entry &entry)
+{
+    const QString path = _localPath + relativePath;
+    const qint64 size = FileSystem::getSize(path);
+    const qint64 modtime = FileSystem::getModTime(path);
+    const bool hadSample = entry.size >= 0;
+    const bool changed = size != entry.size || modtime != entry.modtime;
+    entry.size = size;
+    entry.modtime = modtime;
+    entry.lastSample.start();
+    return hadSample && changed;
+}
+
+bool WriteQuiescenceTracker::shouldDeferUpload(const QString &relativePath, qint64 size)
+{
+    auto it = _entries.find(relativePath);
+    if (it == _entries.end())
+        return false;
+
+    auto &entry = *it;
+    const bool writing = entry.writerOpen
+        && !entry.lastEvent.hasExpired(_openWriterTimeout.count());
+    const bool changed = resample(relativePath, entry);
+    if (!writing && !changed) {
+        _entries.erase(it);
+        return false;
+    }
+
+    entry.deferred = true;
+    ++_deferredUploads;
+    _wastedBytesAvoided += size;
+    qCInfo(lcWriteQuiescence) << "Deferring upload of" << relativePath
+                              << (writing ? "which is open for writing" : "which is still changing");
+    return true;
+}
+
+bool WriteQuiescenceTracker::isUploadDeferred(const QString &relativePath) const
+{
+    auto it = _entries.constFind(relativePath);
+    return it != _entries.constEnd() && it->deferred;
+}
+
+void WriteQuiescenceTracker::slotSample()
+{
+    QStringList quiescent;
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        auto &entry = *it;
+        const bool expired = entry.lastEvent.hasExpired(_openWriterTimeout.count());
+        if (entry.writerOpen) {
+            if (!expired) {
+                ++it;
+                continue;
+            }
+            // A missed close event or a writer that keeps the file open for good
+            qCInfo(lcWriteQuiescence) << "No writes to" << it.key() << "for a while, no longer waiting for the writer";
+            entry.writerOpen = false;
+        }
+
+        if (!entry.deferred) {
+            // Nothing to report, the sample is only kept for the next upload check
+            it = expired ? _entries.erase(it) : std::next(it);
+            continue;
+        }
+
+        if (entry.lastSample.isValid() && !entry.lastSample.hasExpired(_sampleTimer.interval() / 2)) {
+            // Sampled by an upload check just now, compare on the next round
+            ++it;
+            continue;
+        }
+        if (!FileSystem::fileExists(_localPath + it.key())) {
+            it = _entries.erase(it);
+            continue;
+        }
+        if (resample(it.key(), entry)) {
+            ++it;
+            continue;
+        }
+        quiescent.append(it.key());
+        it = _entries.erase(it);
+    }
+
+    if (_entries.isEmpty())
+        _sampleTimer.stop();
+
+    for (const auto &path : qAsConst(quiescent)) {
+        qCInfo(lcWriteQuiescence) << path << "is no longer being written to";
+        emit fileBecameQuiescent(path);
+    }
+}
+}
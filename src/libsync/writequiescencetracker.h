@@ -0,0 +1,116 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef WRITEQUIESCENCETRACKER_H
+#define WRITEQUIESCENCETRACKER_H
+
+#include "owncloudlib.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Keeps track of local files that are still being written to
+ *
+ * Uploading a file while an application is still writing it wastes the
+ * bandwidth of the upload and produces a follow-up upload of the final
+ * version anyway. The folder watcher reports write and close events
+ * (inotify IN_MODIFY and IN_CLOSE_WRITE on Linux) as well as plain change
+ * notifications; for the latter the size and modification time of the
+ * file are sampled to find out whether it is still growing.
+ *
+ * Uploads of files that have an open writer or whose size or modification
+ * time changed since the last sample are deferred. Deferred files are
+ * sampled periodically and fileBecameQuiescent() is emitted once they are
+ * stable, so the folder can schedule a sync for them.
+ *
+ * All paths are relative to the local sync folder.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT WriteQuiescenceTracker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WriteQuiescenceTracker(const QString &localPath, QObject *parent = nullptr);
+
+    /**
+     * Whether the upload of a file has to wait because it is still being written.
+     *
+     * If so, @a size counts towards wastedBytesAvoided() and fileBecameQuiescent()
+     * will be emitted for the file later.
+     */
+    bool shouldDeferUpload(const QString &relativePath, qint64 size);
+
+    /** Whether the upload of a file was deferred and it is still being written. */
+    bool isUploadDeferred(const QString &relativePath) const;
+
+    /** The number of bytes that weren't uploaded because the file was still being written. */
+    qint64 wastedBytesAvoided() const { return _wastedBytesAvoided; }
+
+    /** The number of deferred uploads. */
+    int deferredUploads() const { return _deferredUploads; }
+
+    /** How often deferred files are sampled, a file is stable if two samples match. */
+    void setSampleInterval(std::chrono::milliseconds interval);
+
+    /** After this time without write events an open writer is no longer waited for. */
+    void setOpenWriterTimeout(std::chrono::milliseconds timeout) { _openWriterTimeout = timeout; }
+
+public slots:
+    /** Data was written to a file, the writer still has it open. */
+    void slotFileWritten(const QString &relativePath);
+
+    /** A writer closed the file. */
+    void slotFileClosed(const QString &relativePath);
+
+    /** A change notification without information about writers. */
+    void slotFileChanged(const QString &relativePath);
+
+signals:
+    /** A file whose upload was deferred is no longer being written. */
+    void fileBecameQuiescent(const QString &relativePath);
+
+private slots:
+    void slotSample();
+
+private:
+    struct Entry
+    {
+        QElapsedTimer lastEvent;
+        QElapsedTimer lastSample;
+        bool writerOpen = false;
+        bool deferred = false;
+        qint64 size = -1;
+        qint64 modtime = 0;
+    };
+
+    // Takes a new sample of the file, returns whether it differs from the previous one
+    bool resample(const QString &relativePath, Entry &entry);
+    Entry &touch(const QString &relativePath);
+
+    QString _localPath;
+    QHash<QString, Entry> _entries;
+    QTimer _sampleTimer;
+    std::chrono::milliseconds _openWriterTimeout = std::chrono::minutes(1);
+    qint64 _wastedBytesAvoided = 0;
+    int _deferredUploads = 0;
+};
+}
+
+#endif // WRITEQUIESCENCETRACKER_H
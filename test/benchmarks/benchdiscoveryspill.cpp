@@ -0,0 +1,85 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+int numDirs = 0;
+int numFiles = 0;
+
+template<int filesPerDir, int dirPerDir, int maxDepth>
+void addBunchOfFiles(int depth, const QString &path, FileModifier &fi) {
+    for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+        QString name = QStringLiteral("file") + QString::number(fileNum);
+        fi.insert(path.isEmpty() ? name : path + "/" + name);
+        numFiles++;
+    }
+    if (depth >= maxDepth)
+        return;
+    for (int dirNum = 1; dirNum <= dirPerDir; ++dirNum) {
+        QString name = QStringLiteral("dir") + QString::number(dirNum);
+        QString subPath = path.isEmpty() ? name : path + "/" + name;
+        fi.mkdir(subPath);
+        numDirs++;
+        addBunchOfFiles<filesPerDir, dirPerDir, maxDepth>(depth + 1, subPath, fi);
+    }
+}
+
+/* Syncs the same tree with the given spill threshold and returns the time
+ * spent in the syncs after the initial one, or -1 if a sync failed.
+ * The initial sync is not compared: all its files are new, and only
+ * unchanged files are spilled. */
+static qint64 benchSyncs(qint64 spillThreshold)
+{
+    FakeFolder fakeFolder{FileInfo{}};
+    SyncOptions options;
+    options._discoverySpillThreshold = spillThreshold;
+    fakeFolder.syncEngine().setSyncOptions(options);
+    numDirs = numFiles = 0;
+    addBunchOfFiles<10, 8, 4>(0, "", fakeFolder.remoteModifier());
+
+    QElapsedTimer timer;
+    timer.start();
+    bool result1 = fakeFolder.syncOnce();
+    qDebug() << "SPILL THRESHOLD" << spillThreshold << "FIRST SYNC: " << result1 << timer.restart();
+    bool result2 = fakeFolder.syncOnce();
+    qint64 unchanged = timer.restart();
+    qDebug() << "SPILL THRESHOLD" << spillThreshold << "UNCHANGED SYNC: " << result2 << unchanged;
+
+    // A change below each top level folder, so their listings are fetched again
+    for (int dirNum = 1; dirNum <= 8; ++dirNum)
+        fakeFolder.remoteModifier().appendByte(QStringLiteral("dir%1/dir1/file1").arg(dirNum));
+    timer.restart();
+    bool result3 = fakeFolder.syncOnce();
+    qint64 changed = timer.restart();
+    qDebug() << "SPILL THRESHOLD" << spillThreshold << "CHANGED SYNC: " << result3 << changed;
+
+    if (!result1 || !result2 || !result3 || fakeFolder.currentLocalState() != fakeFolder.currentRemoteState())
+        return -1;
+    return unchanged + changed;
+}
+
+// Usage: benchdiscoveryspill [spill threshold]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const qint64 spillThreshold = qMax(1LL, app.arguments().value(1, QStringLiteral("1000")).toLongLong());
+
+    const qint64 inMemory = benchSyncs(0);
+    const qint64 spilled = benchSyncs(spillThreshold);
+    qDebug() << "NUMFILES" << numFiles;
+    qDebug() << "NUMDIRS" << numDirs;
+    if (inMemory < 0 || spilled < 0)
+        return -1;
+
+    // Spilling is meant to stay within twice the time of in-memory discovery
+    const double ratio = double(spilled) / qMax<qint64>(inMemory, 1);
+    qDebug() << "IN MEMORY: " << inMemory << "SPILLED: " << spilled << "RATIO: " << ratio;
+    return 0;
+}
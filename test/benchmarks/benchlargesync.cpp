@@ -45,5 +45,31 @@ int main(int argc, char *argv[])
     qDebug() << "FIRST SYNC: " << result1 << timer.restart();
     bool result2 = fakeFolder.syncOnce();
     qDebug() << "SECOND SYNC: " << result2 << timer.restart();
-    return (result1 && result2) ? 0 : -1;
+
+    // Download changes over a HTTP/2 connection whose server resets every
+    // other stream once, so the jobs go through their resend path
+    fakeFolder.syncEngine().account()->setHttp2Supported(true);
+    QSet<QString> reset;
+    int numGets = 0;
+    fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+        if (op != QNetworkAccessManager::GetOperation)
+            return nullptr;
+        const QString path = getFilePathFromUrl(request.url());
+        if (++numGets % 2 == 0 && !reset.contains(path)) {
+            reset.insert(path);
+            auto reply = new FakeErrorReply(op, request, &fakeFolder.syncEngine(), 0);
+            reply->setError(QNetworkReply::ContentReSendError, "Stream reset");
+            reply->setAttribute(QNetworkRequest::HTTP2WasUsedAttribute, true);
+            return reply;
+        }
+        return nullptr;
+    });
+    for (int dirNum = 1; dirNum <= 8; ++dirNum) {
+        for (int fileNum = 1; fileNum <= 10; ++fileNum)
+            fakeFolder.remoteModifier().appendByte(QStringLiteral("dir%1/file%2").arg(dirNum).arg(fileNum));
+    }
+    timer.restart();
+    bool result3 = fakeFolder.syncOnce();
+    qDebug() << "RESEND SYNC: " << result3 << timer.restart() << "RESENT" << reset.size() << "OF" << numGets - reset.size();
+    return (result1 && result2 && result3) ? 0 : -1;
 }
@@ -0,0 +1,80 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include "csync_private.h"
+#include "csync_update.h"
+#include "vio/csync_vio_memory.h"
+
+using namespace OCC;
+
+static const int filesPerDir = 10;
+static const int dirsPerDir = 8;
+static const int maxDepth = 4;
+
+static int numFiles = 0;
+static int numDirs = 0;
+
+static void addBunchOfFiles(CSyncVioMemoryBackend &backend, int depth, const QByteArray &path)
+{
+    for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+        backend.addFile(path + "/file" + QByteArray::number(fileNum), fileNum * 1000, 1500000000 + fileNum);
+        numFiles++;
+    }
+    if (depth >= maxDepth)
+        return;
+    for (int dirNum = 1; dirNum <= dirsPerDir; ++dirNum) {
+        const QByteArray subPath = path + "/dir" + QByteArray::number(dirNum);
+        backend.mkdir(subPath);
+        numDirs++;
+        addBunchOfFiles(backend, depth + 1, subPath);
+    }
+}
+
+// Usage: benchlocaldiscovery [stat latency in microseconds]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto latency = std::chrono::microseconds(app.arguments().value(1).toInt());
+
+    CSyncVioMemoryBackend backend;
+    backend.mkdir("/bench");
+    addBunchOfFiles(backend, 0, "/bench");
+    backend.setLatency(CSyncVioMemoryBackend::Stat, latency);
+    csync_vio_local_set_backend(&backend);
+
+    qDebug() << "NUMFILES" << numFiles;
+    qDebug() << "NUMDIRS" << numDirs;
+    qDebug() << "STAT LATENCY" << latency.count() << "us";
+
+    QTemporaryDir dir;
+    SyncJournalDb journal(dir.filePath("journal.db"));
+    int rc = 0;
+    for (int run = 1; run <= 2 && rc == 0; ++run) {
+        CSYNC ctx("/bench", &journal);
+        ctx.current = LOCAL_REPLICA;
+        backend.resetCallCounts();
+
+        QElapsedTimer timer;
+        timer.start();
+        rc = csync_ftw(&ctx, ctx.local.uri, csync_walker, MAX_DEPTH);
+        qDebug() << "LOCAL DISCOVERY" << run << ":" << rc << timer.elapsed() << "ms"
+                 << ctx.local.files.size() << "entries"
+                 << backend.callCount(CSyncVioMemoryBackend::OpenDir) << "opendir"
+                 << backend.callCount(CSyncVioMemoryBackend::ReadDir) << "readdir"
+                 << backend.callCount(CSyncVioMemoryBackend::Stat) << "stat";
+        if (rc == 0 && ctx.local.files.size() != size_t(numFiles + numDirs))
+            rc = -1;
+    }
+
+    csync_vio_local_set_backend(nullptr);
+    return rc == 0 ? 0 : -1;
+}
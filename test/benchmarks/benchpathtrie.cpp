@@ -0,0 +1,88 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMap>
+
+#include <algorithm>
+
+#include "pathtrie.h"
+
+using namespace OCC;
+
+static const int folderCount = 30;
+static const int lookups = 1000000;
+
+/* The lookup FolderMan::folderForPath() did before it used the PathTrie */
+static QString linearLookup(const QMap<QString, QString> &folders, const QString &path)
+{
+    QString absolutePath = QDir::cleanPath(path) + QLatin1Char('/');
+
+    const auto values = folders.values();
+    const auto it = std::find_if(values.cbegin(), values.cend(), [absolutePath](const QString &folder) {
+        return absolutePath.startsWith(folder + QLatin1Char('/'));
+    });
+    return it != values.cend() ? *it : QString();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QMap<QString, QString> folders;
+    PathTrie<QString> trie(Qt::CaseSensitive);
+    for (int i = 0; i < folderCount; ++i) {
+        const auto path = QStringLiteral("/home/user/sync/account%1/Folder %2").arg(i % 3).arg(i);
+        folders.insert(QString::number(i), path);
+    }
+    for (auto it = folders.cbegin(); it != folders.cend(); ++it)
+        trie.insert(it.value(), it.value());
+
+    // Mostly files inside the folders, like overlay icon queries, some outside
+    QVector<QString> paths;
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 == 0) {
+            paths.append(QStringLiteral("/home/user/Documents/file%1.txt").arg(i));
+        } else {
+            paths.append(QStringLiteral("/home/user/sync/account%1/Folder %2/dir%3/sub/file%4.txt")
+                             .arg(i % 3)
+                             .arg(i % folderCount)
+                             .arg(i % 7)
+                             .arg(i));
+        }
+    }
+
+    int mismatches = 0;
+    for (const auto &path : qAsConst(paths)) {
+        if (linearLookup(folders, path) != trie.findLongestPrefix(path))
+            ++mismatches;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int found = 0;
+    for (int i = 0; i < lookups; ++i) {
+        if (!linearLookup(folders, paths.at(i % paths.size())).isNull())
+            ++found;
+    }
+    const auto linearMsecs = timer.restart();
+
+    int trieFound = 0;
+    for (int i = 0; i < lookups; ++i) {
+        if (!trie.findLongestPrefix(paths.at(i % paths.size())).isNull())
+            ++trieFound;
+    }
+    const auto trieMsecs = timer.elapsed();
+
+    qDebug() << "FOLDERS" << folderCount << "LOOKUPS" << lookups;
+    qDebug() << "LINEAR SCAN:" << linearMsecs << "ms" << found << "found";
+    qDebug() << "PATH TRIE:" << trieMsecs << "ms" << trieFound << "found";
+    return mismatches == 0 && found == trieFound ? 0 : -1;
+}
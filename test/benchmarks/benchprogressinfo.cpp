@@ -0,0 +1,78 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "progressdispatcher.h"
+
+using namespace OCC;
+
+static const int concurrentTransfers = 20;
+static const int completions = 100000;
+static const int updatesPerItem = 10;
+static const quint64 itemSize = 1000 * 1000;
+
+static SyncFileItem makeItem(int i)
+{
+    SyncFileItem item;
+    item._file = QStringLiteral("dir%1/file%2").arg(i % 100).arg(i);
+    item._instruction = CSYNC_INSTRUCTION_NEW;
+    item._direction = i % 2 ? SyncFileItem::Up : SyncFileItem::Down;
+    item._type = ItemTypeFile;
+    item._size = itemSize;
+    return item;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QVector<SyncFileItem> items;
+    items.reserve(completions);
+    for (int i = 0; i < completions; ++i)
+        items.append(makeItem(i));
+
+    ProgressInfo progress;
+    for (const auto &item : qAsConst(items))
+        progress.adjustTotalsForFile(item);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Keep concurrentTransfers items in flight, each one reports
+    // updatesPerItem progress steps before it completes.
+    QVector<int> running;
+    QVector<int> steps;
+    int next = 0;
+    int completed = 0;
+    quint64 updates = 0;
+    while (completed < completions) {
+        while (running.size() < concurrentTransfers && next < completions) {
+            running.append(next++);
+            steps.append(0);
+        }
+        for (int i = running.size() - 1; i >= 0; --i) {
+            const auto &item = items.at(running.at(i));
+            if (++steps[i] <= updatesPerItem) {
+                progress.setProgressItem(item, itemSize * steps.at(i) / updatesPerItem);
+                ++updates;
+                continue;
+            }
+            progress.setProgressComplete(item);
+            running.remove(i);
+            steps.remove(i);
+            ++completed;
+        }
+    }
+
+    const auto elapsed = timer.elapsed();
+    qDebug() << "UPDATES" << updates << "COMPLETIONS" << completed;
+    qDebug() << "PROGRESS ACCOUNTING:" << elapsed << "ms";
+    return progress.completedSize() == progress.totalSize() ? 0 : -1;
+}
@@ -118,14 +118,14 @@ static void check_csync_exclude_add(void **)
     assert_int_equal(check_file_full("/tmp/check_csync2/foo"), CSYNC_NOT_EXCLUDED);
     assert_true(excludedFiles->_allExcludes["/"].contains("/tmp/check_csync1/*"));
 
-    assert_true(excludedFiles->_fullRegexFile["/"].pattern().contains("csync1"));
-    assert_true(excludedFiles->_fullTraversalRegexFile["/"].pattern().contains("csync1"));
-    assert_false(excludedFiles->_bnameTraversalRegexFile["/"].pattern().contains("csync1"));
+    assert_true(excludedFiles->_regexSets["/"]->fullRegexFile.pattern().contains("csync1"));
+    assert_true(excludedFiles->_regexSets["/"]->fullTraversalRegexFile.pattern().contains("csync1"));
+    assert_false(excludedFiles->_regexSets["/"]->bnameTraversalRegexFile.pattern().contains("csync1"));
 
     excludedFiles->addManualExclude("foo");
-    assert_true(excludedFiles->_bnameTraversalRegexFile["/"].pattern().contains("foo"));
-    assert_true(excludedFiles->_fullRegexFile["/"].pattern().contains("foo"));
-    assert_false(excludedFiles->_fullTraversalRegexFile["/"].pattern().contains("foo"));
+    assert_true(excludedFiles->_regexSets["/"]->bnameTraversalRegexFile.pattern().contains("foo"));
+    assert_true(excludedFiles->_regexSets["/"]->fullRegexFile.pattern().contains("foo"));
+    assert_false(excludedFiles->_regexSets["/"]->fullTraversalRegexFile.pattern().contains("foo"));
 }
 
 static void check_csync_exclude_add_per_dir(void **)
@@ -136,12 +136,12 @@ static void check_csync_exclude_add_per_dir(void **)
     assert_true(excludedFiles->_allExcludes["/tmp/check_csync1/"].contains("*"));
 
     excludedFiles->addManualExclude("foo");
-    assert_true(excludedFiles->_fullRegexFile["/"].pattern().contains("foo"));
+    assert_true(excludedFiles->_regexSets["/"]->fullRegexFile.pattern().contains("foo"));
 
     excludedFiles->addManualExclude("foo/bar", "/tmp/check_csync1/");
-    assert_true(excludedFiles->_fullRegexFile["/tmp/check_csync1/"].pattern().contains("bar"));
-    assert_true(excludedFiles->_fullTraversalRegexFile["/tmp/check_csync1/"].pattern().contains("bar"));
-    assert_false(excludedFiles->_bnameTraversalRegexFile["/tmp/check_csync1/"].pattern().contains("foo"));
+    assert_true(excludedFiles->_regexSets["/tmp/check_csync1/"]->fullRegexFile.pattern().contains("bar"));
+    assert_true(excludedFiles->_regexSets["/tmp/check_csync1/"]->fullTraversalRegexFile.pattern().contains("bar"));
+    assert_false(excludedFiles->_regexSets["/tmp/check_csync1/"]->bnameTraversalRegexFile.pattern().contains("foo"));
 }
 
 static void check_csync_excluded(void **)
@@ -291,6 +291,113 @@ static void check_csync_excluded_per_dir(void **)
 #undef FOO_EXCLUDE_LIST
 }
 
+static void write_exclude_file(const char *path, const char *content)
+{
+    FILE *fh = fopen(path, "w");
+    assert_non_null(fh);
+    int rc = fprintf(fh, "%s", content);
+    assert_int_not_equal(rc, 0);
+    rc = fclose(fh);
+    assert_int_equal(rc, 0);
+}
+
+static void check_csync_exclude_reload_incremental(void **)
+{
+#define BAR_DIR "/tmp/check_csync1/bar"
+#define BAZ_DIR "/tmp/check_csync1/baz"
+    int rc = system("mkdir -p " BAR_DIR " " BAZ_DIR);
+    assert_int_equal(rc, 0);
+    write_exclude_file(BAR_DIR "/.sync-exclude.lst", "*.tmp\n");
+    write_exclude_file(BAZ_DIR "/.sync-exclude.lst", "*.tmp\n");
+
+    excludedFiles->addInTreeExcludeFilePath(BAR_DIR "/.sync-exclude.lst");
+    excludedFiles->addInTreeExcludeFilePath(BAZ_DIR "/.sync-exclude.lst");
+    assert_true(excludedFiles->reloadExcludeFiles());
+    const auto bar = excludedFiles->_regexSets[BAR_DIR "/"];
+    const auto baz = excludedFiles->_regexSets[BAZ_DIR "/"];
+    assert_non_null(bar.data());
+    // Files with the same patterns share the compiled regular expressions
+    assert_true(bar == baz);
+
+    // ... also with other instances
+    ExcludedFiles other;
+    other.setWildcardsMatchSlash(false);
+    other.addInTreeExcludeFilePath(BAR_DIR "/.sync-exclude.lst");
+    assert_true(other.reloadExcludeFiles());
+    assert_true(other._regexSets[BAR_DIR "/"] == bar);
+
+    // Reloading unchanged files keeps everything
+    assert_true(excludedFiles->reloadExcludeFiles());
+    assert_true(excludedFiles->_regexSets[BAR_DIR "/"] == bar);
+
+    // Only the base path of the changed file gets new regular expressions
+    write_exclude_file(BAR_DIR "/.sync-exclude.lst", "*.tmp\nfoo\n");
+    assert_true(excludedFiles->reloadExcludeFiles());
+    assert_true(excludedFiles->_regexSets[BAR_DIR "/"] != bar);
+    assert_true(excludedFiles->_regexSets[BAZ_DIR "/"] == baz);
+    assert_int_equal(check_file_full(BAR_DIR "/foo"), CSYNC_FILE_EXCLUDE_LIST);
+    assert_int_equal(check_file_full(BAZ_DIR "/foo"), CSYNC_NOT_EXCLUDED);
+    assert_int_equal(check_file_full(BAZ_DIR "/a.tmp"), CSYNC_FILE_EXCLUDE_LIST);
+
+    // An edit that keeps the size and the modification time is noticed too
+    const QString barFile = QStringLiteral(BAR_DIR "/.sync-exclude.lst");
+    const auto modified = QFileInfo(barFile).lastModified();
+    write_exclude_file(BAR_DIR "/.sync-exclude.lst", "*.tmp\nqux\n");
+    QFile f(barFile);
+    assert_true(f.open(QIODevice::Append));
+    assert_true(f.setFileTime(modified, QFileDevice::FileModificationTime));
+    f.close();
+    assert_true(excludedFiles->reloadExcludeFiles());
+    assert_int_equal(check_file_full(BAR_DIR "/qux"), CSYNC_FILE_EXCLUDE_LIST);
+    assert_int_equal(check_file_full(BAR_DIR "/foo"), CSYNC_NOT_EXCLUDED);
+#undef BAR_DIR
+#undef BAZ_DIR
+}
+
+static void check_csync_exclude_deleted_in_tree_file(void **)
+{
+#define BAR_DIR "/tmp/check_csync1/bar"
+    int rc = system("mkdir -p " BAR_DIR);
+    assert_int_equal(rc, 0);
+    write_exclude_file(BAR_DIR "/.sync-exclude.lst", "*.tmp\n");
+    excludedFiles->addInTreeExcludeFilePath(BAR_DIR "/.sync-exclude.lst");
+    assert_true(excludedFiles->reloadExcludeFiles());
+    assert_int_equal(check_file_full(BAR_DIR "/a.tmp"), CSYNC_FILE_EXCLUDE_LIST);
+
+    // A deleted in-tree exclude file is forgotten instead of failing the reload
+    rc = remove(BAR_DIR "/.sync-exclude.lst");
+    assert_int_equal(rc, 0);
+    assert_true(excludedFiles->reloadExcludeFiles());
+    assert_false(excludedFiles->_excludeFiles.contains(BAR_DIR "/"));
+    assert_false(excludedFiles->_regexSets.contains(BAR_DIR "/"));
+    assert_int_equal(check_file_full(BAR_DIR "/a.tmp"), CSYNC_NOT_EXCLUDED);
+
+    // A configured exclude file that is missing still is an error
+    excludedFiles->addExcludeFilePath(QStringLiteral("/tmp/check_csync1/missing-exclude.lst"));
+    assert_false(excludedFiles->reloadExcludeFiles());
+#undef BAR_DIR
+}
+
+static void check_csync_exclude_root_file_merged(void **)
+{
+#define ROOT_DIR "/tmp/check_csync2/"
+    int rc = system("mkdir -p " ROOT_DIR);
+    assert_int_equal(rc, 0);
+    write_exclude_file(ROOT_DIR ".sync-exclude.lst", "rootonly\n");
+
+    // The exclude file at the root of the sync folder has the same base
+    // path as the global one, the patterns of both apply
+    ExcludedFiles excluded(QStringLiteral(ROOT_DIR));
+    excluded.setWildcardsMatchSlash(false);
+    excluded.addExcludeFilePath(EXCLUDE_LIST_FILE);
+    assert_true(excluded.reloadExcludeFiles());
+    assert_int_equal(excluded._excludeFiles.value(ROOT_DIR).size(), 2);
+    assert_int_equal(excluded.fullPatternMatch("rootonly", ItemTypeFile), CSYNC_FILE_EXCLUDE_LIST);
+    assert_int_equal(excluded.fullPatternMatch("a~", ItemTypeFile), CSYNC_FILE_EXCLUDE_LIST);
+    assert_int_equal(excluded.fullPatternMatch("other", ItemTypeFile), CSYNC_NOT_EXCLUDED);
+#undef ROOT_DIR
+}
+
 static void check_csync_excluded_traversal_per_dir(void **)
 {
     assert_int_equal(check_file_traversal("/"), CSYNC_NOT_EXCLUDED);
@@ -707,6 +814,9 @@ int torture_run_tests(void)
         cmocka_unit_test_setup_teardown(T::check_csync_excluded_per_dir, T::setup, T::teardown),
         cmocka_unit_test_setup_teardown(T::check_csync_excluded_traversal, T::setup_init, T::teardown),
         cmocka_unit_test_setup_teardown(T::check_csync_excluded_traversal_per_dir, T::setup, T::teardown),
+        cmocka_unit_test_setup_teardown(T::check_csync_exclude_reload_incremental, T::setup, T::teardown),
+        cmocka_unit_test_setup_teardown(T::check_csync_exclude_deleted_in_tree_file, T::setup, T::teardown),
+        cmocka_unit_test_setup_teardown(T::check_csync_exclude_root_file_merged, T::setup, T::teardown),
         cmocka_unit_test_setup_teardown(T::check_csync_dir_only, T::setup, T::teardown),
         cmocka_unit_test_setup_teardown(T::check_csync_pathes, T::setup_init, T::teardown),
         cmocka_unit_test_setup_teardown(T::check_csync_wildcards, T::setup, T::teardown),
@@ -0,0 +1,160 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <cerrno>
+
+#include <QElapsedTimer>
+
+#include "csync_private.h"
+#include "vio/csync_vio.h"
+#include "vio/csync_vio_local.h"
+#include "vio/csync_vio_memory.h"
+
+#include "torture.h"
+
+struct statevar {
+    CSYNC *csync;
+    CSyncVioMemoryBackend *backend;
+};
+
+static int setup(void **state)
+{
+    auto *sv = new statevar;
+
+    sv->backend = new CSyncVioMemoryBackend;
+    sv->backend->mkdir("/memory/empty");
+    sv->backend->addFile("/memory/b.txt", 20, 2000);
+    sv->backend->addFile("/memory/a.txt", 10, 1000);
+    sv->backend->addFile("/memory/sub/c.txt", 30, 3000);
+    csync_vio_local_set_backend(sv->backend);
+
+    sv->csync = new CSYNC("/memory", new OCC::SyncJournalDb(""));
+    sv->csync->current = LOCAL_REPLICA;
+
+    *state = sv;
+    return 0;
+}
+
+static int teardown(void **state)
+{
+    auto *sv = (statevar *)*state;
+
+    csync_vio_local_set_backend(nullptr);
+    auto statedb = sv->csync->statedb;
+    delete sv->csync;
+    delete statedb;
+    delete sv->backend;
+    delete sv;
+
+    *state = nullptr;
+    return 0;
+}
+
+static void check_vio_memory_readdir(void **state)
+{
+    auto *sv = (statevar *)*state;
+
+    csync_vio_handle_t *dh = csync_vio_opendir(sv->csync, "/memory");
+    assert_non_null(dh);
+
+    /* Entries are listed by name */
+    auto fs = csync_vio_readdir(sv->csync, dh);
+    assert_non_null(fs.get());
+    assert_string_equal(fs->path.constData(), "a.txt");
+    assert_int_equal(fs->type, ItemTypeFile);
+    assert_int_equal(fs->size, 10);
+    assert_int_equal(fs->modtime, 1000);
+
+    fs = csync_vio_readdir(sv->csync, dh);
+    assert_string_equal(fs->path.constData(), "b.txt");
+
+    fs = csync_vio_readdir(sv->csync, dh);
+    assert_string_equal(fs->path.constData(), "empty");
+    assert_int_equal(fs->type, ItemTypeDirectory);
+
+    /* Removed after opendir: skipped like a vanished entry */
+    assert_true(sv->backend->remove("/memory/sub"));
+    fs = csync_vio_readdir(sv->csync, dh);
+    assert_null(fs.get());
+
+    assert_int_equal(csync_vio_closedir(sv->csync, dh), 0);
+}
+
+static void check_vio_memory_opendir_errors(void **state)
+{
+    auto *sv = (statevar *)*state;
+
+    assert_null(csync_vio_opendir(sv->csync, "/memory/missing"));
+    assert_int_equal(errno, ENOENT);
+
+    assert_null(csync_vio_opendir(sv->csync, "/memory/a.txt"));
+    assert_int_equal(errno, ENOTDIR);
+
+    assert_int_equal(csync_vio_closedir(sv->csync, nullptr), -1);
+}
+
+static void check_vio_memory_stat(void **state)
+{
+    auto *sv = (statevar *)*state;
+    csync_file_stat_t fs;
+
+    assert_int_equal(csync_vio_local_stat("/memory/sub/c.txt", &fs), 0);
+    assert_int_equal(fs.type, ItemTypeFile);
+    assert_int_equal(fs.size, 30);
+    assert_int_equal(fs.modtime, 3000);
+
+    csync_file_stat_t other;
+    assert_int_equal(csync_vio_local_stat("/memory/a.txt", &other), 0);
+    assert_true(other.inode != fs.inode);
+
+    /* Updating a file keeps its inode */
+    sv->backend->addFile("/memory/a.txt", 11, 1001);
+    assert_int_equal(csync_vio_local_stat("/memory/a.txt", &fs), 0);
+    assert_int_equal(fs.size, 11);
+    assert_true(other.inode == fs.inode);
+
+    assert_int_equal(csync_vio_local_stat("/memory/missing", &fs), -1);
+    assert_int_equal(errno, ENOENT);
+}
+
+static void check_vio_memory_latency(void **state)
+{
+    auto *sv = (statevar *)*state;
+    csync_file_stat_t fs;
+
+    sv->backend->resetCallCounts();
+    sv->backend->setLatency(CSyncVioMemoryBackend::Stat, std::chrono::milliseconds(20));
+
+    QElapsedTimer timer;
+    timer.start();
+    assert_int_equal(csync_vio_local_stat("/memory/a.txt", &fs), 0);
+    assert_int_equal(csync_vio_local_stat("/memory/b.txt", &fs), 0);
+    assert_true(timer.elapsed() >= 40);
+
+    assert_int_equal(sv->backend->callCount(CSyncVioMemoryBackend::Stat), 2);
+    assert_int_equal(sv->backend->callCount(CSyncVioMemoryBackend::OpenDir), 0);
+}
+
+int torture_run_tests(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(check_vio_memory_readdir, setup, teardown),
+        cmocka_unit_test_setup_teardown(check_vio_memory_opendir_errors, setup, teardown),
+        cmocka_unit_test_setup_teardown(check_vio_memory_stat, setup, teardown),
+        cmocka_unit_test_setup_teardown(check_vio_memory_latency, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, nullptr, nullptr);
+}
@@ -0,0 +1,534 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "davhandler.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QXmlStreamWriter>
+
+static const QString davNs = QStringLiteral("DAV:");
+static const QString ocNs = QStringLiteral("http://owncloud.org/ns");
+
+static QByteArray httpDate(qint64 secsSinceEpoch)
+{
+    return QLocale::c().toString(QDateTime::fromSecsSinceEpoch(secsSinceEpoch, Qt::UTC), "ddd, dd MMM yyyy HH:mm:ss 'GMT'").toLatin1();
+}
+
+static QByteArray quoted(const QByteArray &etag)
+{
+    return '"' + etag + '"';
+}
+
+static QString cleanPath(const QString &path)
+{
+    return path.split(QLatin1Char('/'), QString::SkipEmptyParts).join(QLatin1Char('/'));
+}
+
+DavHandler::DavHandler(const QString &user)
+    : _user(user)
+    , _uploads("ocupload")
+{
+}
+
+DavHandler::Area DavHandler::resolve(const QByteArray &encodedPath, QString *path, QString *base) const
+{
+    const QString decoded = QUrl::fromPercentEncoding(encodedPath);
+    const struct
+    {
+        QString prefix;
+        Area area;
+    } roots[] = {
+        { QStringLiteral("/remote.php/webdav"), Area::Files },
+        { QStringLiteral("/remote.php/dav/files/") + _user, Area::Files },
+        { QStringLiteral("/remote.php/dav/uploads/") + _user, Area::Uploads },
+    };
+    for (const auto &root : roots) {
+        const int start = decoded.indexOf(root.prefix);
+        if (start < 0)
+            continue;
+        const int end = start + root.prefix.size();
+        if (end < decoded.size() && decoded.at(end) != QLatin1Char('/'))
+            continue;
+        *path = cleanPath(decoded.mid(end));
+        if (base)
+            *base = decoded.left(end);
+        return root.area;
+    }
+    return Area::None;
+}
+
+HttpResponse DavHandler::handle(const HttpRequest &request)
+{
+    const QString decoded = QUrl::fromPercentEncoding(request.path);
+    if (decoded.endsWith(QLatin1String("/status.php")))
+        return status();
+    const int ocsStart = decoded.indexOf(QLatin1String("/ocs/v"));
+    if (ocsStart >= 0)
+        return ocs(request, decoded.mid(ocsStart));
+
+    QString path;
+    QString base;
+    const Area area = resolve(request.path, &path, &base);
+    if (area == Area::None)
+        return HttpResponse(404, "Not found\n");
+
+    DavStore &store = this->store(area);
+    const QByteArray &method = request.method;
+    if (method == "PROPFIND")
+        return propfind(request, store, path, base);
+    if (method == "PROPPATCH")
+        return proppatch(request);
+    if (method == "GET" || method == "HEAD")
+        return get(request, store, path);
+    if (method == "PUT")
+        return put(request, area, path);
+    if (method == "MKCOL")
+        return mkcol(store, path);
+    if (method == "DELETE")
+        return remove(store, path);
+    if (method == "MOVE")
+        return move(request, area, path);
+    if (method == "OPTIONS") {
+        HttpResponse response;
+        response.setHeader("DAV", "1, 3");
+        response.setHeader("Allow", "OPTIONS, GET, HEAD, PUT, DELETE, PROPFIND, PROPPATCH, MKCOL, MOVE");
+        return response;
+    }
+    return HttpResponse(501, "Not implemented\n");
+}
+
+HttpResponse DavHandler::status() const
+{
+    const QJsonObject status{
+        { QStringLiteral("installed"), true },
+        { QStringLiteral("maintenance"), false },
+        { QStringLiteral("needsDbUpgrade"), false },
+        { QStringLiteral("version"), QStringLiteral("20.0.0.0") },
+        { QStringLiteral("versionstring"), QStringLiteral("20.0.0") },
+        { QStringLiteral("edition"), QString() },
+        { QStringLiteral("productname"), QStringLiteral("Nextcloud") },
+        { QStringLiteral("extendedSupport"), false },
+    };
+    HttpResponse response(200, QJsonDocument(status).toJson(QJsonDocument::Compact));
+    response.setHeader("Content-Type", "application/json; charset=utf-8");
+    return response;
+}
+
+HttpResponse DavHandler::ocs(const HttpRequest &request, const QString &endpoint) const
+{
+    const bool v2 = endpoint.startsWith(QLatin1String("/ocs/v2.php/"));
+    const QString api = endpoint.mid(endpoint.indexOf(QLatin1String(".php/")) + 5);
+
+    QJsonObject data;
+    int status = v2 ? 200 : 100;
+    int httpStatus = 200;
+    if (request.method == "GET" && api == QLatin1String("cloud/capabilities")) {
+        QJsonObject dav;
+        if (_chunking)
+            dav.insert(QStringLiteral("chunking"), QStringLiteral("1.0"));
+        data = QJsonObject{
+            { QStringLiteral("version"), QJsonObject{
+                                             { QStringLiteral("major"), 20 },
+                                             { QStringLiteral("minor"), 0 },
+                                             { QStringLiteral("micro"), 0 },
+                                             { QStringLiteral("string"), QStringLiteral("20.0.0") },
+                                             { QStringLiteral("edition"), QString() },
+                                         } },
+            { QStringLiteral("capabilities"), QJsonObject{
+                                                  { QStringLiteral("core"), QJsonObject{
+                                                                                { QStringLiteral("pollinterval"), 60 },
+                                                                                { QStringLiteral("webdav-root"), QStringLiteral("remote.php/webdav") },
+                                                                            } },
+                                                  { QStringLiteral("dav"), dav },
+                                                  { QStringLiteral("files"), QJsonObject{
+                                                                                 { QStringLiteral("bigfilechunking"), true },
+                                                                                 { QStringLiteral("versioning"), true },
+                                                                             } },
+                                                  { QStringLiteral("checksums"), QJsonObject{
+                                                                                     { QStringLiteral("supportedTypes"), QJsonArray{ QStringLiteral("SHA1"), QStringLiteral("MD5") } },
+                                                                                     { QStringLiteral("preferredUploadType"), QStringLiteral("SHA1") },
+                                                                                 } },
+                                              } },
+        };
+    } else if (request.method == "GET" && api == QLatin1String("cloud/user")) {
+        data = QJsonObject{
+            { QStringLiteral("id"), _user },
+            { QStringLiteral("display-name"), _user },
+            { QStringLiteral("email"), QJsonValue() },
+        };
+    } else {
+        status = v2 ? 404 : 998;
+        httpStatus = v2 ? 404 : 200;
+    }
+
+    const QJsonObject reply{
+        { QStringLiteral("ocs"), QJsonObject{
+                                     { QStringLiteral("meta"), QJsonObject{
+                                                                   { QStringLiteral("status"), status < 300 ? QStringLiteral("ok") : QStringLiteral("failure") },
+                                                                   { QStringLiteral("statuscode"), status },
+                                                                   { QStringLiteral("message"), status < 300 ? QStringLiteral("OK") : QStringLiteral("Not found") },
+                                                               } },
+                                     { QStringLiteral("data"), data },
+                                 } },
+    };
+    HttpResponse response(httpStatus, QJsonDocument(reply).toJson(QJsonDocument::Compact));
+    response.setHeader("Content-Type", "application/json; charset=utf-8");
+    return response;
+}
+
+HttpResponse DavHandler::propfind(const HttpRequest &request, DavStore &store, const QString &path, const QString &base) const
+{
+    const DavStore::Node *node = store.find(path);
+    if (!node)
+        return HttpResponse(404, "Not found\n");
+
+    const QByteArray depthHeader = request.header("Depth");
+    const int depth = depthHeader == "0" ? 0 : depthHeader == "1" ? 1 : -1;
+
+    QByteArray payload;
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    xml.writeNamespace(davNs, "d");
+    xml.writeNamespace(ocNs, "oc");
+    xml.writeStartDocument();
+    xml.writeStartElement(davNs, QStringLiteral("multistatus"));
+
+    std::function<void(const DavStore::Node &, int)> writeResponse = [&](const DavStore::Node &node, int remainingDepth) {
+        QString href = base + QLatin1Char('/') + node.path();
+        if (node.isDir && !href.endsWith(QLatin1Char('/')))
+            href += QLatin1Char('/');
+
+        xml.writeStartElement(davNs, QStringLiteral("response"));
+        xml.writeTextElement(davNs, QStringLiteral("href"), QString::fromLatin1(QUrl::toPercentEncoding(href, "/")));
+        xml.writeStartElement(davNs, QStringLiteral("propstat"));
+        xml.writeStartElement(davNs, QStringLiteral("prop"));
+        if (node.isDir) {
+            xml.writeStartElement(davNs, QStringLiteral("resourcetype"));
+            xml.writeEmptyElement(davNs, QStringLiteral("collection"));
+            xml.writeEndElement(); // resourcetype
+            xml.writeTextElement(davNs, QStringLiteral("quota-available-bytes"), QStringLiteral("-3"));
+            xml.writeTextElement(davNs, QStringLiteral("quota-used-bytes"), QString::number(node.size()));
+            xml.writeTextElement(ocNs, QStringLiteral("permissions"), QStringLiteral("RDNVCK"));
+        } else {
+            xml.writeEmptyElement(davNs, QStringLiteral("resourcetype"));
+            xml.writeTextElement(davNs, QStringLiteral("getcontentlength"), QString::number(node.size()));
+            xml.writeTextElement(davNs, QStringLiteral("getcontenttype"), QStringLiteral("application/octet-stream"));
+            xml.writeTextElement(ocNs, QStringLiteral("permissions"), QStringLiteral("RDNVW"));
+            xml.writeTextElement(ocNs, QStringLiteral("checksums"), QString::fromLatin1(node.checksum));
+        }
+        xml.writeTextElement(davNs, QStringLiteral("getlastmodified"), QString::fromLatin1(httpDate(node.modtime)));
+        xml.writeTextElement(davNs, QStringLiteral("getetag"), QString::fromLatin1(quoted(node.etag)));
+        xml.writeTextElement(ocNs, QStringLiteral("id"), QString::fromLatin1(node.fileId));
+        xml.writeTextElement(ocNs, QStringLiteral("fileid"), QString::number(node.fileId.left(8).toLongLong()));
+        xml.writeTextElement(ocNs, QStringLiteral("size"), QString::number(node.size()));
+        if (!node.parent)
+            xml.writeEmptyElement(ocNs, QStringLiteral("data-fingerprint"));
+        xml.writeEmptyElement(ocNs, QStringLiteral("share-types"));
+        xml.writeEndElement(); // prop
+        xml.writeTextElement(davNs, QStringLiteral("status"), QStringLiteral("HTTP/1.1 200 OK"));
+        xml.writeEndElement(); // propstat
+        xml.writeEndElement(); // response
+
+        if (node.isDir && remainingDepth != 0) {
+            for (const auto &child : node.children)
+                writeResponse(*child.second, remainingDepth - 1);
+        }
+    };
+    writeResponse(*node, depth);
+
+    xml.writeEndElement(); // multistatus
+    xml.writeEndDocument();
+
+    HttpResponse response(207, payload);
+    response.setHeader("Content-Type", "application/xml; charset=utf-8");
+    return response;
+}
+
+HttpResponse DavHandler::proppatch(const HttpRequest &request) const
+{
+    // Accept every property without storing it
+    QByteArray payload;
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    xml.writeNamespace(davNs, "d");
+    xml.writeStartDocument();
+    xml.writeStartElement(davNs, QStringLiteral("multistatus"));
+    xml.writeStartElement(davNs, QStringLiteral("response"));
+    xml.writeTextElement(davNs, QStringLiteral("href"), QString::fromLatin1(request.path));
+    xml.writeStartElement(davNs, QStringLiteral("propstat"));
+    xml.writeEmptyElement(davNs, QStringLiteral("prop"));
+    xml.writeTextElement(davNs, QStringLiteral("status"), QStringLiteral("HTTP/1.1 200 OK"));
+    xml.writeEndElement(); // propstat
+    xml.writeEndElement(); // response
+    xml.writeEndElement(); // multistatus
+    xml.writeEndDocument();
+
+    HttpResponse response(207, payload);
+    response.setHeader("Content-Type", "application/xml; charset=utf-8");
+    return response;
+}
+
+void DavHandler::addFileHeaders(HttpResponse &response, const DavStore::Node &node)
+{
+    response.setHeader("ETag", quoted(node.etag));
+    response.setHeader("OC-ETag", quoted(node.etag));
+    response.setHeader("OC-FileId", node.fileId);
+}
+
+HttpResponse DavHandler::get(const HttpRequest &request, DavStore &store, const QString &path) const
+{
+    const DavStore::Node *node = store.find(path);
+    if (!node)
+        return HttpResponse(404, "Not found\n");
+    if (node->isDir)
+        return HttpResponse(405, "Cannot download a folder\n");
+
+    const QByteArray &content = node->content;
+    HttpResponse response(200);
+    addFileHeaders(response, *node);
+    response.setHeader("Last-Modified", httpDate(node->modtime));
+    response.setHeader("Content-Type", "application/octet-stream");
+    response.setHeader("Accept-Ranges", "bytes");
+    if (!node->checksum.isEmpty())
+        response.setHeader("OC-Checksum", node->checksum);
+
+    const QByteArray range = request.header("Range");
+    if (range.isEmpty()) {
+        response.body = content;
+        return response;
+    }
+
+    // Single ranges only: bytes=first-last, bytes=first- and bytes=-suffix
+    static const QRegularExpression rangeRe(QStringLiteral("^bytes=(\\d*)-(\\d*)$"));
+    const auto match = rangeRe.match(QString::fromLatin1(range));
+    qint64 first = 0;
+    qint64 last = content.size() - 1;
+    if (!match.hasMatch() || (match.capturedRef(1).isEmpty() && match.capturedRef(2).isEmpty()))
+        return HttpResponse(416, "Invalid range\n");
+    if (match.capturedRef(1).isEmpty()) {
+        first = std::max<qint64>(content.size() - match.capturedRef(2).toLongLong(), 0);
+    } else {
+        first = match.capturedRef(1).toLongLong();
+        if (!match.capturedRef(2).isEmpty())
+            last = std::min(last, match.capturedRef(2).toLongLong());
+    }
+    if (first >= content.size() || first > last) {
+        HttpResponse unsatisfiable(416, "Range not satisfiable\n");
+        unsatisfiable.setHeader("Content-Range", "bytes */" + QByteArray::number(content.size()));
+        return unsatisfiable;
+    }
+
+    response.status = 206;
+    response.setHeader("Content-Range", "bytes " + QByteArray::number(first) + '-' + QByteArray::number(last) + '/' + QByteArray::number(content.size()));
+    response.body = content.mid(int(first), int(last - first + 1));
+    return response;
+}
+
+bool DavHandler::preconditionsHold(const HttpRequest &request, const DavStore::Node *destination) const
+{
+    QByteArray expected = request.header("If-Match");
+    const QByteArray ifHeader = request.header("If");
+    if (expected.isEmpty() && !ifHeader.isEmpty()) {
+        // <destination> (["etag"])
+        static const QRegularExpression ifRe(QStringLiteral("\\(\\[(\"?[^\\]]*\"?)\\]\\)"));
+        const auto match = ifRe.match(QString::fromLatin1(ifHeader));
+        if (match.hasMatch())
+            expected = match.captured(1).toLatin1();
+    }
+    if (expected.isEmpty())
+        return true;
+    if (expected == "*")
+        return destination != nullptr;
+    return destination && quoted(destination->etag) == expected;
+}
+
+bool DavHandler::checksumMatches(const QByteArray &checksumHeader, const QByteArray &content)
+{
+    const int colon = checksumHeader.indexOf(':');
+    if (colon < 0)
+        return true;
+    const QByteArray type = checksumHeader.left(colon).toUpper();
+    const QByteArray expected = checksumHeader.mid(colon + 1).trimmed().toLower();
+    if (type == "SHA1")
+        return QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex() == expected;
+    if (type == "MD5")
+        return QCryptographicHash::hash(content, QCryptographicHash::Md5).toHex() == expected;
+    // Other types, like Adler32, are stored without verification
+    return true;
+}
+
+HttpResponse DavHandler::put(const HttpRequest &request, Area area, const QString &path)
+{
+    DavStore &store = this->store(area);
+    if (!store.parentFor(path))
+        return HttpResponse(409, "Parent folder does not exist\n");
+
+    DavStore::Node *existing = store.find(path);
+    if (existing && existing->isDir)
+        return HttpResponse(409, "A folder with that name exists\n");
+
+    if (area == Area::Uploads) {
+        // A chunk of a chunked upload
+        DavStore::Node *chunk = store.put(path, request.body, QDateTime::currentSecsSinceEpoch());
+        const QByteArray offset = request.header("OC-Chunk-Offset");
+        chunk->chunkOffset = offset.isEmpty() ? -1 : offset.toLongLong();
+        HttpResponse response(201);
+        addFileHeaders(response, *chunk);
+        return response;
+    }
+
+    if (!preconditionsHold(request, existing))
+        return HttpResponse(412, "The etag doesn't match\n");
+    const QByteArray checksum = request.header("OC-Checksum");
+    if (!checksumMatches(checksum, request.body))
+        return HttpResponse(400, "The computed checksum does not match the one received from the client\n");
+
+    const QByteArray mtime = request.header("X-OC-Mtime");
+    DavStore::Node *node = store.put(path, request.body, mtime.isEmpty() ? QDateTime::currentSecsSinceEpoch() : mtime.toLongLong());
+    node->checksum = checksum;
+
+    HttpResponse response(existing ? 204 : 201);
+    addFileHeaders(response, *node);
+    if (!mtime.isEmpty())
+        response.setHeader("X-OC-MTime", "accepted");
+    return response;
+}
+
+HttpResponse DavHandler::mkcol(DavStore &store, const QString &path)
+{
+    if (store.find(path))
+        return HttpResponse(405, "The resource already exists\n");
+    DavStore::Node *node = store.mkdir(path);
+    if (!node)
+        return HttpResponse(409, "Parent folder does not exist\n");
+    HttpResponse response(201);
+    response.setHeader("OC-FileId", node->fileId);
+    return response;
+}
+
+HttpResponse DavHandler::remove(DavStore &store, const QString &path)
+{
+    if (path.isEmpty())
+        return HttpResponse(403, "Cannot delete the root\n");
+    return store.remove(path) ? HttpResponse(204) : HttpResponse(404, "Not found\n");
+}
+
+HttpResponse DavHandler::move(const HttpRequest &request, Area area, const QString &path)
+{
+    QByteArray destinationHeader = request.header("Destination");
+    if (destinationHeader.startsWith("http"))
+        destinationHeader = QUrl::fromEncoded(destinationHeader).path(QUrl::FullyEncoded).toLatin1();
+    QString destination;
+    const Area destinationArea = resolve(destinationHeader, &destination);
+    if (destinationArea == Area::None || destination.isEmpty())
+        return HttpResponse(400, "Invalid destination\n");
+
+    if (area == Area::Uploads && destinationArea == Area::Files && path.endsWith(QLatin1String("/.file")))
+        return assembleChunks(request, path.left(path.size() - 6), destination);
+    if (area != destinationArea)
+        return HttpResponse(403, "Cannot move between these folders\n");
+
+    DavStore &store = this->store(area);
+    if (!store.find(path))
+        return HttpResponse(404, "Not found\n");
+    DavStore::Node *existing = store.find(destination);
+    if (existing && request.header("Overwrite") == "F")
+        return HttpResponse(412, "The destination exists\n");
+    if (!preconditionsHold(request, existing))
+        return HttpResponse(412, "The etag doesn't match\n");
+    if (!store.parentFor(destination))
+        return HttpResponse(409, "Parent folder does not exist\n");
+    if (existing && existing != store.find(path))
+        store.remove(destination);
+
+    DavStore::Node *node = store.move(path, destination);
+    if (!node)
+        return HttpResponse(403, "Cannot move a folder into itself\n");
+    HttpResponse response(existing ? 204 : 201);
+    addFileHeaders(response, *node);
+    return response;
+}
+
+HttpResponse DavHandler::assembleChunks(const HttpRequest &request, const QString &uploadPath, const QString &destination)
+{
+    DavStore::Node *upload = _uploads.find(uploadPath);
+    if (!upload || !upload->isDir)
+        return HttpResponse(404, "Upload not found\n");
+    if (!_files.parentFor(destination))
+        return HttpResponse(409, "Parent folder does not exist\n");
+    DavStore::Node *existing = _files.find(destination);
+    if (existing && existing->isDir)
+        return HttpResponse(409, "A folder with that name exists\n");
+    if (!preconditionsHold(request, existing))
+        return HttpResponse(412, "The etag doesn't match\n");
+
+    qint64 chunkBytes = 0;
+    for (const auto &chunk : upload->children)
+        chunkBytes += chunk.second->content.size();
+    const QByteArray totalHeader = request.header("OC-Total-Length");
+    const qint64 total = totalHeader.isEmpty() ? chunkBytes : totalHeader.toLongLong();
+
+    QByteArray content(int(total), '\0');
+    // With delta uploads, the ranges that didn't change come from the current version
+    const QByteArray deltaRanges = request.header("OC-Delta-Ranges");
+    if (!deltaRanges.isEmpty()) {
+        if (!existing)
+            return HttpResponse(400, "Delta upload without a base version\n");
+        for (const auto &range : deltaRanges.split(',')) {
+            const auto bounds = range.split('-');
+            const qint64 first = bounds.value(0).toLongLong();
+            const qint64 last = bounds.value(1).toLongLong();
+            if (bounds.size() != 2 || first > last || last >= existing->content.size() || last >= total)
+                return HttpResponse(400, "Invalid delta range\n");
+            memcpy(content.data() + first, existing->content.constData() + first, size_t(last - first + 1));
+        }
+    }
+
+    // Chunks are ordered by name, the client pads the chunk numbers
+    qint64 offset = 0;
+    for (const auto &entry : upload->children) {
+        const DavStore::Node &chunk = *entry.second;
+        if (chunk.chunkOffset >= 0)
+            offset = chunk.chunkOffset;
+        if (offset + chunk.content.size() > total)
+            return HttpResponse(400, "Chunks exceed the total length\n");
+        memcpy(content.data() + offset, chunk.content.constData(), size_t(chunk.content.size()));
+        offset += chunk.content.size();
+    }
+    if (deltaRanges.isEmpty() && chunkBytes != total)
+        return HttpResponse(400, "Chunks don't add up to the total length\n");
+
+    const QByteArray checksum = request.header("OC-Checksum");
+    if (!checksumMatches(checksum, content))
+        return HttpResponse(400, "The computed checksum does not match the one received from the client\n");
+
+    const QByteArray mtime = request.header("X-OC-Mtime");
+    DavStore::Node *node = _files.put(destination, content, mtime.isEmpty() ? QDateTime::currentSecsSinceEpoch() : mtime.toLongLong());
+    node->checksum = checksum;
+    _uploads.remove(uploadPath);
+
+    HttpResponse response(existing ? 204 : 201);
+    addFileHeaders(response, *node);
+    if (!mtime.isEmpty())
+        response.setHeader("X-OC-MTime", "accepted");
+    return response;
+}
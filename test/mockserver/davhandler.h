@@ -0,0 +1,79 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "davstore.h"
+#include "httpserver.h"
+
+/**
+ * @brief Answers requests like a Nextcloud server would
+ *
+ * Serves status.php, the OCS capabilities and user endpoints and WebDAV on
+ * remote.php/webdav, remote.php/dav/files/<user> and, for chunked uploads,
+ * remote.php/dav/uploads/<user>. Any path prefix before these is accepted,
+ * so the server works for account urls with a sub folder. Credentials are
+ * not checked.
+ *
+ * Supported WebDAV methods: PROPFIND (depth 0, 1 and infinity), PROPPATCH,
+ * GET and HEAD (with single byte ranges), PUT, MKCOL, MOVE and DELETE.
+ * Uploads verify SHA1 and MD5 OC-Checksum headers; chunked uploads are
+ * assembled by the MOVE of the upload folder's .file.
+ */
+class DavHandler
+{
+public:
+    explicit DavHandler(const QString &user = QStringLiteral("admin"));
+
+    HttpResponse handle(const HttpRequest &request);
+
+    DavStore &files() { return _files; }
+    DavStore &uploads() { return _uploads; }
+
+    /** Whether chunked uploads are advertised in the capabilities. */
+    void setChunking(bool enabled) { _chunking = enabled; }
+
+private:
+    enum class Area {
+        None,
+        Files,
+        Uploads
+    };
+
+    // Maps a request path to the store it addresses and the path inside it;
+    // base receives the decoded request path up to the store's root
+    Area resolve(const QByteArray &encodedPath, QString *path, QString *base = nullptr) const;
+
+    HttpResponse status() const;
+    HttpResponse ocs(const HttpRequest &request, const QString &endpoint) const;
+
+    HttpResponse propfind(const HttpRequest &request, DavStore &store, const QString &path, const QString &base) const;
+    HttpResponse proppatch(const HttpRequest &request) const;
+    HttpResponse get(const HttpRequest &request, DavStore &store, const QString &path) const;
+    HttpResponse put(const HttpRequest &request, Area area, const QString &path);
+    HttpResponse mkcol(DavStore &store, const QString &path);
+    HttpResponse remove(DavStore &store, const QString &path);
+    HttpResponse move(const HttpRequest &request, Area area, const QString &path);
+    HttpResponse assembleChunks(const HttpRequest &request, const QString &uploadPath, const QString &destination);
+
+    // Checks the If and If-Match preconditions against the destination
+    bool preconditionsHold(const HttpRequest &request, const DavStore::Node *destination) const;
+    static bool checksumMatches(const QByteArray &checksumHeader, const QByteArray &content);
+    static void addFileHeaders(HttpResponse &response, const DavStore::Node &node);
+
+    DavStore &store(Area area) { return area == Area::Uploads ? _uploads : _files; }
+
+    QString _user;
+    bool _chunking = true;
+    DavStore _files;
+    DavStore _uploads;
+};
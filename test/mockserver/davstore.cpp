@@ -0,0 +1,194 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "davstore.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+static QStringList splitPath(const QString &path)
+{
+    return path.split(QLatin1Char('/'), QString::SkipEmptyParts);
+}
+
+qint64 DavStore::Node::size() const
+{
+    if (!isDir)
+        return content.size();
+    qint64 total = 0;
+    for (const auto &child : children)
+        total += child.second->size();
+    return total;
+}
+
+QString DavStore::Node::path() const
+{
+    if (!parent)
+        return QString();
+    const QString parentPath = parent->path();
+    return parentPath.isEmpty() ? name : parentPath + QLatin1Char('/') + name;
+}
+
+DavStore::DavStore(const QByteArray &instanceId)
+    : _instanceId(instanceId)
+    , _root(new Node)
+{
+    _root->fileId = QByteArray::number(_nextFileId++).rightJustified(8, '0') + _instanceId;
+    touch(_root.get());
+}
+
+DavStore::Node *DavStore::find(const QString &path) const
+{
+    Node *node = _root.get();
+    for (const auto &part : splitPath(path)) {
+        auto it = node->children.find(part);
+        if (it == node->children.end())
+            return nullptr;
+        node = it->second.get();
+    }
+    return node;
+}
+
+DavStore::Node *DavStore::parentFor(const QString &path) const
+{
+    QStringList parts = splitPath(path);
+    if (parts.isEmpty())
+        return nullptr;
+    parts.removeLast();
+    Node *parent = find(parts.join(QLatin1Char('/')));
+    return parent && parent->isDir ? parent : nullptr;
+}
+
+DavStore::Node *DavStore::createChild(Node *parent, const QString &name, bool isDir)
+{
+    auto &slot = parent->children[name];
+    slot.reset(new Node);
+    slot->name = name;
+    slot->isDir = isDir;
+    slot->parent = parent;
+    slot->modtime = QDateTime::currentSecsSinceEpoch();
+    slot->fileId = QByteArray::number(_nextFileId++).rightJustified(8, '0') + _instanceId;
+    return slot.get();
+}
+
+void DavStore::touch(Node *node)
+{
+    for (; node; node = node->parent)
+        node->etag = QByteArray::number(_nextEtag++, 16);
+}
+
+DavStore::Node *DavStore::mkdir(const QString &path)
+{
+    Node *parent = parentFor(path);
+    if (!parent || find(path))
+        return nullptr;
+    Node *node = createChild(parent, splitPath(path).last(), true);
+    touch(node);
+    return node;
+}
+
+DavStore::Node *DavStore::mkpath(const QString &path)
+{
+    Node *node = _root.get();
+    for (const auto &part : splitPath(path)) {
+        auto it = node->children.find(part);
+        if (it == node->children.end()) {
+            node = createChild(node, part, true);
+            touch(node);
+        } else {
+            node = it->second.get();
+        }
+    }
+    return node;
+}
+
+DavStore::Node *DavStore::put(const QString &path, const QByteArray &content, qint64 modtime)
+{
+    Node *parent = parentFor(path);
+    if (!parent)
+        return nullptr;
+    const QString name = splitPath(path).last();
+    auto it = parent->children.find(name);
+    Node *node = nullptr;
+    if (it != parent->children.end() && !it->second->isDir) {
+        // Overwriting keeps the file id, like the server does
+        node = it->second.get();
+    } else if (it != parent->children.end()) {
+        return nullptr;
+    } else {
+        node = createChild(parent, name, false);
+    }
+    node->content = content;
+    node->modtime = modtime;
+    node->checksum.clear();
+    touch(node);
+    return node;
+}
+
+bool DavStore::remove(const QString &path)
+{
+    Node *node = find(path);
+    if (!node || !node->parent)
+        return false;
+    Node *parent = node->parent;
+    parent->children.erase(node->name);
+    touch(parent);
+    return true;
+}
+
+DavStore::Node *DavStore::move(const QString &from, const QString &to)
+{
+    Node *source = find(from);
+    Node *targetParent = parentFor(to);
+    if (!source || !source->parent || !targetParent)
+        return nullptr;
+    for (Node *ancestor = targetParent; ancestor; ancestor = ancestor->parent) {
+        if (ancestor == source)
+            return nullptr; // into itself
+    }
+
+    std::unique_ptr<Node> moved = std::move(source->parent->children[source->name]);
+    source->parent->children.erase(source->name);
+    touch(source->parent);
+
+    moved->name = splitPath(to).last();
+    moved->parent = targetParent;
+    Node *result = moved.get();
+    targetParent->children[moved->name] = std::move(moved);
+    touch(result);
+    return result;
+}
+
+bool DavStore::importDirectory(const QString &localPath, const QString &path)
+{
+    QDir dir(localPath);
+    if (!dir.exists())
+        return false;
+    mkpath(path);
+    const auto entries = dir.entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+    for (const auto &entry : entries) {
+        const QString childPath = path.isEmpty() ? entry.fileName() : path + QLatin1Char('/') + entry.fileName();
+        if (entry.isDir()) {
+            if (!importDirectory(entry.absoluteFilePath(), childPath))
+                return false;
+            continue;
+        }
+        QFile file(entry.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        put(childPath, file.readAll(), entry.lastModified().toSecsSinceEpoch());
+    }
+    return true;
+}
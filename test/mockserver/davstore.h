@@ -0,0 +1,78 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <map>
+#include <memory>
+
+/**
+ * @brief An in-memory file tree as the mock server's storage
+ *
+ * Like a Nextcloud server, every change gives the file a new etag and
+ * also changes the etags of all its parent folders, so clients can skip
+ * unchanged subtrees during discovery. Paths are relative to the root and
+ * '/' separated.
+ */
+class DavStore
+{
+public:
+    struct Node
+    {
+        QString name;
+        bool isDir = true;
+        QByteArray content;
+        qint64 modtime = 0;
+        QByteArray etag;
+        QByteArray fileId;
+        QByteArray checksum; // as sent in OC-Checksum
+        qint64 chunkOffset = -1; // only for chunks of a chunked upload
+        std::map<QString, std::unique_ptr<Node>> children;
+        Node *parent = nullptr;
+
+        qint64 size() const;
+        QString path() const;
+    };
+
+    explicit DavStore(const QByteArray &instanceId = "ocmock");
+
+    Node *root() const { return _root.get(); }
+    Node *find(const QString &path) const;
+
+    /** The parent folder a new item at path would go into, null if it doesn't exist. */
+    Node *parentFor(const QString &path) const;
+
+    Node *mkdir(const QString &path);
+    Node *put(const QString &path, const QByteArray &content, qint64 modtime);
+    bool remove(const QString &path);
+    Node *move(const QString &from, const QString &to);
+
+    /** Gives the node and all its parents new etags. */
+    void touch(Node *node);
+
+    /** Creates the missing folders of path and returns the last one. */
+    Node *mkpath(const QString &path);
+
+    /** Copies a local directory into the store. */
+    bool importDirectory(const QString &localPath, const QString &path = QString());
+
+private:
+    Node *createChild(Node *parent, const QString &name, bool isDir);
+
+    QByteArray _instanceId;
+    std::unique_ptr<Node> _root;
+    quint64 _nextFileId = 1;
+    quint64 _nextEtag = 1;
+};
@@ -14,51 +14,256 @@
 
 #include "httpserver.h"
 
-HttpServer::HttpServer(quint16 port, QObject* parent)
+#include <QDateTime>
+#include <QLocale>
+#include <QTcpSocket>
+#include <QUrl>
+
+static const int throttleIntervalMsecs = 100;
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 207: return "Multi-Status";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 412: return "Precondition Failed";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 507: return "Insufficient Storage";
+    default: return "Unknown";
+    }
+}
+
+HttpResponse::HttpResponse(int status, const QByteArray &body)
+    : status(status)
+    , body(body)
+{
+}
+
+void HttpResponse::setHeader(const QByteArray &name, const QByteArray &value)
+{
+    for (auto &header : headers) {
+        if (qstricmp(header.first.constData(), name.constData()) == 0) {
+            header.second = value;
+            return;
+        }
+    }
+    headers.append(qMakePair(name, value));
+}
+
+HttpServer::HttpServer(Handler handler, QObject *parent)
     : QTcpServer(parent)
+    , _handler(std::move(handler))
+{
+}
+
+void HttpServer::incomingConnection(qintptr socketDescriptor)
 {
-    listen(QHostAddress::Any, port);
+    new HttpConnection(this, socketDescriptor);
 }
 
-void HttpServer::readClient()
+bool HttpServer::injectError(const HttpRequest &request, HttpResponse *response)
 {
-    QTcpSocket* socket = (QTcpSocket*)sender();
-    if (socket->canReadLine()) {
-        QStringList tokens = QString(socket->readLine()).split(QRegExp("[ \r\n][ \r\n]*"));
-        if (tokens[0] == "GET") {
-            QTextStream os(socket);
-            os.setAutoDetectUnicode(true);
-            os << "HTTP/1.0 200 Ok\r\n"
-                "Content-Type: text/html; charset=\"utf-8\"\r\n"
-                "\r\n"
-                "<h1>Nothing to see here</h1>\n"
-                << QDateTime::currentDateTimeUtc().toString() << "\n";
-            socket->close();
+    const QString path = QUrl::fromPercentEncoding(request.path);
+    for (const auto &rule : qAsConst(_errorRules)) {
+        if (!rule.method.isEmpty() && rule.method != request.method)
+            continue;
+        if (!rule.path.match(path).hasMatch())
+            continue;
+        *response = HttpResponse(rule.status, "Injected error\n");
+        return true;
+    }
+    if (_errorRate > 0 && _random.generateDouble() < _errorRate) {
+        *response = HttpResponse(503, "Injected random error\n");
+        return true;
+    }
+    return false;
+}
 
-            QtServiceBase::instance()->logMessage("Wrote to client");
+HttpResponse HttpServer::handle(const HttpRequest &request)
+{
+    ++_requestCount;
+    HttpResponse response;
+    if (!injectError(request, &response))
+        response = _handler(request);
+    if (request.method == "HEAD")
+        response.headOnly = true;
+    return response;
+}
 
-            if (socket->state() == QTcpSocket::UnconnectedState) {
-                delete socket;
-                QtServiceBase::instance()->logMessage("Connection closed");
-            }
-        }
+HttpConnection::HttpConnection(HttpServer *server, qintptr socketDescriptor)
+    : QObject(server)
+    , _server(server)
+    , _socket(new QTcpSocket(this))
+{
+    _socket->setSocketDescriptor(socketDescriptor);
+    connect(_socket, &QTcpSocket::readyRead, this, &HttpConnection::slotReadyRead);
+    connect(_socket, &QTcpSocket::bytesWritten, this, &HttpConnection::writeSome);
+    connect(_socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+
+    _throttle.setInterval(throttleIntervalMsecs);
+    connect(&_throttle, &QTimer::timeout, this, &HttpConnection::slotTick);
+    if (_server->_bytesPerSecond > 0) {
+        // Let TCP flow control slow down the client instead of buffering everything
+        _socket->setReadBufferSize(tickBudget());
+        _readBudget = _writeBudget = tickBudget();
+        _throttle.start();
     }
 }
-void HttpServer::discardClient()
+
+qint64 HttpConnection::tickBudget() const
 {
-    QTcpSocket* socket = (QTcpSocket*)sender();
-    socket->deleteLater();
+    return std::max<qint64>(_server->_bytesPerSecond * throttleIntervalMsecs / 1000, 1);
+}
 
-    QtServiceBase::instance()->logMessage("Connection closed");
+void HttpConnection::slotTick()
+{
+    _readBudget = _writeBudget = tickBudget();
+    slotReadyRead();
+    writeSome();
 }
 
+void HttpConnection::slotReadyRead()
+{
+    if (_throttle.isActive()) {
+        const QByteArray data = _socket->read(_readBudget);
+        _readBudget -= data.size();
+        _input += data;
+    } else {
+        _input += _socket->readAll();
+    }
+    processInput();
+}
 
-void HttpServer::incomingConnection(int socket)
+void HttpConnection::processInput()
 {
-    if (disabled)
+    if (_busy)
+        return;
+    if (!_haveHead && !parseHead())
         return;
-    QTcpSocket* s = new QTcpSocket(this);
-    connect(s, SIGNAL(readyRead()), this, SLOT(readClient()));
-    connect(s, SIGNAL(disconnected()), this, SLOT(discardClient()));
-    s->setSocketDescriptor(socket);
+    if (_input.size() < _bodyLength)
+        return;
+    requestComplete();
+}
+
+bool HttpConnection::parseHead()
+{
+    const int end = _input.indexOf("\r\n\r\n");
+    if (end < 0)
+        return false;
+
+    const QList<QByteArray> lines = _input.left(end).split('\n');
+    _input.remove(0, end + 4);
+
+    _request = HttpRequest();
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3) {
+        _closeAfterResponse = true;
+        _busy = true;
+        sendResponse(HttpResponse(400, "Malformed request line\n"));
+        return false;
+    }
+    _request.method = requestLine.at(0);
+    const QByteArray &target = requestLine.at(1);
+    const int queryStart = target.indexOf('?');
+    _request.path = queryStart < 0 ? target : target.left(queryStart);
+    _request.query = queryStart < 0 ? QByteArray() : target.mid(queryStart + 1);
+    _closeAfterResponse = requestLine.at(2) == "HTTP/1.0";
+
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray &line = lines.at(i);
+        const int colon = line.indexOf(':');
+        if (colon <= 0)
+            continue;
+        _request.headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+    }
+
+    if (_request.header("Connection").toLower() == "close")
+        _closeAfterResponse = true;
+    _bodyLength = _request.header("Content-Length").toLongLong();
+    _haveHead = true;
+
+    if (_request.header("Transfer-Encoding").toLower() == "chunked") {
+        _closeAfterResponse = true;
+        _busy = true;
+        sendResponse(HttpResponse(411, "Chunked request bodies are not supported\n"));
+        return false;
+    }
+    return true;
+}
+
+void HttpConnection::requestComplete()
+{
+    _request.body = _input.left(_bodyLength);
+    _input.remove(0, _bodyLength);
+    _haveHead = false;
+    _busy = true;
+
+    const HttpResponse response = _server->handle(_request);
+    if (_server->_latencyMsecs > 0) {
+        QTimer::singleShot(_server->_latencyMsecs, this, [this, response] { sendResponse(response); });
+    } else {
+        sendResponse(response);
+    }
+}
+
+void HttpConnection::sendResponse(const HttpResponse &response)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    for (const auto &header : response.headers)
+        head += header.first + ": " + header.second + "\r\n";
+    head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    head += "Date: " + QLocale::c().toString(QDateTime::currentDateTimeUtc(), "ddd, dd MMM yyyy HH:mm:ss 'GMT'").toLatin1() + "\r\n";
+    head += _closeAfterResponse ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    head += "\r\n";
+
+    _output += head;
+    if (!response.headOnly)
+        _output += response.body;
+    writeSome();
+}
+
+void HttpConnection::writeSome()
+{
+    if (!_output.isEmpty()) {
+        qint64 chunk = _output.size();
+        if (_throttle.isActive())
+            chunk = std::min(chunk, _writeBudget);
+        if (chunk <= 0)
+            return;
+        // Only hand out more once the socket sent what it has
+        if (_socket->bytesToWrite() > 0 && _throttle.isActive())
+            return;
+        const qint64 written = _socket->write(_output.constData(), chunk);
+        if (written > 0) {
+            _output.remove(0, int(written));
+            _writeBudget -= written;
+        }
+        if (!_output.isEmpty())
+            return;
+    }
+
+    if (!_busy || _socket->bytesToWrite() > 0)
+        return;
+
+    _busy = false;
+    if (_closeAfterResponse) {
+        _socket->disconnectFromHost();
+        return;
+    }
+    // The client may have sent the next request already
+    processInput();
 }
@@ -12,16 +12,129 @@
  * for more details.
  */
 
+#pragma once
+
+#include <QHash>
+#include <QRandomGenerator>
+#include <QRegularExpression>
 #include <QTcpServer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+class QTcpSocket;
+
+struct HttpRequest
+{
+    QByteArray method;
+    QByteArray path; // percent encoded, without the query
+    QByteArray query;
+    QHash<QByteArray, QByteArray> headers; // names in lower case
+    QByteArray body;
+
+    QByteArray header(const QByteArray &name) const { return headers.value(name.toLower()); }
+};
+
+struct HttpResponse
+{
+    HttpResponse(int status = 200, const QByteArray &body = QByteArray());
+
+    void setHeader(const QByteArray &name, const QByteArray &value);
 
+    int status;
+    QVector<QPair<QByteArray, QByteArray>> headers;
+    QByteArray body;
+    bool headOnly = false; // send the headers of the body, but not the body
+};
+
+/**
+ * @brief A minimal HTTP/1.1 server with fault injection
+ *
+ * Parses requests with a Content-Length body and hands them to the handler
+ * one at a time per connection. Keep-alive connections are supported.
+ *
+ * Every response can be delayed by a fixed latency and sent with a limited
+ * bandwidth; request bodies are read with the same limit. Error rules and a
+ * random error rate make requests fail before they reach the handler.
+ */
 class HttpServer : public QTcpServer
- {
-     Q_OBJECT
- public:
-    HttpServer(qint16 port, QObject* parent = 0);
-    void incomingConnection(int socket);
-
- private slots:
-     void readClient();
-     void discardClient();
- };
+{
+    Q_OBJECT
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest &)>;
+
+    struct ErrorRule
+    {
+        QRegularExpression path; // matched against the decoded path
+        QByteArray method; // empty matches all methods
+        int status;
+    };
+
+    explicit HttpServer(Handler handler, QObject *parent = nullptr);
+
+    void setLatency(int msecs) { _latencyMsecs = msecs; }
+    void setBandwidth(qint64 bytesPerSecond) { _bytesPerSecond = bytesPerSecond; }
+    /** Fraction of requests, between 0 and 1, that randomly fail with 503. */
+    void setErrorRate(double rate) { _errorRate = rate; }
+    void setSeed(quint32 seed) { _random.seed(seed); }
+    void addErrorRule(const ErrorRule &rule) { _errorRules.append(rule); }
+    void clearErrorRules() { _errorRules.clear(); }
+
+    quint64 requestCount() const { return _requestCount; }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    friend class HttpConnection;
+
+    // Whether the request fails instead of being handled, fills in the error response
+    bool injectError(const HttpRequest &request, HttpResponse *response);
+    HttpResponse handle(const HttpRequest &request);
+
+    Handler _handler;
+    int _latencyMsecs = 0;
+    qint64 _bytesPerSecond = 0;
+    double _errorRate = 0;
+    QRandomGenerator _random;
+    QVector<ErrorRule> _errorRules;
+    quint64 _requestCount = 0;
+};
+
+/**
+ * @brief One client connection of the HttpServer
+ */
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+public:
+    HttpConnection(HttpServer *server, qintptr socketDescriptor);
+
+private slots:
+    void slotReadyRead();
+    void slotTick();
+
+private:
+    void processInput();
+    bool parseHead();
+    void requestComplete();
+    void sendResponse(const HttpResponse &response);
+    void writeSome();
+    qint64 tickBudget() const;
+
+    HttpServer *_server;
+    QTcpSocket *_socket;
+    QTimer _throttle; // drives reading and writing while the bandwidth is limited
+
+    QByteArray _input;
+    bool _haveHead = false;
+    bool _busy = false; // a request is being answered
+    qint64 _bodyLength = 0;
+    HttpRequest _request;
+    bool _closeAfterResponse = false;
+
+    QByteArray _output;
+    qint64 _readBudget = 0;
+    qint64 _writeBudget = 0;
+};
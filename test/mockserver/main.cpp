@@ -12,13 +12,73 @@
  * for more details.
  */
 
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QHostAddress>
 
+#include <cstdio>
+
+#include "davhandler.h"
 #include "httpserver.h"
 
-int main(int argc, char* argv[])
+int main(int argc, char *argv[])
 {
-  QCoreApplication app(argc, argv);
-  HttpServer server;
-  return app.exec();
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("mockserver"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("In-memory WebDAV server for end-to-end and performance tests of the sync client"));
+    parser.addHelpOption();
+    const QCommandLineOption portOption(QStringLiteral("port"), QStringLiteral("Port to listen on."), QStringLiteral("port"), QStringLiteral("8080"));
+    const QCommandLineOption userOption(QStringLiteral("user"), QStringLiteral("User name in the dav paths."), QStringLiteral("user"), QStringLiteral("admin"));
+    const QCommandLineOption latencyOption(QStringLiteral("latency"), QStringLiteral("Delay of every response in milliseconds."), QStringLiteral("msecs"), QStringLiteral("0"));
+    const QCommandLineOption bandwidthOption(QStringLiteral("bandwidth"), QStringLiteral("Bandwidth limit in KiB/s per connection, 0 for none."), QStringLiteral("kibps"), QStringLiteral("0"));
+    const QCommandLineOption errorRateOption(QStringLiteral("error-rate"), QStringLiteral("Percentage of requests failing with 503."), QStringLiteral("percent"), QStringLiteral("0"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Seed for the random errors."), QStringLiteral("seed"));
+    const QCommandLineOption failOption(QStringLiteral("fail"), QStringLiteral("Fail requests whose path matches REGEX with STATUS, optionally only for METHOD. Can be repeated."), QStringLiteral("STATUS:REGEX[:METHOD]"));
+    const QCommandLineOption importOption(QStringLiteral("import"), QStringLiteral("Copy a local directory into the server's root."), QStringLiteral("dir"));
+    const QCommandLineOption noChunkingOption(QStringLiteral("no-chunking"), QStringLiteral("Don't advertise chunked uploads."));
+    parser.addOptions({ portOption, userOption, latencyOption, bandwidthOption, errorRateOption, seedOption, failOption, importOption, noChunkingOption });
+    parser.process(app);
+
+    DavHandler dav(parser.value(userOption));
+    dav.setChunking(!parser.isSet(noChunkingOption));
+    if (parser.isSet(importOption) && !dav.files().importDirectory(parser.value(importOption))) {
+        fprintf(stderr, "Could not import %s\n", qPrintable(parser.value(importOption)));
+        return 1;
+    }
+
+    HttpServer server([&dav](const HttpRequest &request) { return dav.handle(request); });
+    server.setLatency(parser.value(latencyOption).toInt());
+    server.setBandwidth(parser.value(bandwidthOption).toLongLong() * 1024);
+    server.setErrorRate(parser.value(errorRateOption).toDouble() / 100);
+    if (parser.isSet(seedOption))
+        server.setSeed(parser.value(seedOption).toUInt());
+    for (const auto &fail : parser.values(failOption)) {
+        // The regex may contain ':' itself, so the method is only split off when it looks like one
+        const int first = fail.indexOf(QLatin1Char(':'));
+        bool ok = false;
+        HttpServer::ErrorRule rule;
+        rule.status = fail.left(first).toInt(&ok);
+        if (first < 0 || !ok) {
+            fprintf(stderr, "Invalid --fail rule %s\n", qPrintable(fail));
+            return 1;
+        }
+        QString pattern = fail.mid(first + 1);
+        const int last = pattern.lastIndexOf(QLatin1Char(':'));
+        if (last >= 0 && pattern.mid(last + 1).contains(QRegularExpression(QStringLiteral("^[A-Z]+$")))) {
+            rule.method = pattern.mid(last + 1).toLatin1();
+            pattern.truncate(last);
+        }
+        rule.path = QRegularExpression(pattern);
+        server.addErrorRule(rule);
+    }
+
+    if (!server.listen(QHostAddress::Any, quint16(parser.value(portOption).toUInt()))) {
+        fprintf(stderr, "Could not listen: %s\n", qPrintable(server.errorString()));
+        return 1;
+    }
+    printf("Serving http://localhost:%d/ for user %s\n", server.serverPort(), qPrintable(parser.value(userOption)));
+    fflush(stdout);
+    return app.exec();
 }
@@ -14,6 +14,8 @@
 #include "common/syncjournaldb.h"
 
 #include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkReply>
 #include <QMap>
 #include <QtTest>
@@ -462,6 +464,105 @@ public:
     qint64 readData(char *, qint64) override { return 0; }
 };
 
+class FakeBulkUploadReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    QByteArray payload;
+
+    FakeBulkUploadReply(FileInfo &remoteRootFileInfo, const QHash<QString, int> &errorPaths,
+        QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent)
+        : QNetworkReply{parent}
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+
+        const QByteArray contentType = request.rawHeader("Content-Type");
+        const int boundaryIndex = contentType.indexOf("boundary=");
+        Q_ASSERT(contentType.startsWith("multipart/related") && boundaryIndex > 0);
+        const QByteArray delimiter = "--" + contentType.mid(boundaryIndex + qstrlen("boundary="));
+
+        QJsonObject results;
+        int pos = body.indexOf(delimiter);
+        while (pos >= 0 && body.mid(pos + delimiter.size(), 2) != "--") {
+            const int headersStart = pos + delimiter.size() + 2;
+            const int headersEnd = body.indexOf("\r\n\r\n", headersStart);
+            Q_ASSERT(headersEnd > 0);
+            QMap<QByteArray, QByteArray> headers;
+            for (const auto &line : body.mid(headersStart, headersEnd - headersStart).split('\n')) {
+                const int colon = line.indexOf(':');
+                headers[line.left(colon).trimmed().toLower()] = line.mid(colon + 1).trimmed();
+            }
+            const int size = headers["content-length"].toInt();
+            const QByteArray data = body.mid(headersEnd + 4, size);
+            Q_ASSERT(data.size() == size);
+            Q_ASSERT(headers["x-file-md5"] == QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+            ++partCount;
+
+            const QString remotePath = QString::fromUtf8(headers["x-file-path"]);
+            const QString fileName = PathComponents(remotePath).join('/');
+            QJsonObject result;
+            if (errorPaths.contains(fileName)) {
+                result[QStringLiteral("error")] = true;
+                result[QStringLiteral("status")] = errorPaths[fileName];
+                result[QStringLiteral("message")] = QStringLiteral("Fake bulk upload error");
+            } else {
+                FileInfo *fileInfo = remoteRootFileInfo.find(fileName);
+                if (fileInfo) {
+                    fileInfo->size = size;
+                    fileInfo->contentChar = data.at(0);
+                } else {
+                    fileInfo = remoteRootFileInfo.create(fileName, size, data.at(0));
+                }
+                fileInfo->lastModified = OCC::Utility::qDateTimeFromTime_t(headers["x-file-mtime"].toLongLong());
+                fileInfo->checksums = headers["oc-checksum"];
+                remoteRootFileInfo.find(fileName, /*invalidateEtags=*/true);
+                result[QStringLiteral("error")] = false;
+                result[QStringLiteral("etag")] = fileInfo->etag;
+                result[QStringLiteral("fileid")] = QString::fromUtf8(fileInfo->fileId);
+            }
+            results[remotePath] = result;
+            pos = body.indexOf(delimiter, headersEnd + 4 + size);
+        }
+        payload = QJsonDocument(results).toJson(QJsonDocument::Compact);
+        bodySize = body.size();
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond()
+    {
+        emit uploadProgress(bodySize / 2, bodySize);
+        emit uploadProgress(bodySize, bodySize);
+        setHeader(QNetworkRequest::ContentLengthHeader, payload.size());
+        setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+        setFinished(true);
+        emit metaDataChanged();
+        if (bytesAvailable())
+            emit readyRead();
+        emit finished();
+    }
+
+    void abort() override
+    {
+        setError(OperationCanceledError, "abort");
+        emit finished();
+    }
+
+    qint64 bytesAvailable() const override { return payload.size() + QIODevice::bytesAvailable(); }
+    qint64 readData(char *data, qint64 maxlen) override {
+        qint64 len = std::min(qint64{payload.size()}, maxlen);
+        std::copy(payload.cbegin(), payload.cbegin() + len, data);
+        payload.remove(0, static_cast<int>(len));
+        return len;
+    }
+
+    int partCount = 0;
+    qint64 bodySize = 0;
+};
+
 class FakeMkcolReply : public QNetworkReply
 {
     Q_OBJECT
@@ -574,7 +675,7 @@ public:
         QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
     }
 
-    Q_INVOKABLE void respond() {
+    Q_INVOKABLE virtual void respond() {
         if (aborted) {
             setError(OperationCanceledError, "Operation Canceled");
             emit metaDataChanged();
@@ -612,6 +713,7 @@ public:
 
     // useful to be public for testing
     using QNetworkReply::setRawHeader;
+    using QNetworkReply::setAttribute;
 };
 
 
@@ -654,7 +756,9 @@ public:
             ++count;
         } while(true);
 
-        Q_ASSERT(count > 1); // There should be at least two chunks, otherwise why would we use chunking?
+        // With delta chunking, the chunks only contain the changed parts
+        const bool isDelta = request.hasRawHeader("OC-Delta-Ranges");
+        Q_ASSERT(count > 1 || isDelta); // There should be at least two chunks, otherwise why would we use chunking?
         QCOMPARE(sourceFolder->children.count(), count); // There should not be holes or extra files
 
         QString fileName = getFilePathFromUrl(QUrl::fromEncoded(request.rawHeader("Destination")));
@@ -667,10 +771,25 @@ public:
                 QMetaObject::invokeMethod(this, "respondPreconditionFailed", Qt::QueuedConnection);
                 return;
             }
+            if (isDelta) {
+                // The reused ranges come from the current version of the file
+                for (const auto &range : request.rawHeader("OC-Delta-Ranges").split(',')) {
+                    const auto bounds = range.split('-');
+                    Q_ASSERT(bounds.size() == 2);
+                    const qint64 first = bounds[0].toLongLong();
+                    const qint64 last = bounds[1].toLongLong();
+                    Q_ASSERT(first <= last && last < fileInfo->size);
+                    size += last - first + 1;
+                }
+                QCOMPARE(QByteArray::number(size), request.rawHeader("OC-Total-Length"));
+                if (!payload)
+                    payload = fileInfo->contentChar;
+            }
             fileInfo->size = size;
             fileInfo->contentChar = payload;
         } else {
             Q_ASSERT(!request.hasRawHeader("If"));
+            Q_ASSERT(!isDelta);
             // Assume that the file is filled with the same character
             fileInfo = remoteRootFileInfo.create(fileName, size, payload);
         }
@@ -821,6 +940,11 @@ protected:
             if (auto reply = _override(op, request, outgoingData))
                 return reply;
         }
+        if (request.url().path().endsWith(QLatin1String("/remote.php/dav/bulk"))) {
+            Q_ASSERT(op == QNetworkAccessManager::PostOperation);
+            return new FakeBulkUploadReply{_remoteRootFileInfo, _errorPaths, op, request, outgoingData->readAll(), this};
+        }
+
         const QString fileName = getFilePathFromUrl(request.url());
         Q_ASSERT(!fileName.isNull());
         if (_errorPaths.contains(fileName))
@@ -910,6 +1034,14 @@ public:
     OCC::SyncEngine &syncEngine() const { return *_syncEngine; }
     OCC::SyncJournalDb &syncJournal() const { return *_journalDb; }
 
+    // Like a restart of the client: a new engine and journal for the same folder
+    void restartEngine() {
+        _syncEngine.reset();
+        _journalDb.reset();
+        _journalDb = std::make_unique<OCC::SyncJournalDb>(localPath() + "._sync_test.db");
+        _syncEngine = std::make_unique<OCC::SyncEngine>(_account, localPath(), "", _journalDb.get());
+    }
+
     FileModifier &localModifier() { return _localModifier; }
     FileInfo &remoteModifier() { return _fakeQnam->currentRemoteState(); }
     FileInfo currentLocalState() {
@@ -0,0 +1,207 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "accountstate.h"
+#include "tray/ActivityListModel.h"
+
+using namespace OCC;
+
+class FakeActivityReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    FakeActivityReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+        int httpStatus, const QByteArray &etag, const QByteArray &body, QObject *parent)
+        : QNetworkReply{ parent }
+        , _httpStatus(httpStatus)
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        setRawHeader("ETag", etag);
+        open(QIODevice::ReadOnly);
+        _payload.setData(body);
+        _payload.open(QIODevice::ReadOnly);
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond()
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, _httpStatus);
+        emit metaDataChanged();
+        emit readyRead();
+        emit finished();
+    }
+
+    void abort() override {}
+    qint64 bytesAvailable() const override { return _payload.bytesAvailable() + QIODevice::bytesAvailable(); }
+    qint64 readData(char *data, qint64 maxlen) override { return _payload.read(data, maxlen); }
+
+private:
+    int _httpStatus;
+    QBuffer _payload;
+};
+
+/* A connected account whose server answers the activity api with ETags */
+class ActivityServer
+{
+public:
+    ActivityServer()
+    {
+        auto qnam = new FakeQNAM({});
+        qnam->setOverride([this, qnam](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (!request.url().path().endsWith("/api/v2/activity"))
+                return new FakeErrorReply(op, request, qnam, 404);
+
+            const QUrlQuery query(request.url());
+            const auto since = query.queryItemValue("since").toLongLong();
+            const bool ascending = query.queryItemValue("sort") == "asc";
+            queries.append(QStringLiteral("since=%1%2").arg(since).arg(ascending ? "&sort=asc" : ""));
+            ifNoneMatch.append(request.rawHeader("If-None-Match"));
+
+            QByteArray data;
+            for (int i = 0; i < _ids.size(); ++i) {
+                const auto id = ascending ? _ids.at(i) : _ids.at(_ids.size() - 1 - i);
+                if (since != 0 && (ascending ? id <= since : id >= since))
+                    continue;
+                if (!data.isEmpty())
+                    data += ',';
+                data += QStringLiteral(R"({"activity_id":%1,"type":"file_created","subject":"created %1","object_name":"/file%1","datetime":"%2"})")
+                            .arg(id)
+                            .arg(QDateTime::currentDateTimeUtc().addSecs(id - 1000).toString(Qt::ISODate))
+                            .toUtf8();
+            }
+            // The meta data in the order of the server, the client looks for "statuscode":200,
+            const QByteArray body = R"({"ocs":{"meta":{"status":"ok","statuscode":200,"message":"OK"},"data":[)" + data + "]}}";
+            const QByteArray etag = '"' + QCryptographicHash::hash(query.toString().toUtf8() + data, QCryptographicHash::Md5).toHex() + '"';
+
+            if (request.rawHeader("If-None-Match") == etag)
+                lastReply = new FakeActivityReply(op, request, 304, etag, QByteArray(), qnam);
+            else
+                lastReply = new FakeActivityReply(op, request, 200, etag, body, qnam);
+            return lastReply;
+        });
+
+        auto account = Account::create();
+        account->setUrl(QUrl(QStringLiteral("http://example.com/owncloud/")));
+        account->setCredentials(new FakeCredentials{ qnam });
+        account->setCapabilities({ { "activity", QVariantMap{ { "apiv2", QVariantList{ "filters", "rich-strings" } } } } });
+        accountState.reset(new AccountState(account));
+        QMetaObject::invokeMethod(accountState.data(), "slotConnectionValidatorResult",
+            Q_ARG(ConnectionValidator::Status, ConnectionValidator::Connected), Q_ARG(QStringList, QStringList()));
+    }
+
+    void addActivity() { _ids.append(_ids.size() + 1); }
+
+    // Waits until the model got the answer to its last request
+    bool waitForReply() const
+    {
+        if (!lastReply)
+            return false;
+        QSignalSpy finished(lastReply.data(), &QNetworkReply::finished);
+        return finished.wait();
+    }
+
+    AccountStatePtr accountState;
+    QStringList queries;
+    QList<QByteArray> ifNoneMatch;
+    QPointer<QNetworkReply> lastReply;
+
+private:
+    QVector<qlonglong> _ids;
+};
+
+static QVector<qlonglong> activityIds(ActivityListModel &model)
+{
+    QVector<qlonglong> ids;
+    for (const auto &activity : model.activityList())
+        ids.append(activity._id);
+    return ids;
+}
+
+class TestActivityListModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testNewActivitiesAreInserted()
+    {
+        ActivityServer server;
+        QVERIFY(server.accountState->isConnected());
+        for (int i = 0; i < 3; ++i)
+            server.addActivity();
+
+        ActivityListModel model(server.accountState.data());
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(activityIds(model), QVector<qlonglong>({ 3, 2, 1 }));
+
+        QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+        server.addActivity();
+        server.addActivity();
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(server.queries.last(), QString("since=3&sort=asc"));
+
+        // Only rows for the new activities are inserted, above the others
+        QCOMPARE(resetSpy.count(), 0);
+        QCOMPARE(insertSpy.count(), 1);
+        QCOMPARE(insertSpy.first().at(1).toInt(), 0);
+        QCOMPARE(insertSpy.first().at(2).toInt(), 1);
+        QCOMPARE(activityIds(model), QVector<qlonglong>({ 5, 4, 3, 2, 1 }));
+        QCOMPARE(model.rowCount(), 5);
+    }
+
+    void testNotModified()
+    {
+        ActivityServer server;
+        server.addActivity();
+        ActivityListModel model(server.accountState.data());
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+
+        // The ETag of the first page is not sent for the query of new activities
+        server.addActivity();
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(server.ifNoneMatch.last(), QByteArray());
+        QCOMPARE(activityIds(model), QVector<qlonglong>({ 2, 1 }));
+
+        // Neither the one of since=1 for since=2
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(server.queries.last(), QString("since=2&sort=asc"));
+        QCOMPARE(server.ifNoneMatch.last(), QByteArray());
+
+        // The same query sends its ETag and the model keeps its rows
+        QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+        QSignalSpy statusSpy(&model, &ActivityListModel::activityJobStatusCode);
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(server.queries.last(), QString("since=2&sort=asc"));
+        QVERIFY(!server.ifNoneMatch.last().isEmpty());
+        QCOMPARE(server.lastReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 304);
+        QCOMPARE(resetSpy.count(), 0);
+        QCOMPARE(insertSpy.count(), 0);
+        QCOMPARE(statusSpy.count(), 0);
+        QCOMPARE(activityIds(model), QVector<qlonglong>({ 2, 1 }));
+
+        // A new activity changes the answer
+        server.addActivity();
+        model.slotRefreshActivity();
+        QVERIFY(server.waitForReply());
+        QCOMPARE(server.lastReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+        QCOMPARE(activityIds(model), QVector<qlonglong>({ 3, 2, 1 }));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestActivityListModel)
+#include "testactivitylistmodel.moc"
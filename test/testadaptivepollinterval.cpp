@@ -0,0 +1,86 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "adaptivepollinterval.h"
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+class TestAdaptivePollInterval : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testBackoff()
+    {
+        AdaptivePollInterval poll(30s, 2min);
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(30s));
+
+        poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(45s));
+        poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(67500ms));
+
+        // Idle folders stop at the maximum
+        for (int i = 0; i < 10; ++i)
+            poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(2min));
+    }
+
+    void testRemoteChange()
+    {
+        AdaptivePollInterval poll(30s, 2min);
+        for (int i = 0; i < 10; ++i)
+            poll.etagUnchanged();
+
+        // A change makes the folder poll faster than the base interval
+        poll.remoteChanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(15s));
+        QCOMPARE(poll.interval(), poll.minimum());
+
+        // Local activity does not slow down a fast poll
+        poll.localActivity();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(15s));
+
+        poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(22500ms));
+    }
+
+    void testLocalActivity()
+    {
+        AdaptivePollInterval poll(30s, 10min);
+        for (int i = 0; i < 10; ++i)
+            poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(10min));
+
+        poll.localActivity();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(30s));
+    }
+
+    void testBounds()
+    {
+        // Never below five seconds, the maximum is at least the base
+        AdaptivePollInterval poll(6s, 1s);
+        QCOMPARE(poll.base(), std::chrono::milliseconds(6s));
+        QCOMPARE(poll.maximum(), std::chrono::milliseconds(6s));
+        QCOMPARE(poll.minimum(), std::chrono::milliseconds(5s));
+
+        poll.etagUnchanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(6s));
+
+        poll.setBounds(1s, 1min);
+        QCOMPARE(poll.base(), std::chrono::milliseconds(5s));
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(5s));
+        poll.remoteChanged();
+        QCOMPARE(poll.interval(), std::chrono::milliseconds(5s));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestAdaptivePollInterval)
+#include "testadaptivepollinterval.moc"
@@ -0,0 +1,237 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+static void setBulkUploadCapability(FakeFolder &fakeFolder)
+{
+    fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "bulkupload", "1.0" } } },
+        { "checksums", QVariantMap{ { "supportedTypes", QStringList() << "SHA1" } } } });
+}
+
+struct RequestCounter
+{
+    int puts = 0;
+    int bulkPosts = 0;
+
+    FakeQNAM::Override override()
+    {
+        return [this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation)
+                ++puts;
+            if (op == QNetworkAccessManager::PostOperation && request.url().path().endsWith("/remote.php/dav/bulk"))
+                ++bulkPosts;
+            return nullptr;
+        };
+    }
+};
+
+class TestBulkUpload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testBulkUpload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+
+        for (int i = 0; i < 10; ++i)
+            fakeFolder.localModifier().insert(QString("A/new%1").arg(i), 100 + i);
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(counter.puts, 0);
+        QCOMPARE(counter.bulkPosts, 1);
+
+        // The journal knows about the uploaded files
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/new3"), &record));
+        QVERIFY(record.isValid());
+        QCOMPARE(record._etag, fakeFolder.currentRemoteState().find("A/new3")->etag.toUtf8());
+        QCOMPARE(record._fileId, fakeFolder.currentRemoteState().find("A/new3")->fileId);
+        QVERIFY(record._checksumHeader.startsWith("SHA1:"));
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/new3")->checksums, record._checksumHeader);
+
+        // Nothing left to do
+        counter = RequestCounter();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(counter.puts, 0);
+        QCOMPARE(counter.bulkPosts, 0);
+    }
+
+    void testBatchSize()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+        SyncOptions options;
+        options._bulkUploadBatchSize = 4;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+
+        for (int i = 0; i < 10; ++i)
+            fakeFolder.localModifier().insert(QString("B/new%1").arg(i));
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        // 4 + 4 + 2
+        QCOMPARE(counter.bulkPosts, 3);
+        QCOMPARE(counter.puts, 0);
+    }
+
+    // The body is built in memory, so the batches are limited by size too
+    void testBatchBytes()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+        SyncOptions options;
+        options._bulkUploadBatchBytes = 2500;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+
+        for (int i = 0; i < 5; ++i)
+            fakeFolder.localModifier().insert(QString("B/new%1").arg(i), 1000);
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        // 2 + 2 + 1
+        QCOMPARE(counter.bulkPosts, 3);
+        QCOMPARE(counter.puts, 0);
+    }
+
+    void testProgress()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+
+        fakeFolder.localModifier().insert("A/new1", 100);
+        fakeFolder.localModifier().insert("A/new2", 300);
+
+        // Each file's progress follows its share of the body
+        QHash<QString, quint64> halfway;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::transmissionProgress, this, [&](const ProgressInfo &progress) {
+            for (const auto &current : progress.currentItems()) {
+                const auto completed = current._progress.completed();
+                if (completed > 0 && completed < current._item._size && !halfway.contains(current._item._file))
+                    halfway.insert(current._item._file, completed);
+            }
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(halfway.size(), 2);
+        QVERIFY(qAbs(qint64(halfway["A/new1"]) - 50) <= 5);
+        QVERIFY(qAbs(qint64(halfway["A/new2"]) - 150) <= 5);
+    }
+
+    void testNoCapability()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+
+        for (int i = 0; i < 5; ++i)
+            fakeFolder.localModifier().insert(QString("A/new%1").arg(i));
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(counter.puts, 5);
+        QCOMPARE(counter.bulkPosts, 0);
+    }
+
+    // Modified and big files are never bulk uploaded
+    void testOnlySmallNewFiles()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+
+        fakeFolder.localModifier().insert("A/small1");
+        fakeFolder.localModifier().insert("A/small2");
+        fakeFolder.localModifier().insert("A/big", 1000 * 1000);
+        fakeFolder.localModifier().appendByte("A/a1");
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(counter.bulkPosts, 1);
+        QCOMPARE(counter.puts, 2);
+    }
+
+    // A single file failing within the batch does not affect the others
+    void testPerFileError()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+
+        for (int i = 0; i < 5; ++i)
+            fakeFolder.localModifier().insert(QString("A/new%1").arg(i));
+        fakeFolder.serverErrorPaths().append("A/new2", 500);
+
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), SIGNAL(itemCompleted(const SyncFileItemPtr &)));
+        QVERIFY(!fakeFolder.syncOnce());
+
+        SyncFileItemPtr failed;
+        int succeeded = 0;
+        for (const QList<QVariant> &args : completeSpy) {
+            auto item = args[0].value<SyncFileItemPtr>();
+            if (item->_file == "A/new2")
+                failed = item;
+            else if (item->_file.startsWith("A/new") && item->_status == SyncFileItem::Success)
+                ++succeeded;
+        }
+        QVERIFY(failed);
+        QCOMPARE(failed->_status, SyncFileItem::NormalError);
+        QCOMPARE(failed->_httpErrorCode, quint16(500));
+        QCOMPARE(succeeded, 4);
+        QVERIFY(!fakeFolder.currentRemoteState().find("A/new2"));
+        QVERIFY(fakeFolder.currentRemoteState().find("A/new4"));
+        QVERIFY(fakeFolder.syncJournal().errorBlacklistEntry("A/new2").isValid());
+
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/new2"), &record));
+        QVERIFY(!record.isValid());
+    }
+
+    // Servers without the endpoint get individual PUTs instead
+    void testFallbackWhenEndpointMissing()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setBulkUploadCapability(fakeFolder);
+        int puts = 0;
+        int bulkPosts = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PostOperation && request.url().path().endsWith("/remote.php/dav/bulk")) {
+                ++bulkPosts;
+                return new FakeErrorReply(op, request, this, 404);
+            }
+            if (op == QNetworkAccessManager::PutOperation)
+                ++puts;
+            return nullptr;
+        });
+
+        for (int i = 0; i < 5; ++i)
+            fakeFolder.localModifier().insert(QString("A/new%1").arg(i));
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(bulkPosts, 1);
+        QCOMPARE(puts, 5);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBulkUpload)
+#include "testbulkupload.moc"
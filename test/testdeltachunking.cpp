@@ -0,0 +1,188 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+static const qint64 blockSize = 1024 * 1024;
+
+static void setupDeltaChunking(FakeFolder &fakeFolder, bool deltaChunking = true)
+{
+    QVariantMap dav{ { "chunking", "1.0" } };
+    if (deltaChunking)
+        dav["deltachunking"] = "1.0";
+    fakeFolder.syncEngine().account()->setCapabilities({ { "dav", dav } });
+
+    SyncOptions options;
+    options._maxChunkSize = blockSize;
+    options._initialChunkSize = blockSize;
+    options._minChunkSize = blockSize;
+    options._deltaBlockSize = blockSize;
+    fakeFolder.syncEngine().setSyncOptions(options);
+}
+
+// Overwrite some bytes in the middle of a local file, keeping the first byte
+// (FakeFolder compares files by size and first byte only)
+static void overwriteLocal(FakeFolder &fakeFolder, const QString &path, qint64 offset, qint64 size)
+{
+    QFile file(fakeFolder.localPath() + path);
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.seek(offset));
+    file.write(QByteArray(size, 'X'));
+    file.close();
+    fakeFolder.localModifier().setModTime(path, QDateTime::currentDateTimeUtc().addSecs(10));
+}
+
+struct UploadRecorder
+{
+    QList<qint64> chunkOffsets;
+    QList<QByteArray> deltaRanges; // one entry per MOVE
+
+    FakeQNAM::Override override()
+    {
+        return [this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation && request.hasRawHeader("OC-Chunk-Offset"))
+                chunkOffsets.append(request.rawHeader("OC-Chunk-Offset").toLongLong());
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "MOVE")
+                deltaRanges.append(request.rawHeader("OC-Delta-Ranges"));
+            return nullptr;
+        };
+    }
+};
+
+class TestDeltaChunking : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testOnlyChangedBlocksAreSent()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupDeltaChunking(fakeFolder);
+        UploadRecorder recorder;
+        fakeFolder.setServerOverride(recorder.override());
+        const qint64 size = 10 * blockSize;
+
+        fakeFolder.localModifier().insert("A/a0", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        // The first upload sends everything
+        QCOMPARE(recorder.chunkOffsets.size(), 10);
+        QCOMPARE(recorder.deltaRanges, QList<QByteArray>{ QByteArray() });
+
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/a0"), &record));
+        auto manifest = fakeFolder.syncJournal().getBlockManifest("A/a0");
+        QVERIFY(manifest._valid);
+        QCOMPARE(manifest._etag, record._etag);
+        QCOMPARE(manifest._blockHashes.size(), 10 * ComputeBlockHashes::hashSize);
+
+        // Change data within the fifth block
+        recorder = UploadRecorder();
+        overwriteLocal(fakeFolder, "A/a0", 4 * blockSize + 100, 1000);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(recorder.chunkOffsets, QList<qint64>{ 4 * blockSize });
+        QCOMPARE(recorder.deltaRanges, QList<QByteArray>{ "0-4194303,5242880-10485759" });
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/a0")->size, size);
+
+        // The manifest follows the new version
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/a0"), &record));
+        QCOMPARE(fakeFolder.syncJournal().getBlockManifest("A/a0")._etag, record._etag);
+
+        // Appending only touches the last block
+        recorder = UploadRecorder();
+        fakeFolder.localModifier().appendByte("A/a0");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(recorder.chunkOffsets, QList<qint64>{ 10 * blockSize });
+        QCOMPARE(recorder.deltaRanges, QList<QByteArray>{ "0-10485759" });
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/a0")->size, size + 1);
+    }
+
+    void testNoCapability()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupDeltaChunking(fakeFolder, false);
+        UploadRecorder recorder;
+        fakeFolder.setServerOverride(recorder.override());
+
+        fakeFolder.localModifier().insert("A/a0", 5 * blockSize);
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(!fakeFolder.syncJournal().getBlockManifest("A/a0")._valid);
+
+        recorder = UploadRecorder();
+        overwriteLocal(fakeFolder, "A/a0", blockSize, 10);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(recorder.chunkOffsets.size(), 5);
+        QCOMPARE(recorder.deltaRanges, QList<QByteArray>{ QByteArray() });
+    }
+
+    // When the server changed the file, the manifest is outdated and the file is not uploaded as delta
+    void testRemoteChange()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupDeltaChunking(fakeFolder);
+        UploadRecorder recorder;
+        fakeFolder.setServerOverride(recorder.override());
+
+        fakeFolder.localModifier().insert("A/a0", 5 * blockSize);
+        QVERIFY(fakeFolder.syncOnce());
+
+        fakeFolder.remoteModifier().appendByte("A/a0");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        recorder = UploadRecorder();
+        overwriteLocal(fakeFolder, "A/a0", blockSize, 10);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(recorder.chunkOffsets.size(), 6);
+        QCOMPARE(recorder.deltaRanges, QList<QByteArray>{ QByteArray() });
+    }
+
+    // If the server refuses the delta, the next attempt uploads the whole file
+    void testDeltaRejected()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupDeltaChunking(fakeFolder);
+        fakeFolder.localModifier().insert("A/a0", 5 * blockSize);
+        QVERIFY(fakeFolder.syncOnce());
+
+        int rejected = 0;
+        UploadRecorder recorder;
+        auto recorderOverride = recorder.override();
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *data) -> QNetworkReply * {
+            if (request.hasRawHeader("OC-Delta-Ranges")) {
+                ++rejected;
+                return new FakeErrorReply(op, request, this, 400);
+            }
+            return recorderOverride(op, request, data);
+        });
+
+        overwriteLocal(fakeFolder, "A/a0", 2 * blockSize, 10);
+        QVERIFY(!fakeFolder.syncOnce());
+        QCOMPARE(rejected, 1);
+        QVERIFY(!fakeFolder.syncJournal().getBlockManifest("A/a0")._valid);
+
+        recorder = UploadRecorder();
+        fakeFolder.syncJournal().wipeErrorBlacklist();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(rejected, 1);
+        QCOMPARE(recorder.chunkOffsets.size(), 5);
+        QVERIFY(fakeFolder.syncJournal().getBlockManifest("A/a0")._valid);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDeltaChunking)
+#include "testdeltachunking.moc"
@@ -0,0 +1,66 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+class TestDiscoveryDirectDownload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testPropertiesPerSubtree()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        auto &remote = fakeFolder.remoteModifier();
+        // The root only has folders
+        remote.mkdir("A");
+        remote.mkdir("B");
+        // A has direct download cookies
+        remote.insert("A/a1");
+        remote.find("A/a1")->extraDavProperties = "<oc:dDC>cookie</oc:dDC>";
+        remote.mkdir("A/sub");
+        remote.insert("A/sub/s1");
+        remote.find("A/sub/s1")->extraDavProperties = "<oc:dDC>cookie</oc:dDC>";
+        // B has none, except in the storage mounted in it
+        remote.insert("B/b1");
+        remote.mkdir("B/deep");
+        remote.insert("B/deep/d1");
+        remote.mkdir("B/mount");
+        remote.find("B/mount")->extraDavProperties = "<oc:permissions>MRDNVCKW</oc:permissions>";
+        remote.insert("B/mount/m1");
+        remote.find("B/mount/m1")->extraDavProperties = "<oc:dDC>cookie</oc:dDC>";
+
+        // Whether each listing asked for the direct download properties
+        QMap<QString, bool> asked;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "PROPFIND" && outgoingData)
+                asked.insert(getFilePathFromUrl(request.url()), outgoingData->peek(outgoingData->size()).contains("dDC"));
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // A listing with folders only doesn't turn them off
+        QVERIFY(asked.value(""));
+        QVERIFY(asked.value("A"));
+        QVERIFY(asked.value("A/sub"));
+        QVERIFY(asked.value("B"));
+        // Below a listing of files without them they aren't asked for
+        QVERIFY(asked.contains("B/deep"));
+        QVERIFY(!asked.value("B/deep"));
+        // but again for another storage mounted there
+        QVERIFY(asked.value("B/mount"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDiscoveryDirectDownload)
+#include "testdiscoverydirectdownload.moc"
@@ -0,0 +1,127 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+#include "common/memorycounters.h"
+
+using namespace OCC;
+
+static const int filesPerFolder = 40;
+static const int spillThreshold = 20;
+
+/* A folder whose discovery trees are far larger than the spill threshold */
+static void setupLargeFolder(FakeFolder &fakeFolder)
+{
+    SyncOptions options;
+    options._discoverySpillThreshold = spillThreshold;
+    fakeFolder.syncEngine().setSyncOptions(options);
+
+    for (const auto &folder : { "A", "B", "C", "C/sub" }) {
+        fakeFolder.remoteModifier().mkdir(folder);
+        for (int i = 0; i < filesPerFolder; ++i)
+            fakeFolder.remoteModifier().insert(QStringLiteral("%1/f%2").arg(folder).arg(i), 10 + i);
+    }
+    QVERIFY(fakeFolder.syncOnce());
+    QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+}
+
+class TestDiscoverySpill : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testUnchangedSync()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        setupLargeFolder(fakeFolder);
+
+        // With nothing to do, the discovery trees stay below the full size
+        MemoryCounters::resetHighWater();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(MemoryCounters::highWater(MemoryCounters::FileStats) < 4 * filesPerFolder);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testChangesOnBothSides()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        setupLargeFolder(fakeFolder);
+
+        fakeFolder.localModifier().appendByte("A/f1");
+        fakeFolder.localModifier().remove("A/f2");
+        fakeFolder.localModifier().insert("A/new");
+        fakeFolder.remoteModifier().appendByte("B/f3");
+        fakeFolder.remoteModifier().remove("B/f4");
+        fakeFolder.remoteModifier().insert("B/new");
+        fakeFolder.remoteModifier().remove("C/sub/f5");
+        fakeFolder.localModifier().remove("C/f6");
+
+        MemoryCounters::resetHighWater();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(MemoryCounters::highWater(MemoryCounters::FileStats) < 4 * filesPerFolder);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(!fakeFolder.currentRemoteState().find("A/f2"));
+        QVERIFY(!fakeFolder.currentLocalState().find("B/f4"));
+        QVERIFY(!fakeFolder.currentLocalState().find("C/sub/f5"));
+        QVERIFY(!fakeFolder.currentRemoteState().find("C/f6"));
+
+        // The journal matches: another sync has nothing to do
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testConflictAndRemovedFolder()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        setupLargeFolder(fakeFolder);
+
+        fakeFolder.localModifier().appendByte("A/f7");
+        fakeFolder.remoteModifier().setContents("A/f7", 'R');
+        fakeFolder.remoteModifier().remove("C/sub");
+
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(!fakeFolder.currentLocalState().find("C/sub"));
+        QCOMPARE(fakeFolder.currentLocalState().find("A/f7")->contentChar, 'R');
+        int conflicts = 0;
+        for (const auto &item : fakeFolder.currentLocalState().children["A"].children) {
+            if (item.name.contains("(conflicted copy"))
+                ++conflicts;
+        }
+        QCOMPARE(conflicts, 1);
+    }
+
+    void testFolderRename()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        setupLargeFolder(fakeFolder);
+
+        int nPUT = 0;
+        int nGET = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &, QIODevice *) {
+            if (op == QNetworkAccessManager::PutOperation)
+                ++nPUT;
+            if (op == QNetworkAccessManager::GetOperation)
+                ++nGET;
+            return nullptr;
+        });
+
+        // Renames are still detected when the files below the folders were spilled
+        fakeFolder.localModifier().rename("A", "A2");
+        fakeFolder.remoteModifier().rename("B", "B2");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(fakeFolder.currentRemoteState().find("A2/f0"));
+        QVERIFY(fakeFolder.currentLocalState().find("B2/f0"));
+        QCOMPARE(nPUT, 0);
+        QCOMPARE(nGET, 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDiscoverySpill)
+#include "testdiscoveryspill.moc"
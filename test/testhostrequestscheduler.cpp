@@ -0,0 +1,148 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include <QNetworkReply>
+
+#include "account.h"
+#include "hostrequestscheduler.h"
+#include "syncenginetestutils.h"
+
+using namespace OCC;
+
+/* A reply that finishes when the test says so */
+class ManualReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    void finish()
+    {
+        setFinished(true);
+        emit finished();
+    }
+    void abort() override {}
+    qint64 readData(char *, qint64) override { return -1; }
+};
+
+static AccountPtr makeAccount(const QString &url)
+{
+    auto account = Account::create();
+    account->setUrl(QUrl(url));
+    return account;
+}
+
+class TestHostRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHostKey()
+    {
+        QCOMPARE(HostRequestScheduler::hostKey(QUrl("https://Cloud.Example.com/nextcloud")),
+            QString("https://cloud.example.com:443"));
+        QCOMPARE(HostRequestScheduler::hostKey(QUrl("https://cloud.example.com:443/")),
+            HostRequestScheduler::hostKey(QUrl("https://cloud.example.com")));
+        QVERIFY(HostRequestScheduler::hostKey(QUrl("http://cloud.example.com"))
+            != HostRequestScheduler::hostKey(QUrl("https://cloud.example.com")));
+        QVERIFY(HostRequestScheduler::hostKey(QUrl("https://cloud.example.com:8443"))
+            != HostRequestScheduler::hostKey(QUrl("https://cloud.example.com")));
+    }
+
+    void testBudgetAndFairShare()
+    {
+        auto scheduler = HostRequestScheduler::instance();
+        auto personal = makeAccount("https://shared.example.com/");
+        auto team = makeAccount("https://shared.example.com/");
+        auto other = makeAccount("https://other.example.com/");
+        const QString host = HostRequestScheduler::hostKey(personal->url());
+        QSignalSpy capacitySpy(scheduler, &HostRequestScheduler::hostCapacityAvailable);
+
+        // Alone on the host, an account may use the whole budget
+        std::vector<std::unique_ptr<ManualReply>> personalReplies;
+        while (scheduler->mayStartRequest(personal.data(), 4)) {
+            personalReplies.emplace_back(new ManualReply);
+            scheduler->trackReply(personal.data(), personalReplies.back().get());
+        }
+        QCOMPARE(scheduler->requestsInFlight(host), 4);
+        QCOMPARE(scheduler->requestsInFlight(personal.data()), 4);
+
+        // Other servers have their own budget
+        QVERIFY(scheduler->mayStartRequest(other.data(), 4));
+
+        // The second account has to wait for a request to finish
+        QVERIFY(!scheduler->mayStartRequest(team.data(), 4));
+        personalReplies.back()->finish();
+        personalReplies.pop_back();
+        QCOMPARE(capacitySpy.count(), 1);
+        QCOMPARE(capacitySpy.first().first().toString(), host);
+
+        // The free slot goes to the waiting account, not to the one above its fair share
+        QVERIFY(!scheduler->mayStartRequest(personal.data(), 4));
+        QVERIFY(scheduler->mayStartRequest(team.data(), 4));
+        ManualReply teamReply;
+        scheduler->trackReply(team.data(), &teamReply);
+        QCOMPARE(scheduler->requestsInFlight(host), 4);
+
+        // Finished replies free the budget again, deleted ones count as finished
+        personalReplies.back()->finish();
+        personalReplies.clear();
+        teamReply.finish();
+        QCOMPARE(scheduler->requestsInFlight(host), 0);
+        QCOMPARE(scheduler->requestsInFlight(personal.data()), 0);
+        QCOMPARE(scheduler->requestsInFlight(team.data()), 0);
+        QVERIFY(scheduler->mayStartRequest(personal.data(), 4));
+        QVERIFY(scheduler->mayStartRequest(team.data(), 4));
+
+        // Granted requests that were never sent leave nothing behind
+        QCOMPARE(scheduler->hostCount(), 0);
+    }
+
+    void testStopWaiting()
+    {
+        auto scheduler = HostRequestScheduler::instance();
+        auto first = makeAccount("https://waiting.example.com/");
+        auto second = makeAccount("https://waiting.example.com/");
+
+        ManualReply reply;
+        QVERIFY(scheduler->mayStartRequest(first.data(), 1));
+        scheduler->trackReply(first.data(), &reply);
+        QVERIFY(!scheduler->mayStartRequest(second.data(), 1));
+
+        // An account that gave up waiting doesn't hold the others back
+        scheduler->stopWaiting(second.data());
+        reply.finish();
+        QCOMPARE(scheduler->hostCount(), 0);
+    }
+
+    void testLocalJobsDontWaitForTheHost()
+    {
+        auto scheduler = HostRequestScheduler::instance();
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+
+        // Another account on the same server uses the whole budget
+        auto other = makeAccount("http://localhost/owncloud");
+        std::vector<std::unique_ptr<ManualReply>> otherReplies;
+        while (scheduler->mayStartRequest(other.data(), 6)) {
+            otherReplies.emplace_back(new ManualReply);
+            scheduler->trackReply(other.data(), otherReplies.back().get());
+        }
+
+        // Only local changes to propagate: they don't wait for the server
+        fakeFolder.remoteModifier().remove("A/a1");
+        fakeFolder.remoteModifier().remove("B");
+        fakeFolder.remoteModifier().mkdir("N");
+        fakeFolder.remoteModifier().rename("C/c1", "C/c3");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        otherReplies.clear();
+        QCOMPARE(scheduler->hostCount(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestHostRequestScheduler)
+#include "testhostrequestscheduler.moc"
@@ -0,0 +1,190 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+/* Answers a download the way Qt reports an answer over an HTTP/2 connection */
+class Http2GetReply : public FakeGetReply
+{
+    Q_OBJECT
+public:
+    using FakeGetReply::FakeGetReply;
+
+    void respond() override
+    {
+        setAttribute(QNetworkRequest::HTTP2WasUsedAttribute, true);
+        FakeGetReply::respond();
+    }
+};
+
+static void insertRemoteFiles(FakeFolder &fakeFolder, int count)
+{
+    fakeFolder.remoteModifier().mkdir("many");
+    for (int i = 0; i < count; ++i)
+        fakeFolder.remoteModifier().insert(QStringLiteral("many/f%1").arg(i));
+}
+
+class TestHttp2 : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testDetection()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto account = fakeFolder.syncEngine().account();
+        QVERIFY(!account->isHttp2Supported());
+
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation)
+                return new Http2GetReply(fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            return nullptr;
+        });
+        fakeFolder.remoteModifier().appendByte("A/a1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(account->isHttp2Supported());
+    }
+
+    void testRefusedStreamsAreResent()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        auto account = fakeFolder.syncEngine().account();
+        account->setHttp2Supported(true);
+        insertRemoteFiles(fakeFolder, 10);
+
+        // The server resets the first stream of each download
+        QSet<QString> refused;
+        int nGET = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation)
+                return nullptr;
+            ++nGET;
+            const QString path = getFilePathFromUrl(request.url());
+            if (!refused.contains(path)) {
+                refused.insert(path);
+                auto reply = new FakeErrorReply(op, request, &fakeFolder.syncEngine(), 0);
+                reply->setError(QNetworkReply::ContentReSendError, "Stream reset");
+                reply->setAttribute(QNetworkRequest::HTTP2WasUsedAttribute, true);
+                return reply;
+            }
+            return new Http2GetReply(fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(nGET, 20);
+
+        // The refused streams lowered the estimate
+        QVERIFY(account->http2StreamCapacity().streams() < Http2StreamCapacity::initialStreams);
+    }
+
+    void testRefusedUploadsAreResentFromTheStart()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        fakeFolder.syncEngine().account()->setHttp2Supported(true);
+        fakeFolder.localModifier().mkdir("up");
+        for (int i = 0; i < 5; ++i)
+            fakeFolder.localModifier().insert(QStringLiteral("up/f%1").arg(i), 100 + i);
+
+        // The server resets the first stream of each upload after half of its body
+        QSet<QString> refused;
+        QMap<QString, int> resentBodySizes;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::PutOperation)
+                return nullptr;
+            const QString path = getFilePathFromUrl(request.url());
+            if (!refused.contains(path)) {
+                refused.insert(path);
+                outgoingData->read(outgoingData->size() / 2);
+                auto reply = new FakeErrorReply(op, request, &fakeFolder.syncEngine(), 0);
+                reply->setError(QNetworkReply::ContentReSendError, "Stream reset");
+                reply->setAttribute(QNetworkRequest::HTTP2WasUsedAttribute, true);
+                return reply;
+            }
+            const auto body = outgoingData->readAll();
+            resentBodySizes.insert(path, body.size());
+            return new FakePutReply(fakeFolder.remoteModifier(), op, request, body, &fakeFolder.syncEngine());
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(refused.size(), 5);
+        for (int i = 0; i < 5; ++i)
+            QCOMPARE(resentBodySizes.value(QStringLiteral("up/f%1").arg(i)), 100 + i);
+    }
+
+    void testStreamCapacity()
+    {
+        Http2StreamCapacity capacity;
+        QCOMPARE(capacity.streams(), int(Http2StreamCapacity::initialStreams));
+
+        // A full window of successful streams allows one more
+        for (int i = 0; i < Http2StreamCapacity::initialStreams - 1; ++i)
+            capacity.streamSucceeded();
+        QCOMPARE(capacity.streams(), int(Http2StreamCapacity::initialStreams));
+        capacity.streamSucceeded();
+        QCOMPARE(capacity.streams(), Http2StreamCapacity::initialStreams + 1);
+
+        capacity.streamRefused();
+        QCOMPARE(capacity.streams(), (Http2StreamCapacity::initialStreams + 1) / 2);
+        for (int i = 0; i < 5; ++i)
+            capacity.streamRefused();
+        QCOMPARE(capacity.streams(), int(Http2StreamCapacity::minimumStreams));
+
+        for (int i = 0; i < 100000; ++i)
+            capacity.streamSucceeded();
+        QCOMPARE(capacity.streams(), int(Http2StreamCapacity::maximumStreams));
+    }
+
+    void testSmallTransfersFillTheStreams_data()
+    {
+        QTest::addColumn<bool>("http2");
+        QTest::newRow("HTTP/1") << false;
+        QTest::newRow("HTTP/2") << true;
+    }
+
+    void testSmallTransfersFillTheStreams()
+    {
+        QFETCH(bool, http2);
+        FakeFolder fakeFolder{ FileInfo{} };
+        fakeFolder.syncEngine().account()->setHttp2Supported(http2);
+        insertRemoteFiles(fakeFolder, 40);
+
+        int running = 0;
+        int maxRunning = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation)
+                return nullptr;
+            QNetworkReply *reply = nullptr;
+            if (http2)
+                reply = new DelayedReply<Http2GetReply>(50, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            else
+                reply = new DelayedReply<FakeGetReply>(50, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            maxRunning = qMax(maxRunning, ++running);
+            connect(reply, &QNetworkReply::finished, [&] { --running; });
+            return reply;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        if (http2) {
+            // Small downloads don't count against the transfer limit
+            QVERIFY(maxRunning > 6);
+            QVERIFY(maxRunning <= fakeFolder.syncEngine().account()->http2StreamCapacity().streams());
+        } else {
+            QVERIFY(maxRunning <= 6);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestHttp2)
+#include "testhttp2.moc"
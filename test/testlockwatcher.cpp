@@ -0,0 +1,85 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "lockwatcher.h"
+
+using namespace OCC;
+
+class TestLockWatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        LockWatcher::firstCheckDelay = 5 * 1000;
+        LockWatcher::maxPollingInterval = 20 * 1000;
+    }
+
+    void testPollingBackoff()
+    {
+        LockWatcher::firstCheckDelay = 50;
+        LockWatcher::maxPollingInterval = 200;
+
+        // The probes are run by hand at the times of a fake clock
+        LockWatcher watcher;
+        qint64 now = 0;
+        watcher.setClock([&] { return now; });
+        bool locked = true;
+        QVector<qint64> probeTimes;
+        watcher.setLockProbe([&](const QString &) {
+            probeTimes.append(now);
+            return locked;
+        });
+        auto checkAt = [&](qint64 time) {
+            now = time;
+            QMetaObject::invokeMethod(&watcher, "checkFiles");
+        };
+
+        QSignalSpy spy(&watcher, &LockWatcher::fileUnlocked);
+        watcher.addFile(QStringLiteral("/nonexistent/locked.txt"));
+        checkAt(49);
+        QVERIFY(probeTimes.isEmpty());
+
+        // The interval doubles, up to the maximum
+        for (qint64 time : { 50, 149, 150, 349, 350, 549, 550 })
+            checkAt(time);
+        QCOMPARE(probeTimes, QVector<qint64>({ 50, 150, 350, 550 }));
+        QCOMPARE(spy.count(), 0);
+
+        locked = false;
+        checkAt(750);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.first().first().toString(), QStringLiteral("/nonexistent/locked.txt"));
+        QCOMPARE(watcher.probeCount(), qint64(5));
+        // More probes than at the fixed interval don't count as negative savings
+        QCOMPARE(watcher.savedProbeCount(), qint64(0));
+
+        // Not watched anymore
+        checkAt(10000);
+        QCOMPARE(watcher.probeCount(), qint64(5));
+    }
+
+    void testTimerProbes()
+    {
+        LockWatcher::firstCheckDelay = 10;
+
+        LockWatcher watcher;
+        watcher.setLockProbe([](const QString &) { return false; });
+        QSignalSpy spy(&watcher, &LockWatcher::fileUnlocked);
+        watcher.addFile(QStringLiteral("/nonexistent/locked.txt"));
+        watcher.addFile(QStringLiteral("/nonexistent/locked.txt"));
+        QVERIFY(spy.wait());
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(watcher.probeCount(), qint64(1));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLockWatcher)
+#include "testlockwatcher.moc"
@@ -0,0 +1,73 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+class TestMemoryCounters : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInstanceCounts()
+    {
+        const auto before = MemoryCounters::current(MemoryCounters::SyncFileItems);
+        MemoryCounters::resetHighWater();
+        {
+            SyncFileItem item;
+            SyncFileItem copy = item;
+            auto ptr = QSharedPointer<SyncFileItem>::create(copy);
+            QCOMPARE(MemoryCounters::current(MemoryCounters::SyncFileItems), before + 3);
+            copy = *ptr;
+            QCOMPARE(MemoryCounters::current(MemoryCounters::SyncFileItems), before + 3);
+        }
+        QCOMPARE(MemoryCounters::current(MemoryCounters::SyncFileItems), before);
+        QCOMPARE(MemoryCounters::highWater(MemoryCounters::SyncFileItems), before + 3);
+
+        MemoryCounters::resetHighWater();
+        QCOMPARE(MemoryCounters::highWater(MemoryCounters::SyncFileItems), before);
+    }
+
+    void testBytes()
+    {
+        const auto before = MemoryCounters::current(MemoryCounters::UploadBufferBytes);
+        {
+            MemoryCounters::Bytes<MemoryCounters::UploadBufferBytes> bytes;
+            bytes.set(1000);
+            bytes.set(300);
+            QCOMPARE(MemoryCounters::current(MemoryCounters::UploadBufferBytes), before + 300);
+        }
+        QCOMPARE(MemoryCounters::current(MemoryCounters::UploadBufferBytes), before);
+    }
+
+    // The engine reports the counters after each phase
+    void testSyncPhases()
+    {
+        QStringList phases;
+        QString discoveryUsage;
+        {
+            FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+            fakeFolder.localModifier().insert("A/new");
+            QObject::connect(&fakeFolder.syncEngine(), &SyncEngine::memoryUsage,
+                [&](const QString &phase, const QString &usage) {
+                    phases.append(phase);
+                    if (phase == "discovery")
+                        discoveryUsage = usage;
+                });
+            QVERIFY(fakeFolder.syncOnce());
+        }
+        QCOMPARE(phases, QStringList({ "discovery", "reconcile", "post-reconcile", "propagation" }));
+        QVERIFY(discoveryUsage.contains("fileStats="));
+        QVERIFY(!discoveryUsage.contains("discoveryTreeBytes=0,"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMemoryCounters)
+#include "testmemorycounters.moc"
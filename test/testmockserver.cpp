@@ -0,0 +1,204 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "mockserver/davhandler.h"
+#include "mockserver/httpserver.h"
+#include <syncengine.h>
+
+#include <QHostAddress>
+
+using namespace OCC;
+
+/* Syncs a local folder against the mock server over real sockets */
+class MockServerFolder
+{
+public:
+    MockServerFolder()
+        : _server([this](const HttpRequest &request) { return _dav.handle(request); })
+    {
+        OCC::SyncEngine::minimumFileAgeForUpload = 0;
+        QVERIFY(_server.listen(QHostAddress::LocalHost));
+
+        _account = Account::create();
+        _account->setUrl(QUrl(QStringLiteral("http://127.0.0.1:%1").arg(_server.serverPort())));
+        _account->setCredentials(new FakeCredentials{ new QNetworkAccessManager });
+        _account->setDavDisplayName("fakename");
+
+        _journalDb = std::make_unique<SyncJournalDb>(localPath() + "._sync_test.db");
+        _syncEngine = std::make_unique<SyncEngine>(_account, localPath(), "", _journalDb.get());
+    }
+
+    QString localPath() const { return _tempDir.path() + '/'; }
+    DavHandler &dav() { return _dav; }
+    HttpServer &server() { return _server; }
+    Account &account() { return *_account; }
+    SyncEngine &syncEngine() { return *_syncEngine; }
+
+    void writeLocal(const QString &relativePath, const QByteArray &content)
+    {
+        QDir(localPath()).mkpath(QFileInfo(relativePath).path());
+        QFile file(localPath() + relativePath);
+        QVERIFY(file.open(QFile::WriteOnly));
+        file.write(content);
+    }
+
+    QByteArray readLocal(const QString &relativePath)
+    {
+        QFile file(localPath() + relativePath);
+        return file.open(QFile::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+    bool syncOnce()
+    {
+        QSignalSpy spy(_syncEngine.get(), SIGNAL(finished(bool)));
+        QMetaObject::invokeMethod(_syncEngine.get(), "startSync", Qt::QueuedConnection);
+        if (!spy.wait(60000))
+            return false;
+        return spy[0][0].toBool();
+    }
+
+private:
+    QTemporaryDir _tempDir;
+    DavHandler _dav;
+    HttpServer _server;
+    AccountPtr _account;
+    std::unique_ptr<SyncJournalDb> _journalDb;
+    std::unique_ptr<SyncEngine> _syncEngine;
+};
+
+class TestMockServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testUploadAndDownload()
+    {
+        MockServerFolder folder;
+        folder.dav().files().mkdir("remote");
+        folder.dav().files().put("remote/r1", "remote content", 1500000000);
+        folder.writeLocal("local/l1", "local content");
+
+        QVERIFY(folder.syncOnce());
+        QCOMPARE(folder.readLocal("remote/r1"), QByteArray("remote content"));
+        auto uploaded = folder.dav().files().find("local/l1");
+        QVERIFY(uploaded);
+        QCOMPARE(uploaded->content, QByteArray("local content"));
+
+        // A second sync finds nothing to do
+        const auto requestsBefore = folder.server().requestCount();
+        QVERIFY(folder.syncOnce());
+        QVERIFY(folder.server().requestCount() - requestsBefore <= 2);
+
+        // Remote changes come down, remote removals are applied locally
+        folder.dav().files().put("remote/r1", "changed", 1500000100);
+        folder.dav().files().remove("local/l1");
+        QVERIFY(folder.syncOnce());
+        QCOMPARE(folder.readLocal("remote/r1"), QByteArray("changed"));
+        QVERIFY(!QFile::exists(folder.localPath() + "local/l1"));
+    }
+
+    void testChunkedUpload()
+    {
+        MockServerFolder folder;
+        folder.account().setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" } } } });
+        SyncOptions options;
+        options._maxChunkSize = 1000;
+        options._initialChunkSize = 1000;
+        options._minChunkSize = 1000;
+        folder.syncEngine().setSyncOptions(options);
+
+        QByteArray content;
+        for (int i = 0; i < 1000; ++i)
+            content += QByteArray::number(i) + ' ';
+        folder.writeLocal("A/big", content);
+
+        const auto requestsBefore = folder.server().requestCount();
+        QVERIFY(folder.syncOnce());
+        auto uploaded = folder.dav().files().find("A/big");
+        QVERIFY(uploaded);
+        QCOMPARE(uploaded->content, content);
+        // Several PUTs of chunks plus MKCOL and MOVE
+        QVERIFY(folder.server().requestCount() - requestsBefore > quint64(content.size() / 1000));
+        // The upload folder is gone after the MOVE
+        QVERIFY(folder.dav().uploads().root()->children.empty());
+    }
+
+    void testRangeRequest()
+    {
+        DavHandler dav;
+        dav.files().put("file", "0123456789", 1500000000);
+
+        HttpRequest request;
+        request.method = "GET";
+        request.path = "/remote.php/webdav/file";
+        request.headers.insert("range", "bytes=2-5");
+        auto response = dav.handle(request);
+        QCOMPARE(response.status, 206);
+        QCOMPARE(response.body, QByteArray("2345"));
+
+        request.headers.insert("range", "bytes=-3");
+        response = dav.handle(request);
+        QCOMPARE(response.status, 206);
+        QCOMPARE(response.body, QByteArray("789"));
+
+        request.headers.insert("range", "bytes=20-");
+        QCOMPARE(dav.handle(request).status, 416);
+    }
+
+    void testPropfind()
+    {
+        DavHandler dav;
+        dav.files().mkdir("A");
+        dav.files().put("A/a b", "x", 1500000000);
+
+        HttpRequest request;
+        request.method = "PROPFIND";
+        request.path = "/owncloud/remote.php/dav/files/admin/A";
+        request.headers.insert("depth", "1");
+        auto response = dav.handle(request);
+        QCOMPARE(response.status, 207);
+        QVERIFY(response.body.contains("/owncloud/remote.php/dav/files/admin/A/</d:href>"));
+        QVERIFY(response.body.contains("/owncloud/remote.php/dav/files/admin/A/a%20b</d:href>"));
+
+        request.path = "/remote.php/webdav/missing";
+        QCOMPARE(dav.handle(request).status, 404);
+    }
+
+    void testErrorRule()
+    {
+        MockServerFolder folder;
+        folder.writeLocal("A/a1", "content");
+        folder.server().addErrorRule({ QRegularExpression("A/a1$"), "PUT", 507 });
+
+        QVERIFY(!folder.syncOnce());
+        QVERIFY(!folder.dav().files().find("A/a1"));
+
+        folder.server().clearErrorRules();
+        folder.syncEngine().journal()->wipeErrorBlacklist();
+        QVERIFY(folder.syncOnce());
+        QVERIFY(folder.dav().files().find("A/a1"));
+    }
+
+    void testLatency()
+    {
+        MockServerFolder folder;
+        folder.dav().files().put("f", "content", 1500000000);
+        folder.server().setLatency(50);
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(folder.syncOnce());
+        // At least a PROPFIND of the root and the GET
+        QVERIFY(timer.elapsed() >= 100);
+        QCOMPARE(folder.readLocal("f"), QByteArray("content"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMockServer)
+#include "testmockserver.moc"
@@ -0,0 +1,90 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "pathtrie.h"
+
+using namespace OCC;
+
+class TestPathTrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLongestPrefix()
+    {
+        PathTrie<int> trie(Qt::CaseSensitive);
+        trie.insert("/home/user/Nextcloud", 1);
+        trie.insert("/home/user/Nextcloud2", 2);
+        trie.insert("/home/user/Nextcloud/sub", 3);
+        trie.insert("C:/Users/user/Nextcloud", 4);
+        QCOMPARE(trie.size(), 4);
+
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud"), 1);
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud/"), 1);
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud/a/b.txt"), 1);
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud2/a"), 2);
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud/sub/a"), 3);
+        QCOMPARE(trie.findLongestPrefix("C:/Users/user/Nextcloud/a"), 4);
+
+        // Only whole components match
+        QCOMPARE(trie.findLongestPrefix("/home/user/Next"), 0);
+        QCOMPARE(trie.findLongestPrefix("/home/user/Nextcloud3/a"), 0);
+        QCOMPARE(trie.findLongestPrefix("/home/user"), 0);
+        QCOMPARE(trie.findLongestPrefix("home/user/Nextcloud"), 0);
+        QCOMPARE(trie.findLongestPrefix(""), 0);
+
+        // Redundant separators and dots don't matter
+        QCOMPARE(trie.findLongestPrefix("/home//user/./Nextcloud2/a"), 2);
+
+        // Case sensitive
+        QCOMPARE(trie.findLongestPrefix("/home/user/nextcloud/a"), 0);
+    }
+
+    void testCaseInsensitive()
+    {
+        PathTrie<int> trie(Qt::CaseInsensitive);
+        trie.insert("C:/Users/User/Nextcloud", 1);
+        QCOMPARE(trie.findLongestPrefix("c:/users/user/NEXTCLOUD/a.txt"), 1);
+        QCOMPARE(trie.findLongestPrefix("c:/users/user/NEXTCLOUD2/a.txt"), 0);
+
+        // Inserting a path that only differs in case replaces the value
+        trie.insert("c:/users/user/nextcloud", 2);
+        QCOMPARE(trie.size(), 1);
+        QCOMPARE(trie.findLongestPrefix("C:/Users/User/Nextcloud"), 2);
+    }
+
+    void testRemove()
+    {
+        PathTrie<int> trie(Qt::CaseSensitive);
+        trie.insert("/a/b", 1);
+        trie.insert("/a/b/c/d", 2);
+
+        // Only removed with the stored value
+        QVERIFY(!trie.remove("/a/b", 2));
+        QVERIFY(!trie.remove("/a", 1));
+        QVERIFY(!trie.remove("/a/b/c", 1));
+        QCOMPARE(trie.size(), 2);
+
+        QVERIFY(trie.remove("/a/b/c/d", 2));
+        QCOMPARE(trie.size(), 1);
+        QCOMPARE(trie.findLongestPrefix("/a/b/c/d/e"), 1);
+
+        QVERIFY(trie.remove("/a/b", 1));
+        QCOMPARE(trie.size(), 0);
+        QCOMPARE(trie.findLongestPrefix("/a/b/c"), 0);
+
+        trie.insert("/a/b", 3);
+        QCOMPARE(trie.findLongestPrefix("/a/b/c"), 3);
+        trie.clear();
+        QCOMPARE(trie.findLongestPrefix("/a/b/c"), 0);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestPathTrie)
+#include "testpathtrie.moc"
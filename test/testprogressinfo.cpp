@@ -0,0 +1,100 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "progressdispatcher.h"
+
+using namespace OCC;
+
+static SyncFileItem makeItem(const QString &file, quint64 size, csync_instructions_e instruction = CSYNC_INSTRUCTION_NEW)
+{
+    SyncFileItem item;
+    item._file = file;
+    item._instruction = instruction;
+    item._type = ItemTypeFile;
+    item._size = size;
+    return item;
+}
+
+class TestProgressInfo : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testCompletedSize()
+    {
+        ProgressInfo progress;
+        const auto a = makeItem("a", 100);
+        const auto b = makeItem("b", 200);
+        const auto c = makeItem("c", 300);
+        const auto removal = makeItem("d", 400, CSYNC_INSTRUCTION_REMOVE);
+        for (const auto &item : { a, b, c, removal })
+            progress.adjustTotalsForFile(item);
+        QCOMPARE(progress.totalSize(), quint64(600));
+        QCOMPARE(progress.totalFiles(), quint64(4));
+
+        progress.setProgressItem(a, 50);
+        progress.setProgressItem(b, 20);
+        progress.setProgressItem(c, 30);
+        progress.setProgressItem(removal, 400);
+        QCOMPARE(progress.completedSize(), quint64(100));
+        QCOMPARE(progress.currentItems().size(), 4);
+        QCOMPARE(progress.currentFile(), quint64(4));
+
+        // Progress can also go backwards, e.g. when a transfer restarts
+        progress.setProgressItem(b, 10);
+        QCOMPARE(progress.completedSize(), quint64(90));
+
+        // Completing an item that isn't the last one moves the last item into its slot
+        progress.setProgressComplete(a);
+        QCOMPARE(progress.completedSize(), quint64(140));
+        QCOMPARE(progress.completedFiles(), quint64(1));
+        QCOMPARE(progress.currentItems().size(), 3);
+        progress.setProgressItem(removal, 400);
+        progress.setProgressItem(c, 300);
+        QCOMPARE(progress.currentItems().size(), 3);
+        QCOMPARE(progress.completedSize(), quint64(410));
+
+        progress.setProgressComplete(c);
+        progress.setProgressComplete(removal);
+        progress.setProgressComplete(b);
+        QVERIFY(progress.currentItems().isEmpty());
+        QCOMPARE(progress.completedSize(), quint64(600));
+        QCOMPARE(progress.completedFiles(), quint64(4));
+
+        progress.reset();
+        QCOMPARE(progress.completedSize(), quint64(0));
+        QVERIFY(progress.currentItems().isEmpty());
+    }
+
+    // Copies of the current items are not affected by later updates
+    void testCurrentItemsSnapshot()
+    {
+        ProgressInfo progress;
+        const auto a = makeItem("a", 100);
+        const auto b = makeItem("b", 100);
+        progress.adjustTotalsForFile(a);
+        progress.adjustTotalsForFile(b);
+        progress.setProgressItem(a, 10);
+        progress.setProgressItem(b, 20);
+
+        const auto snapshot = progress.currentItems();
+        progress.setProgressItem(a, 90);
+        progress.setProgressComplete(b);
+
+        QCOMPARE(snapshot.size(), 2);
+        QCOMPARE(snapshot.at(0)._item._file, QString("a"));
+        QCOMPARE(snapshot.at(0)._progress.completed(), quint64(10));
+        QCOMPARE(progress.currentItems().size(), 1);
+        QCOMPARE(progress.currentItems().at(0)._progress.completed(), quint64(90));
+        QCOMPARE(progress.fileProgress(a).estimatedEta, quint64(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestProgressInfo)
+#include "testprogressinfo.moc"
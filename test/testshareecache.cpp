@@ -0,0 +1,272 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "sharee.h"
+#include "shareecache.h"
+
+using namespace OCC;
+
+class FakeShareeReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    FakeShareeReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &body, QObject *parent)
+        : QNetworkReply{ parent }
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+        _payload.setData(body);
+        _payload.open(QIODevice::ReadOnly);
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond()
+    {
+        if (aborted)
+            return;
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+        emit metaDataChanged();
+        emit readyRead();
+        emit finished();
+    }
+
+    void abort() override
+    {
+        aborted = true;
+        setError(OperationCanceledError, "Operation canceled");
+        emit finished();
+    }
+
+    bool aborted = false;
+    qint64 bytesAvailable() const override { return _payload.bytesAvailable() + QIODevice::bytesAvailable(); }
+    qint64 readData(char *data, qint64 maxlen) override { return _payload.read(data, maxlen); }
+
+private:
+    QBuffer _payload;
+};
+
+/* An account whose server knows some users and counts the sharee searches */
+class ShareeServer
+{
+public:
+    ShareeServer(const QStringList &users)
+        : _users(users)
+    {
+        auto qnam = new FakeQNAM({});
+        qnam->setOverride([this, qnam](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (!request.url().path().endsWith("/sharees"))
+                return nullptr;
+            const QString search = QUrlQuery(request.url()).queryItemValue("search");
+            searches.append(search);
+            QJsonArray users;
+            for (const auto &user : _users) {
+                if (user.contains(search, Qt::CaseInsensitive) && users.size() < ShareeCache::resultsPerPage)
+                    users.append(QJsonObject{ { "label", user }, { "value", QJsonObject{ { "shareType", 0 }, { "shareWith", user } } } });
+            }
+            QJsonObject data{ { "users", users }, { "exact", QJsonObject{} } };
+            QJsonObject ocs{ { "meta", QJsonObject{ { "statuscode", 200 } } }, { "data", data } };
+            auto reply = new FakeShareeReply(op, request, QJsonDocument(QJsonObject{ { "ocs", ocs } }).toJson(), qnam);
+            replies.append(reply);
+            return reply;
+        });
+        account = Account::create();
+        account->setUrl(QUrl(QStringLiteral("http://example.com/owncloud/")));
+        account->setCredentials(new FakeCredentials{ qnam });
+    }
+
+    QStringList abortedSearches() const
+    {
+        QStringList result;
+        for (int i = 0; i < replies.size(); ++i) {
+            if (replies[i] && replies[i]->aborted)
+                result.append(searches[i]);
+        }
+        return result;
+    }
+
+    AccountPtr account;
+    QStringList searches;
+    QVector<QPointer<FakeShareeReply>> replies;
+
+private:
+    QStringList _users;
+};
+
+static QStringList shareWithList(const ShareeCache::ShareeList &sharees)
+{
+    QStringList result;
+    for (const auto &sharee : sharees)
+        result.append(sharee->shareWith());
+    result.sort();
+    return result;
+}
+
+class TestShareeCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        qRegisterMetaType<ShareeCache::ShareeList>("OCC::ShareeCache::ShareeList");
+    }
+
+    void init()
+    {
+        ShareeCache::timeToLive = 2 * 60 * 1000;
+    }
+
+    void testSameSearchReused()
+    {
+        ShareeServer server({ "john", "johanna", "joe", "mary" });
+        auto cache = ShareeCache::forAccount(server.account);
+        QCOMPARE(ShareeCache::forAccount(server.account), cache);
+
+        ShareeCache::ShareeList sharees;
+        QVERIFY(!cache->lookup("jo", "file", false, &sharees));
+        QSignalSpy spy(cache, &ShareeCache::shareesFetched);
+        cache->fetch("jo", "file", false);
+        QVERIFY(spy.wait());
+        QCOMPARE(server.searches, QStringList{ "jo" });
+
+        QVERIFY(cache->lookup("jo", "file", false, &sharees));
+        QCOMPARE(shareWithList(sharees), QStringList({ "joe", "johanna", "john" }));
+
+        // Not for other item types or lookup modes
+        QVERIFY(!cache->lookup("jo", "folder", false, &sharees));
+        QVERIFY(!cache->lookup("jo", "file", true, &sharees));
+    }
+
+    void testLongerSearchAsksServer()
+    {
+        // The server may match on attributes the client doesn't see, so a
+        // longer search is never filtered from the result of a shorter one
+        ShareeServer server({ "john", "johanna", "joe" });
+        auto cache = ShareeCache::forAccount(server.account);
+
+        QSignalSpy spy(cache, &ShareeCache::shareesFetched);
+        cache->fetch("jo", "file", false);
+        QVERIFY(spy.wait());
+
+        ShareeCache::ShareeList sharees;
+        QVERIFY(!cache->lookup("joh", "file", false, &sharees));
+        QVERIFY(!cache->lookup("jo@example.com", "file", false, &sharees));
+        cache->fetch("joh", "file", false);
+        QVERIFY(spy.wait());
+        QCOMPARE(server.searches, QStringList({ "jo", "joh" }));
+        QCOMPARE(shareWithList(spy.last()[3].value<ShareeCache::ShareeList>()), QStringList({ "johanna", "john" }));
+    }
+
+    void testRunningSearchIsJoined()
+    {
+        ShareeServer server({ "john", "johanna", "joe" });
+        auto cache = ShareeCache::forAccount(server.account);
+
+        QSignalSpy spy(cache, &ShareeCache::shareesFetched);
+        cache->fetch("jo", "file", false);
+        cache->fetch("jo", "file", false);
+        QVERIFY(spy.wait());
+        QCOMPARE(server.searches, QStringList{ "jo" });
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy[0][0].toString(), QString("jo"));
+
+        // A different search doesn't wait for the running one
+        cache->fetch("jo", "folder", false);
+        cache->fetch("joh", "folder", false);
+        QTRY_COMPARE(spy.count(), 3);
+        QCOMPARE(server.searches, QStringList({ "jo", "jo", "joh" }));
+    }
+
+    void testExpiry()
+    {
+        ShareeServer server({ "john" });
+        auto cache = ShareeCache::forAccount(server.account);
+        ShareeCache::timeToLive = 50;
+
+        QSignalSpy spy(cache, &ShareeCache::shareesFetched);
+        cache->fetch("jo", "file", false);
+        QVERIFY(spy.wait());
+        ShareeCache::ShareeList sharees;
+        QVERIFY(cache->lookup("jo", "file", false, &sharees));
+
+        QTest::qWait(100);
+        QVERIFY(!cache->lookup("jo", "file", false, &sharees));
+    }
+
+    void testModelUsesCache()
+    {
+        ShareeServer server({ "john", "johanna", "joe" });
+        ShareeModel model(server.account, "file");
+        QSignalSpy ready(&model, &ShareeModel::shareesReady);
+
+        ShareeModel::ShareeSet blacklist;
+        blacklist << QSharedPointer<Sharee>(new Sharee("johanna", "", Sharee::User));
+        model.fetch("jo", blacklist, ShareeModel::LocalSearch);
+        QVERIFY(ready.wait());
+        QCOMPARE(model.rowCount(), 2);
+
+        model.fetch("joh", blacklist, ShareeModel::LocalSearch);
+        QVERIFY(ready.wait());
+        QCOMPARE(model.rowCount(), 1);
+        QCOMPARE(model.getSharee(0)->shareWith(), QString("john"));
+
+        // Going back to the previous search is answered without asking the server
+        model.fetch("jo", blacklist, ShareeModel::LocalSearch);
+        QCOMPARE(ready.count(), 3);
+        QCOMPARE(model.rowCount(), 2);
+        QCOMPARE(server.searches, QStringList({ "jo", "joh" }));
+    }
+
+    void testSupersededSearchIsAborted()
+    {
+        ShareeServer server({ "john", "johanna", "joe" });
+        ShareeModel model(server.account, "file");
+        QSignalSpy ready(&model, &ShareeModel::shareesReady);
+
+        // The user typed on before the first search finished
+        model.fetch("jo", {}, ShareeModel::LocalSearch);
+        model.fetch("joh", {}, ShareeModel::LocalSearch);
+        QVERIFY(ready.wait());
+        QCOMPARE(server.searches, QStringList({ "jo", "joh" }));
+        QCOMPARE(server.abortedSearches(), QStringList{ "jo" });
+        QCOMPARE(model.rowCount(), 2);
+
+        // Nothing was cached for the aborted search
+        ShareeCache::ShareeList sharees;
+        QVERIFY(!ShareeCache::forAccount(server.account)->lookup("jo", "file", false, &sharees));
+
+        // The same search is joined, not aborted
+        model.fetch("j", {}, ShareeModel::LocalSearch);
+        model.fetch("j", {}, ShareeModel::LocalSearch);
+        QVERIFY(ready.wait());
+        QCOMPARE(server.searches, QStringList({ "jo", "joh", "j" }));
+        QCOMPARE(server.abortedSearches(), QStringList{ "jo" });
+    }
+
+    void testSearchOfAnotherModelIsNotAborted()
+    {
+        ShareeServer server({ "john", "johanna", "joe" });
+        ShareeModel first(server.account, "file");
+        ShareeModel second(server.account, "file");
+        QSignalSpy secondReady(&second, &ShareeModel::shareesReady);
+
+        first.fetch("jo", {}, ShareeModel::LocalSearch);
+        second.fetch("jo", {}, ShareeModel::LocalSearch);
+        first.fetch("joh", {}, ShareeModel::LocalSearch);
+        QVERIFY(secondReady.wait());
+        QCOMPARE(second.rowCount(), 3);
+        QCOMPARE(server.searches, QStringList({ "jo", "joh" }));
+        QVERIFY(server.abortedSearches().isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestShareeCache)
+#include "testshareecache.moc"
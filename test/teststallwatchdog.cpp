@@ -0,0 +1,183 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "stallwatchdog.h"
+#include "syncenginetestutils.h"
+#include "networkjobs.h"
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+/* Measures its own event dispatches, like Application::notify() does */
+class SlowReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    StallWatchdog *watchdog = nullptr;
+
+    bool event(QEvent *event) override
+    {
+        StallWatchdog::Dispatch dispatch(watchdog, this, event);
+        return QObject::event(event);
+    }
+
+public slots:
+    void slowSlot() { QThread::msleep(100); }
+};
+
+class Pinger : public QObject
+{
+    Q_OBJECT
+signals:
+    void ping();
+    void pong();
+};
+
+class TestStallWatchdog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testStallAttribution()
+    {
+        StallWatchdog watchdog(50ms);
+        QSignalSpy stallSpy(&watchdog, &StallWatchdog::stallDetected);
+
+        QObject receiver;
+        receiver.setObjectName("slowReceiver");
+        QTimerEvent event(1);
+
+        // A fast dispatch is not reported
+        {
+            StallWatchdog::Dispatch dispatch(&watchdog, &receiver, &event);
+        }
+        QCOMPARE(stallSpy.count(), 0);
+
+        {
+            StallWatchdog::Dispatch dispatch(&watchdog, &receiver, &event);
+            QThread::msleep(100);
+        }
+        QCOMPARE(stallSpy.count(), 1);
+        QCOMPARE(stallSpy.first().at(0).toString(), QString("QObject(slowReceiver) handling Timer"));
+        QVERIFY(stallSpy.first().at(1).toLongLong() >= 100);
+        QCOMPARE(watchdog.stallCount(), quint64(1));
+        QVERIFY(watchdog.summary().join('\n').contains("culprit: QObject count=1"));
+    }
+
+    // Time spent in nested dispatches is not counted for the outer one
+    void testNestedDispatch()
+    {
+        StallWatchdog watchdog(50ms);
+        QSignalSpy stallSpy(&watchdog, &StallWatchdog::stallDetected);
+
+        QObject outer;
+        QTimer inner;
+        QEvent userEvent(QEvent::User);
+        QTimerEvent timerEvent(1);
+        {
+            StallWatchdog::Dispatch outerDispatch(&watchdog, &outer, &userEvent);
+            for (int i = 0; i < 4; ++i) {
+                StallWatchdog::Dispatch innerDispatch(&watchdog, &inner, &timerEvent);
+                QThread::msleep(30);
+            }
+        }
+        QCOMPARE(stallSpy.count(), 0);
+
+        {
+            StallWatchdog::Dispatch outerDispatch(&watchdog, &outer, &userEvent);
+            {
+                StallWatchdog::Dispatch innerDispatch(&watchdog, &inner, &timerEvent);
+                QThread::msleep(80);
+            }
+        }
+        QCOMPARE(stallSpy.count(), 1);
+        QCOMPARE(stallSpy.first().at(0).toString(), QString("QTimer handling Timer"));
+    }
+
+    // Queued calls name the slot and the signal that queued them
+    void testQueuedCallAttribution()
+    {
+        StallWatchdog watchdog(50ms);
+        QSignalSpy stallSpy(&watchdog, &StallWatchdog::stallDetected);
+
+        SlowReceiver receiver;
+        receiver.watchdog = &watchdog;
+        Pinger pinger;
+        connect(&pinger, &Pinger::ping, &receiver, &SlowReceiver::slowSlot, Qt::QueuedConnection);
+        connect(&pinger, &Pinger::pong, &receiver, [&receiver] { receiver.slowSlot(); }, Qt::QueuedConnection);
+
+        emit pinger.ping();
+        QTRY_COMPARE(stallSpy.count(), 1);
+        QCOMPARE(stallSpy.last().at(0).toString(), QString("SlowReceiver handling MetaCall of slowSlot() from Pinger::ping()"));
+        QVERIFY(watchdog.summary().join('\n').contains("culprit: SlowReceiver::slowSlot() count=1"));
+
+        // A lambda has no method, the signal still tells where the call came from
+        emit pinger.pong();
+        QTRY_COMPARE(stallSpy.count(), 2);
+        QCOMPARE(stallSpy.last().at(0).toString(), QString("SlowReceiver handling MetaCall from Pinger::pong()"));
+
+        // Invoked without a sender
+        QMetaObject::invokeMethod(&receiver, "slowSlot", Qt::QueuedConnection);
+        QTRY_COMPARE(stallSpy.count(), 3);
+        QCOMPARE(stallSpy.last().at(0).toString(), QString("SlowReceiver handling MetaCall of slowSlot()"));
+    }
+
+    // The reply classes are shared by all jobs, their job is what matters
+    void testReplyAttributedToJob()
+    {
+        auto qnam = new FakeQNAM({});
+        qnam->setOverride([qnam](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            return new FakeErrorReply(op, request, qnam, 500);
+        });
+        auto account = Account::create();
+        account->setUrl(QUrl(QStringLiteral("http://example.com/owncloud/")));
+        account->setCredentials(new FakeCredentials{ qnam });
+
+        StallWatchdog watchdog(50ms);
+        QSignalSpy stallSpy(&watchdog, &StallWatchdog::stallDetected);
+
+        auto job = new PropfindJob(account, QStringLiteral("/"), this);
+        job->setProperties({ "getetag" });
+        job->start();
+        QVERIFY(job->reply());
+        QTimerEvent event(1);
+        {
+            StallWatchdog::Dispatch dispatch(&watchdog, job->reply(), &event);
+            QThread::msleep(100);
+        }
+        QCOMPARE(stallSpy.count(), 1);
+        QCOMPARE(stallSpy.first().at(0).toString(), QString("FakeErrorReply handling Timer for OCC::PropfindJob"));
+        QVERIFY(watchdog.summary().join('\n').contains("culprit: OCC::PropfindJob count=1"));
+        job->deleteLater();
+    }
+
+    // Dispatches on other threads are ignored
+    void testOtherThread()
+    {
+        StallWatchdog watchdog(10ms);
+        QSignalSpy stallSpy(&watchdog, &StallWatchdog::stallDetected);
+
+        QObject receiver;
+        QTimerEvent event(1);
+        QThread thread;
+        QObject worker;
+        worker.moveToThread(&thread);
+        connect(&thread, &QThread::started, &worker, [&] {
+            StallWatchdog::Dispatch dispatch(&watchdog, &receiver, &event);
+            QThread::msleep(30);
+            thread.quit();
+        });
+        thread.start();
+        QVERIFY(thread.wait(5000));
+        QCOMPARE(stallSpy.count(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestStallWatchdog)
+#include "teststallwatchdog.moc"
@@ -715,6 +715,51 @@ private slots:
         QTextCodec::setCodecForLocale(utf8Locale);
 #endif
     }
+
+    // Prioritized paths are propagated before the other items
+    void testPrioritizePath()
+    {
+        FakeFolder fakeFolder{ FileInfo{} };
+        SyncOptions syncOptions;
+        syncOptions._parallelNetworkJobs = false;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        auto addRemoteFiles = [&](const QString &dir) {
+            fakeFolder.remoteModifier().mkdir(dir);
+            for (int i = 0; i < 10; ++i)
+                fakeFolder.remoteModifier().insert(QString("%1/file%2").arg(dir).arg(i));
+        };
+        QStringList completed;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted, [&](const SyncFileItemPtr &item) {
+            if (item->_type == ItemTypeFile)
+                completed.append(item->_file);
+        });
+
+        // Before the sync starts
+        addRemoteFiles("A");
+        addRemoteFiles("B");
+        fakeFolder.syncEngine().prioritizePath("B/file5");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(completed.size(), 20);
+        QCOMPARE(completed.first(), QString("B/file5"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // While propagating: the whole subtree goes before the rest of C
+        addRemoteFiles("C");
+        addRemoteFiles("D");
+        completed.clear();
+        auto con = connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted, [&](const SyncFileItemPtr &item) {
+            if (item->_file == "C/file0")
+                fakeFolder.syncEngine().prioritizePath("D");
+        });
+        QVERIFY(fakeFolder.syncOnce());
+        disconnect(con);
+        QCOMPARE(completed.size(), 20);
+        QCOMPARE(completed.at(0), QString("C/file0"));
+        for (int i = 1; i <= 10; ++i)
+            QVERIFY(completed.at(i).startsWith("D/"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncEngine)
@@ -170,6 +170,56 @@ private slots:
         QVERIFY(!wipedRecord._valid);
     }
 
+    void testBlockManifest()
+    {
+        using Manifest = SyncJournalDb::BlockManifest;
+        Manifest manifest = _db.getBlockManifest("nonexistant");
+        QVERIFY(!manifest._valid);
+
+        manifest._etag = "ABCDEF";
+        manifest._size = 3 * 1024 * 1024;
+        manifest._blockSize = 1024 * 1024;
+        // Raw digests, including zero bytes
+        manifest._blockHashes = QByteArray(20, '\0') + QByteArray(20, 'x') + QByteArray(20, '\xff');
+        manifest._valid = true;
+        _db.setBlockManifest("foo", manifest);
+
+        Manifest stored = _db.getBlockManifest("foo");
+        QVERIFY(stored._valid);
+        QCOMPARE(stored._etag, manifest._etag);
+        QCOMPARE(stored._size, manifest._size);
+        QCOMPARE(stored._blockSize, manifest._blockSize);
+        QCOMPARE(stored._blockHashes, manifest._blockHashes);
+
+        _db.setBlockManifest("foo", Manifest());
+        QVERIFY(!_db.getBlockManifest("foo")._valid);
+    }
+
+    void testSyncPlan()
+    {
+        QVERIFY(_db.syncPlanHeader().isEmpty());
+        QVERIFY(_db.pendingSyncPlanItems().isEmpty());
+
+        _db.setSyncPlan("header", { "item0", "item1", QByteArray("item\0two", 9) });
+        QCOMPARE(_db.syncPlanHeader(), QByteArray("header"));
+        _db.setSyncPlanItemDone(1);
+        auto pending = _db.pendingSyncPlanItems();
+        QCOMPARE(pending.size(), 2);
+        QCOMPARE(pending[0].first, 0);
+        QCOMPARE(pending[0].second, QByteArray("item0"));
+        QCOMPARE(pending[1].first, 2);
+        QCOMPARE(pending[1].second, QByteArray("item\0two", 9));
+
+        // A new plan replaces the old one
+        _db.setSyncPlan("other", { "new" });
+        QCOMPARE(_db.syncPlanHeader(), QByteArray("other"));
+        QCOMPARE(_db.pendingSyncPlanItems().size(), 1);
+
+        _db.clearSyncPlan();
+        QVERIFY(_db.syncPlanHeader().isEmpty());
+        QVERIFY(_db.pendingSyncPlanItems().isEmpty());
+    }
+
     void testNumericId()
     {
         SyncJournalFileRecord record;
@@ -320,6 +370,66 @@ private slots:
         QVERIFY(checkElements());
     }
 
+    void testDeleteStaleEntries()
+    {
+        auto makeDownloadInfo = [&](const QString &path) {
+            SyncJournalDb::DownloadInfo info;
+            info._tmpfile = path + ".tmp";
+            info._etag = "etag";
+            info._valid = true;
+            _db.setDownloadInfo(path, info);
+        };
+        auto makeUploadInfo = [&](const QString &path, uint transferId) {
+            SyncJournalDb::UploadInfo info;
+            info._transferid = transferId;
+            info._modtime = 1500000000;
+            info._valid = true;
+            _db.setUploadInfo(path, info);
+        };
+        auto makeBlacklistEntry = [&](const QString &path) {
+            SyncJournalErrorBlacklistRecord record;
+            record._file = path;
+            record._errorString = "error";
+            record._lastTryEtag = "etag";
+            record._lastTryTime = 1500000000;
+            record._ignoreDuration = 3600;
+            _db.setErrorBlacklistEntry(record);
+        };
+
+        makeDownloadInfo("down/keep");
+        makeDownloadInfo("down/stale");
+        makeUploadInfo("up/keep", 11);
+        makeUploadInfo("up/stale", 12);
+        makeBlacklistEntry("black/keep");
+        makeBlacklistEntry("black/stale");
+
+        // A path kept for one table doesn't keep the entries of another one
+        SyncJournalDb::StaleEntryKeepList keep;
+        keep.downloadInfos << "down/keep" << "up/stale";
+        keep.uploadInfos << "up/keep" << "down/stale";
+        keep.errorBlacklist << "black/keep" << "black/keep";
+        auto stale = _db.deleteStaleEntries(keep);
+
+        QCOMPARE(stale.downloadInfos.size(), 1);
+        QCOMPARE(stale.downloadInfos[0]._tmpfile, QString("down/stale.tmp"));
+        QCOMPARE(stale.uploadTransferIds, QVector<uint>{ 12 });
+
+        QVERIFY(_db.getDownloadInfo("down/keep")._valid);
+        QVERIFY(!_db.getDownloadInfo("down/stale")._valid);
+        QVERIFY(_db.getUploadInfo("up/keep")._valid);
+        QVERIFY(!_db.getUploadInfo("up/stale")._valid);
+        QVERIFY(_db.errorBlacklistEntry("black/keep").isValid());
+        QVERIFY(!_db.errorBlacklistEntry("black/stale").isValid());
+
+        // Nothing kept removes everything
+        stale = _db.deleteStaleEntries({});
+        QCOMPARE(stale.downloadInfos.size(), 1);
+        QCOMPARE(stale.uploadTransferIds, QVector<uint>{ 11 });
+        QVERIFY(!_db.getDownloadInfo("down/keep")._valid);
+        QVERIFY(!_db.getUploadInfo("up/keep")._valid);
+        QVERIFY(!_db.errorBlacklistEntry("black/keep").isValid());
+    }
+
 private:
     SyncJournalDb _db;
 };
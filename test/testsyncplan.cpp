@@ -0,0 +1,185 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+struct RequestCounter
+{
+    int propfinds = 0;
+    QStringList gets;
+
+    FakeQNAM::Override override()
+    {
+        return [this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "PROPFIND")
+                ++propfinds;
+            if (op == QNetworkAccessManager::GetOperation)
+                gets.append(request.url().path().section('/', -1));
+            return nullptr;
+        };
+    }
+};
+
+static void setSyncPlanOptions(FakeFolder &fakeFolder, int minimumItems = 1)
+{
+    SyncOptions options;
+    options._syncPlanMinimumItems = minimumItems;
+    options._parallelNetworkJobs = false;
+    fakeFolder.syncEngine().setSyncOptions(options);
+}
+
+static void setupSyncPlan(FakeFolder &fakeFolder, int minimumItems = 1)
+{
+    setSyncPlanOptions(fakeFolder, minimumItems);
+
+    fakeFolder.remoteModifier().mkdir("D");
+    for (int i = 0; i < 20; ++i)
+        fakeFolder.remoteModifier().insert(QString("D/file%1").arg(i));
+}
+
+// Runs a sync that is aborted after some downloads completed
+static bool syncAndAbort(FakeFolder &fakeFolder, int downloads)
+{
+    int completed = 0;
+    auto con = QObject::connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted,
+        [&](const SyncFileItemPtr &item) {
+            if (item->_type == ItemTypeFile && item->_status == SyncFileItem::Success && ++completed == downloads)
+                fakeFolder.syncEngine().abort();
+        });
+    bool ok = fakeFolder.syncOnce();
+    QObject::disconnect(con);
+    return !ok && completed >= downloads;
+}
+
+// The client is stopped after the abort: only the journal is left
+static void restartClient(FakeFolder &fakeFolder, int minimumItems = 1)
+{
+    fakeFolder.restartEngine();
+    setSyncPlanOptions(fakeFolder, minimumItems);
+}
+
+static int localFileCount(FakeFolder &fakeFolder, const QString &dir)
+{
+    auto info = fakeFolder.currentLocalState().find(dir);
+    return info ? info->children.size() : 0;
+}
+
+class TestSyncPlan : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testResumeWithoutDiscovery()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupSyncPlan(fakeFolder);
+
+        QVERIFY(syncAndAbort(fakeFolder, 5));
+        const int downloaded = localFileCount(fakeFolder, "D");
+        QVERIFY(downloaded >= 5 && downloaded < 20);
+        restartClient(fakeFolder);
+
+        // Only the root etag is checked and the remaining files are downloaded
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(counter.propfinds, 1);
+        QCOMPARE(counter.gets.size(), 20 - downloaded);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.syncEngine().isAnotherSyncNeeded(), ImmediateFollowUp);
+
+        // The regular follow-up sync finds nothing left to do
+        counter = RequestCounter();
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(counter.propfinds > 1);
+        QCOMPARE(counter.gets.size(), 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.syncEngine().isAnotherSyncNeeded(), NoFollowUpSync);
+    }
+
+    // A server change since the plan was made requires a new discovery
+    void testRemoteChange()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupSyncPlan(fakeFolder);
+
+        QVERIFY(syncAndAbort(fakeFolder, 5));
+        restartClient(fakeFolder);
+        fakeFolder.remoteModifier().mkdir("E");
+        fakeFolder.remoteModifier().insert("E/new");
+
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(counter.propfinds > 1);
+        QVERIFY(counter.gets.contains("new"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.syncEngine().isAnotherSyncNeeded(), NoFollowUpSync);
+    }
+
+    void testLocalChangeDropsItem_data()
+    {
+        QTest::addColumn<bool>("restart");
+        QTest::newRow("changed while the client was stopped") << true;
+        QTest::newRow("reported by the folder watcher") << false;
+    }
+
+    // Items whose local file changed are left to the follow-up sync
+    void testLocalChangeDropsItem()
+    {
+        QFETCH(bool, restart);
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupSyncPlan(fakeFolder);
+
+        QVERIFY(syncAndAbort(fakeFolder, 5));
+        QVERIFY(!fakeFolder.currentLocalState().find("D/file9"));
+        fakeFolder.localModifier().insert("D/file9", 64, 'L');
+        if (restart) {
+            // Nothing watched the folder, every item is checked
+            restartClient(fakeFolder);
+        } else {
+            fakeFolder.syncEngine().setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem, { "D/file9" });
+        }
+
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(counter.propfinds, 1);
+        QVERIFY(!counter.gets.contains("file9"));
+        QCOMPARE(fakeFolder.currentLocalState().find("D/file9")->contentChar, 'L');
+        QCOMPARE(fakeFolder.syncEngine().isAnotherSyncNeeded(), ImmediateFollowUp);
+
+        // The follow-up sync handles it as a regular conflict
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState().find("D/file9")->contentChar, 'W');
+    }
+
+    // Small sync runs don't store a plan
+    void testMinimumItems()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        setupSyncPlan(fakeFolder, 100);
+
+        QVERIFY(syncAndAbort(fakeFolder, 5));
+        QVERIFY(fakeFolder.syncJournal().syncPlanHeader().isEmpty());
+        restartClient(fakeFolder, 100);
+
+        RequestCounter counter;
+        fakeFolder.setServerOverride(counter.override());
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(counter.propfinds > 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSyncPlan)
+#include "testsyncplan.moc"
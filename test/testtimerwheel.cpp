@@ -0,0 +1,100 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "timerwheel.h"
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+class TestTimerWheel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testCoalescing()
+    {
+        auto wheel = TimerWheel::instance();
+        CoalescedTimer first;
+        CoalescedTimer second;
+        QSignalSpy firstSpy(&first, &CoalescedTimer::timeout);
+        QSignalSpy secondSpy(&second, &CoalescedTimer::timeout);
+
+        // The first timer may fire up to 100ms late, the second is due within that
+        const auto wakeupsBefore = wheel->totalWakeups();
+        first.start(400ms);
+        second.start(450ms);
+        QCOMPARE(wheel->activeTimers(), 2);
+
+        QVERIFY(secondSpy.wait(2000));
+        QCOMPARE(firstSpy.count(), 1);
+        QCOMPARE(secondSpy.count(), 1);
+        QCOMPARE(wheel->totalWakeups() - wakeupsBefore, qint64(1));
+
+        // Both restarted at the same time and stay aligned
+        QVERIFY(secondSpy.wait(2000));
+        QCOMPARE(firstSpy.count(), 2);
+        QCOMPARE(wheel->totalWakeups() - wakeupsBefore, qint64(2));
+        QVERIFY(wheel->wakeupsPerMinute() >= 2);
+    }
+
+    void testSingleShotAndStop()
+    {
+        auto wheel = TimerWheel::instance();
+        CoalescedTimer singleShot;
+        singleShot.setSingleShot(true);
+        CoalescedTimer stopped;
+        QSignalSpy singleShotSpy(&singleShot, &CoalescedTimer::timeout);
+        QSignalSpy stoppedSpy(&stopped, &CoalescedTimer::timeout);
+
+        singleShot.start(50ms);
+        stopped.start(50ms);
+        QVERIFY(stopped.remainingTime() > 0 && stopped.remainingTime() <= 50);
+        stopped.stop();
+        QVERIFY(!stopped.isActive());
+        QCOMPARE(stopped.remainingTime(), -1);
+
+        QVERIFY(singleShotSpy.wait(1000));
+        QVERIFY(!singleShot.isActive());
+        QTest::qWait(200);
+        QCOMPARE(singleShotSpy.count(), 1);
+        QCOMPARE(stoppedSpy.count(), 0);
+        QCOMPARE(wheel->activeTimers(), 0);
+    }
+
+    void testDeleteFromHandler()
+    {
+        CoalescedTimer first;
+        auto second = new CoalescedTimer;
+        QSignalSpy firstSpy(&first, &CoalescedTimer::timeout);
+        connect(&first, &CoalescedTimer::timeout, this, [&second] {
+            delete second;
+            second = nullptr;
+        });
+
+        // Both are due in the same wakeup, the second is gone before its turn
+        first.setSingleShot(true);
+        first.start(50ms);
+        second->start(50ms);
+        QVERIFY(firstSpy.wait(1000));
+        QVERIFY(!second);
+        QCOMPARE(TimerWheel::instance()->activeTimers(), 0);
+    }
+
+    void testSlack()
+    {
+        CoalescedTimer timer;
+        timer.setInterval(4000ms);
+        QCOMPARE(timer.slack(), qint64(1000));
+        timer.setInterval(10min);
+        QCOMPARE(timer.slack(), qint64(30000));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTimerWheel)
+#include "testtimerwheel.moc"
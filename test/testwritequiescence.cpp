@@ -0,0 +1,121 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+static QByteArray journalEtag(FakeFolder &folder, const QString &path)
+{
+    SyncJournalFileRecord rec;
+    folder.syncJournal().getFileRecord(path, &rec);
+    return rec._etag;
+}
+
+class TestWriteQuiescence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void testOpenWriterDefersUpload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto &tracker = fakeFolder.syncEngine().writeQuiescenceTracker();
+        tracker.setSampleInterval(50ms);
+        QSignalSpy quiescentSpy(&tracker, &WriteQuiescenceTracker::fileBecameQuiescent);
+
+        const auto initialEtag = journalEtag(fakeFolder, "A");
+        QVERIFY(!initialEtag.isEmpty());
+
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted);
+        fakeFolder.localModifier().insert("A/new", 1000);
+        fakeFolder.remoteModifier().appendByte("A/a2");
+        tracker.slotFileWritten("A/new");
+        QVERIFY(!fakeFolder.syncOnce());
+        QVERIFY(!fakeFolder.currentRemoteState().find("A/new"));
+        SyncFileItemPtr item;
+        for (const auto &args : qAsConst(completeSpy)) {
+            auto completed = args.first().value<SyncFileItemPtr>();
+            if (completed->_file == "A/new")
+                item = completed;
+        }
+        QVERIFY(item);
+        QCOMPARE(item->_status, SyncFileItem::SoftError);
+        QVERIFY(!item->_errorString.isEmpty());
+        QVERIFY(!fakeFolder.syncJournal().errorBlacklistEntry("A/new").isValid());
+        // The directory isn't recorded as up to date with the server
+        QCOMPARE(journalEtag(fakeFolder, "A"), initialEtag);
+        QCOMPARE(tracker.deferredUploads(), 1);
+        QCOMPARE(tracker.wastedBytesAvoided(), 1000);
+
+        // Nothing is reported while the writer has the file open
+        QVERIFY(!quiescentSpy.wait(200));
+
+        tracker.slotFileClosed("A/new");
+        QVERIFY(quiescentSpy.wait());
+        QCOMPARE(quiescentSpy.first().first().toString(), QString("A/new"));
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(tracker.deferredUploads(), 1);
+        QVERIFY(journalEtag(fakeFolder, "A") != initialEtag);
+    }
+
+    // Without write events the size and mtime are sampled
+    void testGrowingFileDefersUpload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto &tracker = fakeFolder.syncEngine().writeQuiescenceTracker();
+        tracker.setSampleInterval(50ms);
+        QSignalSpy quiescentSpy(&tracker, &WriteQuiescenceTracker::fileBecameQuiescent);
+
+        tracker.slotFileChanged("A/a1");
+        fakeFolder.localModifier().appendByte("A/a1");
+        fakeFolder.syncOnce();
+        QCOMPARE(tracker.deferredUploads(), 1);
+        QVERIFY(fakeFolder.currentLocalState() != fakeFolder.currentRemoteState());
+
+        QVERIFY(quiescentSpy.wait());
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    // A changed file that stopped changing before the sync is uploaded directly
+    void testStableFileIsUploaded()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto &tracker = fakeFolder.syncEngine().writeQuiescenceTracker();
+
+        fakeFolder.localModifier().appendByte("A/a1");
+        tracker.slotFileChanged("A/a1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(tracker.deferredUploads(), 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    // A writer that stays silent for too long is no longer waited for
+    void testOpenWriterTimeout()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        auto &tracker = fakeFolder.syncEngine().writeQuiescenceTracker();
+        tracker.setOpenWriterTimeout(1ms);
+
+        fakeFolder.localModifier().insert("A/new");
+        tracker.slotFileWritten("A/new");
+        QTest::qWait(20);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(tracker.deferredUploads(), 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestWriteQuiescence)
+#include "testwritequiescence.moc"
@@ -613,6 +613,90 @@ private slots:
         QVERIFY(_subdirs.size() == 1);
     }
 
+    void testParserChunked() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004213ocobzus5kn6s</oc:id>"
+              "<oc:permissions>RDNVCK</oc:permissions>"
+              "<oc:size>121780</oc:size>"
+              "<d:getetag>\"5527beb0400b0\"</d:getetag>"
+              "<d:resourcetype>"
+              "<d:collection/>"
+              "</d:resourcetype>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/%C3%A4.pdf</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004215ocobzus5kn6s</oc:id>"
+              "<oc:checksums><oc:checksum>SHA1:\xc3\xa4" "bc MD5:123</oc:checksum></oc:checksums>"
+              "<d:resourcetype/>"
+              "<d:getcontentlength>121780</d:getcontentlength>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:downloadURL/>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 404 Not Found</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "</d:multistatus>";
+        const QString expectedPath = "/oc/remote.php/webdav/sharefolder";
+
+        using Results = QList<QPair<QString, QMap<QString, QString>>>;
+        Results wholeResults;
+        QHash<QString, ExtraFolderInfo> wholeSizes;
+        {
+            LsColXMLParser parser;
+            connect(&parser, &LsColXMLParser::directoryListingIterated, [&](const QString &item, const QMap<QString, QString> &props) {
+                wholeResults.append(qMakePair(item, props));
+            });
+            QVERIFY(parser.parse(testXml, &wholeSizes, expectedPath));
+        }
+        QCOMPARE(wholeResults.size(), 2);
+        QCOMPARE(wholeResults[1].first, QString::fromUtf8("/oc/remote.php/webdav/sharefolder/\xc3\xa4.pdf"));
+        QCOMPARE(wholeResults[1].second.value("checksums"),
+            QString::fromUtf8("<checksum>SHA1:\xc3\xa4" "bc MD5:123</checksum>"));
+
+        // Byte by byte, splitting tags, text and utf8 sequences, gives the same result
+        LsColXMLParser parser;
+        connect( &parser, SIGNAL(directoryListingSubfolders(const QStringList&)),
+                 this, SLOT(slotDirectoryListingSubFolders(const QStringList&)) );
+        connect( &parser, SIGNAL(finishedWithoutError()),
+                 this, SLOT(slotFinishedSuccessfully()) );
+        Results results;
+        connect(&parser, &LsColXMLParser::directoryListingIterated, [&](const QString &item, const QMap<QString, QString> &props) {
+            results.append(qMakePair(item, props));
+        });
+        QHash<QString, ExtraFolderInfo> sizes;
+        parser.start(&sizes, expectedPath);
+        for (int i = 0; i < testXml.size(); ++i)
+            QVERIFY(parser.addData(testXml.mid(i, 1)));
+        QVERIFY(!_success);
+        QVERIFY(parser.finish());
+        QVERIFY(_success);
+        QCOMPARE(results, wholeResults);
+        QCOMPARE(_subdirs, QStringList(expectedPath + "/"));
+        QCOMPARE(sizes.size(), wholeSizes.size());
+        QCOMPARE(sizes[expectedPath + "/"].size, 121780);
+
+        // A reply that ends early is an error
+        _success = false;
+        parser.start(&sizes, expectedPath);
+        QVERIFY(parser.addData(testXml.left(testXml.size() / 2)));
+        QVERIFY(!parser.finish());
+        QVERIFY(!_success);
+    }
+
 };
 
     QTEST_GUILESS_MAIN(TestXmlParse)